@@ -30,6 +30,23 @@ ApplyHangingProtocolQViewerCommand::ApplyHangingProtocolQViewerCommand(Q2DViewer
     m_displaySet = displaySet;
 }
 
+int ApplyHangingProtocolQViewerCommand::getSliceToDisplay() const
+{
+    // With a reconstruction the slice isn't in the acquisition plane
+    if (!m_displaySet->getReconstruction().isEmpty())
+    {
+        return -1;
+    }
+    else if (m_displaySet->getSliceModifiedForVolumes() != -1)
+    {
+        return m_displaySet->getSliceModifiedForVolumes();
+    }
+    else
+    {
+        return m_displaySet->getSlice();
+    }
+}
+
 void ApplyHangingProtocolQViewerCommand::execute()
 {
     // HACK Així evitem el bug del ticket 1249 i tenim el mateix comportament que abans
@@ -32,6 +32,8 @@ Q_OBJECT
 public:
     ApplyHangingProtocolQViewerCommand(Q2DViewerWidget *viewer, HangingProtocolDisplaySet *displaySet, QObject *parent = 0);
 
+    virtual int getSliceToDisplay() const;
+
 public slots:
     void execute();
 
@@ -34,6 +34,20 @@ ChangeSliceQViewerCommand::ChangeSliceQViewerCommand(Q2DViewer *viewer, int slic
     m_customSliceNumber = slice;
 }
 
+int ChangeSliceQViewerCommand::getSliceToDisplay() const
+{
+    switch (m_slicePosition)
+    {
+        case MinimumSlice:
+            return 0;
+        case CustomSlice:
+            return qMax(m_customSliceNumber, 0);
+        default:
+            // Depends on the number of slices of the volume
+            return -1;
+    }
+}
+
 void ChangeSliceQViewerCommand::execute()
 {
     switch (m_slicePosition)
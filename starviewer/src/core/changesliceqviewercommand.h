@@ -36,6 +36,8 @@ public:
     /// la llesca assignada serà la mínima, i en cas que estigui per sobre del màxim, s'assignarà la màxima
     ChangeSliceQViewerCommand(Q2DViewer *viewer, int slice, QObject *parent = 0);
 
+    virtual int getSliceToDisplay() const;
+
 public slots:
     void execute();
 
@@ -58,6 +58,7 @@ HEADERS += extensionfactory.h \
     q2dviewer.h \
     q3dviewer.h \
     qviewer.h \
+    renderscheduler.h \
     patient.h \
     series.h \
     study.h \
@@ -111,6 +112,7 @@ HEADERS += extensionfactory.h \
     windowlevellefttool.h \
     seedtool.h \
     magicroitool.h \
+    magicroiregiongrower.h \
     rotate3dtool.h \
     screenshottool.h \
     synchronizetool.h \
@@ -183,6 +185,7 @@ HEADERS += extensionfactory.h \
     vtk4dlinearregressiongradientestimator.h \
     combiningvoxelshader.h \
     vtkVolumeRayCastSingleVoxelShaderCompositeFunction.h \
+    emptyspacemap.h \
     obscurance.h \
     viewpointgenerator.h \
     thumbnailcreator.h \
@@ -190,6 +193,7 @@ HEADERS += extensionfactory.h \
     abortrendercommand.h \
     roitool.h \
     roidata.h \
+    scanlinepolygonrasterizer.h \
     abstractroidataprinter.h \
     roidataprinter.h \
     petroidataprinter.h \
@@ -455,6 +459,7 @@ SOURCES += extensionmediator.cpp \
     q2dviewer.cpp \
     q3dviewer.cpp \
     qviewer.cpp \
+    renderscheduler.cpp \
     patient.cpp \
     series.cpp \
     study.cpp \
@@ -510,6 +515,7 @@ SOURCES += extensionmediator.cpp \
     windowlevellefttool.cpp \
     seedtool.cpp \
     magicroitool.cpp \
+    magicroiregiongrower.cpp \
     rotate3dtool.cpp \
     screenshottool.cpp \
     synchronizetool.cpp \
@@ -576,6 +582,7 @@ SOURCES += extensionmediator.cpp \
     vtk4dlinearregressiongradientestimator.cpp \
     combiningvoxelshader.cpp \
     vtkVolumeRayCastSingleVoxelShaderCompositeFunction.cxx \
+    emptyspacemap.cpp \
     obscurance.cpp \
     viewpointgenerator.cpp \
     thumbnailcreator.cpp \
@@ -583,6 +590,7 @@ SOURCES += extensionmediator.cpp \
     abortrendercommand.cpp \
     roitool.cpp \
     roidata.cpp \
+    scanlinepolygonrasterizer.cpp \
     abstractroidataprinter.cpp \
     roidataprinter.cpp \
     petroidataprinter.cpp \
@@ -65,6 +65,7 @@ const QString CoreSettings::ForcedImageReaderLibrary("Input/ForcedImageReaderLib
 const QString CoreSettings::ForceITKImageReaderForSpecifiedModalities("Input/ForceITKImageReaderForSpecifiedModalities");
 const QString CoreSettings::ForceVTKImageReaderForSpecifiedModalities("Input/ForceVTKImageReaderForSpecifiedModalities");
 const QString CoreSettings::UseItkGdcmImageReaderByDefault("Input/UseItkGdcmImageReaderByDefault");
+const QString CoreSettings::NumberOfThreadsForVtkDcmtkImageReader("Input/NumberOfThreadsForVtkDcmtkImageReader");
 
 // Release Notes
 const QString CoreSettings::LastReleaseNotesVersionShown("LastReleaseNotesVersionShown");
@@ -80,7 +81,9 @@ const QString CoreSettings::UpdateCheckUrlAdditionalParameters("UpdateCheckUrlAd
 const QString CoreSettings::MammographyAutoOrientationExceptions("MammographyAutoOrientationExceptions");
 
 const QString CoreSettings::AllowAsynchronousVolumeLoading("AllowAsynchronousVolumeLoading");
+const QString CoreSettings::AllowProgressiveVolumeLoading("AllowProgressiveVolumeLoading");
 const QString CoreSettings::MaximumNumberOfVolumesLoadingConcurrently("MaximumNumberOfVolumesLoadingConcurrently");
+const QString CoreSettings::VolumeMemoryBudgetInMegaBytes("VolumeMemoryBudgetInMegaBytes");
 
 const QString CoreSettings::MaximumNumberOfVisibleVoiLutComboItems("MaximumNumberOfVisibleVoiLutComboItems");
 
@@ -147,7 +150,10 @@ void CoreSettings::init()
 #endif
     settingsRegistry->addSetting(MammographyAutoOrientationExceptions, (QStringList() << "BAV" << "BAG" << "estereot"));
     settingsRegistry->addSetting(AllowAsynchronousVolumeLoading, true);
+    settingsRegistry->addSetting(AllowProgressiveVolumeLoading, true);
     settingsRegistry->addSetting(MaximumNumberOfVolumesLoadingConcurrently, 1);
+    settingsRegistry->addSetting(VolumeMemoryBudgetInMegaBytes, 0);
+    settingsRegistry->addSetting(NumberOfThreadsForVtkDcmtkImageReader, 0);
     settingsRegistry->addSetting(MaximumNumberOfVisibleVoiLutComboItems, 50);
     settingsRegistry->addSetting(EnableQ2DViewerSliceScrollLoop, false);
     settingsRegistry->addSetting(EnableQ2DViewerPhaseScrollLoop, false);
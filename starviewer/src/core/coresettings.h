@@ -67,6 +67,9 @@ public:
     /// If true, the ITK-GDCM image reader will be the default, instead of the new VTK-DCMTK.
     static const QString UseItkGdcmImageReaderByDefault;
 
+    /// Number of threads used by the VTK-DCMTK image reader to decode the frames of a volume. 0 means as many threads as cores; 1 means sequential decoding.
+    static const QString NumberOfThreadsForVtkDcmtkImageReader;
+
     /// La última versió comprobada de les Release Notes
     static const QString LastReleaseNotesVersionShown;
 
@@ -91,8 +94,14 @@ public:
 
     /// Indica si es pot realitzar càrrega de volums asíncrona o no
     static const QString AllowAsynchronousVolumeLoading;
+    /// If true, volumes loaded asynchronously are shown as soon as the first slice and a coarse subset of slices are read, and the rest of slices are shown
+    /// as they arrive.
+    static const QString AllowProgressiveVolumeLoading;
     /// Indica quans volums poden estar-se carregant a la vegada com a màxim.
     static const QString MaximumNumberOfVolumesLoadingConcurrently;
+    /// Maximum amount of memory in megabytes for the pixel data of the loaded volumes. When exceeded, the least recently used volumes that are not being
+    /// displayed are freed and will be read again if needed. 0 means no limit.
+    static const QString VolumeMemoryBudgetInMegaBytes;
 
     /// Defineix el nombre màxim d'ítems visibles al desplegar-se el combo de window/levels per defecte.
     /// Si tenim més presets que els que indiqui aquest setting, apareixerà un scroll vertical.
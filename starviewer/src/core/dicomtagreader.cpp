@@ -48,6 +48,9 @@ bool isEncodedText(const DcmTag &tag)
     }
 }
 
+/// Maximum length in bytes of the values read from the file when loading only metadata. Longer values are left in the file and DCMTK loads them on demand.
+const Uint32 MetadataOnlyMaxReadLength = 256;
+
 }
 
 namespace udg {
@@ -57,16 +60,16 @@ DICOMTagReader::DICOMTagReader()
     initialize();
 }
 
-DICOMTagReader::DICOMTagReader(const QString &filename, DcmDataset *dcmDataset)
+DICOMTagReader::DICOMTagReader(const QString &filename, DcmDataset *dcmDataset, LoadMode loadMode)
 {
     initialize();
-    this->setDcmDataset(filename, dcmDataset);
+    this->setDcmDataset(filename, dcmDataset, loadMode);
 }
 
-DICOMTagReader::DICOMTagReader(const QString &filename)
+DICOMTagReader::DICOMTagReader(const QString &filename, LoadMode loadMode)
 {
     initialize();
-    this->setFile(filename);
+    this->setFile(filename, loadMode);
 }
 
 DICOMTagReader::~DICOMTagReader()
@@ -94,13 +97,14 @@ void DICOMTagReader::deleteDataLastLoadedFile()
     }
 }
 
-bool DICOMTagReader::setFile(const QString &filename)
+bool DICOMTagReader::setFile(const QString &filename, LoadMode loadMode)
 {
     DcmFileFormat dicomFile;
 
     m_filename = filename;
 
-    OFCondition status = dicomFile.loadFile(qPrintable(filename));
+    Uint32 maxReadLength = loadMode == MetadataOnly ? MetadataOnlyMaxReadLength : DCM_MaxReadLength;
+    OFCondition status = dicomFile.loadFile(qPrintable(filename), EXS_Unknown, EGL_noChange, maxReadLength);
     if (status.good())
     {
         m_hasValidFile = true;
@@ -110,6 +114,11 @@ bool DICOMTagReader::setFile(const QString &filename)
         m_dicomHeader = new DcmMetaInfo(*dicomFile.getMetaInfo());
         m_dicomData = dicomFile.getAndRemoveDataset();
         initializeTextCodec();
+
+        if (loadMode == MetadataOnly)
+        {
+            releaseBulkData();
+        }
     }
     else
     {
@@ -132,7 +141,7 @@ QString DICOMTagReader::getFileName() const
     return m_filename;
 }
 
-void DICOMTagReader::setDcmDataset(const QString &filename, DcmDataset *dcmDataset)
+void DICOMTagReader::setDcmDataset(const QString &filename, DcmDataset *dcmDataset, LoadMode loadMode)
 {
     if (!dcmDataset)
     {
@@ -150,6 +159,37 @@ void DICOMTagReader::setDcmDataset(const QString &filename, DcmDataset *dcmDatas
 
     m_dicomData = dcmDataset;
     initializeTextCodec();
+
+    if (loadMode == MetadataOnly)
+    {
+        releaseBulkData();
+    }
+}
+
+void DICOMTagReader::releaseBulkData()
+{
+    if (!m_dicomData)
+    {
+        return;
+    }
+
+    QList<DcmTagKey> bulkDataTags;
+    bulkDataTags << DCM_PixelData;
+
+    // Overlay data can be in any of the 16 repeating groups 6000-601E
+    for (Uint16 group = 0x6000; group <= 0x601E; group += 2)
+    {
+        bulkDataTags << DcmTagKey(group, DCM_OverlayData.getElement());
+    }
+
+    foreach (const DcmTagKey &tag, bulkDataTags)
+    {
+        // Replacing the element with an empty one releases its value but keeps the tag in the dataset
+        if (m_dicomData->tagExists(tag))
+        {
+            m_dicomData->insertEmptyElement(tag);
+        }
+    }
 }
 
 DcmDataset* DICOMTagReader::getDcmDataset() const
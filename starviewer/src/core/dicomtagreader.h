@@ -47,17 +47,23 @@ public:
     /// hem de retornar-los sense sel seu valor, estalviant-nos de llegir i carregar-los en memòria
     enum ReturnValueOfTags { AllTags, ExcludeHeavyTags };
 
+    /// Indicates which data of the file is kept by the reader.
+    /// FullLoad keeps the whole dataset, and its bulk data can be read on demand (e.g. to decode the pixel data).
+    /// MetadataOnly keeps only the attributes: values of bulk data elements (Pixel Data, Overlay Data) are never read from the file, or are released if the
+    /// dataset is already in memory. These elements are kept without value, so their presence can still be checked with tagExists().
+    enum LoadMode { FullLoad, MetadataOnly };
+
     DICOMTagReader();
     /// Constructor per nom de fitxer.
-    DICOMTagReader(const QString &filename);
+    DICOMTagReader(const QString &filename, LoadMode loadMode = FullLoad);
     /// Constructor per nom de fitxer per si es té un DcmDataset ja llegit.
     /// D'aquesta forma no cal tornar-lo a llegir.
-    DICOMTagReader(const QString &filename, DcmDataset *dcmDataset);
+    DICOMTagReader(const QString &filename, DcmDataset *dcmDataset, LoadMode loadMode = FullLoad);
 
     virtual ~DICOMTagReader();
 
     /// Nom de l'arxiu DICOM que es vol llegir. Torna cert si l'arxiu s'ha pogut carregar correctament, fals altrament.
-    bool setFile(const QString &filename);
+    bool setFile(const QString &filename, LoadMode loadMode = FullLoad);
 
     /// Ens diu si l'arxiu assignat és vàlid com a arxiu DICOM. Si no tenim arxiu assignat retornarà fals.
     bool canReadFile() const;
@@ -68,7 +74,7 @@ public:
     /// Mètode de conveniència per aprofitar un DcmDataset ja obert. Es presuposa que dcmDataset no és null i pertany al fitxer passat.
     /// En el cas que ja tingués un fitxer obert, el substitueix esborrant el DcmDataset anterior. Un cop passat el propietari
     /// del DcmDataset passa a ser el DICOMTagReader.
-    void setDcmDataset(const QString &filename, DcmDataset *dcmDataset);
+    void setDcmDataset(const QString &filename, DcmDataset *dcmDataset, LoadMode loadMode = FullLoad);
 
     /// Retorna el Dataset de dcmtk que es fa servir internament
     DcmDataset* getDcmDataset() const;
@@ -118,6 +124,9 @@ private:
 
     /// Initializes the text codec according to the current dataset.
     void initializeTextCodec();
+
+    /// Releases the values of the bulk data elements of the current dataset, keeping the elements.
+    void releaseBulkData();
     
     /// Converteix una seqüència de DCMTK a una seqüència pròpia.
     DICOMSequenceAttribute* convertToDICOMSequenceAttribute(DcmSequenceOfItems *dcmtkSequence, DICOMTagReader::ReturnValueOfTags returnValueOfTags) const;
@@ -0,0 +1,165 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#include "emptyspacemap.h"
+
+#include "logging.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+
+namespace udg {
+
+EmptySpaceMap::EmptySpaceMap()
+    : m_data(0), m_maximumValue(0), m_numberOfEmptyBlocks(0)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        m_dimensions[i] = 0;
+        m_numberOfBlocks[i] = 0;
+    }
+}
+
+void EmptySpaceMap::setData(const unsigned short *data, const int dimensions[3])
+{
+    m_data = data;
+    m_blockMinimums.clear();
+    m_blockMaximums.clear();
+    m_emptyBlocks.clear();
+    m_numberOfEmptyBlocks = 0;
+    m_maximumValue = 0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        m_dimensions[i] = data ? dimensions[i] : 0;
+        // The blocks cover the cells between voxels, so there are no blocks along an axis with a single voxel
+        m_numberOfBlocks[i] = m_dimensions[i] >= 2 ? (m_dimensions[i] - 2) / BlockSize + 1 : 0;
+    }
+
+    int numberOfBlocks = m_numberOfBlocks[0] * m_numberOfBlocks[1] * m_numberOfBlocks[2];
+
+    if (numberOfBlocks == 0)
+    {
+        return;
+    }
+
+    m_blockMinimums.resize(numberOfBlocks);
+    m_blockMaximums.resize(numberOfBlocks);
+
+    // Each slab of blocks reads different slices, so they can be computed in parallel
+    QVector<int> blockZIndices(m_numberOfBlocks[2]);
+    for (int i = 0; i < blockZIndices.size(); i++)
+    {
+        blockZIndices[i] = i;
+    }
+    QtConcurrent::blockingMap(blockZIndices, [this](int blockZ) { computeBlockRanges(blockZ); });
+
+    m_maximumValue = *std::max_element(m_blockMaximums.constBegin(), m_blockMaximums.constEnd());
+
+    classifyBlocks();
+}
+
+void EmptySpaceMap::setTransferFunction(const TransferFunction &transferFunction)
+{
+    m_transferFunction = transferFunction;
+    classifyBlocks();
+}
+
+int EmptySpaceMap::getNumberOfBlocks() const
+{
+    return m_emptyBlocks.size();
+}
+
+int EmptySpaceMap::getNumberOfEmptyBlocks() const
+{
+    return m_numberOfEmptyBlocks;
+}
+
+void EmptySpaceMap::computeBlockRanges(int blockZ)
+{
+    const int YIncrement = m_dimensions[0];
+    const int ZIncrement = m_dimensions[0] * m_dimensions[1];
+
+    int firstZ = blockZ * BlockSize;
+    int lastZ = qMin(firstZ + BlockSize, m_dimensions[2] - 1);
+
+    for (int blockY = 0; blockY < m_numberOfBlocks[1]; blockY++)
+    {
+        int firstY = blockY * BlockSize;
+        int lastY = qMin(firstY + BlockSize, m_dimensions[1] - 1);
+
+        for (int blockX = 0; blockX < m_numberOfBlocks[0]; blockX++)
+        {
+            int firstX = blockX * BlockSize;
+            int lastX = qMin(firstX + BlockSize, m_dimensions[0] - 1);
+            unsigned short minimum = std::numeric_limits<unsigned short>::max();
+            unsigned short maximum = 0;
+
+            for (int z = firstZ; z <= lastZ; z++)
+            {
+                for (int y = firstY; y <= lastY; y++)
+                {
+                    const unsigned short *row = m_data + static_cast<qint64>(z) * ZIncrement + y * YIncrement;
+
+                    for (int x = firstX; x <= lastX; x++)
+                    {
+                        minimum = qMin(minimum, row[x]);
+                        maximum = qMax(maximum, row[x]);
+                    }
+                }
+            }
+
+            int block = (blockZ * m_numberOfBlocks[1] + blockY) * m_numberOfBlocks[0] + blockX;
+            m_blockMinimums[block] = minimum;
+            m_blockMaximums[block] = maximum;
+        }
+    }
+}
+
+void EmptySpaceMap::classifyBlocks()
+{
+    m_emptyBlocks.fill(false, m_blockMinimums.size());
+    m_numberOfEmptyBlocks = 0;
+
+    if (m_blockMinimums.isEmpty())
+    {
+        return;
+    }
+
+    // opaqueValuesUpTo[v] is the number of values in [0, v) with a non-zero opacity, so a range of values is transparent if the count doesn't change
+    QVector<int> opaqueValuesUpTo(m_maximumValue + 2);
+    opaqueValuesUpTo[0] = 0;
+    for (int value = 0; value <= m_maximumValue; value++)
+    {
+        opaqueValuesUpTo[value + 1] = opaqueValuesUpTo[value] + (m_transferFunction.getOpacity(value) > 0.0 ? 1 : 0);
+    }
+
+    for (int block = 0; block < m_emptyBlocks.size(); block++)
+    {
+        // The shaders truncate the interpolated values, which can fall just below the minimum because of rounding errors
+        int minimum = qMax(m_blockMinimums.at(block) - 1, 0);
+        int maximum = m_blockMaximums.at(block);
+
+        if (opaqueValuesUpTo.at(maximum + 1) == opaqueValuesUpTo.at(minimum))
+        {
+            m_emptyBlocks[block] = true;
+            m_numberOfEmptyBlocks++;
+        }
+    }
+
+    DEBUG_LOG(QString("%1 of %2 blocks are empty").arg(m_numberOfEmptyBlocks).arg(m_emptyBlocks.size()));
+}
+
+} // namespace udg
@@ -0,0 +1,141 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#ifndef UDG_EMPTYSPACEMAP_H
+#define UDG_EMPTYSPACEMAP_H
+
+#include "transferfunction.h"
+#include "vector3.h"
+
+#include <QVector>
+
+#include <cmath>
+#include <limits>
+
+namespace udg {
+
+/**
+ * @brief The EmptySpaceMap class divides a volume in blocks and tells which ones are fully transparent with a transfer function, so that the CPU ray casters
+ *        can skip them.
+ *
+ * The range of values of each block is computed once when the data is set. Changing the transfer function only classifies the blocks again from their ranges,
+ * so it's cheap enough to be done at each edit. Each block includes the voxels on its upper faces, so that nearest and trilinear samples taken inside a block
+ * only read voxels of that block.
+ */
+class EmptySpaceMap {
+
+public:
+    EmptySpaceMap();
+
+    /// Sets the volume data, with x varying fastest, and computes the range of values of each block. The data must stay alive while the map is used.
+    /// If data is null the map is cleared and no space is skipped.
+    void setData(const unsigned short *data, const int dimensions[3]);
+    /// Sets the transfer function whose scalar opacity decides which blocks are empty. It must be defined over the values of the data.
+    void setTransferFunction(const TransferFunction &transferFunction);
+
+    /// Returns the number of consecutive samples, starting at position and advancing by increment, that are inside the same empty block. Positions are in
+    /// voxel coordinates. Returns 0 if the position is not inside an empty block.
+    int getNumberOfEmptySamples(const Vector3 &position, const Vector3 &increment) const;
+
+    /// Returns the number of blocks and the number of them that are empty with the current transfer function.
+    int getNumberOfBlocks() const;
+    int getNumberOfEmptyBlocks() const;
+
+private:
+    /// Computes the range of values of the blocks with the given z index.
+    void computeBlockRanges(int blockZ);
+    /// Classifies each block as empty or not from its range and the transfer function.
+    void classifyBlocks();
+
+private:
+    /// Number of cells of a block along each axis.
+    static const int BlockSize = 8;
+
+    const unsigned short *m_data;
+    int m_dimensions[3];
+    unsigned short m_maximumValue;
+    TransferFunction m_transferFunction;
+
+    /// Number of blocks along each axis.
+    int m_numberOfBlocks[3];
+    /// Minimum and maximum value of each block, x varying fastest.
+    QVector<unsigned short> m_blockMinimums;
+    QVector<unsigned short> m_blockMaximums;
+    /// Whether each block is fully transparent.
+    QVector<bool> m_emptyBlocks;
+    int m_numberOfEmptyBlocks;
+
+};
+
+inline int EmptySpaceMap::getNumberOfEmptySamples(const Vector3 &position, const Vector3 &increment) const
+{
+    if (m_numberOfEmptyBlocks == 0)
+    {
+        return 0;
+    }
+
+    const double coordinates[3] = { position.x, position.y, position.z };
+    const double increments[3] = { increment.x, increment.y, increment.z };
+    int block[3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (coordinates[i] < 0.0)
+        {
+            return 0;
+        }
+
+        block[i] = static_cast<int>(coordinates[i]) / BlockSize;
+
+        if (block[i] >= m_numberOfBlocks[i])
+        {
+            return 0;
+        }
+    }
+
+    if (!m_emptyBlocks.at((block[2] * m_numberOfBlocks[1] + block[1]) * m_numberOfBlocks[0] + block[0]))
+    {
+        return 0;
+    }
+
+    // Samples closer than this to the faces of the block aren't skipped, so that the rounding errors of the ray position can't take them out of the block
+    const double Margin = 0.001;
+    double numberOfSamples = std::numeric_limits<int>::max();
+
+    for (int i = 0; i < 3; i++)
+    {
+        double lower = block[i] * BlockSize + Margin;
+        double upper = qMin((block[i] + 1) * BlockSize, m_dimensions[i] - 1) - Margin;
+
+        if (coordinates[i] < lower || coordinates[i] >= upper)
+        {
+            return 0;
+        }
+
+        if (increments[i] > 0.0)
+        {
+            numberOfSamples = qMin(numberOfSamples, std::ceil((upper - coordinates[i]) / increments[i]));
+        }
+        else if (increments[i] < 0.0)
+        {
+            numberOfSamples = qMin(numberOfSamples, std::floor((coordinates[i] - lower) / -increments[i]) + 1.0);
+        }
+    }
+
+    return static_cast<int>(numberOfSamples);
+}
+
+} // namespace udg
+
+#endif // UDG_EMPTYSPACEMAP_H
@@ -292,27 +292,22 @@ bool ImageFillerStep::fillIndividually()
 
     if (dicomReader)
     {
-        ok = true;
-        QList<Image*> generatedImages = processDICOMFile(dicomReader);
-        if (!generatedImages.isEmpty())
-        {
-            m_input->setCurrentImages(generatedImages);
-        }
+        ok = fillIndividually(createImages(dicomReader));
     }
 
     return ok;
 }
 
-QList<Image*> ImageFillerStep::processDICOMFile(const DICOMTagReader *dicomReader)
+QList<Image*> ImageFillerStep::createImages(const DICOMTagReader *dicomReader)
 {
-    QList<Image*> generatedImages;
+    QList<Image*> images;
     bool ok = dicomReader->tagExists(DICOMPixelData);
     if (ok)
     {
         // Comprovem si la imatge és enhanced o no per tal de cridar el mètode específic més adient
         if (isEnhancedImageSOPClass(dicomReader->getValueAttributeAsQString(DICOMSOPClassUID)))
         {
-            generatedImages = processEnhancedDICOMFile(dicomReader);
+            images = createEnhancedImages(dicomReader);
         }
         else
         {
@@ -323,20 +318,44 @@ QList<Image*> ImageFillerStep::processDICOMFile(const DICOMTagReader *dicomReade
                 Image *image = new Image();
                 image->setFrameNumber(frameNumber);
                 processImage(image, dicomReader);
-
-                // Afegirem la imatge a la llista si aquesta s'ha pogut afegir a la corresponent sèrie
-                if (m_input->getCurrentSeries()->addImage(image))
-                {
-                    generatedImages << image;
-                }
-                else
-                {
-                    delete image;
-                }
+                images << image;
             }
         }
     }
-    return generatedImages;
+    return images;
+}
+
+bool ImageFillerStep::fillIndividually(const QList<Image*> &images)
+{
+    Q_ASSERT(m_input);
+
+    if (!m_input->getDICOMFile())
+    {
+        qDeleteAll(images);
+        return false;
+    }
+
+    QList<Image*> generatedImages;
+
+    foreach (Image *image, images)
+    {
+        // Afegirem la imatge a la llista si aquesta s'ha pogut afegir a la corresponent sèrie
+        if (m_input->getCurrentSeries()->addImage(image))
+        {
+            generatedImages << image;
+        }
+        else
+        {
+            delete image;
+        }
+    }
+
+    if (!generatedImages.isEmpty())
+    {
+        m_input->setCurrentImages(generatedImages);
+    }
+
+    return true;
 }
 
 void ImageFillerStep::fillCommonImageInformation(Image *image, const DICOMTagReader *dicomReader)
@@ -525,10 +544,11 @@ void ImageFillerStep::processImage(Image *image, const DICOMTagReader *dicomRead
     fillDisplayShutterInformation(image, dicomReader);
 }
 
-QList<Image*> ImageFillerStep::processEnhancedDICOMFile(const DICOMTagReader *dicomReader)
+QList<Image*> ImageFillerStep::createEnhancedImages(const DICOMTagReader *dicomReader)
 {
     QList<Image*> generatedImages;
     int numberOfFrames = getNumberOfFrames(dicomReader);
+    QString sopClassUID = dicomReader->getValueAttributeAsQString(DICOMSOPClassUID);
 
     for (int frameNumber = 0; frameNumber < numberOfFrames; frameNumber++)
     {
@@ -536,12 +556,7 @@ QList<Image*> ImageFillerStep::processEnhancedDICOMFile(const DICOMTagReader *di
         fillCommonImageInformation(image, dicomReader);
         // Li assignem el nº de frame i el nº de volum al que pertany
         image->setFrameNumber(frameNumber);
-
-        // Afegirem la imatge a la llista si aquesta s'ha pogut afegir a la corresponent sèrie
-        if (m_input->getCurrentSeries()->addImage(image))
-        {
-            generatedImages << image;
-        }
+        generatedImages << image;
     }
 
     // Tractem la Shared Functional Groups Sequence
@@ -554,7 +569,7 @@ QList<Image*> ImageFillerStep::processEnhancedDICOMFile(const DICOMTagReader *di
         {
             foreach (Image *image, generatedImages)
             {
-                fillFunctionalGroupsInformation(image, sharedItems.first());
+                fillFunctionalGroupsInformation(image, sharedItems.first(), sopClassUID);
             }
         }
     }
@@ -570,7 +585,12 @@ QList<Image*> ImageFillerStep::processEnhancedDICOMFile(const DICOMTagReader *di
         int frameNumber = 0;
         foreach (DICOMSequenceItem *item, perFrameItems)
         {
-            fillFunctionalGroupsInformation(generatedImages.at(frameNumber), item);
+            if (frameNumber >= generatedImages.size())
+            {
+                break;
+            }
+
+            fillFunctionalGroupsInformation(generatedImages.at(frameNumber), item, sopClassUID);
             frameNumber++;
         }
     }
@@ -582,11 +602,9 @@ QList<Image*> ImageFillerStep::processEnhancedDICOMFile(const DICOMTagReader *di
     return generatedImages;
 }
 
-void ImageFillerStep::fillFunctionalGroupsInformation(Image *image, DICOMSequenceItem *frameItem)
+void ImageFillerStep::fillFunctionalGroupsInformation(Image *image, DICOMSequenceItem *frameItem, const QString &sopClassUID)
 {
     // Hi ha alguns atributs que els haurem de buscar en llocs diferents segons la modalitat
-    QString sopClassUID = m_input->getDICOMFile()->getValueAttributeAsQString(DICOMSOPClassUID);
-
     // Atributs de CT i MR i MG Breast Tomosyntesis
     if (sopClassUID == UIDEnhancedCTImageStorage || sopClassUID == UIDEnhancedMRImageStorage || sopClassUID == UIDBreastTomosynthesisImageStorage)
     {
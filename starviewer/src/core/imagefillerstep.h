@@ -36,16 +36,20 @@ public:
 
     virtual bool fillIndividually() override;
 
+    /// Creates and fills the images contained in the given DICOM file, without adding them to any series. The caller takes ownership of the images.
+    /// It doesn't modify the step nor its input, so it can be called from several threads at the same time.
+    QList<Image*> createImages(const DICOMTagReader *dicomReader);
+
+    /// Adds the given images, previously created with createImages() from the current DICOM file of the input, to the current series and sets them as the
+    /// current images. Images that can't be added to the series are deleted. Returns true if the input has a DICOM file, as fillIndividually().
+    bool fillIndividually(const QList<Image*> &images);
+
 private:
     /// Mètode per processar la informació específica de pacient,series i imatge
     void processImage(Image *image, const DICOMTagReader *dicomReader);
 
-    /// Mètode encarregat de processar el fitxer DICOM per extreure'n el conjunt de les imatges
-    /// que el conformen, omplint la informació necessària
-    QList<Image*> processDICOMFile(const DICOMTagReader *dicomReader);
-
-    /// Mètode específic per processar els arxius que siguin de tipus Enhanced
-    QList<Image*> processEnhancedDICOMFile(const DICOMTagReader *dicomReader);
+    /// Mètode específic per crear les imatges dels arxius que siguin de tipus Enhanced
+    QList<Image*> createEnhancedImages(const DICOMTagReader *dicomReader);
 
     /// Omple la informació comú a totes les imatges.
     /// Image i dicomReader han de ser objectes vàlids.
@@ -54,7 +58,7 @@ private:
     /// Omple l'image donat amb la informació dels functional groups continguts en l'ítem proporcionat
     /// Aquest mètode està pensat per fer-se servir amb els ítems obtinguts
     /// tant amb la Shared Functional Groups Sequence com amb la Per-Frame Functional Groups Sequence
-    void fillFunctionalGroupsInformation(Image *image, DICOMSequenceItem *frameItem);
+    void fillFunctionalGroupsInformation(Image *image, DICOMSequenceItem *frameItem, const QString &sopClassUID);
 
     /// Retorna quants overlays hi ha en el dataset proporcionat
     unsigned short getNumberOfOverlays(const DICOMTagReader *dicomReader);
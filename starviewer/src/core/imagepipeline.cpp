@@ -19,12 +19,22 @@
 #include "vtkRunThroughFilter.h"
 #include "windowlevelfilter.h"
 
+#include <QtConcurrentRun>
+
 #include <vtkImageData.h>
 
 namespace udg {
 
+namespace {
+
+// Default maximum memory used by the prefetched phases. Fewer phases are prefetched from big volumes, and none if a single phase doesn't fit.
+const qint64 MaximumPrefetchedPhasesSizeInBytes = 512 * 1024 * 1024;
+
+}
+
 ImagePipeline::ImagePipeline()
- : m_input(nullptr), m_enableColorMapping(false), m_hasTransferFunction(false)
+ : m_maximumPrefetchedPhasesSizeInBytes(MaximumPrefetchedPhasesSizeInBytes), m_input(nullptr), m_enableColorMapping(false), m_hasTransferFunction(false), m_hasLookupTable(false), m_phase(0), m_isShowingPrefetchedPhase(false),
+   m_prefetchGeneration(0)
 {
     m_phaseFilter = new PhaseFilter();
     m_windowLevelLUTFilter = new WindowLevelFilter();
@@ -33,6 +43,9 @@ ImagePipeline::ImagePipeline()
 
 ImagePipeline::~ImagePipeline()
 {
+    m_prefetchThreadPool.clear();
+    m_prefetchThreadPool.waitForDone();
+
     delete m_phaseFilter;
     delete m_windowLevelLUTFilter;
     m_outputFilter->Delete();
@@ -41,6 +54,7 @@ ImagePipeline::~ImagePipeline()
 void ImagePipeline::setInput(vtkImageData *input)
 {
     m_input = input;
+    invalidatePrefetchedPhases();
     rebuild();
 }
 
@@ -52,52 +66,150 @@ void ImagePipeline::setInput(FilterOutput input)
 void ImagePipeline::setNumberOfPhases(int numberOfPhases)
 {
     m_phaseFilter->setNumberOfPhases(numberOfPhases);
+    invalidatePrefetchedPhases();
     rebuild();
 }
 
 void ImagePipeline::setPhase(int phase)
 {
     m_phaseFilter->setPhase(phase);
+    m_phase = phase;
+
+    // Only rebuild when needed to switch between the filters and the prefetched images
+    PrefetchedPhase prefetchedPhase;
+    if (m_isShowingPrefetchedPhase || getCurrentPrefetchedPhase(prefetchedPhase))
+    {
+        rebuild();
+    }
 }
 
-vtkImageData* ImagePipeline::getPhaseOutput()
+void ImagePipeline::prefetchPhases(const QList<int> &phases)
 {
-    return m_phaseFilter->getOutput().getVtkImageData();
+    if (!m_input || m_phaseFilter->getNumberOfPhases() <= 1)
+    {
+        return;
+    }
+
+    QMutexLocker locker(&m_prefetchMutex);
+
+    // The current phase may be kept too, so it's counted as one more
+    int maximumNumberOfPhases = static_cast<int>(m_maximumPrefetchedPhasesSizeInBytes / getPrefetchedPhaseSizeInBytes()) - 1;
+    QList<int> phasesToPrefetch = phases.mid(0, qMax(maximumNumberOfPhases, 0));
+
+    // Discard the phases that are no longer needed to keep the buffer bounded
+    foreach (int phase, m_prefetchedPhases.keys())
+    {
+        if (phase != m_phase && !phasesToPrefetch.contains(phase))
+        {
+            m_prefetchedPhases.remove(phase);
+        }
+    }
+
+    // Each job gets its own data object that shares the voxels with the input, so that no pipeline object is shared with the worker threads
+    vtkSmartPointer<vtkImageData> input = vtkSmartPointer<vtkImageData>::New();
+    input->ShallowCopy(m_input);
+    unsigned long inputMTime = m_input->GetMTime();
+    int numberOfPhases = m_phaseFilter->getNumberOfPhases();
+    bool enableColorMapping = m_enableColorMapping;
+    WindowLevel windowLevel = m_windowLevel;
+    bool hasLookupTable = m_hasLookupTable;
+    TransferFunction lookupTable = m_lookupTable;
+    int generation = m_prefetchGeneration;
+
+    foreach (int phase, phasesToPrefetch)
+    {
+        if (phase < 0 || phase >= numberOfPhases || m_prefetchedPhases.contains(phase) || m_phasesBeingPrefetched.contains(phase))
+        {
+            continue;
+        }
+
+        m_phasesBeingPrefetched.insert(phase);
+
+        QtConcurrent::run(&m_prefetchThreadPool, [=]() {
+            PrefetchedPhase prefetchedPhase = preparePhase(input, numberOfPhases, phase, enableColorMapping, windowLevel,
+                                                           hasLookupTable ? &lookupTable : 0);
+            prefetchedPhase.inputMTime = inputMTime;
+
+            QMutexLocker workerLocker(&m_prefetchMutex);
+
+            if (generation == m_prefetchGeneration)
+            {
+                m_prefetchedPhases.insert(phase, prefetchedPhase);
+                m_phasesBeingPrefetched.remove(phase);
+            }
+        });
+    }
 }
 
 void ImagePipeline::enableColorMapping(bool enable)
 {
     m_enableColorMapping = enable;
+    invalidatePrefetchedPhases();
     rebuild();
 }
 
 void ImagePipeline::setVoiLut(const VoiLut &voiLut)
 {
+    bool changed = !(m_windowLevel == voiLut.getWindowLevel());
+
     m_windowLevelLUTFilter->setWindowLevel(voiLut.getWindowLevel());
+    m_windowLevel = voiLut.getWindowLevel();
 
     if (!m_hasTransferFunction)
     {
         if (voiLut.isLut())
         {
+            changed = changed || !m_hasLookupTable || !(m_lookupTable == voiLut.getLut());
             m_windowLevelLUTFilter->setTransferFunction(voiLut.getLut());
+            m_lookupTable = voiLut.getLut();
+            m_hasLookupTable = true;
         }
         else
         {
+            changed = changed || m_hasLookupTable;
             m_windowLevelLUTFilter->clearTransferFunction();
+            m_hasLookupTable = false;
         }
     }
+
+    // The same VOI LUT may be set again on each phase change, which must not discard the prefetched phases
+    if (changed)
+    {
+        invalidatePrefetchedPhases();
+    }
 }
 
 void ImagePipeline::setTransferFunction(const TransferFunction &transferFunction)
 {
     m_windowLevelLUTFilter->setTransferFunction(transferFunction);
     m_hasTransferFunction = true;
+    m_lookupTable = transferFunction;
+    m_hasLookupTable = true;
+    invalidatePrefetchedPhases();
 }
 
 void ImagePipeline::clearTransferFunction()
 {
     m_windowLevelLUTFilter->clearTransferFunction();
     m_hasTransferFunction = false;
+    m_hasLookupTable = false;
+    invalidatePrefetchedPhases();
+}
+
+void ImagePipeline::waitForPrefetchedPhases()
+{
+    m_prefetchThreadPool.waitForDone();
+}
+
+QList<int> ImagePipeline::getPrefetchedPhases() const
+{
+    QMutexLocker locker(&m_prefetchMutex);
+    return m_prefetchedPhases.keys();
+}
+
+bool ImagePipeline::isShowingPrefetchedPhase() const
+{
+    return m_isShowingPrefetchedPhase;
 }
 
 vtkAlgorithm* ImagePipeline::getVtkAlgorithm() const
@@ -107,7 +219,14 @@ vtkAlgorithm* ImagePipeline::getVtkAlgorithm() const
 
 void ImagePipeline::rebuild()
 {
-    if (m_phaseFilter->getNumberOfPhases() > 1 && m_enableColorMapping)
+    PrefetchedPhase prefetchedPhase;
+    m_isShowingPrefetchedPhase = m_phaseFilter->getNumberOfPhases() > 1 && getCurrentPrefetchedPhase(prefetchedPhase);
+
+    if (m_isShowingPrefetchedPhase)
+    {
+        m_outputFilter->SetInputData(prefetchedPhase.outputImage);
+    }
+    else if (m_phaseFilter->getNumberOfPhases() > 1 && m_enableColorMapping)
     {
         m_phaseFilter->setInput(m_input);
         m_windowLevelLUTFilter->setInput(m_phaseFilter->getOutput());
@@ -129,4 +248,97 @@ void ImagePipeline::rebuild()
     }
 }
 
+void ImagePipeline::invalidatePrefetchedPhases()
+{
+    {
+        QMutexLocker locker(&m_prefetchMutex);
+        m_prefetchGeneration++;
+        m_prefetchedPhases.clear();
+        m_phasesBeingPrefetched.clear();
+    }
+
+    if (m_isShowingPrefetchedPhase)
+    {
+        rebuild();
+    }
+}
+
+ImagePipeline::PrefetchedPhase ImagePipeline::preparePhase(vtkSmartPointer<vtkImageData> input, int numberOfPhases, int phase, bool enableColorMapping,
+                                                           const WindowLevel &windowLevel, const TransferFunction *lookupTable)
+{
+    PrefetchedPhase prefetchedPhase;
+
+    PhaseFilter phaseFilter;
+    phaseFilter.setInput(input);
+    phaseFilter.setNumberOfPhases(numberOfPhases);
+    phaseFilter.setPhase(phase);
+    phaseFilter.update();
+
+    // The outputs are copied to data objects detached from the filters, which are destroyed at the end
+    vtkSmartPointer<vtkImageData> phaseImage = vtkSmartPointer<vtkImageData>::New();
+    phaseImage->ShallowCopy(phaseFilter.getOutput().getVtkImageData());
+
+    if (enableColorMapping)
+    {
+        WindowLevelFilter windowLevelFilter;
+        windowLevelFilter.setInput(phaseImage);
+        windowLevelFilter.setWindowLevel(windowLevel);
+
+        if (lookupTable)
+        {
+            windowLevelFilter.setTransferFunction(*lookupTable);
+        }
+
+        windowLevelFilter.update();
+
+        prefetchedPhase.outputImage = vtkSmartPointer<vtkImageData>::New();
+        prefetchedPhase.outputImage->ShallowCopy(windowLevelFilter.getOutput().getVtkImageData());
+    }
+    else
+    {
+        prefetchedPhase.outputImage = phaseImage;
+    }
+
+    return prefetchedPhase;
+}
+
+qint64 ImagePipeline::getPrefetchedPhaseSizeInBytes() const
+{
+    // Once a phase has been prepared its actual size is known
+    if (!m_prefetchedPhases.isEmpty())
+    {
+        return qMax(static_cast<qint64>(m_prefetchedPhases.first().outputImage->GetActualMemorySize()) * 1024, Q_INT64_C(1));
+    }
+
+    // Otherwise it's estimated from the input. The window level output has up to 4 bytes per voxel (RGBA).
+    qint64 bytesPerVoxel = static_cast<qint64>(m_input->GetScalarSize()) * m_input->GetNumberOfScalarComponents();
+
+    if (m_enableColorMapping)
+    {
+        bytesPerVoxel = qMax(bytesPerVoxel, Q_INT64_C(4));
+    }
+
+    return qMax(static_cast<qint64>(m_input->GetNumberOfPoints()) / m_phaseFilter->getNumberOfPhases() * bytesPerVoxel, Q_INT64_C(1));
+}
+
+bool ImagePipeline::getCurrentPrefetchedPhase(PrefetchedPhase &prefetchedPhase) const
+{
+    if (!m_input)
+    {
+        return false;
+    }
+
+    QMutexLocker locker(&m_prefetchMutex);
+
+    if (!m_prefetchedPhases.contains(m_phase))
+    {
+        return false;
+    }
+
+    prefetchedPhase = m_prefetchedPhases.value(m_phase);
+
+    // The input may have been modified in place, for instance while it's being loaded progressively
+    return prefetchedPhase.inputMTime == m_input->GetMTime();
+}
+
 }
@@ -17,6 +17,16 @@
 
 #include "filter.h"
 
+#include "transferfunction.h"
+#include "windowlevel.h"
+
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QThreadPool>
+
+#include <vtkSmartPointer.h>
+
 class vtkImageData;
 class vtkRunThroughFilter;
 
@@ -45,8 +55,13 @@ public:
     void setNumberOfPhases(int numberOfPhases);
     /// Sets the phase that has to be displayed in the volume.
     void setPhase(int phase);
-    /// Returns the output image data of the phase filter.
-    vtkImageData* getPhaseOutput();
+
+    /// Prepares the images of the given phases in worker threads, running the phase and window level filters with the current settings, so that setPhase()
+    /// can show them without running the filters. Only the given phases and the one being displayed are kept, so the prepared images behave as a ring buffer
+    /// that advances with the playback. Prepared images are discarded when the input or the color mapping change. The input must not be modified by a
+    /// pipeline while the images are being prepared. The memory used by the prepared images is bounded, so only the first phases that fit are prepared,
+    /// or none if the volume is too big.
+    void prefetchPhases(const QList<int> &phases);
 
     /// Enables or disables window level and transfer function filter.
     void enableColorMapping(bool enable);
@@ -57,6 +72,18 @@ public:
     /// Clears the transfer function.
     void clearTransferFunction();
 
+protected:
+    /// Waits until the phases being prepared in the worker threads are finished.
+    void waitForPrefetchedPhases();
+    /// Returns the phases that have been prepared and are kept, in ascending order.
+    QList<int> getPrefetchedPhases() const;
+    /// Returns true if the current phase is being shown from a prefetched image.
+    bool isShowingPrefetchedPhase() const;
+
+protected:
+    /// Maximum memory used by the prefetched phases, including the one being displayed.
+    qint64 m_maximumPrefetchedPhasesSizeInBytes;
+
 private:
     /// Returns the vtkAlgorithm used to implement the filter.
     virtual vtkAlgorithm* getVtkAlgorithm() const;
@@ -64,6 +91,29 @@ private:
     /// Rebuilds this pipeline choosing which filters to use according to their current status.
     void rebuild();
 
+    /// Discards the prefetched phases and the ones being prepared. If the current phase was being shown from a prefetched image the pipeline is rebuilt.
+    void invalidatePrefetchedPhases();
+
+    /// Prepared images of a phase.
+    struct PrefetchedPhase
+    {
+        /// Final output of the pipeline.
+        vtkSmartPointer<vtkImageData> outputImage;
+        /// Modification time of the input when the images were prepared.
+        unsigned long inputMTime;
+    };
+
+    /// Prepares the images of the given phase of the given input with the given color mapping settings. Runs in a worker thread.
+    static PrefetchedPhase preparePhase(vtkSmartPointer<vtkImageData> input, int numberOfPhases, int phase, bool enableColorMapping,
+                                        const WindowLevel &windowLevel, const TransferFunction *lookupTable);
+
+    /// Returns the memory used by the prepared images of a phase, measured if some phase has already been prepared or estimated from the input otherwise.
+    /// Must be called with the prefetch mutex locked.
+    qint64 getPrefetchedPhaseSizeInBytes() const;
+
+    /// Fills the given struct with the prefetched images of the current phase and returns true if they exist and are up to date. Returns false otherwise.
+    bool getCurrentPrefetchedPhase(PrefetchedPhase &prefetchedPhase) const;
+
 private:
     /// Filter to extract a single phase from a multi-phase volume.
     PhaseFilter *m_phaseFilter;
@@ -80,6 +130,27 @@ private:
     /// Used to keep track of whether there's a currently active transfer function when applying a VOI LUT.
     bool m_hasTransferFunction;
 
+    /// Color mapping settings given to the window level filter, needed to prepare phases in worker threads.
+    WindowLevel m_windowLevel;
+    TransferFunction m_lookupTable;
+    bool m_hasLookupTable;
+
+    /// Phase being displayed.
+    int m_phase;
+    /// True if the current phase is being shown from a prefetched image.
+    bool m_isShowingPrefetchedPhase;
+
+    /// Prefetched phases, indexed by phase.
+    QMap<int, PrefetchedPhase> m_prefetchedPhases;
+    /// Phases being prepared in the worker threads.
+    QSet<int> m_phasesBeingPrefetched;
+    /// Incremented each time the prefetched phases are discarded so that the phases being prepared at that moment are discarded too when they finish.
+    int m_prefetchGeneration;
+    /// Protects the prefetched phases, the phases being prepared and the generation.
+    mutable QMutex m_prefetchMutex;
+    /// Worker threads where the phases are prepared.
+    QThreadPool m_prefetchThreadPool;
+
 };
 
 }
@@ -0,0 +1,386 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#include "magicroiregiongrower.h"
+
+#include "logging.h"
+
+#include <algorithm>
+
+namespace udg {
+
+namespace {
+
+// Neighbour directions used to trace the contour, in counterclockwise order. The odd ones are the 4-connected neighbours.
+enum { LeftDown, Down, RightDown, Right, RightUp, Up, LeftUp, Left };
+const int DirectionX[8] = { -1, 0, 1, 1, 1, 0, -1, -1 };
+const int DirectionY[8] = { -1, -1, -1, 0, 1, 1, 1, 0 };
+
+const int BitsPerWord = 64;
+
+// Returns the index of the lowest set bit of a non-zero word.
+int getLowestSetBit(quint64 word)
+{
+    int bit = 0;
+    while (!(word & 1))
+    {
+        word >>= 1;
+        ++bit;
+    }
+    return bit;
+}
+
+}
+
+MagicROIRegionGrower::MagicROIRegionGrower()
+    : m_width(0), m_height(0), m_wordsPerRow(0), m_seedX(0), m_seedY(0), m_lowerLevel(0.0), m_upperLevel(0.0), m_numberOfPixels(0), m_firstRow(0),
+      m_lastRow(-1)
+{
+}
+
+void MagicROIRegionGrower::setImage(int width, int height, const RowLoader &rowLoader)
+{
+    m_width = width;
+    m_height = height;
+    m_wordsPerRow = (width + BitsPerWord - 1) / BitsPerWord;
+    m_rowLoader = rowLoader;
+
+    m_values.resize(width * height);
+    m_loadedRows.fill(false, height);
+    m_mask.fill(0, m_wordsPerRow * height);
+    m_frontierMask.fill(0, m_wordsPerRow * height);
+    m_frontier.resize(0);
+    m_numberOfPixels = 0;
+    m_firstRow = height;
+    m_lastRow = -1;
+}
+
+void MagicROIRegionGrower::setSeed(int x, int y)
+{
+    clearRegion();
+    m_seedX = x;
+    m_seedY = y;
+}
+
+float MagicROIRegionGrower::getValue(int x, int y)
+{
+    return getRow(y)[x];
+}
+
+void MagicROIRegionGrower::grow(double lowerLevel, double upperLevel)
+{
+    if (m_seedX < 1 || m_seedX > m_width - 2 || m_seedY < 1 || m_seedY > m_height - 2)
+    {
+        DEBUG_LOG(QString("The seed (%1, %2) is out of the slice or on its border").arg(m_seedX).arg(m_seedY));
+        clearRegion();
+        return;
+    }
+
+    bool widening = m_numberOfPixels > 0 && lowerLevel <= m_lowerLevel && upperLevel >= m_upperLevel;
+
+    if (widening && lowerLevel == m_lowerLevel && upperLevel == m_upperLevel)
+    {
+        return;
+    }
+
+    m_lowerLevel = lowerLevel;
+    m_upperLevel = upperLevel;
+
+    if (widening)
+    {
+        // All the previous region is still inside the range, so it can only grow through the pixels that were rejected around it
+        QVector<int> previousFrontier;
+        previousFrontier.swap(m_frontier);
+
+        foreach (int index, previousFrontier)
+        {
+            int x = index % m_width;
+            int y = index / m_width;
+            m_frontierMask[y * m_wordsPerRow + x / BitsPerWord] &= ~(Q_UINT64_C(1) << (x % BitsPerWord));
+        }
+
+        foreach (int index, previousFrontier)
+        {
+            int x = index % m_width;
+            int y = index / m_width;
+
+            if (testMask(x, y))
+            {
+                continue;
+            }
+
+            if (isInRange(getRow(y)[x]))
+            {
+                fill(x, y);
+            }
+            else
+            {
+                addToFrontier(x, y);
+            }
+        }
+    }
+    else
+    {
+        // The new region is contained in the previous one, or unrelated to it, so it has to be filled again from the seed
+        clearRegion();
+
+        if (isInRange(getRow(m_seedY)[m_seedX]))
+        {
+            fill(m_seedX, m_seedY);
+        }
+    }
+}
+
+bool MagicROIRegionGrower::contains(int x, int y) const
+{
+    if (x < 0 || x >= m_width || y < 0 || y >= m_height)
+    {
+        return false;
+    }
+
+    return testMask(x, y);
+}
+
+int MagicROIRegionGrower::getNumberOfPixels() const
+{
+    return m_numberOfPixels;
+}
+
+QVector<QPointF> MagicROIRegionGrower::traceContour() const
+{
+    QVector<QPointF> contour;
+
+    if (m_numberOfPixels == 0)
+    {
+        return contour;
+    }
+
+    // The contour starts at the leftmost pixel, the lowest one if there are several
+    int x = m_width;
+    int y = 0;
+    for (int row = m_firstRow; row <= m_lastRow; ++row)
+    {
+        const quint64 *rowMask = m_mask.constData() + row * m_wordsPerRow;
+        for (int word = 0; word < m_wordsPerRow && word * BitsPerWord < x; ++word)
+        {
+            if (rowMask[word])
+            {
+                int firstX = word * BitsPerWord + getLowestSetBit(rowMask[word]);
+                if (firstX < x)
+                {
+                    x = firstX;
+                    y = row;
+                }
+                break;
+            }
+        }
+    }
+
+    // Each pixel edge is visited at most once per turn around the region
+    const int MaximumNumberOfPoints = 4 * m_numberOfPixels + 8;
+
+    // The left edge of the first pixel is on the contour because there are no pixels at its left
+    contour.append(QPointF(x - 0.5, y));
+
+    int direction = LeftDown;
+    bool loop = false;
+    while (!loop)
+    {
+        int nextX = x + DirectionX[direction];
+        int nextY = y + DirectionY[direction];
+        while (!contains(nextX, nextY) && !loop)
+        {
+            if (direction % 2 == 1)
+            {
+                contour.append(QPointF(x + 0.5 * DirectionX[direction], y + 0.5 * DirectionY[direction]));
+                loop = contour.last() == contour.first();
+
+                if (!loop && contour.size() > MaximumNumberOfPoints)
+                {
+                    DEBUG_LOG("The contour doesn't close, stopping the tracing");
+                    contour.append(contour.first());
+                    return contour;
+                }
+            }
+            direction = (direction + 1) % 8;
+            nextX = x + DirectionX[direction];
+            nextY = y + DirectionY[direction];
+        }
+        x = nextX;
+        y = nextY;
+        direction = (direction + 5) % 8;
+    }
+
+    return contour;
+}
+
+void MagicROIRegionGrower::fill(int x, int y)
+{
+    const int MinimumX = 1;
+    const int MaximumX = m_width - 2;
+    const int MinimumY = 1;
+    const int MaximumY = m_height - 2;
+
+    m_stack.resize(0);
+    m_stack.append(y * m_width + x);
+
+    while (!m_stack.isEmpty())
+    {
+        int index = m_stack.last();
+        m_stack.removeLast();
+        x = index % m_width;
+        y = index / m_width;
+
+        if (testMask(x, y))
+        {
+            continue;
+        }
+
+        // Extend the span to both sides as far as the values are in range
+        const float *values = getRow(y);
+        int firstX = x;
+        while (firstX > MinimumX && !testMask(firstX - 1, y) && isInRange(values[firstX - 1]))
+        {
+            --firstX;
+        }
+        if (firstX > MinimumX && !testMask(firstX - 1, y))
+        {
+            addToFrontier(firstX - 1, y);
+        }
+
+        int lastX = x;
+        while (lastX < MaximumX && !testMask(lastX + 1, y) && isInRange(values[lastX + 1]))
+        {
+            ++lastX;
+        }
+        if (lastX < MaximumX && !testMask(lastX + 1, y))
+        {
+            addToFrontier(lastX + 1, y);
+        }
+
+        setMaskSpan(y, firstX, lastX);
+        m_numberOfPixels += lastX - firstX + 1;
+        m_firstRow = qMin(m_firstRow, y);
+        m_lastRow = qMax(m_lastRow, y);
+
+        // Push one seed for each run of unvisited pixels in range above and below the span
+        for (int neighbourY = y - 1; neighbourY <= y + 1; neighbourY += 2)
+        {
+            if (neighbourY < MinimumY || neighbourY > MaximumY)
+            {
+                continue;
+            }
+
+            const float *neighbourValues = getRow(neighbourY);
+            bool inRun = false;
+            for (int neighbourX = firstX; neighbourX <= lastX; ++neighbourX)
+            {
+                if (testMask(neighbourX, neighbourY))
+                {
+                    inRun = false;
+                }
+                else if (isInRange(neighbourValues[neighbourX]))
+                {
+                    if (!inRun)
+                    {
+                        m_stack.append(neighbourY * m_width + neighbourX);
+                        inRun = true;
+                    }
+                }
+                else
+                {
+                    addToFrontier(neighbourX, neighbourY);
+                    inRun = false;
+                }
+            }
+        }
+    }
+}
+
+void MagicROIRegionGrower::addToFrontier(int x, int y)
+{
+    quint64 &word = m_frontierMask[y * m_wordsPerRow + x / BitsPerWord];
+    quint64 bit = Q_UINT64_C(1) << (x % BitsPerWord);
+
+    if (!(word & bit))
+    {
+        word |= bit;
+        m_frontier.append(y * m_width + x);
+    }
+}
+
+void MagicROIRegionGrower::clearRegion()
+{
+    if (m_lastRow >= m_firstRow)
+    {
+        std::fill(m_mask.begin() + m_firstRow * m_wordsPerRow, m_mask.begin() + (m_lastRow + 1) * m_wordsPerRow, Q_UINT64_C(0));
+    }
+
+    foreach (int index, m_frontier)
+    {
+        int x = index % m_width;
+        int y = index / m_width;
+        m_frontierMask[y * m_wordsPerRow + x / BitsPerWord] = 0;
+    }
+
+    m_frontier.resize(0);
+    m_numberOfPixels = 0;
+    m_firstRow = m_height;
+    m_lastRow = -1;
+}
+
+const float* MagicROIRegionGrower::getRow(int y)
+{
+    float *row = m_values.data() + y * m_width;
+
+    if (!m_loadedRows.at(y))
+    {
+        m_rowLoader(y, row);
+        m_loadedRows[y] = true;
+    }
+
+    return row;
+}
+
+bool MagicROIRegionGrower::isInRange(float value) const
+{
+    return value >= m_lowerLevel && value <= m_upperLevel;
+}
+
+bool MagicROIRegionGrower::testMask(int x, int y) const
+{
+    return m_mask.at(y * m_wordsPerRow + x / BitsPerWord) & (Q_UINT64_C(1) << (x % BitsPerWord));
+}
+
+void MagicROIRegionGrower::setMaskSpan(int y, int firstX, int lastX)
+{
+    quint64 *row = m_mask.data() + y * m_wordsPerRow;
+    int firstWord = firstX / BitsPerWord;
+    int lastWord = lastX / BitsPerWord;
+    quint64 firstBits = ~Q_UINT64_C(0) << (firstX % BitsPerWord);
+    quint64 lastBits = ~Q_UINT64_C(0) >> (BitsPerWord - 1 - lastX % BitsPerWord);
+
+    if (firstWord == lastWord)
+    {
+        row[firstWord] |= firstBits & lastBits;
+    }
+    else
+    {
+        row[firstWord] |= firstBits;
+        std::fill(row + firstWord + 1, row + lastWord, ~Q_UINT64_C(0));
+        row[lastWord] |= lastBits;
+    }
+}
+
+} // namespace udg
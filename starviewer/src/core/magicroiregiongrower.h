@@ -0,0 +1,109 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#ifndef UDG_MAGICROIREGIONGROWER_H
+#define UDG_MAGICROIREGIONGROWER_H
+
+#include <QPointF>
+#include <QVector>
+
+#include <functional>
+
+namespace udg {
+
+/**
+ * @brief The MagicROIRegionGrower class computes the 4-connected region of a slice that contains a seed and whose values are inside an intensity range,
+ *        and traces its contour.
+ *
+ * The region is grown with a scanline flood fill over a bit-packed mask. Successive calls to grow() with nested ranges reuse the previous result:
+ * when the range widens the fill only continues from the pixels that were rejected on the border of the previous region, and when it narrows the
+ * region is filled again from the seed, clearing only the rows covered by the previous region. A pixel border of the slice is never included.
+ *
+ * The slice values are read row by row on demand through a RowLoader, so only the rows reached by the region and their neighbours are loaded.
+ */
+class MagicROIRegionGrower
+{
+public:
+    /// Function that writes the values of the row y of the slice into rowValues, which has room for a whole row.
+    typedef std::function<void(int y, float *rowValues)> RowLoader;
+
+    MagicROIRegionGrower();
+
+    /// Sets the size of the slice and the function used to read its values. Discards the current region.
+    void setImage(int width, int height, const RowLoader &rowLoader);
+    /// Sets the seed of the region. Discards the current region.
+    void setSeed(int x, int y);
+
+    /// Returns the value of the slice at the given pixel.
+    float getValue(int x, int y);
+
+    /// Updates the region to the pixels connected to the seed with values in [lowerLevel, upperLevel].
+    void grow(double lowerLevel, double upperLevel);
+
+    /// Returns true if the given pixel belongs to the region. Out of bounds pixels don't.
+    bool contains(int x, int y) const;
+    /// Returns the number of pixels of the region.
+    int getNumberOfPixels() const;
+
+    /// Returns the outer contour of the region, as the midpoints of the pixel edges between the region and the outside, in pixel coordinates.
+    /// The first point is repeated at the end. Returns an empty contour if the region is empty.
+    QVector<QPointF> traceContour() const;
+
+private:
+    /// Fills the span containing (x, y) and the spans connected to it.
+    void fill(int x, int y);
+    /// Adds the given pixel to the rejected pixels that bound the region, unless it is already there.
+    void addToFrontier(int x, int y);
+    /// Empties the region and the frontier.
+    void clearRegion();
+
+    /// Returns the values of the row y, loading them if needed.
+    const float* getRow(int y);
+
+    bool isInRange(float value) const;
+    bool testMask(int x, int y) const;
+    void setMaskSpan(int y, int firstX, int lastX);
+
+private:
+    int m_width;
+    int m_height;
+    int m_wordsPerRow;
+    RowLoader m_rowLoader;
+
+    /// Values of the slice and whether each row has been loaded.
+    QVector<float> m_values;
+    QVector<bool> m_loadedRows;
+
+    int m_seedX;
+    int m_seedY;
+    double m_lowerLevel;
+    double m_upperLevel;
+
+    /// Region mask, one bit per pixel, each row starting at a new word.
+    QVector<quint64> m_mask;
+    int m_numberOfPixels;
+    int m_firstRow;
+    int m_lastRow;
+
+    /// Pixels adjacent to the region that were out of the range, as y * width + x, and a bit mask to avoid duplicates.
+    QVector<int> m_frontier;
+    QVector<quint64> m_frontierMask;
+
+    /// Pending seeds of the flood fill, kept to reuse its memory.
+    QVector<int> m_stack;
+};
+
+} // namespace udg
+
+#endif // UDG_MAGICROIREGIONGROWER_H
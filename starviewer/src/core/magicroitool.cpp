@@ -19,7 +19,6 @@
 #include "drawer.h"
 #include "drawerpolygon.h"
 #include "drawertext.h"
-#include "mathtools.h"
 #include "sliceorientedvolumepixeldata.h"
 #include "voxel.h"
 #include "voxelindex.h"
@@ -46,6 +45,8 @@ MagicROITool::MagicROITool(QViewer *viewer, QObject *parent)
     m_maxY = 0;
     m_lowerLevel = 0.0;
     m_upperLevel = 0.0;
+    m_seedValue = 0.0;
+    m_standardDeviation = 0.0;
     m_inputIndex = getROIInputIndex();
     m_toolName = "MagicROITool";
 
@@ -180,11 +181,6 @@ void MagicROITool::computeMaskBounds()
     m_maxY = extent[3];
 }
 
-double MagicROITool::getVoxelValue(const VoxelIndex &index) // slice oriented index
-{
-    return getPixelData().getVoxelValue(index).getComponent(0);
-}
-
 void MagicROITool::startRegion()
 {
     if (m_state == Ready && m_2DViewer->hasInput())
@@ -201,6 +197,27 @@ void MagicROITool::startRegion()
                 return;
             }
 
+            if (m_minX != 0 || m_minY != 0)
+            {
+                DEBUG_LOG("ERROR: the slice extent doesn't start at 0");
+                return;
+            }
+
+            // The values of the slice are read row by row as the region reaches them, and kept until the next region
+            SliceOrientedVolumePixelData pixelData = getPixelData();
+            int width = m_maxX + 1;
+            int z = index.z();
+            m_regionGrower.setImage(width, m_maxY + 1, [pixelData, width, z](int y, float *rowValues) mutable
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    rowValues[x] = pixelData.getVoxelValue(VoxelIndex(x, y, z)).getComponent(0);
+                }
+            });
+            m_regionGrower.setSeed(index.x(), index.y());
+            m_seedValue = m_regionGrower.getValue(index.x(), index.y());
+            m_standardDeviation = getStandardDeviation();
+
             m_pickedPositionInDisplayCoordinates = m_2DViewer->getEventPosition();
             m_magicFactor = InitialMagicFactor;
             m_roiPolygon = new DrawerPolygon;
@@ -288,8 +305,6 @@ void MagicROITool::modifyRegionByFactor()
 
 void MagicROITool::generateRegion()
 {
-    computeMaskBounds();
-
     // Posem a true els punts on la imatge està dins els llindard i connectat amb la llavor (region growing)
     this->computeRegionMask();
 
@@ -338,301 +353,42 @@ VoxelIndex MagicROITool::getPickedPositionVoxelIndex()
 
 void MagicROITool::computeLevelRange()
 {
-    // Calculem la desviació estàndard dins la finestra que ens marca la magic size
-    double standardDeviation = getStandardDeviation();
-    
     // Calculem els llindars com el valor en el pixel +/- la desviació estàndard * magic factor
-    double value = this->getVoxelValue(getPickedPositionVoxelIndex());
-    m_lowerLevel = value - m_magicFactor * standardDeviation;
-    m_upperLevel = value + m_magicFactor * standardDeviation;
+    m_lowerLevel = m_seedValue - m_magicFactor * m_standardDeviation;
+    m_upperLevel = m_seedValue + m_magicFactor * m_standardDeviation;
 }
 
 void MagicROITool::computeRegionMask()
 {
     this->computeLevelRange();
 
-    // Creem la màscara
-    if (m_minX == 0 && m_minY == 0)
-    {
-        m_mask = QVector<bool>((m_maxX + 1) * (m_maxY + 1), false);
-    }
-    else
-    {
-        DEBUG_LOG("ERROR: extension no comença a 0");
-    }
-    
-    VoxelIndex index = getPickedPositionVoxelIndex();   // slice oriented index
-    double value = this->getVoxelValue(index);
-    int x = index.x(), y = index.y(), z = index.z();
-
-    if ((value >= m_lowerLevel) && (value <= m_upperLevel))
-    {
-        int maskIndex = getMaskVectorIndex(x, y);
-        m_mask[maskIndex] = true;
-    }
-    else
-    {
-        DEBUG_LOG("Ha petat i sortim");
-        return;
-    }
-
-    // Comencem el Region Growing
-    QVector<int> movements;
-    // First movement \TODO Codi duplicat amb main loop
-    int i = 0;
-    bool found = false;
-    int maskIndex = 0;
-    while (i < 4 && !found)
-    {
-        this->doMovement(x, y, i);
-        value = this->getVoxelValue(VoxelIndex(x, y, z));
-
-        if ((value >= m_lowerLevel) && (value <= m_upperLevel))
-        {
-            maskIndex = getMaskVectorIndex(x, y);
-            m_mask[maskIndex] = true;
-            found = true;
-            movements.push_back(i);
-        }
-        if (!found)
-        {
-            this->undoMovement(x, y, i);
-        }
-        ++i;
-    }
-
-    // Main loop
-    i = 0;
-    while (movements.size() > 0)
-    {
-        found = false;
-        while (i < 4 && !found)
-        {
-            this->doMovement(x, y, i);
-            if ((x > m_minX) && (x < m_maxX) && (y > m_minY) && (y < m_maxY))
-            {
-                value = this->getVoxelValue(VoxelIndex(x, y, z));
-                maskIndex = getMaskVectorIndex(x, y);
-                if ((value >= m_lowerLevel) && (value <= m_upperLevel) && (!m_mask[maskIndex]))
-                {
-                    m_mask[maskIndex] = true;
-                    found = true;
-                    movements.push_back(i);
-                    i = 0;
-                }
-            }
-            if (!found)
-            {
-                this->undoMovement(x, y, i);
-                ++i;
-            }
-        }
-        if (!found)
-        {
-            this->undoMovement(x, y, movements.back());
-            i = movements.back();
-            ++i;
-            movements.pop_back();
-        }
-    }
-}
-
-void MagicROITool::doMovement(int &x, int &y, int movement)
-{
-    switch (movement)
-    {
-        case MoveRight:
-            x++;
-            break;
-        case MoveLeft:
-            x--;
-            break;
-        case MoveUp:
-            y++;
-            break;
-        case MoveDown:
-            y--;
-            break;
-        default:
-            DEBUG_LOG("Invalid movement");
-    }
-}
-
-void MagicROITool::undoMovement(int &x, int &y, int movement)
-{
-    switch (movement)
-    {
-        case MoveRight:
-            x--;
-            break;
-        case MoveLeft:
-            x++;
-            break;
-        case MoveUp:
-            y--;
-            break;
-        case MoveDown:
-            y++;
-            break;
-        default:
-            DEBUG_LOG("Invalid movement");
-    }
+    // While dragging the range only widens or narrows around the seed value, so the grower can reuse the previous region
+    m_regionGrower.grow(m_lowerLevel, m_upperLevel);
 }
 
 void MagicROITool::computePolygon()
 {
-    int i = m_minX;
-    int j;
-    int maskIndex = 0;
-    // Busquem el primer punt
-    bool found = false;
-    while ((i <= m_maxX) && !found)
-    {
-        j = m_minY;
-        while ((j <= m_maxY) && !found)
-        {
-            maskIndex = getMaskVectorIndex(i, j);
-            if (m_mask[maskIndex])
-            {
-                found = true;
-            }
-            ++j;
-        }
-        ++i;
-    }
-
-    // L'índex és -1 pq els hem incrementat una vegada més    
-    int x = i - 1;
-    int y = j - 1;
     m_roiPolygon->removeVertices();
     m_filledRoiPolygon->removeVertices();
-    
-    this->addPoint(7, x, y);
-    this->addPoint(1, x, y);
-    
-    int nextX;
-    int nextY;
 
-    int direction = 0;
+    // The contour is given in slice oriented pixel coordinates, which are transformed to world coordinates with the same affine mapping as the voxels
+    SliceOrientedVolumePixelData pixelData = getPixelData();
+    int z = getPickedPositionVoxelIndex().z();
+    Vector3 origin = pixelData.getWorldCoordinate(VoxelIndex(0, 0, z));
+    Vector3 xStep = pixelData.getWorldCoordinate(VoxelIndex(1, 0, z)) - origin;
+    Vector3 yStep = pixelData.getWorldCoordinate(VoxelIndex(0, 1, z)) - origin;
 
-    bool loop = false;
-    bool next = false;
-    while (!loop)
+    foreach (const QPointF &point, m_regionGrower.traceContour())
     {
-        this->getNextIndex(direction, x, y, nextX, nextY);
-        next = getMaskValue(nextX, nextY);
-        while (!next && !loop)
-        {
-            if (MathTools::isOdd(direction) && !next)
-            {
-                this->addPoint(direction, x, y);
-                loop = this->isLoopReached();
-            }
-            direction = this->getNextDirection(direction);
-            this->getNextIndex(direction, x, y, nextX, nextY);
-            next = getMaskValue(nextX, nextY);
-        }
-        x = nextX;
-        y = nextY;
-        direction = this->getInverseDirection(direction);
-        direction = this->getNextDirection(direction);
+        Vector3 worldPoint = origin + point.x() * xStep + point.y() * yStep;
+        m_roiPolygon->addVertix(worldPoint.x, worldPoint.y, worldPoint.z);
+        m_filledRoiPolygon->addVertix(worldPoint.x, worldPoint.y, worldPoint.z);
     }
 
     m_roiPolygon->update();
     m_filledRoiPolygon->update();
 }
 
-void MagicROITool::getNextIndex(int direction, int x, int y, int &nextX, int &nextY)
-{
-    switch (direction)
-    {
-        case LeftDown:
-            nextX = x - 1;
-            nextY = y - 1;
-            break;
-        case Down:
-            nextX = x;
-            nextY = y - 1;
-            break;
-        case RightDown:
-            nextX = x + 1;
-            nextY = y - 1;
-            break;
-        case Right:
-            nextX = x + 1;
-            nextY = y;
-            break;
-        case RightUp:
-            nextX = x + 1;
-            nextY = y + 1;
-            break;
-        case Up:
-            nextX = x;
-            nextY = y + 1;
-            break;
-        case LeftUp:
-            nextX = x - 1;
-            nextY = y + 1;
-            break;
-        case Left:
-            nextX = x - 1;
-            nextY = y;
-            break;
-        default:
-            DEBUG_LOG("ERROR: This direction doesn't exist");
-    }
-}
-
-int MagicROITool::getNextDirection(int direction)
-{
-    int nextDirection = direction + 1;
-    return (nextDirection == 8)? 0: nextDirection;
-}
-
-int MagicROITool::getInverseDirection(int direction)
-{
-    return (direction + 4) % 8;
-}
-
-void MagicROITool::addPoint(int direction, int x, int y)
-{
-    int z = getPickedPositionVoxelIndex().z();
-    Vector3 p1 = getPixelData().getWorldCoordinate(VoxelIndex(x, y, z));
-    Vector3 p2;
-
-    switch (direction)
-    {
-        case Down:
-            p2 = getPixelData().getWorldCoordinate(VoxelIndex(x, y-1, z));
-            break;
-        case Right:
-            p2 = getPixelData().getWorldCoordinate(VoxelIndex(x+1, y, z));
-            break;
-        case Up:
-            p2 = getPixelData().getWorldCoordinate(VoxelIndex(x, y+1, z));
-            break;
-        case Left:
-            p2 = getPixelData().getWorldCoordinate(VoxelIndex(x-1, y, z));
-            break;
-        default:
-            DEBUG_LOG("ERROR: This direction doesn't exist");
-    }
-
-    Vector3 point = (p1 + p2) * 0.5;
-
-    m_roiPolygon->addVertix(point.x, point.y, point.z);
-    m_filledRoiPolygon->addVertix(point.x, point.y, point.z);
-}
-
-bool MagicROITool::isLoopReached()
-{
-    const double *firstVertix = this->m_roiPolygon->getVertix(0);
-    const double *lastVertix = this->m_roiPolygon->getVertix(m_roiPolygon->getNumberOfPoints() - 1);
-    return ((qAbs(firstVertix[0] - lastVertix[0]) < 0.0001)
-         && (qAbs(firstVertix[1] - lastVertix[1]) < 0.0001)
-         && (qAbs(firstVertix[2] - lastVertix[2]) < 0.0001));
-}
-
 double MagicROITool::getStandardDeviation()
 {
     VoxelIndex index = getPickedPositionVoxelIndex();   // slice oriented index
@@ -640,7 +396,6 @@ double MagicROITool::getStandardDeviation()
     int maxX = qMin(index.x() + MagicSize, m_maxX);
     int minY = qMax(index.y() - MagicSize, m_minY);
     int maxY = qMin(index.y() + MagicSize, m_maxY);
-    int z = index.z();
 
     // Calculem la mitjana
     double mean = 0.0;
@@ -650,7 +405,7 @@ double MagicROITool::getStandardDeviation()
     {
         for (int j = minY; j <= maxY; ++j)
         {
-            value = this->getVoxelValue(VoxelIndex(i, j, z));
+            value = m_regionGrower.getValue(i, j);
             mean += value;
         }
     }
@@ -664,7 +419,7 @@ double MagicROITool::getStandardDeviation()
     {
         for (int j = minY; j <= maxY; ++j)
         {
-            value = this->getVoxelValue(VoxelIndex(i, j, z));
+            value = m_regionGrower.getValue(i, j);
             deviation += qPow(value - mean, 2);
         }
     }
@@ -672,22 +427,4 @@ double MagicROITool::getStandardDeviation()
     return deviation;
 }
 
-int MagicROITool::getMaskVectorIndex(int x, int y) const
-{
-    return y * (m_maxX + 1) + x;
-}
-
-bool MagicROITool::getMaskValue(int x, int y) const
-{
-    if (MathTools::isInsideRange(x, m_minX, m_maxX) && MathTools::isInsideRange(y, m_minY, m_maxY))
-    {
-        int maskIndex = getMaskVectorIndex(x, y);
-        return m_mask[maskIndex];
-    }
-    else
-    {
-        return false;
-    }
-}
-
 }
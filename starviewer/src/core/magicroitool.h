@@ -17,7 +17,7 @@
 
 #include "roitool.h"
 
-#include <QVector>
+#include "magicroiregiongrower.h"
 
 namespace udg {
 
@@ -34,12 +34,6 @@ class VoxelIndex;
 class MagicROITool : public ROITool {
 Q_OBJECT
 public:
-    
-    // Creixement
-    enum { LeftDown, Down, RightDown, Right, RightUp, Up, LeftUp, Left };
-    // Moviments
-    enum { MoveRight, MoveLeft, MoveUp, MoveDown };
-
     MagicROITool(QViewer *viewer, QObject *parent = 0);
     ~MagicROITool();
 
@@ -64,29 +58,12 @@ private:
     /// Calcula el rang de valors d'intensitat vàlid a partir de \sa #m_magicSize i \see #m_magicFactor
     void computeLevelRange();
 
-    /// Versió iterativa del region Growing
+    /// Updates the region mask with the current level range, reusing the previous one while dragging
     void computeRegionMask();
 
-    /// Fer un moviment des d'un índex cap a una direcció
-    /// @param a, @param b índex del volum de la màscara que estem mirant en cada crida
-    /// @param movement direcció en el moviment
-    void doMovement(int &a, int &b, int movement);
-
-    /// Desfer un moviment dses d'un índex cap a una direcció
-    /// @param a, @param b índex del volum de la màscara que estem mirant en cada crida
-    /// @param movement direcció en el moviment
-    void undoMovement(int &a, int &b, int movement);
-
     /// Genera el polígon a partir de la màscara
     void computePolygon();
 
-    /// Mètodes auxiliar per la generació del polígon
-    void getNextIndex(int direction, int x, int y, int &nextX, int &nextY);
-    int getNextDirection(int direction);
-    int getInverseDirection(int direction);
-    void addPoint(int direction, int x, int y);
-    bool isLoopReached();
-
     /// Retorna la desviació estàndard dins la regió marcada per la magicSize
     double getStandardDeviation();
 
@@ -102,18 +79,9 @@ private:
     /// Calcula els bounds de la màscara
     void computeMaskBounds();
 
-    /// Returns the value of the voxel at the given slice oriented voxel index. Only the first component is considered.
-    double getVoxelValue(const VoxelIndex &index);
-
     /// Elimina la representacio temporal de la tool
     void deleteTemporalRepresentation();
 
-    /// Returns the mask index corresponding to the given x and y image indices.
-    int getMaskVectorIndex(int x, int y) const;
-
-    /// Returns the mask value at the given x and y image indices. If the indices are out of bounds, returns false.
-    bool getMaskValue(int x, int y) const;
-
 private slots:
     /// Inicialitza la tool
     void initialize();
@@ -131,8 +99,12 @@ private:
 
     double m_magicFactor;
 
-    /// Màscara de la regió que formarà el polígon
-    QVector<bool> m_mask;
+    /// Computes the region that will form the polygon. It keeps the values of the current slice while the region is being drawn.
+    MagicROIRegionGrower m_regionGrower;
+
+    /// Value of the picked voxel and standard deviation around it, computed when the region is started
+    double m_seedValue;
+    double m_standardDeviation;
 
     /// Bounds de la màscara
     int m_minX, m_maxX, m_minY, m_maxY;
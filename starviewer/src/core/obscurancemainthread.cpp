@@ -22,6 +22,8 @@
 #include <vtkVolume.h>
 #include <vtkVolumeRayCastMapper.h>
 
+#include <QTime>
+
 #include "logging.h"
 #include "obscurancethread.h"
 #include "vector3.h"
@@ -29,6 +31,14 @@
 
 namespace udg {
 
+namespace {
+
+// Number of blocks of lines of each direction per thread. Lines near the edges of the volume are much shorter than the ones in the middle, so the lines are
+// split in many more blocks than threads and the threads take them as they finish the previous ones to keep all of them busy until the end of the direction.
+const int LineBlocksPerThread = 32;
+
+}
+
 bool ObscuranceMainThread::hasColor(Variant variant)
 {
     return variant >= OpacityColorBleeding;
@@ -40,7 +50,9 @@ ObscuranceMainThread::ObscuranceMainThread(int numberOfDirections, double maximu
    m_numberOfDirections(numberOfDirections), m_maximumDistance(maximumDistance), m_function(function), m_variant(variant),
    m_doublePrecision(doublePrecision),
    m_volume(0),
-   m_obscurance(0)
+   m_obscurance(0),
+   m_saliency(0),
+   m_numberOfThreads(0)
 {
 }
 
@@ -76,6 +88,11 @@ void ObscuranceMainThread::setSaliency(const double *saliency, double fxSaliency
     m_fxSaliencyHigh = fxSaliencyHigh;
 }
 
+void ObscuranceMainThread::setNumberOfThreads(int numberOfThreads)
+{
+    m_numberOfThreads = numberOfThreads;
+}
+
 Obscurance* ObscuranceMainThread::getObscurance() const
 {
     return m_obscurance;
@@ -92,14 +109,16 @@ void ObscuranceMainThread::run()
 
     m_stopped = false;
 
+    QTime time;
+    time.start();
+
     vtkVolumeRayCastMapper *mapper = vtkVolumeRayCastMapper::SafeDownCast(m_volume->GetMapper());
     vtkEncodedGradientEstimator *gradientEstimator = mapper->GetGradientEstimator();
     /// \TODO fent això aquí crec que va més ràpid, però s'hauria de comprovar i provar també amb l'Update()
     gradientEstimator->GetEncodedNormals();
 
     // Creem els threads
-    /// \todo QThread::idealThreadCount() amb Qt >= 4.3
-    int numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+    int numberOfThreads = m_numberOfThreads > 0 ? m_numberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
     QVector<ObscuranceThread*> threads(numberOfThreads);
 
     // Variables necessàries
@@ -120,7 +139,7 @@ void ObscuranceMainThread::run()
 
     for (int i = 0; i < numberOfThreads; i++)
     {
-        ObscuranceThread * thread = new ObscuranceThread(i, numberOfThreads, m_transferFunction);
+        ObscuranceThread * thread = new ObscuranceThread(i, m_transferFunction);
         thread->setGradientEstimator(gradientEstimator);
         thread->setData(data, dataSize, dimensions, increments);
         thread->setObscuranceParameters(m_maximumDistance, m_function, m_variant, m_obscurance);
@@ -223,10 +242,13 @@ void ObscuranceMainThread::run()
         int sXYZ[3] = { sX, sY, sZ };
 
         // Iniciem els threads
+        QAtomicInt nextLineStart(0);
+        int lineBlockSize = qMax(1, lineStarts.size() / (numberOfThreads * LineBlocksPerThread));
+
         for (int j = 0; j < numberOfThreads; j++)
         {
             ObscuranceThread * thread = threads[j];
-            thread->setPerDirectionParameters(direction, forward, xyz, sXYZ, lineStarts, startDelta);
+            thread->setPerDirectionParameters(direction, forward, xyz, sXYZ, lineStarts, startDelta, &nextLineStart, lineBlockSize);
             thread->start();
         }
 
@@ -254,6 +276,9 @@ void ObscuranceMainThread::run()
 
     m_obscurance->normalize();
 
+    INFO_LOG(QString("Obscurances computed in %1 ms (%2 directions, %3 voxels, %4 threads)").arg(time.elapsed()).arg(nDirections).arg(dataSize)
+             .arg(numberOfThreads));
+
     emit computed();
 }
 
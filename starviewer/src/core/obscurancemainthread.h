@@ -49,6 +49,8 @@ public:
     void setVolume(vtkVolume *volume);
     void setTransferFunction(const TransferFunction &transferFunction);
     void setSaliency(const double *saliency, double fxSaliencyA, double fxSaliencyB, double fxSaliencyLow, double fxSaliencyHigh);
+    /// Sets the number of threads used to compute the obscurances. A value lower than 1 means that the default number of threads of VTK will be used.
+    void setNumberOfThreads(int numberOfThreads);
 
     Obscurance* getObscurance() const;
 
@@ -78,6 +80,7 @@ private:
     const double *m_saliency;
     double m_fxSaliencyA, m_fxSaliencyB;
     double m_fxSaliencyLow, m_fxSaliencyHigh;
+    int m_numberOfThreads;
 
     bool m_stopped;
 
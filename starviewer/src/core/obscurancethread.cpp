@@ -28,8 +28,9 @@
 
 namespace udg {
 
-ObscuranceThread::ObscuranceThread(int id, int numberOfThreads, const TransferFunction &transferFunction, QObject *parent)
- : QThread(parent), m_id(id), m_numberOfThreads(numberOfThreads), m_transferFunction(transferFunction), m_obscurance(0), m_saliency(0)
+ObscuranceThread::ObscuranceThread(int id, const TransferFunction &transferFunction, QObject *parent)
+ : QThread(parent), m_id(id), m_transferFunction(transferFunction), m_obscurance(0), m_saliency(0), m_nextLineStart(0), m_lineBlockSize(1),
+   m_lineBlockEnd(0)
 {
 }
 
@@ -69,7 +70,8 @@ void ObscuranceThread::setSaliency(const double * saliency, double fxSaliencyA,
 }
 
 void ObscuranceThread::setPerDirectionParameters(const Vector3 &direction, const Vector3 &forward, const int xyz[3], const int sXYZ[3],
-                                                 const QVector<Vector3> &lineStarts, qptrdiff startDelta)
+                                                 const QVector<Vector3> &lineStarts, qptrdiff startDelta, QAtomicInt *nextLineStart,
+                                                 int lineBlockSize)
 {
     m_direction = direction;
     m_forward = forward;
@@ -77,6 +79,8 @@ void ObscuranceThread::setPerDirectionParameters(const Vector3 &direction, const
     m_sXYZ = sXYZ;
     m_lineStarts = lineStarts;
     m_startDelta = startDelta;
+    m_nextLineStart = nextLineStart;
+    m_lineBlockSize = lineBlockSize;
 }
 
 void ObscuranceThread::run()
@@ -128,7 +132,7 @@ void ObscuranceThread::runDensity()
     int nLineStarts = m_lineStarts.size();
 
     // Iterar per cada línia
-    for (int j = m_id; j < nLineStarts; j += m_numberOfThreads)
+    for (int j = takeLineBlock(); j < nLineStarts; j = getNextLine(j))
     {
         Vector3 rv = m_lineStarts.at(j);
         Voxel v = { qRound(rv.x), qRound(rv.y), qRound(rv.z) };
@@ -200,7 +204,7 @@ void ObscuranceThread::runDensitySmooth()
     int nLineStarts = m_lineStarts.size();
 
     // Iterar per cada línia
-    for (int j = m_id; j < nLineStarts; j += m_numberOfThreads)
+    for (int j = takeLineBlock(); j < nLineStarts; j = getNextLine(j))
     {
         Vector3 rv = m_lineStarts.at(j);
         Voxel v = { qRound(rv.x), qRound(rv.y), qRound(rv.z) };
@@ -350,7 +354,7 @@ void ObscuranceThread::runOpacity()
     int nLineStarts = m_lineStarts.size();
 
     // Iterar per cada línia
-    for (int j = m_id; j < nLineStarts; j += m_numberOfThreads)
+    for (int j = takeLineBlock(); j < nLineStarts; j = getNextLine(j))
     {
         Vector3 rv = m_lineStarts.at(j);
         Voxel v = { qRound(rv.x), qRound(rv.y), qRound(rv.z) };
@@ -419,7 +423,7 @@ void ObscuranceThread::runOpacitySmooth()
     int nLineStarts = m_lineStarts.size();
 
     // Iterar per cada línia
-    for (int j = m_id; j < nLineStarts; j += m_numberOfThreads)
+    for (int j = takeLineBlock(); j < nLineStarts; j = getNextLine(j))
     {
         Vector3 rv = m_lineStarts.at(j);
         Voxel v = { qRound(rv.x), qRound(rv.y), qRound(rv.z) };
@@ -570,7 +574,7 @@ void ObscuranceThread::runOpacitySaliency()
     int nLineStarts = m_lineStarts.size();
 
     // Iterar per cada línia
-    for (int j = m_id; j < nLineStarts; j += m_numberOfThreads)
+    for (int j = takeLineBlock(); j < nLineStarts; j = getNextLine(j))
     {
         Vector3 rv = m_lineStarts.at(j);
         Voxel v = { qRound(rv.x), qRound(rv.y), qRound(rv.z) };
@@ -640,7 +644,7 @@ void ObscuranceThread::runOpacitySmoothSaliency()
     int nLineStarts = m_lineStarts.size();
 
     // Iterar per cada línia
-    for (int j = m_id; j < nLineStarts; j += m_numberOfThreads)
+    for (int j = takeLineBlock(); j < nLineStarts; j = getNextLine(j))
     {
         Vector3 rv = m_lineStarts.at(j);
         Voxel v = { qRound(rv.x), qRound(rv.y), qRound(rv.z) };
@@ -808,7 +812,7 @@ void ObscuranceThread::runOpacityColorBleeding()
     int nLineStarts = m_lineStarts.size();
 
     // Iterar per cada línia
-    for (int j = m_id; j < nLineStarts; j += m_numberOfThreads)
+    for (int j = takeLineBlock(); j < nLineStarts; j = getNextLine(j))
     {
         Vector3 rv = m_lineStarts.at(j);
         Voxel v = { qRound(rv.x), qRound(rv.y), qRound(rv.z) };
@@ -964,7 +968,7 @@ void ObscuranceThread::runOpacitySmoothColorBleeding()
 
     // u és el tapat, v és el que tapa
     // Iterar per cada línia
-    for (int j = m_id; j < nLineStarts; j += m_numberOfThreads)
+    for (int j = takeLineBlock(); j < nLineStarts; j = getNextLine(j))
     {
         Vector3 rv = m_lineStarts.at(j);
         Voxel v = { qRound(rv.x), qRound(rv.y), qRound(rv.z) };
@@ -1133,4 +1137,23 @@ inline double ObscuranceThread::obscurance(double distance) const
     return true;
 }
 
+int ObscuranceThread::takeLineBlock()
+{
+    int firstLine = m_nextLineStart->fetchAndAddRelaxed(m_lineBlockSize);
+    m_lineBlockEnd = firstLine + m_lineBlockSize;
+    return firstLine;
+}
+
+int ObscuranceThread::getNextLine(int line)
+{
+    line++;
+
+    if (line < m_lineBlockEnd)
+    {
+        return line;
+    }
+
+    return takeLineBlock();
+}
+
 }
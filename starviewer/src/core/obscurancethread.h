@@ -15,6 +15,7 @@
 #ifndef UDGOBSCURANCETHREAD_H
 #define UDGOBSCURANCETHREAD_H
 
+#include <QAtomicInt>
 #include <QThread>
 #include <QVector>
 
@@ -38,7 +39,7 @@ class ObscuranceThread : public QThread {
 Q_OBJECT
 
 public:
-    ObscuranceThread(int id, int numberOfThreads, const TransferFunction &transferFunction, QObject *parent = 0);
+    ObscuranceThread(int id, const TransferFunction &transferFunction, QObject *parent = 0);
     virtual ~ObscuranceThread();
 
     /// Assigna l'estimador del gradient, d'on es treuran les normals.
@@ -47,8 +48,11 @@ public:
     void setObscuranceParameters(double obscuranceMaximumDistance, ObscuranceMainThread::Function obscuranceFunction,
                                  ObscuranceMainThread::Variant obscuranceVariant, Obscurance *obscurance);
     void setSaliency(const double *saliency, double fxSaliencyA, double fxSaliencyB, double fxSaliencyLow, double fxSaliencyHigh);
+    /// Sets the parameters of a direction. Lines are distributed dynamically among all the threads in blocks of \a lineBlockSize consecutive lines: each
+    /// thread takes the next pending block by incrementing \a nextLineStart, shared by all of them, until none is left. Since each voxel belongs to a single
+    /// line in a direction, the result doesn't depend on the distribution.
     void setPerDirectionParameters(const Vector3 &direction, const Vector3 &forward, const int xyz[3], const int sXYZ[3],
-                                   const QVector<Vector3> &lineStarts, qptrdiff startDelta);
+                                   const QVector<Vector3> &lineStarts, qptrdiff startDelta, QAtomicInt *nextLineStart, int lineBlockSize);
 
 protected:
     virtual void run();
@@ -68,8 +72,12 @@ private:
     void runOpacitySmoothColorBleeding();
     double obscurance(double distance) const;
     bool smoothBlocking(const Vector3 &blocking, const Vector3 &blocked, double distance, const float *blockedGradient) const;
+    /// Takes the next pending block of lines and returns its first line. If none is left returns a value greater than or equal to the number of lines.
+    int takeLineBlock();
+    /// Returns the line to process after \a line: the next one in the current block or the first one of a new block.
+    int getNextLine(int line);
 
-    int m_id, m_numberOfThreads;
+    int m_id;
     const TransferFunction &m_transferFunction;
     vtkDirectionEncoder *m_directionEncoder;
     const ushort *m_encodedNormals;
@@ -90,6 +98,9 @@ private:
     const int *m_sXYZ;
     QVector<Vector3> m_lineStarts;
     qptrdiff m_startDelta;
+    QAtomicInt *m_nextLineStart;
+    int m_lineBlockSize;
+    int m_lineBlockEnd;
 
 };
 
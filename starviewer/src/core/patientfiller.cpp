@@ -17,6 +17,7 @@
 #include "dicomfileclassifierfillerstep.h"
 #include "dicomtagreader.h"
 #include "encapsulateddocumentfillerstep.h"
+#include "image.h"
 #include "imagefillerstep.h"
 //#include "keyimagenotefillerstep.h"       // future use
 #include "logging.h"
@@ -29,20 +30,71 @@
 #include "temporaldimensionfillerstep.h"
 #include "volumefillerstep.h"
 
+#include <QFuture>
+#include <QThread>
+#include <QtConcurrentMap>
+
 namespace udg {
 
 namespace {
 
+// Number of files per thread that are read ahead while the rest of steps are executed when processing files in parallel.
+// Keeps the memory used by the files waiting to be processed bounded.
+const int FilesReadAheadPerThread = 32;
+
 // Returns true if the list contains MHD files and false otherwise. Only the first file is checked.
 bool containsMHDFiles(const QStringList &files)
 {
     return !files.isEmpty() && files.first().endsWith(".mhd", Qt::CaseInsensitive);
 }
 
+// A DICOM file read and with its images already created, ready to be processed by the rest of first stage steps.
+struct PreparedDICOMFile
+{
+    DICOMTagReader *dicomTagReader;
+    QList<Image*> images;
+};
+
+// Reads a DICOM file and creates its images with the given step. It's used to prepare several files at the same time.
+class DICOMFilePreparer {
+public:
+    typedef PreparedDICOMFile result_type;
+
+    DICOMFilePreparer(ImageFillerStep *imageFillerStep, QThread *imagesThread)
+        : m_imageFillerStep(imageFillerStep), m_imagesThread(imagesThread)
+    {
+    }
+
+    PreparedDICOMFile operator()(const QString &file) const
+    {
+        PreparedDICOMFile preparedFile;
+        // Fillers only need the attributes, so bulk data is not loaded.
+        preparedFile.dicomTagReader = new DICOMTagReader(file, DICOMTagReader::MetadataOnly);
+
+        // Images are not created for invalid files because the DICOMFileClassifierFillerStep will skip them
+        if (preparedFile.dicomTagReader->canReadFile())
+        {
+            preparedFile.images = m_imageFillerStep->createImages(preparedFile.dicomTagReader);
+
+            // Images are QObjects and must live in the thread that will use them, not in the worker thread
+            foreach (Image *image, preparedFile.images)
+            {
+                image->moveToThread(m_imagesThread);
+            }
+        }
+
+        return preparedFile;
+    }
+
+private:
+    ImageFillerStep *m_imageFillerStep;
+    QThread *m_imagesThread;
+};
+
 }
 
 PatientFiller::PatientFiller(DICOMSource dicomSource, QObject *parent)
- : QObject(parent), m_numberOfProcessedFiles(0)
+ : QObject(parent), m_imageFillerStep(0), m_parallelProcessingEnabled(true), m_numberOfProcessedFiles(0)
 {
     createSteps();
 
@@ -94,6 +146,44 @@ void PatientFiller::processDICOMFile(const DICOMTagReader *dicomTagReader)
     emit progress(++m_numberOfProcessedFiles);
 }
 
+void PatientFiller::processDICOMFile(const DICOMTagReader *dicomTagReader, const QList<Image*> &images)
+{
+    Q_ASSERT(dicomTagReader);
+
+    m_patientFillerInput->setDICOMFile(dicomTagReader);
+
+    bool imagesUsed = false;
+
+    foreach (PatientFillerStep *fillerStep, m_firstStageSteps)
+    {
+        bool filled;
+
+        if (fillerStep == m_imageFillerStep)
+        {
+            // The image filler step takes ownership of the images
+            filled = m_imageFillerStep->fillIndividually(images);
+            imagesUsed = true;
+        }
+        else
+        {
+            filled = fillerStep->fillIndividually();
+        }
+
+        // Same as in processDICOMFile(const DICOMTagReader*)
+        if (!filled)
+        {
+            break;
+        }
+    }
+
+    if (!imagesUsed)
+    {
+        qDeleteAll(images);
+    }
+
+    emit progress(++m_numberOfProcessedFiles);
+}
+
 void PatientFiller::finishDICOMFilesProcess()
 {
     foreach (Patient *patient, m_patientFillerInput->getPatientList())
@@ -134,9 +224,15 @@ QList<Patient*> PatientFiller::processFiles(const QStringList &files)
     }
 }
 
+void PatientFiller::setParallelProcessingEnabled(bool enabled)
+{
+    m_parallelProcessingEnabled = enabled;
+}
+
 void PatientFiller::createSteps()
 {
-    m_firstStageSteps << new DICOMFileClassifierFillerStep() << new ImageFillerStep() << new EncapsulatedDocumentFillerStep();
+    m_imageFillerStep = new ImageFillerStep();
+    m_firstStageSteps << new DICOMFileClassifierFillerStep() << m_imageFillerStep << new EncapsulatedDocumentFillerStep();
     m_secondStageSteps << new VolumeFillerStep() << new OrderImagesFillerStep() << new TemporalDimensionFillerStep();
 }
 
@@ -162,11 +258,18 @@ QList<Patient*> PatientFiller::processMHDFiles(const QStringList &files)
 
 QList<Patient*> PatientFiller::processDICOMFiles(const QStringList &files)
 {
-    foreach (const QString &dicomFile, files)
+    if (m_parallelProcessingEnabled && QThread::idealThreadCount() > 1 && files.size() > 1)
+    {
+        this->processDICOMFilesInParallel(files);
+    }
+    else
     {
-        // The DICOMTagReader is deleted by the PatientFillerInput
-        DICOMTagReader *dicomTagReader = new DICOMTagReader(dicomFile);
-        this->processDICOMFile(dicomTagReader);
+        foreach (const QString &dicomFile, files)
+        {
+            // The DICOMTagReader is deleted by the PatientFillerInput. Fillers only need the attributes, so bulk data is not loaded.
+            DICOMTagReader *dicomTagReader = new DICOMTagReader(dicomFile, DICOMTagReader::MetadataOnly);
+            this->processDICOMFile(dicomTagReader);
+        }
     }
 
     this->finishDICOMFilesProcess();
@@ -174,4 +277,30 @@ QList<Patient*> PatientFiller::processDICOMFiles(const QStringList &files)
     return m_patientFillerInput->getPatientList();
 }
 
+void PatientFiller::processDICOMFilesInParallel(const QStringList &files)
+{
+    DICOMFilePreparer preparer(m_imageFillerStep, QThread::currentThread());
+    const int blockSize = FilesReadAheadPerThread * QThread::idealThreadCount();
+
+    // Files are prepared in blocks: while the files of a block are processed here in order, the next block is being prepared in other threads
+    QFuture<PreparedDICOMFile> nextBlock = QtConcurrent::mapped(files.mid(0, blockSize), preparer);
+
+    for (int blockStart = 0; blockStart < files.size(); blockStart += blockSize)
+    {
+        QFuture<PreparedDICOMFile> currentBlock = nextBlock;
+
+        if (blockStart + blockSize < files.size())
+        {
+            nextBlock = QtConcurrent::mapped(files.mid(blockStart + blockSize, blockSize), preparer);
+        }
+
+        // Results are given in the same order as the files and iterating waits for each one to be ready
+        for (QFuture<PreparedDICOMFile>::const_iterator it = currentBlock.constBegin(); it != currentBlock.constEnd(); ++it)
+        {
+            // The DICOMTagReader is deleted by the PatientFillerInput
+            this->processDICOMFile(it->dicomTagReader, it->images);
+        }
+    }
+}
+
 }
@@ -22,6 +22,8 @@
 namespace udg {
 
 class DICOMTagReader;
+class Image;
+class ImageFillerStep;
 class Patient;
 class PatientFillerInput;
 class PatientFillerStep;
@@ -33,6 +35,9 @@ class PatientFillerStep;
  * Alternatively, files can be given to it all at once (e.g. when reading fils from a directory) in processFiles().
  *
  * The files are processed by several steps that share a common PatientFillerInput.
+ *
+ * When processing several DICOM files at once, files are read and their images created in several threads, while the rest of the first stage is executed
+ * in the calling thread following the order of the files. The result is the same as processing the files one by one.
  */
 class PatientFiller : public QObject {
 
@@ -42,6 +47,9 @@ public:
     PatientFiller(DICOMSource dicomSource = DICOMSource(), QObject *parent = 0);
     virtual ~PatientFiller();
 
+    /// Enables or disables reading files and creating images in several threads in processFiles(). It's enabled by default.
+    void setParallelProcessingEnabled(bool enabled);
+
 public slots:
     /// Processes the given DICOM file. Executes the first stage steps with the file. Emits the progress() signal at the end.
     void processDICOMFile(const DICOMTagReader *dicomTagReader);
@@ -71,11 +79,24 @@ private:
     /// Processes the given DICOM files and returns the generated patients.
     QList<Patient*> processDICOMFiles(const QStringList &files);
 
+    /// Executes the first stage steps with the given DICOM files. Files are read and their images are created in several threads, and the rest of steps
+    /// are executed in the calling thread in the order of the files.
+    void processDICOMFilesInParallel(const QStringList &files);
+
+    /// Executes the first stage steps with the given DICOM file using the given images, already created from that file by the ImageFillerStep.
+    /// Emits the progress() signal at the end.
+    void processDICOMFile(const DICOMTagReader *dicomTagReader, const QList<Image*> &images);
+
 private:
     /// Steps that are executed in the first stage of processing.
     QList<PatientFillerStep*> m_firstStageSteps;
     /// Steps that are executed in the second stage of processing.
     QList<PatientFillerStep*> m_secondStageSteps;
+    /// The image filler step, also included in the first stage steps. Kept apart because it can create images in parallel.
+    ImageFillerStep *m_imageFillerStep;
+
+    /// True if files have to be read and images created in several threads when processing several DICOM files at once.
+    bool m_parallelProcessingEnabled;
 
     /// S'encarrega de guardar l'input durant tota l'execucció dels mòduls. S'utilitza
     /// en cas que es processin fitxer individualment.
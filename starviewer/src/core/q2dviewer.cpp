@@ -42,6 +42,7 @@
 #include "patientbrowsermenu.h"
 #include "voiluthelper.h"
 #include "sliceorientedvolumepixeldata.h"
+#include "vtkdcmtkimagereader.h"
 
 // Qt
 #include <QResizeEvent>
@@ -54,6 +55,7 @@
 #include <QVTKWidget.h>
 #include <vtkWindowToImageFilter.h>
 #include <vtkImageProperty.h>
+#include <vtkImageData.h>
 #include <vtkImageSlice.h>
 #include <vtkMatrix4x4.h>
 
@@ -70,10 +72,17 @@ Q2DViewer::Q2DViewer(QWidget *parent)
     initializeDummyDisplayUnit();
     m_volumeReaderManager = new VolumeReaderManager(this);
     m_inputFinishedCommand = NULL;
+    m_isShowingPartiallyLoadedVolume = false;
+    m_isPartiallyLoadedVolumeLocked = false;
 
     connect(m_volumeReaderManager, SIGNAL(readingFinished()), SLOT(volumeReaderJobFinished()));
+    connect(m_volumeReaderManager, SIGNAL(priorityFramesLoaded(Volume*, vtkImageData*)), SLOT(setPartiallyLoadedVolume(Volume*, vtkImageData*)));
+    connect(m_volumeReaderManager, SIGNAL(framesLoaded(Volume*, QList<int>)), SLOT(updatePartiallyLoadedVolume(Volume*, QList<int>)));
     connect(m_volumeReaderManager, SIGNAL(progress(int)), m_workInProgressWidget, SLOT(updateProgress(int)));
     connect(m_patientBrowserMenu, SIGNAL(selectedVolumes(QList<Volume*>)), this, SLOT(setInputAndRender(QList<Volume*>)));
+    // Every render, whatever triggers it, goes through these events
+    m_vtkQtConnections->Connect(this->getRenderWindow(), vtkCommand::StartEvent, this, SLOT(lockPartiallyLoadedVolumeForRendering()));
+    m_vtkQtConnections->Connect(this->getRenderWindow(), vtkCommand::EndEvent, this, SLOT(unlockPartiallyLoadedVolumeAfterRendering()));
 
     // Creem anotacions i actors
     m_annotationsHandler = new Q2DViewerAnnotationHandler(this);
@@ -93,6 +102,9 @@ Q2DViewer::Q2DViewer(QWidget *parent)
 
 Q2DViewer::~Q2DViewer()
 {
+    // In case a render has been interrupted by an exception
+    unlockPartiallyLoadedVolumeAfterRendering();
+
     delete m_displayUnitsFactory;
     delete m_dummyDisplayUnit;
     // Fem delete d'altres objectes vtk en cas que s'hagin hagut de crear
@@ -395,6 +407,7 @@ void Q2DViewer::setInput(Volume *volume)
     }
 
     m_volumeReaderManager->cancelReading();
+    m_isShowingPartiallyLoadedVolume = false;
     deleteInputFinishedCommand();
 
     setNewVolumes(QList<Volume*>() << volume);
@@ -414,6 +427,7 @@ void Q2DViewer::setInputAsynchronously(Volume *volume, QViewerCommand *inputFini
 void Q2DViewer::setInputAsynchronously(const QList<Volume *> &volumes, QViewerCommand *inputFinishedCommand)
 {
     m_volumeReaderManager->cancelReading();
+    m_isShowingPartiallyLoadedVolume = false;
     setInputFinishedCommand(inputFinishedCommand);
 
     bool allowAsynchronousVolumeLoading = Settings().getValue(CoreSettings::AllowAsynchronousVolumeLoading).toBool();
@@ -482,7 +496,12 @@ void Q2DViewer::loadVolumeAsynchronously(Volume *volume)
 void Q2DViewer::loadVolumesAsynchronously(const QList<Volume*> &volumes)
 {
     setViewerStatus(LoadingVolume);
+    m_loadingTime.start();
 
+    // Only single volumes are shown progressively, starting at the slice that will be displayed first
+    bool progressiveLoading = volumes.size() == 1 && Settings().getValue(CoreSettings::AllowProgressiveVolumeLoading).toBool();
+    int firstSlice = m_inputFinishedCommand ? m_inputFinishedCommand->getSliceToDisplay() : -1;
+    m_volumeReaderManager->setProgressiveReading(progressiveLoading, qMax(firstSlice, 0));
     m_volumeReaderManager->readVolumes(volumes);
 
     // TODO: De moment no tenim cap més remei que especificar un volume fals. La resta del viewer (i els que en depenen) s'esperen
@@ -500,9 +519,39 @@ void Q2DViewer::loadVolumesAsynchronously(const QList<Volume*> &volumes)
 
 void Q2DViewer::volumeReaderJobFinished()
 {
+    bool wasShowingPartiallyLoadedVolume = m_isShowingPartiallyLoadedVolume;
+    m_isShowingPartiallyLoadedVolume = false;
+
     if (m_volumeReaderManager->readingSuccess())
     {
-        setNewVolumesAndExecuteCommand(m_volumeReaderManager->getVolumes());
+        QList<Volume*> volumes = m_volumeReaderManager->getVolumes();
+
+        if (wasShowingPartiallyLoadedVolume && canReplacePartiallyLoadedVolume(volumes.first()))
+        {
+            replacePartiallyLoadedVolume(volumes.first());
+            INFO_LOG(QString("Volume %1 completely loaded after %2 ms").arg(getMainInput()->getIdentifier().getValue()).arg(m_loadingTime.elapsed()));
+        }
+        else if (wasShowingPartiallyLoadedVolume)
+        {
+            // The geometry has changed, so the view has to be reset, but the slice that the user was looking at is kept
+            OrthogonalPlane viewPlane = getCurrentViewPlane();
+            int slice = getCurrentSlice();
+
+            setNewVolumesAndExecuteCommand(volumes);
+            INFO_LOG(QString("Volume %1 completely loaded after %2 ms").arg(getMainInput()->getIdentifier().getValue()).arg(m_loadingTime.elapsed()));
+
+            if (getCurrentViewPlane() == viewPlane)
+            {
+                setSlice(slice);
+                render();
+            }
+        }
+        else
+        {
+            setNewVolumesAndExecuteCommand(volumes);
+            INFO_LOG(QString("Time to first image of volume %1: %2 ms (not progressive)").arg(getMainInput()->getIdentifier().getValue())
+                .arg(m_loadingTime.elapsed()));
+        }
     }
     else
     {
@@ -511,12 +560,16 @@ void Q2DViewer::volumeReaderJobFinished()
     }
 }
 
-void Q2DViewer::setNewVolumesAndExecuteCommand(const QList<Volume*> &volumes)
+void Q2DViewer::setNewVolumesAndExecuteCommand(const QList<Volume*> &volumes, bool emitNewVolumesRendered)
 {
     try
     {
         setNewVolumes(volumes);
-        emit newVolumesRendered();
+
+        if (emitNewVolumesRendered)
+        {
+            emit newVolumesRendered();
+        }
     }
     catch (...)
     {
@@ -529,6 +582,130 @@ void Q2DViewer::setNewVolumesAndExecuteCommand(const QList<Volume*> &volumes)
     }
 }
 
+void Q2DViewer::setPartiallyLoadedVolume(Volume *volume, vtkImageData *imageData)
+{
+    if (!m_volumeReaderManager->isReading())
+    {
+        return;
+    }
+
+    if (m_isShowingPartiallyLoadedVolume)
+    {
+        // The reader has reallocated the data to change the scalar type. The geometry is the same, so the view is kept.
+        getMainInput()->setData(imageData);
+        getMainDisplayUnit()->replaceVolume(getMainInput());
+        render();
+        return;
+    }
+
+    // As the dummy volume shown while loading, it's a volume owned by the viewer that will be deleted when the loaded volume is set
+    Volume *partiallyLoadedVolume = new Volume(this);
+    partiallyLoadedVolume->setObjectName(DummyVolumeObjectName);
+    partiallyLoadedVolume->setImages(volume->getImages());
+    partiallyLoadedVolume->setNumberOfPhases(volume->getNumberOfPhases());
+    partiallyLoadedVolume->setNumberOfSlicesPerPhase(volume->getNumberOfSlicesPerPhase());
+    partiallyLoadedVolume->setData(imageData);
+    partiallyLoadedVolume->setIdentifier(volume->getIdentifier());
+
+    // Set before the first render so that it's already done holding the lock.
+    // The viewers are synchronized only once, when the completed volume replaces this one.
+    m_isShowingPartiallyLoadedVolume = true;
+    setNewVolumesAndExecuteCommand(QList<Volume*>() << partiallyLoadedVolume, false);
+
+    if (getMainInput() != partiallyLoadedVolume)
+    {
+        // It couldn't be shown
+        m_isShowingPartiallyLoadedVolume = false;
+        return;
+    }
+
+    INFO_LOG(QString("Time to first image of volume %1: %2 ms (progressive)").arg(volume->getIdentifier().getValue()).arg(m_loadingTime.elapsed()));
+}
+
+void Q2DViewer::updatePartiallyLoadedVolume(Volume *volume, const QList<int> &frameIndices)
+{
+    Q_UNUSED(volume)
+
+    if (!m_isShowingPartiallyLoadedVolume)
+    {
+        return;
+    }
+
+    // Frame indices are slice indices in the acquisition plane because only volumes with one phase are loaded progressively.
+    // In the other planes all the displayed images change when new slices arrive.
+    if (getCurrentViewPlane() != OrthogonalPlane::XYPlane || frameIndices.contains(getCurrentSlice()))
+    {
+        getMainInput()->getVtkData()->Modified();
+        render();
+    }
+}
+
+bool Q2DViewer::canReplacePartiallyLoadedVolume(Volume *volume)
+{
+    Volume *partiallyLoadedVolume = getMainInput();
+
+    if (getNumberOfInputs() != 1 || !partiallyLoadedVolume || !volume)
+    {
+        return false;
+    }
+
+    int partialDimensions[3], dimensions[3];
+    partiallyLoadedVolume->getDimensions(partialDimensions);
+    volume->getDimensions(dimensions);
+    double partialSpacing[3], spacing[3];
+    partiallyLoadedVolume->getSpacing(partialSpacing);
+    volume->getSpacing(spacing);
+    double partialOrigin[3], origin[3];
+    partiallyLoadedVolume->getOrigin(partialOrigin);
+    volume->getOrigin(origin);
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (partialDimensions[i] != dimensions[i] || !MathTools::closeEnough(partialSpacing[i], spacing[i]) ||
+            !MathTools::closeEnough(partialOrigin[i], origin[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Q2DViewer::replacePartiallyLoadedVolume(Volume *volume)
+{
+    Volume *partiallyLoadedVolume = getMainInput();
+
+    // Unlike setNewVolumes(), the view isn't reset and the input finished command isn't executed again, so that the changes made by the user while the
+    // volume was being loaded are kept
+    getMainDisplayUnit()->replaceVolume(volume);
+    delete partiallyLoadedVolume;
+
+    // They are not loaded for the partially loaded volume
+    loadOverlays(volume);
+    render();
+
+    emit volumeChanged(volume);
+    emit newVolumesRendered();
+}
+
+void Q2DViewer::lockPartiallyLoadedVolumeForRendering()
+{
+    if (m_isShowingPartiallyLoadedVolume && !m_isPartiallyLoadedVolumeLocked)
+    {
+        VtkDcmtkImageReader::getProgressiveReadLock()->lockForRead();
+        m_isPartiallyLoadedVolumeLocked = true;
+    }
+}
+
+void Q2DViewer::unlockPartiallyLoadedVolumeAfterRendering()
+{
+    if (m_isPartiallyLoadedVolumeLocked)
+    {
+        VtkDcmtkImageReader::getProgressiveReadLock()->unlock();
+        m_isPartiallyLoadedVolumeLocked = false;
+    }
+}
+
 Volume* Q2DViewer::getDummyVolumeFromVolume(Volume *volume)
 {
     // TODO: Estem perdent memòria durant la vida del 2dviewer, caldria esborrar el dummy d'abans
@@ -935,6 +1112,15 @@ void Q2DViewer::setPhaseInVolume(int index, int phase)
     this->render();
 }
 
+void Q2DViewer::prefetchPhases(const QList<int> &phases)
+{
+    // The phases are prepared reading the input from worker threads, which is only safe when it isn't the output of the fusion blender
+    if (hasInput() && getNumberOfInputs() == 1)
+    {
+        getMainDisplayUnit()->getImagePipeline()->prefetchPhases(phases);
+    }
+}
+
 void Q2DViewer::updateSliceToDisplay(int value, SliceDimension dimension)
 {
     if (hasInput())
@@ -21,6 +21,7 @@
 #include "volumedisplayunit.h"
 
 #include <QPointer>
+#include <QTime>
 
 // Fordward declarations
 // Vtk
@@ -320,6 +321,8 @@ public slots:
     void setPhase(int value);
     /// Sets the given phase index to the volume at the given index. If there isn't a volume at the given index, it does nothing.
     void setPhaseInVolume(int index, int phase);
+    /// Prepares the images of the given phases of the main volume in worker threads so that they can be shown without delay by setPhase().
+    void prefetchPhases(const QList<int> &phases);
 
     /// Indica el tipu de solapament dels volums, per defecte blending
     void setOverlapMethod(OverlapMethod method);
@@ -498,7 +501,14 @@ private:
     void updateCurrentImageDefaultPresetsInAllInputsOnOriginalAcquisitionPlane();
 
     /// Calls setNewVolumes and excutes the command while catching any exception that may be thrown.
-    void setNewVolumesAndExecuteCommand(const QList<Volume*> &volumes);
+    /// newVolumesRendered() is only emitted if emitNewVolumesRendered is true.
+    void setNewVolumesAndExecuteCommand(const QList<Volume*> &volumes, bool emitNewVolumesRendered = true);
+
+    /// Returns true if the given completely loaded volume can replace the partially loaded volume being shown without resetting the view, i.e. if they have
+    /// the same geometry. Postprocessors may have changed the spacing of the completed volume.
+    bool canReplacePartiallyLoadedVolume(Volume *volume);
+    /// Shows the given completely loaded volume instead of the partially loaded one, keeping the view plane, slice, camera, VOI LUT and drawings.
+    void replacePartiallyLoadedVolume(Volume *volume);
 
     /// Elimina els bitmaps que s'hagin creat per aquest viewer
     void removeViewerBitmaps();
@@ -537,6 +547,16 @@ private slots:
 
     void volumeReaderJobFinished();
 
+    /// Shows the volume being loaded progressively with the slices that are already available in the given image data.
+    void setPartiallyLoadedVolume(Volume *volume, vtkImageData *imageData);
+    /// Refreshes the partially loaded volume if the displayed slice is among the given newly loaded slices.
+    void updatePartiallyLoadedVolume(Volume *volume, const QList<int> &frameIndices);
+
+    /// Called when a render starts and ends. While a partially loaded volume is shown, the reader threads are still writing into its data, so it's only
+    /// rendered while holding the progressive read lock of VtkDcmtkImageReader.
+    void lockPartiallyLoadedVolumeForRendering();
+    void unlockPartiallyLoadedVolumeAfterRendering();
+
 protected:
     /// Aquest és el segon volum afegit a solapar
     Volume *m_overlayVolume;
@@ -583,6 +603,14 @@ private:
 
     QViewerCommand *m_inputFinishedCommand;
 
+    /// Measures the time since an asynchronous load starts until the first image and the whole volume are shown.
+    QTime m_loadingTime;
+    /// True while a partially loaded volume is being shown. Its data is shared with the reader, whose threads are still writing slices into it, so it must
+    /// only be read holding VtkDcmtkImageReader::getProgressiveReadLock(). Renders take the lock by themselves (see lockPartiallyLoadedVolumeForRendering()).
+    bool m_isShowingPartiallyLoadedVolume;
+    /// True while the progressive read lock is held by a render.
+    bool m_isPartiallyLoadedVolumeLocked;
+
     /// Llistat d'overlays
     QList<DrawerBitmap*> m_viewerBitmaps;
 
@@ -14,6 +14,7 @@
 
 #include "q3dviewer.h"
 #include "volume.h"
+#include "volumerepository.h"
 #include "image.h"
 #include "series.h"
 #include "imageplane.h"
@@ -25,6 +26,7 @@
 // Include's qt
 #include <QString>
 #include <QMessageBox>
+#include <QTime>
 
 // Include's vtk
 
@@ -67,6 +69,7 @@
 #include "directilluminationvoxelshader.h"
 #include "obscurancevoxelshader.h"
 #include "contourvoxelshader.h"
+#include "emptyspacemap.h"
 #include "vtk4dlinearregressiongradientestimator.h"
 #include <vtkPointData.h>
 #include <vtkEncodedGradientShader.h>
@@ -77,7 +80,7 @@
 namespace udg {
 
 Q3DViewer::Q3DViewer(QWidget *parent)
- : QViewer(parent), m_imageData(0), m_vtkVolume(0), m_volumeProperty(0), m_clippingPlanes(0)
+ : QViewer(parent), m_imageData(0), m_vtkVolume(0), m_volumeProperty(0), m_range(0.0), m_scalarShift(0.0), m_clippingPlanes(0)
 {
     m_defaultFitIntoViewportMarginRate = 0.4;
     m_vtkWidget->setAutomaticImageCacheEnabled(true);
@@ -153,6 +156,13 @@ Q3DViewer::Q3DViewer(QWidget *parent)
         vtkVolumeRayCastSingleVoxelShaderCompositeFunction<DirectIlluminationContourObscuranceVoxelShader>::New();
     m_volumeRayCastDirectIlluminationContourObscuranceFunction->SetCompositeMethodToClassifyFirst();
     m_volumeRayCastDirectIlluminationContourObscuranceFunction->SetVoxelShader(m_directIlluminationContourObscuranceVoxelShader);
+    m_emptySpaceMap = new EmptySpaceMap();
+    m_volumeRayCastAmbientContourFunction->SetEmptySpaceMap(m_emptySpaceMap);
+    m_volumeRayCastDirectIlluminationContourFunction->SetEmptySpaceMap(m_emptySpaceMap);
+    m_volumeRayCastAmbientObscuranceFunction->SetEmptySpaceMap(m_emptySpaceMap);
+    m_volumeRayCastDirectIlluminationObscuranceFunction->SetEmptySpaceMap(m_emptySpaceMap);
+    m_volumeRayCastAmbientContourObscuranceFunction->SetEmptySpaceMap(m_emptySpaceMap);
+    m_volumeRayCastDirectIlluminationContourObscuranceFunction->SetEmptySpaceMap(m_emptySpaceMap);
     m_volumeRayCastIsosurfaceFunction = vtkVolumeRayCastIsosurfaceFunction::New();
 
     m_contourOn = false;
@@ -171,6 +181,7 @@ Q3DViewer::Q3DViewer(QWidget *parent)
 
 Q3DViewer::~Q3DViewer()
 {
+    VolumeRepository::getRepository()->releaseVolume(m_mainVolume);
     /// \todo falta revisar què falta per destruir
     if (m_obscuranceMainThread && m_obscuranceMainThread->isRunning())
     {
@@ -190,6 +201,7 @@ Q3DViewer::~Q3DViewer()
     delete m_directIlluminationObscuranceVoxelShader;
     delete m_ambientContourObscuranceVoxelShader;
     delete m_directIlluminationContourObscuranceVoxelShader;
+    delete m_emptySpaceMap;
 
     // Eliminem tots els elements vtk creats
     if (m_4DLinearRegressionGradientEstimator)
@@ -379,12 +391,26 @@ void Q3DViewer::setInput(Volume *volume)
         return;
     }
 
-    if (!rescale(volume))
+    QTime time;
+    time.start();
+
+    // The CPU ray cast mapper needs the data as unsigned short. If it's the current one the copy is made now so that the volume can be rejected cleanly if
+    // there's not enough memory, otherwise it's delayed until it's needed.
+    vtkImageData *unsignedShortImageData = 0;
+    if (usesCpuRayCastMapper())
     {
-        unsetCursor();
-        return;
+        unsignedShortImageData = createUnsignedShortImageData(volume);
+        if (!unsignedShortImageData)
+        {
+            unsetCursor();
+            return;
+        }
     }
 
+    double range[2];
+    volume->getScalarRange(range);
+    DEBUG_LOG(QString("Q3DViewer: volume scalar range: min = %1, max = %2").arg(range[0]).arg(range[1]));
+
     if (m_clippingPlanes)
     {
         m_volumeMapper->RemoveAllClippingPlanes();
@@ -392,16 +418,25 @@ void Q3DViewer::setInput(Volume *volume)
         m_clippingPlanes->Delete();
         m_clippingPlanes = 0;
     }
+    VolumeRepository::getRepository()->retainVolume(volume);
+    VolumeRepository::getRepository()->releaseVolume(m_mainVolume);
     m_mainVolume = volume;
 
-    setVolumeTransformation();
+    // The transfer functions are defined in the range [0, m_range]
+    m_scalarShift = -range[0];
+    m_range = range[1] - range[0];
+    emit scalarRange(0, m_range);
 
-    m_volumeMapper->SetInputData(m_imageData);
-    m_gpuRayCastMapper->SetInputData(m_imageData);
+    if (m_imageData)
+    {
+        // Fem un Delete() de m_imageData perquè es destrueixi
+        // La destrucció no és immediata perquè encara hi queden referències al pipeline de VTK
+        m_imageData->Delete();
+    }
+    m_imageData = unsignedShortImageData;
 
-    unsigned short *data = reinterpret_cast<unsigned short*>(m_imageData->GetPointData()->GetScalars()->GetVoidPointer(0));
-    m_ambientVoxelShader->setData(data, static_cast<unsigned short>(m_range));
-    m_directIlluminationVoxelShader->setData(data, static_cast<unsigned short>(m_range));
+    setVolumeTransformation();
+    updateMapperInputs();
 
     if (m_obscuranceMainThread && m_obscuranceMainThread->isRunning())
     {
@@ -421,6 +456,11 @@ void Q3DViewer::setInput(Volume *volume)
 
     applyCurrentRenderingMethod();
 
+    INFO_LOG(QString("Q3DViewer: input set in %1 ms, %2").arg(time.elapsed())
+             .arg(m_imageData && m_imageData != volume->getVtkData() ? QString("with an unsigned short copy of %1 MB for the CPU ray cast mapper")
+                                                                        .arg(m_imageData->GetActualMemorySize() / 1024)
+                                                                    : QString("without copying the data")));
+
     // Indiquem el canvi de volum
     emit volumeChanged(getMainInput());
 
@@ -474,10 +514,22 @@ void Q3DViewer::setTransferFunction(const TransferFunction &transferFunction)
 {
     m_transferFunction = transferFunction;
 
-    m_volumeProperty->SetScalarOpacity(m_transferFunction.vtkOpacityTransferFunction());
-    m_volumeProperty->SetColor(m_transferFunction.vtkColorTransferFunction());
+    // The transfer function is defined in the range [0, m_range]. The CPU ray cast mapper renders the unsigned short data, which is already shifted to that
+    // range, but the GPU ray cast mapper renders the original data, so in this case the shift is applied to the transfer function instead.
+    if (m_vtkVolume->GetMapper() == m_gpuRayCastMapper && m_scalarShift != 0.0)
+    {
+        TransferFunction shiftedTransferFunction = m_transferFunction.toNewRange(0.0, 1.0, -m_scalarShift, 1.0 - m_scalarShift);
+        m_volumeProperty->SetScalarOpacity(shiftedTransferFunction.vtkOpacityTransferFunction());
+        m_volumeProperty->SetColor(shiftedTransferFunction.vtkColorTransferFunction());
+    }
+    else
+    {
+        m_volumeProperty->SetScalarOpacity(m_transferFunction.vtkOpacityTransferFunction());
+        m_volumeProperty->SetColor(m_transferFunction.vtkColorTransferFunction());
+    }
     m_ambientVoxelShader->setTransferFunction(m_transferFunction);
     m_directIlluminationVoxelShader->setTransferFunction(m_transferFunction);
+    m_emptySpaceMap->setTransferFunction(m_transferFunction);
 
     if (m_volumeProperty->GetShade())
     {
@@ -514,29 +566,36 @@ void Q3DViewer::setDefaultViewForCurrentInput()
     resetViewToCoronal();
 }
 
+bool Q3DViewer::usesCpuRayCastMapper() const
+{
+    return m_renderFunction == RayCasting || m_renderFunction == RayCastingObscurance || m_renderFunction == MIP3D || m_renderFunction == IsoSurface;
+}
+
 // Desplacem les dades de manera que el mínim sigui 0 i ho convertim a un unsigned short, perquè el ray casting no accepta signed short.
-bool Q3DViewer::rescale(Volume *volume)
+vtkImageData* Q3DViewer::createUnsignedShortImageData(Volume *volume)
 {
     if (!volume)
     {
-        return false;
+        return 0;
     }
 
     double range[2];
     volume->getScalarRange(range);
-    
-    double min = range[0];
-    double max = range[1];
-    double rangeLength = max - min;
-    double shift = -min;
-    DEBUG_LOG(QString("Q3DViewer: volume scalar range: min = %1, max = %2, range = %3, shift = %4").arg(min).arg(max).arg(rangeLength).arg(shift));
+    double shift = -range[0];
+
+    vtkImageData *originalImageData = volume->getVtkData();
+
+    // If the data is already unsigned short starting at 0 the copy would be identical
+    if (originalImageData->GetScalarType() == VTK_UNSIGNED_SHORT && shift == 0.0)
+    {
+        originalImageData->Register(0);
+        return originalImageData;
+    }
 
     vtkImageShiftScale *rescaler = vtkImageShiftScale::New();
-    rescaler->SetInputData(volume->getVtkData());
+    rescaler->SetInputData(originalImageData);
     rescaler->SetShift(shift);
-//    rescaler->SetScale(1.0);    // per defecte
-    // Ho psoem en unsigned short per tal de mantenir tota la informació
-    // Desavantatge: ocupa més memòria
+    // Ho posem en unsigned short per tal de mantenir tota la informació
     rescaler->SetOutputScalarTypeToUnsignedShort();
     rescaler->ClampOverflowOn();
 
@@ -545,35 +604,78 @@ bool Q3DViewer::rescale(Volume *volume)
         // El lloc on pot generar l'excepció és aquí
         rescaler->Update();
 
-        if (m_imageData)
+        vtkImageData *unsignedShortImageData = rescaler->GetOutput();
+        unsignedShortImageData->Register(0);
+        rescaler->Delete();
+
+        return unsignedShortImageData;
+    }
+    catch (std::exception &e)
+    {
+        ERROR_LOG(QString("Excepció al voler fer rescale(): ") + e.what());
+        QMessageBox::warning(this, tr("Volume Too Large"),
+                             tr("Current volume is too large. Please select another volume or close other extensions and try again."));
+        rescaler->Delete();
+        return 0;
+    }
+}
+
+bool Q3DViewer::prepareUnsignedShortImageData()
+{
+    if (!m_imageData)
+    {
+        m_imageData = createUnsignedShortImageData(getMainInput());
+
+        if (!m_imageData)
         {
-            // Fem un Delete() de m_imageData perquè es destrueixi
-            // La destrucció no és immediata perquè encara hi queden referències al pipeline de VTK
-            m_imageData->Delete();
+            return false;
         }
 
-        m_imageData = rescaler->GetOutput();
-        m_imageData->Register(0);
+        updateMapperInputs();
+    }
 
-        rescaler->Delete();
+    return true;
+}
 
-        m_range = rangeLength;
+void Q3DViewer::releaseUnsignedShortImageData()
+{
+    if (!m_imageData || (m_obscuranceMainThread && m_obscuranceMainThread->isRunning()))
+    {
+        return;
+    }
 
-        emit scalarRange(0, m_range);
+    m_imageData->Delete();
+    m_imageData = 0;
+    updateMapperInputs();
+}
 
-        double *newRange = m_imageData->GetScalarRange();
-        DEBUG_LOG(QString("Q3DViewer: new scalar range: new min = %1, new max = %2").arg(newRange[0]).arg(newRange[1]));
+void Q3DViewer::updateMapperInputs()
+{
+    // The GPU ray cast mapper accepts any scalar type, so it always renders the original data
+    m_gpuRayCastMapper->SetInputData(getMainInput()->getVtkData());
 
-        return true;
+    if (m_imageData)
+    {
+        m_volumeMapper->SetInputData(m_imageData);
+
+        unsigned short *data = reinterpret_cast<unsigned short*>(m_imageData->GetPointData()->GetScalars()->GetVoidPointer(0));
+        m_ambientVoxelShader->setData(data, static_cast<unsigned short>(m_range));
+        m_directIlluminationVoxelShader->setData(data, static_cast<unsigned short>(m_range));
+        m_emptySpaceMap->setData(data, m_imageData->GetDimensions());
     }
-    catch (std::exception &e)
+    else
     {
-        ERROR_LOG(QString("Excepció al voler fer rescale(): ") + e.what());
-        QMessageBox::warning(this, tr("Volume Too Large"),
-                             tr("Current volume is too large. Please select another volume or close other extensions and try again."));
-        // Mantenim tots els atributs de la classe tal com estaven, per rebutjar el volum netament
-        rescaler->Delete();
-        return false;
+        // Don't keep the previous data alive through the mapper nor leave the voxel shaders pointing to it
+        m_volumeMapper->SetInputData(0);
+        m_ambientVoxelShader->setData(0, 0);
+        m_directIlluminationVoxelShader->setData(0, 0);
+        m_emptySpaceMap->setData(0, 0);
+    }
+
+    // The gradient estimator keeps its own reference to the data given to the CPU ray cast mapper
+    if (m_4DLinearRegressionGradientEstimator)
+    {
+        m_4DLinearRegressionGradientEstimator->SetInputData(m_imageData);
     }
 }
 
@@ -608,6 +710,11 @@ void Q3DViewer::setVolumeTransformation()
 
 void Q3DViewer::renderRayCasting()
 {
+    if (!prepareUnsignedShortImageData())
+    {
+        return;
+    }
+
     if (!m_renderer->HasViewProp(m_vtkVolume))
     {
         m_renderer->RemoveAllViewProps();
@@ -656,6 +763,11 @@ void Q3DViewer::renderRayCasting()
 
 void Q3DViewer::renderRayCastingObscurance()
 {
+    if (!prepareUnsignedShortImageData())
+    {
+        return;
+    }
+
     if (!m_renderer->HasViewProp(m_vtkVolume))
     {
         m_renderer->RemoveAllViewProps();
@@ -728,6 +840,9 @@ void Q3DViewer::renderRayCastingObscurance()
 
 void Q3DViewer::renderGpuRayCasting()
 {
+    // The GPU ray cast mapper renders the original data, so the unsigned short copy is not needed anymore
+    releaseUnsignedShortImageData();
+
     if (!m_renderer->HasViewProp(m_vtkVolume))
     {
         m_renderer->RemoveAllViewProps();
@@ -747,6 +862,11 @@ void Q3DViewer::renderGpuRayCasting()
 
 void Q3DViewer::renderMIP3D()
 {
+    if (!prepareUnsignedShortImageData())
+    {
+        return;
+    }
+
     if (!m_renderer->HasViewProp(m_vtkVolume))
     {
         m_renderer->RemoveAllViewProps();
@@ -803,6 +923,9 @@ void Q3DViewer::renderMIP3D()
 
 void Q3DViewer::renderContouring()
 {
+    // Contouring reads the original data, so the unsigned short copy is not needed anymore
+    releaseUnsignedShortImageData();
+
     if (m_renderer->HasViewProp(m_vtkVolume))
     {
         vtkImageShrink3D *shrink = vtkImageShrink3D::New();
@@ -855,6 +978,11 @@ void Q3DViewer::renderContouring()
 
 void Q3DViewer::renderIsoSurface()
 {
+    if (!prepareUnsignedShortImageData())
+    {
+        return;
+    }
+
     if (!m_renderer->HasViewProp(m_vtkVolume))
     {
         m_renderer->RemoveAllViewProps();
@@ -43,6 +43,7 @@ class ObscuranceVoxelShader;
 class Vtk4DLinearRegressionGradientEstimator;
 class Obscurance;
 class ContourVoxelShader;
+class EmptySpaceMap;
 
 /**
     Classe base per als visualitzadors 3D
@@ -167,8 +168,22 @@ private:
     /// Fa la visualització per reconstrucció de superfíces
     void renderIsoSurface();
 
-    /// Reescala les dades de volume en el format adequat per als corresponents algorismes. Retorna fals si no pot crear el volum reescalat.
-    bool rescale(Volume *volume);
+    /// Returns true if the current render function uses the CPU ray cast mapper, which needs the data as unsigned short.
+    bool usesCpuRayCastMapper() const;
+
+    /// Returns a new reference to the data of the given volume shifted so that the minimum is 0 and converted to unsigned short, as needed by the CPU ray
+    /// cast mapper and the voxel shaders. The original data is returned if it already is like this. Returns null if the copy can't be created.
+    vtkImageData* createUnsignedShortImageData(Volume *volume);
+
+    /// Creates the unsigned short data for the current input if it doesn't exist yet. Returns false if it can't be created.
+    bool prepareUnsignedShortImageData();
+
+    /// Frees the unsigned short data of the current input, if it's a copy, because the current rendering method doesn't use it. It's kept while the
+    /// obscurances are being computed from it.
+    void releaseUnsignedShortImageData();
+
+    /// Gives the appropriate data of the current input to each mapper and to the voxel shaders.
+    void updateMapperInputs();
 
     /// S'encarrega de decidir quina és la millor orientació
     /// depenent del tipus d'input que tenim. Generalment serà
@@ -193,7 +208,8 @@ protected:
     RenderFunction m_renderFunction;
 
 private:
-    /// La imatge d'entrada dels mappers.
+    /// Input of the CPU ray cast mapper and the voxel shaders: the input data shifted to start at 0 as unsigned short. It's only created when needed, the
+    /// GPU ray cast mapper renders the original data.
     vtkImageData *m_imageData;
 
     /// Widget per veure la orientació en 3D
@@ -237,6 +253,8 @@ private:
     vtkVolumeRayCastSingleVoxelShaderCompositeFunction<AmbientContourObscuranceVoxelShader> *m_volumeRayCastAmbientContourObscuranceFunction;
     vtkVolumeRayCastSingleVoxelShaderCompositeFunction<DirectIlluminationContourObscuranceVoxelShader> *m_volumeRayCastDirectIlluminationContourObscuranceFunction;
     vtkVolumeRayCastIsosurfaceFunction *m_volumeRayCastIsosurfaceFunction;
+    /// Empty blocks of the volume with the current transfer function, skipped by the voxel shader ray cast functions.
+    EmptySpaceMap *m_emptySpaceMap;
 
     /// Current transfer function.
     TransferFunction m_transferFunction;
@@ -260,6 +278,8 @@ private:
 
     /// Range length of the viewed volume.
     double m_range;
+    /// Shift from the original scalars to the range [0, m_range] where the transfer functions are defined.
+    double m_scalarShift;
 
     /// Estimador de gradient que farem servir per les obscurances (i per la resta després de calcular les obscurances).
     Vtk4DLinearRegressionGradientEstimator *m_4DLinearRegressionGradientEstimator;
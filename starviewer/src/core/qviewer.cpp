@@ -26,6 +26,7 @@
 #include "mathtools.h"
 #include "starviewerapplication.h"
 #include "coresettings.h"
+#include "renderscheduler.h"
 
 // TODO: Ouch! SuperGuarrada (tm). Per poder fer sortir el menú i tenir accés al Patient principal. S'ha d'arreglar en quan es tregui les dependències de
 // interface, pacs, etc.etc.!!
@@ -37,6 +38,7 @@
 #include <QMessageBox>
 #include <QDir>
 #include <QScreen>
+#include <QElapsedTimer>
 
 // Include's vtk
 #include <QVTKWidget.h>
@@ -56,7 +58,7 @@ namespace udg {
 
 QViewer::QViewer(QWidget *parent)
  : QWidget(parent), m_mainVolume(0), m_contextMenuActive(true), m_mouseHasMoved(false), m_voiLutData(0),
-   m_isRenderingEnabled(true), m_isActive(false)
+   m_isRenderingEnabled(true), m_isActive(false), m_numberOfRenderRequests(0), m_numberOfRenders(0), m_lastRenderTime(0.0), m_totalRenderTime(0.0)
 {
     m_lastAngleDelta = QPoint();
     m_defaultFitIntoViewportMarginRate = 0.0;
@@ -101,6 +103,14 @@ QViewer::QViewer(QWidget *parent)
 
 QViewer::~QViewer()
 {
+    RenderScheduler::instance()->cancelRender(this);
+
+    if (m_numberOfRenders > 0)
+    {
+        DEBUG_LOG(QString("Viewer rendered %1 times for %2 render requests, %3 ms per render on average")
+                  .arg(m_numberOfRenders).arg(m_numberOfRenderRequests).arg(getAverageRenderTime(), 0, 'f', 2));
+    }
+
     // Cal que la eliminació del vtkWidget sigui al final ja que els altres
     // objectes que eliminem en poden fer ús durant la seva destrucció
     delete m_toolProxy;
@@ -443,6 +453,27 @@ void QViewer::render()
     // al no obtenir-se el context de rendering openGL adequat
     if (m_isRenderingEnabled && getViewerStatus() == VisualizingVolume)
     {
+        ++m_numberOfRenderRequests;
+        RenderScheduler::instance()->requestRender(this);
+    }
+}
+
+bool QViewer::renderImmediately()
+{
+    bool wasRequested = RenderScheduler::instance()->isRenderPending(this);
+    RenderScheduler::instance()->cancelRender(this);
+
+    // The state may have changed since the render was requested, so it has to be checked again
+    if (m_isRenderingEnabled && getViewerStatus() == VisualizingVolume)
+    {
+        if (!wasRequested)
+        {
+            ++m_numberOfRenderRequests;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+
         try
         {
             this->getRenderWindow()->Render();
@@ -452,7 +483,40 @@ void QViewer::render()
             WARN_LOG(QString("bad_alloc when trying to render: ").arg(ba.what()));
             handleNotEnoughMemoryForVisualizationError();
         }
+
+        ++m_numberOfRenders;
+        m_lastRenderTime = timer.nsecsElapsed() / 1000000.0;
+        m_totalRenderTime += m_lastRenderTime;
+
+        return true;
     }
+
+    return false;
+}
+
+int QViewer::getNumberOfRenderRequests() const
+{
+    return m_numberOfRenderRequests;
+}
+
+int QViewer::getNumberOfRenders() const
+{
+    return m_numberOfRenders;
+}
+
+double QViewer::getLastRenderTime() const
+{
+    return m_lastRenderTime;
+}
+
+double QViewer::getAverageRenderTime() const
+{
+    if (m_numberOfRenders == 0)
+    {
+        return 0.0;
+    }
+
+    return m_totalRenderTime / m_numberOfRenders;
 }
 
 void QViewer::absoluteZoom(double factor)
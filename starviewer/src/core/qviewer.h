@@ -176,6 +176,19 @@ public:
     /// Returns the VOI LUT that is currently applied to the image in this viewer. The default implementation returns a default VoiLut.
     virtual VoiLut getCurrentVoiLut() const;
 
+    /// Renders the viewer right now, discarding its pending render request if there is one. Meant for the RenderScheduler and for the few
+    /// cases that need the rendered image before returning to the event loop. Returns true if the viewer has been rendered and false if rendering
+    /// wasn't possible, i.e. it was disabled or the viewer wasn't visualizing a volume.
+    bool renderImmediately();
+
+    /// Returns the number of times render() or renderImmediately() have been called while rendering was possible.
+    int getNumberOfRenderRequests() const;
+    /// Returns the number of renders actually done. Requests merged into the same frame only count once.
+    int getNumberOfRenders() const;
+    /// Returns the time spent in the last render and the mean time per render, in milliseconds.
+    double getLastRenderTime() const;
+    double getAverageRenderTime() const;
+
 public slots:
     /// Indiquem les dades d'entrada
     virtual void setInput(Volume *volume) = 0;
@@ -183,7 +196,8 @@ public slots:
     /// Gestiona els events que rep de la finestra
     void eventHandler(vtkObject *object, unsigned long vtkEvent, void *clientData, void *callData, vtkCommand *command);
 
-    /// Força l'execució de la visualització
+    /// Requests a render of the viewer. All the requests made during the same event loop turn are merged into a single render, done by the
+    /// RenderScheduler when control returns to the event loop.
     void render();
 
     /// Assignem si aquest visualitzador és actiu, és a dir, amb el que s'està interactuant
@@ -364,6 +378,12 @@ private:
 
     /// Layout que ens permet crear widgets diferents per els estats diferents del visor.
     QStackedLayout *m_stackedLayout;
+
+    /// Render counters and accumulated render time, in milliseconds.
+    int m_numberOfRenderRequests;
+    int m_numberOfRenders;
+    double m_lastRenderTime;
+    double m_totalRenderTime;
 };
 
 };  // End namespace udg
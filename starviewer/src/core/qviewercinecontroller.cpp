@@ -29,9 +29,16 @@
 
 namespace udg {
 
+namespace {
+
+// Maximum number of phases that are prepared in advance during the playback. The pipeline prepares fewer if they don't fit in its memory limit.
+const int NumberOfPrefetchedPhases = 8;
+
+}
+
 QViewerCINEController::QViewerCINEController(QObject *parent)
 : QObject(parent), m_firstSliceInterval(0), m_lastSliceInterval(0), m_nextStep(1), m_velocity(1), m_2DViewer(0), m_playing(false),
-  m_cineDimension(TemporalDimension), m_loopEnabled(false), m_boomerangEnabled(false)
+  m_cineDimension(TemporalDimension), m_loopEnabled(false), m_boomerangEnabled(false), m_numberOfShownFrames(0), m_numberOfDroppedFrames(0)
 {
     m_timer = new QBasicTimer();
 
@@ -104,6 +111,11 @@ QAction *QViewerCINEController::getBoomerangAction() const
     return m_boomerangAction;
 }
 
+int QViewerCINEController::getNumberOfDroppedFrames() const
+{
+    return m_numberOfDroppedFrames;
+}
+
 void QViewerCINEController::play()
 {
     if (!m_playing)
@@ -112,6 +124,17 @@ void QViewerCINEController::play()
         m_playAction->setIcon(QIcon(":/images/icons/media-playback-pause.svg"));
         m_playAction->setText(tr("Pause"));
         emit playing();
+
+        m_numberOfShownFrames = 0;
+        m_numberOfDroppedFrames = 0;
+        m_playbackTimer.start();
+        m_frameTimer.start();
+
+        if (m_2DViewer && m_cineDimension == TemporalDimension)
+        {
+            m_2DViewer->prefetchPhases(getUpcomingImageIndices(m_2DViewer->getCurrentPhase(), m_nextStep, NumberOfPrefetchedPhases));
+        }
+
         m_timer->start(1000 / m_velocity, this);
     }
     else
@@ -123,6 +146,12 @@ void QViewerCINEController::play()
 void QViewerCINEController::pause()
 {
     m_timer->stop();
+
+    if (m_playing)
+    {
+        logPlaybackStatistics();
+    }
+
     m_playing = false;
     m_playAction->setIcon(QIcon(":/images/icons/media-playback-start.svg"));
     m_playAction->setText(tr("Play"));
@@ -174,6 +203,15 @@ void QViewerCINEController::handleCINETimerEvent()
         return;
     }
 
+    // The timer doesn't accumulate ticks, so if more than a period has passed since the last frame the frames that should have been shown meanwhile are lost
+    int framePeriod = 1000 / m_velocity;
+    int elapsedPeriods = qRound(static_cast<double>(m_frameTimer.restart()) / qMax(framePeriod, 1));
+    if (elapsedPeriods > 1)
+    {
+        m_numberOfDroppedFrames += elapsedPeriods - 1;
+        DEBUG_LOG(QString("CINE: %1 frames dropped").arg(elapsedPeriods - 1));
+    }
+
     int currentImageIndex;
     int nextImageIndex;
 
@@ -185,6 +223,8 @@ void QViewerCINEController::handleCINETimerEvent()
     {
         currentImageIndex = m_2DViewer->getCurrentSlice();
     }
+    // If no other index is decided, stay on the current one
+    nextImageIndex = currentImageIndex;
 
     // Si estem al final de l'interval
     if (currentImageIndex == m_lastSliceInterval)
@@ -245,11 +285,79 @@ void QViewerCINEController::handleCINETimerEvent()
     if (m_cineDimension == TemporalDimension)
     {
         m_2DViewer->setPhase(nextImageIndex);
+
+        // The following phases are prepared while this one is shown. Slices don't need it because they are all taken from the same image.
+        if (m_playing)
+        {
+            m_2DViewer->prefetchPhases(getUpcomingImageIndices(nextImageIndex, m_nextStep, NumberOfPrefetchedPhases));
+        }
     }
     else
     {
         m_2DViewer->setSlice(nextImageIndex);
     }
+
+    m_numberOfShownFrames++;
+}
+
+QList<int> QViewerCINEController::getUpcomingImageIndices(int imageIndex, int step, int count) const
+{
+    QList<int> indices;
+
+    while (indices.size() < count)
+    {
+        imageIndex += step;
+
+        if (imageIndex > m_lastSliceInterval)
+        {
+            if (!m_loopEnabled)
+            {
+                break;
+            }
+
+            if (m_boomerangEnabled)
+            {
+                step = -1;
+                imageIndex = m_lastSliceInterval - 1;
+            }
+            else
+            {
+                imageIndex = m_firstSliceInterval;
+            }
+        }
+        else if (imageIndex < m_firstSliceInterval)
+        {
+            if (!m_loopEnabled)
+            {
+                break;
+            }
+
+            step = 1;
+            imageIndex = m_firstSliceInterval + 1;
+        }
+
+        // Stop when the interval is too short or all of it has been covered
+        if (imageIndex < m_firstSliceInterval || imageIndex > m_lastSliceInterval || indices.contains(imageIndex))
+        {
+            break;
+        }
+
+        indices << imageIndex;
+    }
+
+    return indices;
+}
+
+void QViewerCINEController::logPlaybackStatistics()
+{
+    qint64 elapsedTime = m_playbackTimer.elapsed();
+
+    if (m_numberOfShownFrames > 0 && elapsedTime > 0)
+    {
+        INFO_LOG(QString("CINE: %1 frames shown in %2 ms, %3 images/s with a target of %4 images/s, %5 frames dropped")
+                 .arg(m_numberOfShownFrames).arg(elapsedTime).arg(m_numberOfShownFrames * 1000.0 / elapsedTime, 0, 'f', 1).arg(m_velocity)
+                 .arg(m_numberOfDroppedFrames));
+    }
 }
 
 void QViewerCINEController::resetCINEInformation(Volume *input)
@@ -17,6 +17,8 @@
 
 #include <QObject>
 
+#include <QElapsedTimer>
+
 class QAction;
 class QBasicTimer;
 
@@ -47,6 +49,9 @@ public:
     QAction* getLoopAction() const;
     QAction* getBoomerangAction() const;
 
+    /// Returns the number of frames that could not be shown in time at the current velocity since the playback was last started.
+    int getNumberOfDroppedFrames() const;
+
 signals:
     void playing();
     void paused();
@@ -83,11 +88,18 @@ public slots:
 protected:
     void timerEvent(QTimerEvent *event);
 
+    /// Returns the indices of at most the given number of images that will be shown after the given one if the playback goes on with the current settings,
+    /// moving in the direction of the given step (1 forwards, -1 backwards).
+    QList<int> getUpcomingImageIndices(int imageIndex, int step, int count) const;
+
 private:
     /// Aquí ens ocupem de decidir cap on va el següent frame
     /// durant la reproducció
     void handleCINETimerEvent();
 
+    /// Writes to the log the images per second achieved since the playback was started and the number of dropped frames.
+    void logPlaybackStatistics();
+
 private:
     /// Variables de reproducció
     int m_firstSliceInterval;
@@ -117,6 +129,13 @@ private:
     QAction *m_loopAction;
     QAction *m_boomerangAction;
 
+    /// Measure the time since the playback was started and since the last frame was shown.
+    QElapsedTimer m_playbackTimer;
+    QElapsedTimer m_frameTimer;
+    /// Number of frames shown and dropped since the playback was started.
+    int m_numberOfShownFrames;
+    int m_numberOfDroppedFrames;
+
 };
 
 }
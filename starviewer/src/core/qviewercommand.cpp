@@ -25,4 +25,9 @@ QViewerCommand::~QViewerCommand()
 {
 }
 
+int QViewerCommand::getSliceToDisplay() const
+{
+    return -1;
+}
+
 } // End namespace udg
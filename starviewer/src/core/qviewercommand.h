@@ -33,6 +33,10 @@ Q_OBJECT
 public:
     virtual ~QViewerCommand();
 
+    /// Returns the slice that the command will show in the acquisition plane, or -1 if it doesn't choose a slice or it can't be known before executing it.
+    /// Used to read that slice first when the volume is loaded progressively.
+    virtual int getSliceToDisplay() const;
+
 public slots:
     virtual void execute() = 0;
 
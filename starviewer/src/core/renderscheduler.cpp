@@ -0,0 +1,85 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#include "renderscheduler.h"
+
+#include "qviewer.h"
+
+#include <QTimer>
+
+namespace udg {
+
+RenderScheduler::RenderScheduler()
+    : m_isFrameScheduled(false), m_numberOfFrames(0), m_numberOfRendersInLastFrame(0)
+{
+}
+
+RenderScheduler::~RenderScheduler()
+{
+}
+
+void RenderScheduler::requestRender(QViewer *viewer)
+{
+    if (!m_pendingViewers.contains(viewer))
+    {
+        m_pendingViewers.append(viewer);
+    }
+
+    if (!m_isFrameScheduled)
+    {
+        m_isFrameScheduled = true;
+        QTimer::singleShot(0, [this] { runFrame(); });
+    }
+}
+
+void RenderScheduler::cancelRender(QViewer *viewer)
+{
+    m_pendingViewers.removeOne(viewer);
+}
+
+bool RenderScheduler::isRenderPending(QViewer *viewer) const
+{
+    return m_pendingViewers.contains(viewer);
+}
+
+int RenderScheduler::getNumberOfFrames() const
+{
+    return m_numberOfFrames;
+}
+
+int RenderScheduler::getNumberOfRendersInLastFrame() const
+{
+    return m_numberOfRendersInLastFrame;
+}
+
+void RenderScheduler::runFrame()
+{
+    m_isFrameScheduled = false;
+    ++m_numberOfFrames;
+    m_numberOfRendersInLastFrame = 0;
+
+    // A render can request new renders, e.g. through a slot connected to a signal emitted while rendering. Those are left for the next frame.
+    QList<QViewer*> viewers;
+    viewers.swap(m_pendingViewers);
+
+    foreach (QViewer *viewer, viewers)
+    {
+        if (viewer->renderImmediately())
+        {
+            ++m_numberOfRendersInLastFrame;
+        }
+    }
+}
+
+} // namespace udg
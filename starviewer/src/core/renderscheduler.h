@@ -0,0 +1,70 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#ifndef UDG_RENDERSCHEDULER_H
+#define UDG_RENDERSCHEDULER_H
+
+#include "singleton.h"
+
+#include <QList>
+
+namespace udg {
+
+class QViewer;
+
+/**
+ * @brief The RenderScheduler class merges the render requests of all the viewers made during one event loop turn into a single render per viewer.
+ *
+ * Requesting a render only marks the viewer as pending. The first request of a turn schedules a frame that is run when control returns to the event
+ * loop, and then each pending viewer is rendered once, in the order in which they were first requested. This way a single user event that updates
+ * several synchronized viewers, each one through several setters, costs one render per viewer.
+ */
+class RenderScheduler : public Singleton<RenderScheduler> {
+public:
+    /// Marks the given viewer as pending to be rendered in the next frame, scheduling the frame if needed.
+    void requestRender(QViewer *viewer);
+    /// Removes the given viewer from the pending ones, if it is there.
+    void cancelRender(QViewer *viewer);
+    /// Returns true if the given viewer will be rendered in the next frame.
+    bool isRenderPending(QViewer *viewer) const;
+
+    /// Returns the number of frames run so far.
+    int getNumberOfFrames() const;
+    /// Returns the number of viewers rendered in the last frame. Pending viewers that could no longer be rendered when the frame was run aren't counted.
+    int getNumberOfRendersInLastFrame() const;
+
+protected:
+    /// Cal declarar-ho friend perquè sinó hauríem de fer públics
+    /// el constructor i destructor i trencaríem així la filosofia d'un Singleton
+    friend class Singleton<RenderScheduler>;
+    RenderScheduler();
+    ~RenderScheduler();
+
+private:
+    /// Renders each pending viewer once.
+    void runFrame();
+
+private:
+    /// Viewers pending to be rendered in the next frame.
+    QList<QViewer*> m_pendingViewers;
+    /// True if a frame has been scheduled and has not been run yet.
+    bool m_isFrameScheduled;
+
+    int m_numberOfFrames;
+    int m_numberOfRendersInLastFrame;
+};
+
+} // namespace udg
+
+#endif // UDG_RENDERSCHEDULER_H
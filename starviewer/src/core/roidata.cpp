@@ -14,6 +14,8 @@
 
 #include "roidata.h"
 
+#include "logging.h"
+
 #include <QtCore/qmath.h>
 #include <cfloat>
 
@@ -30,11 +32,14 @@ ROIData::~ROIData()
 
 void ROIData::clear()
 {
-    m_voxels.clear();
-    m_statisticsAreOutdated = false;
+    m_numberOfVoxels = 0;
     m_mean = 0.0;
-    m_standardDeviation = 0.0;
-    m_maximum = 0.0;
+    m_sumOfSquaredDeviations = 0.0;
+    m_minimum = DBL_MAX;
+    m_maximum = -DBL_MAX;
+    m_histogram.clear();
+    m_histogramMinimum = 0.0;
+    m_histogramBinWidth = 1.0;
     m_units = "";
     m_modality = "";
 }
@@ -43,105 +48,130 @@ void ROIData::addVoxel(const Voxel &voxel)
 {
     if (!voxel.isEmpty())
     {
-        m_voxels << voxel;
-        m_statisticsAreOutdated = true;
+        addValue(voxel.getComponent(0));
     }
 }
 
-double ROIData::getMean()
+void ROIData::addValue(double value)
 {
-    computeStatistics();
-    return m_mean;
+    addValues(&value, 1);
 }
 
-double ROIData::getStandardDeviation()
+void ROIData::addValues(const double *values, int count)
 {
-    computeStatistics();
-    return m_standardDeviation;
+    for (int i = 0; i < count; ++i)
+    {
+        double value = values[i];
+
+        ++m_numberOfVoxels;
+        double delta = value - m_mean;
+        m_mean += delta / m_numberOfVoxels;
+        m_sumOfSquaredDeviations += delta * (value - m_mean);
+
+        m_minimum = qMin(m_minimum, value);
+        m_maximum = qMax(m_maximum, value);
+    }
+
+    if (!m_histogram.isEmpty())
+    {
+        int lastBin = m_histogram.size() - 1;
+        for (int i = 0; i < count; ++i)
+        {
+            int bin = qBound(0, static_cast<int>((values[i] - m_histogramMinimum) / m_histogramBinWidth), lastBin);
+            ++m_histogram[bin];
+        }
+    }
 }
 
-double ROIData::getMaximum()
+double ROIData::getMean() const
 {
-    computeStatistics();
-    return m_maximum;
+    return m_mean;
 }
 
-void ROIData::setUnits(const QString &units)
+double ROIData::getStandardDeviation() const
 {
-    m_units = units;
+    if (m_numberOfVoxels == 0)
+    {
+        return 0.0;
+    }
+
+    return qSqrt(m_sumOfSquaredDeviations / m_numberOfVoxels);
 }
 
-QString ROIData::getUnits() const
+double ROIData::getMinimum() const
 {
-    return m_units;
+    return m_numberOfVoxels > 0 ? m_minimum : 0.0;
 }
 
-void ROIData::setModality(const QString &modality)
+double ROIData::getMaximum() const
 {
-    m_modality = modality;
+    return m_numberOfVoxels > 0 ? m_maximum : 0.0;
 }
 
-QString ROIData::getModality() const
+int ROIData::getNumberOfVoxels() const
 {
-    return m_modality;
+    return m_numberOfVoxels;
 }
 
-void ROIData::computeStatistics()
+void ROIData::setHistogramRange(double minimum, double maximum, int numberOfBins)
 {
-    if (!m_statisticsAreOutdated)
+    if (numberOfBins < 1 || maximum <= minimum)
     {
+        DEBUG_LOG(QString("Invalid histogram range: [%1, %2] with %3 bins").arg(minimum).arg(maximum).arg(numberOfBins));
         return;
     }
 
-    computeMean();
-    computeStandardDeviation();
-    computeMaximum();
-
-    m_statisticsAreOutdated = false;
+    m_histogram.fill(0, numberOfBins);
+    m_histogramMinimum = minimum;
+    m_histogramBinWidth = (maximum - minimum) / numberOfBins;
 }
 
-void ROIData::computeMean()
+QVector<int> ROIData::getHistogram() const
 {
-    m_mean = 0.0;
-    foreach (const Voxel &voxel, m_voxels)
-    {
-        m_mean += voxel.getComponent(0);
-    }
-
-    m_mean = m_mean / m_voxels.size();
+    return m_histogram;
 }
 
-void ROIData::computeStandardDeviation()
+double ROIData::getPercentile(double percentile) const
 {
-    m_standardDeviation = 0.0;
-    QList<double> deviations;
-    foreach (const Voxel &voxel, m_voxels)
+    if (m_histogram.isEmpty() || m_numberOfVoxels == 0)
     {
-        double individualDeviation = voxel.getComponent(0) - m_mean;
-        deviations << (individualDeviation * individualDeviation);
+        return 0.0;
     }
 
-    foreach (double deviation, deviations)
+    double rank = qBound(0.0, percentile, 100.0) / 100.0 * m_numberOfVoxels;
+    int accumulatedCount = 0;
+    int bin = 0;
+    while (bin < m_histogram.size() - 1 && accumulatedCount + m_histogram.at(bin) < rank)
     {
-        m_standardDeviation += deviation;
+        accumulatedCount += m_histogram.at(bin);
+        ++bin;
     }
 
-    m_standardDeviation /= deviations.size();
-    m_standardDeviation = qSqrt(m_standardDeviation);
+    // Assume the values are evenly distributed inside the bin
+    double fractionOfBin = m_histogram.at(bin) > 0 ? (rank - accumulatedCount) / m_histogram.at(bin) : 0.0;
+    double value = m_histogramMinimum + (bin + fractionOfBin) * m_histogramBinWidth;
+
+    return qBound(getMinimum(), value, getMaximum());
 }
 
-void ROIData::computeMaximum()
+void ROIData::setUnits(const QString &units)
 {
-    m_maximum = -DBL_MAX;
+    m_units = units;
+}
 
-    foreach (const Voxel &voxel, m_voxels)
-    {
-        double value = voxel.getComponent(0);
-        if (value > m_maximum)
-        {
-            m_maximum = value;
-        }
-    }
+QString ROIData::getUnits() const
+{
+    return m_units;
+}
+
+void ROIData::setModality(const QString &modality)
+{
+    m_modality = modality;
+}
+
+QString ROIData::getModality() const
+{
+    return m_modality;
 }
 
 } // End namespace udg
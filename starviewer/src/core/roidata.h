@@ -18,11 +18,14 @@
 #include "voxel.h"
 
 #include <QString>
+#include <QVector>
 
 namespace udg {
 
 /**
-    Class to save voxel data contained in a ROI and compute statistics from it.
+    Class to accumulate the voxel values contained in a ROI and compute statistics from them.
+    The statistics are updated as the values are added (Welford's method for the mean and variance), so the voxels are not stored
+    and the memory used doesn't depend on the size of the ROI. Optionally it also keeps a histogram with a fixed number of bins to estimate percentiles.
     Currently it only takes into account the first component of the voxel,
     i.e. if the voxel is an RGB color voxel, it only will take into account the red channel
  */
@@ -36,11 +39,28 @@ public:
     
     /// Adds a voxel unless Voxel::isEmpty() is true
     void addVoxel(const Voxel &voxel);
-
-    /// Gets the mean/standard deviation/maximum corresponding to the current voxels
-    double getMean();
-    double getStandardDeviation();
-    double getMaximum();
+    /// Adds the value of a voxel
+    void addValue(double value);
+    /// Adds the values of count consecutive voxels, such as a span of a row of the ROI
+    void addValues(const double *values, int count);
+
+    /// Gets the mean/standard deviation/minimum/maximum corresponding to the current voxels
+    double getMean() const;
+    double getStandardDeviation() const;
+    double getMinimum() const;
+    double getMaximum() const;
+
+    /// Returns the number of voxels added
+    int getNumberOfVoxels() const;
+
+    /// Enables the histogram of the values, with numberOfBins bins between minimum and maximum. Values out of the range are counted in the first
+    /// or last bin. It must be called before adding values, and clear() disables it.
+    void setHistogramRange(double minimum, double maximum, int numberOfBins);
+    /// Returns the counts of the histogram bins, empty if the histogram is not enabled
+    QVector<int> getHistogram() const;
+    /// Returns an estimation of the given percentile (0-100) interpolating inside the histogram bins.
+    /// Returns 0 if the histogram is not enabled or there are no voxels.
+    double getPercentile(double percentile) const;
 
     /// Sets/gets the units of the voxels of this ROI
     void setUnits(const QString &units);
@@ -51,30 +71,20 @@ public:
     QString getModality() const;
 
 private:
-    /// Computes all statistics data if needed
-    void computeStatistics();
-
-    /// Computes voxels mean
-    void computeMean();
-
-    /// Computes voxels standard deviation. Requires mean to be computed before, as it uses the m_mean value
-    void computeStandardDeviation();
-
-    /// Computes voxels maximum value
-    void computeMaximum();
+    /// Number of voxels added
+    int m_numberOfVoxels;
 
-private:
-    /// The container of the ROI voxels
-    QVector<Voxel> m_voxels;
-    
-    /// Statistic data members
+    /// Running mean, sum of the squared differences from the mean, minimum and maximum of the values
     double m_mean;
-    double m_standardDeviation;
+    double m_sumOfSquaredDeviations;
+    double m_minimum;
     double m_maximum;
 
-    /// Used to control whether the statistics data has to be computed or not when requested
-    bool m_statisticsAreOutdated;
-    
+    /// Optional histogram of the values
+    QVector<int> m_histogram;
+    double m_histogramMinimum;
+    double m_histogramBinWidth;
+
     /// Additional optional information of the ROI regarding the units of the voxels and their modality
     QString m_units;
     QString m_modality;
@@ -19,7 +19,6 @@
 #include "drawerpolygon.h"
 #include "drawertext.h"
 #include "image.h"
-#include "mathtools.h"
 #include "areameasurecomputer.h"
 #include "voxel.h"
 #include "roidata.h"
@@ -29,11 +28,10 @@
 #include "nmroidataprinter.h"
 #include "nmctfusionroidataprinter.h"
 #include "sliceorientedvolumepixeldata.h"
+#include "scanlinepolygonrasterizer.h"
 
 #include <QApplication>
-
-#include <vtkTransform.h>
-#include <vtkTransformPolyDataFilter.h>
+#include <QtConcurrentMap>
 
 namespace udg {
 
@@ -53,215 +51,95 @@ MeasureComputer* ROITool::getMeasureComputer()
     return new AreaMeasureComputer(m_roiPolygon);
 }
 
+namespace {
+
+// Pixel data of an input and the statistics of the ROI on it
+struct InputROIData {
+    int inputIndex;
+    SliceOrientedVolumePixelData pixelData;
+    ROIData roiData;
+};
+
+}
+
 QMap<int, ROIData> ROITool::computeROIData()
 {
     Q_ASSERT(m_roiPolygon);
 
-    auto pixelData = m_2DViewer->getCurrentPixelData();
-
-    auto transformFilter = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
-    transformFilter->SetInputData(m_roiPolygon->getVtkPolyData());
-    auto transform = vtkSmartPointer<vtkTransform>::New();
-    transform->SetMatrix(pixelData.getWorldToDataMatrix());
-    transformFilter->SetTransform(transform);
-    transformFilter->Update();
-    auto *pixelDataOrientedRoiPolyData = transformFilter->GetOutput();
-    // Pixel data oriented because it's not really slice oriented: still needs to permute axes
-
-    // To compute the voxels inside the polygon we'll use the sweep line algorithm approach
-    // tracing a set of lines within the bounds of the drawn polygon. Upon the resulting intersections between polygon segments and sweep lines
-    // we will be able to compute which points of the line are inside of the polygon and get the corresponding voxel values.
-    // The sweep lines will be horizontal and swept down in vertical direction
-    double bounds[6];
-    pixelDataOrientedRoiPolyData->GetBounds(bounds);
-
-    int xIndex, yIndex, zIndex;
-    pixelData.getOrthogonalPlane().getXYZIndexes(xIndex, yIndex, zIndex);
-
-    // Building up the initial sweep line
-    // We'll have to add some extra space to the x/y bounds just to help the sweep line algorithm work better
-    // when the vertices and segments are just on the bound lines
-    Vector3 spacing = pixelData.getSpacing();   // This is really slice oriented
-    double xMargin = spacing.x * 1.1;
-    double yMargin = spacing.y * 1.1;
-    
-    // First point of the sweep line, will be at the minimum x, y, z bounds of the polygon
-    Point3D sweepLineBeginPoint;
-    sweepLineBeginPoint[xIndex] = bounds[xIndex * 2] - xMargin;
-    sweepLineBeginPoint[yIndex] = bounds[yIndex * 2] - yMargin;
-    sweepLineBeginPoint[zIndex] = bounds[zIndex * 2];
-    
-    // Second point of the sweep line, will be the same as the first but with the maximum x bounds of the polygon so it will trace an horizontal line
-    Point3D sweepLineEndPoint;
-    sweepLineEndPoint[xIndex] = bounds[xIndex * 2 + 1] + xMargin;
-    sweepLineEndPoint[yIndex] = bounds[yIndex * 2] - yMargin;
-    sweepLineEndPoint[zIndex] = bounds[zIndex * 2];
-
-    // The ending height of the sweep line will be at the maximum y bounds of the polygon
-    double verticalLimit = bounds[yIndex * 2 + 1] + yMargin;
-
-    // Build segments
-    QList<Line3D> segments;
-    auto *points = pixelDataOrientedRoiPolyData->GetPoints();
-    for (int i = 0; i < points->GetNumberOfPoints() - 1; i++)
+    QVector<Vector3> polygon;
+    for (int i = 0; i < m_roiPolygon->getNumberOfPoints(); i++)
     {
-        segments.append(Line3D(points->GetPoint(i), points->GetPoint(i+1)));
+        const double *vertex = m_roiPolygon->getVertix(i);
+        polygon.append(Vector3(vertex[0], vertex[1], vertex[2]));
     }
-    segments.append(Line3D(points->GetPoint(points->GetNumberOfPoints() - 1), points->GetPoint(0)));
 
-    // Compute the ROI data corresponding for each input
-    QMap<int, ROIData> roiDataMap;
+    // The pixel data of each input is obtained here and then the statistics of all the inputs are computed in parallel
+    QVector<InputROIData> inputs;
     for (int i = 0; i < m_2DViewer->getNumberOfInputs(); ++i)
     {
         // Compute the voxel values inside of the polygon if the input is visible and the images are monochrome
         if (m_2DViewer->isInputVisible(i) && !m_2DViewer->getInput(i)->getImage(0)->getPhotometricInterpretation().isColor())
         {
-            ROIData roiData = computeVoxelValues(segments, sweepLineBeginPoint, sweepLineEndPoint, verticalLimit, i);
-            
+            InputROIData input;
+            input.inputIndex = i;
+            input.pixelData = m_2DViewer->getCurrentPixelDataFromInput(i);
+
             // Set additional information of the ROI data
-            roiData.setUnits(m_2DViewer->getInput(i)->getPixelUnits());
-            roiData.setModality(m_2DViewer->getInput(i)->getModality());
+            input.roiData.setUnits(m_2DViewer->getInput(i)->getPixelUnits());
+            input.roiData.setModality(m_2DViewer->getInput(i)->getModality());
 
-            roiDataMap.insert(i, roiData);
+            inputs.append(input);
         }
     }
 
-    return roiDataMap;
-}
-
-ROIData ROITool::computeVoxelValues(const QList<Line3D> &polygonSegments, Point3D sweepLineBeginPoint, Point3D sweepLineEndPoint, double sweepLineEnd, int inputNumber)
-{
-    // We get the pixel data to obtain voxels values from
-    auto pixelData = m_2DViewer->getCurrentPixelDataFromInput(inputNumber);
-    
-    OrthogonalPlane currentView = pixelData.getOrthogonalPlane();
-    int yIndex = currentView.getYIndex();
-
-    double verticalSpacingIncrement = pixelData.getSpacing().y; // slice oriented
+    QtConcurrent::blockingMap(inputs, [&polygon](InputROIData &input)
+    {
+        computeVoxelValues(polygon, input.pixelData, input.roiData);
+    });
 
-    // ROI voxel data to be obtained from the sweep line
-    ROIData roiData;
-    while (sweepLineBeginPoint.at(yIndex) <= sweepLineEnd)
+    // Compute the ROI data corresponding for each input
+    QMap<int, ROIData> roiDataMap;
+    foreach (const InputROIData &input, inputs)
     {
-        // We get the intersections bewteen ROI segments and current sweep line
-        QList<double*> intersectionList = getIntersectionPoints(polygonSegments, Line3D(sweepLineBeginPoint, sweepLineEndPoint), currentView);
-
-        // Adding the voxels from the current intersections of the current sweep line to the voxel values list
-        addVoxelsFromIntersections(intersectionList, currentView, pixelData, roiData);
-        
-        // Shift the sweep line the corresponding space in vertical direction
-        sweepLineBeginPoint[yIndex] += verticalSpacingIncrement;
-        sweepLineEndPoint[yIndex] += verticalSpacingIncrement;
+        roiDataMap.insert(input.inputIndex, input.roiData);
     }
 
-    return roiData;
+    return roiDataMap;
 }
 
-QList<int> ROITool::getIndexOfSegmentsCrossingAtHeight(const QList<Line3D> &segments, double height, int heightIndex)
+void ROITool::computeVoxelValues(const QVector<Vector3> &polygon, SliceOrientedVolumePixelData &pixelData, ROIData &roiData)
 {
-    QList<int> intersectedSegmentsIndexList;
-
-    for (int i = 0; i < segments.count(); ++i)
+    if (polygon.size() < 3)
     {
-        if ((height <= segments.at(i).getFirstPoint().at(heightIndex) && height >= segments.at(i).getSecondPoint().at(heightIndex))
-        || (height >= segments.at(i).getFirstPoint().at(heightIndex) && height <= segments.at(i).getSecondPoint().at(heightIndex)))
-        {
-            intersectedSegmentsIndexList << i;
-        }
+        return;
     }
 
-    return intersectedSegmentsIndexList;
-}
-
-QList<double*> ROITool::getIntersectionPoints(const QList<Line3D> &polygonSegments, const Line3D &sweepLine, const OrthogonalPlane &view)
-{
-    QList<double*> intersectionPoints;
-    int sortIndex = view.getXIndex();
-    int heightIndex = view.getYIndex();
-    
-    QList<int> indexListOfSegmentsToIntersect = getIndexOfSegmentsCrossingAtHeight(polygonSegments, sweepLine.getFirstPoint().at(heightIndex), heightIndex);
-    foreach (int segmentIndex, indexListOfSegmentsToIntersect)
+    // The polygon is rasterized in slice oriented voxel coordinates, where the voxel centres are at integer positions
+    QVector<QPointF> voxelPolygon;
+    double slice = 0.0;
+    foreach (const Vector3 &point, polygon)
     {
-        int intersectionState;
-        double *foundPoint = MathTools::infiniteLinesIntersection(polygonSegments.at(segmentIndex).getFirstPoint().getAsDoubleArray(),
-                                                                    polygonSegments.at(segmentIndex).getSecondPoint().getAsDoubleArray(),
-                                                                    sweepLine.getFirstPoint().getAsDoubleArray(), sweepLine.getSecondPoint().getAsDoubleArray(),
-                                                                    intersectionState);
-        if (intersectionState == MathTools::LinesIntersect)
-        {
-            // Must sort intersections horizontally in order to be able to get voxels inside polygon correctly
-            bool found = false;
-            int i = 0;
-            while (!found && i < intersectionPoints.count())
-            {
-                if (foundPoint[sortIndex] > intersectionPoints.at(i)[sortIndex])
-                {
-                    intersectionPoints.insert(i, foundPoint);
-                    found = true;
-                }
-                else
-                {
-                    ++i;
-                }
-            }
-            // If not found, it means it is the greatest point and must be placed at the end
-            if (!found)
-            {
-                intersectionPoints << foundPoint;
-            }
-        }
+        Vector3 voxelCoordinate = pixelData.getVoxelCoordinate(point);
+        voxelPolygon.append(QPointF(voxelCoordinate.x, voxelCoordinate.y));
+        slice += voxelCoordinate.z;
     }
+    int z = qRound(slice / polygon.size());
 
-    return intersectionPoints;
-}
-
-void ROITool::addVoxelsFromIntersections(const QList<double*> &intersectionPoints, const OrthogonalPlane &view, SliceOrientedVolumePixelData &pixelData, ROIData &roiData)
-{
-    if (MathTools::isEven(intersectionPoints.count()))
+    auto extent = pixelData.getExtent();
+    if (z < extent[4] || z > extent[5])
     {
-        int scanDirectionIndex = view.getXIndex();
-        double scanDirectionIncrement = pixelData.getSpacing().x;   // slice oriented
-
-        int limit = intersectionPoints.count() / 2;
-        for (int i = 0; i < limit; ++i)
-        {
-            double *firstIntersection = intersectionPoints.at(i * 2);
-            double *secondIntersection = intersectionPoints.at(i * 2 + 1);
-            // First we check which will be the direction of the scan line
-            Point3D currentScanLinePoint;
-            double scanLineEnd;
-            if (firstIntersection[scanDirectionIndex] <= secondIntersection[scanDirectionIndex])
-            {
-                for (int i = 0; i < 3; ++i)
-                {
-                    currentScanLinePoint[i] = firstIntersection[i];
-                }
-                scanLineEnd = secondIntersection[scanDirectionIndex];
-            }
-            else
-            {
-                for (int i = 0; i < 3; ++i)
-                {
-                    currentScanLinePoint[i] = secondIntersection[i];
-                }
-                scanLineEnd = firstIntersection[scanDirectionIndex];
-            }
-            // Then we scan and get the voxels along the line
-            while (currentScanLinePoint.at(scanDirectionIndex) <= scanLineEnd)
-            {
-                // currentScanLinePoint is pixel data oriented
-                double pixelDataOrientedPoint[4] = { currentScanLinePoint[0], currentScanLinePoint[1], currentScanLinePoint[2], 1.0 };
-                double worldPoint[4];
-                pixelData.getDataToWorldMatrix()->MultiplyPoint(pixelDataOrientedPoint, worldPoint);
-                Vector3 voxelCoordinate(worldPoint);
-                roiData.addVoxel(pixelData.getVoxelValue(voxelCoordinate));
-                currentScanLinePoint[scanDirectionIndex] += scanDirectionIncrement;
-            }
-        }
+        DEBUG_LOG(QString("The ROI is outside the volume: slice %1").arg(z));
+        return;
     }
-    else
+
+    // Only one row of values is kept at a time, and the statistics are accumulated span by span
+    QVector<double> rowValues;
+    ScanlinePolygonRasterizer rasterizer(voxelPolygon);
+    foreach (const ScanlinePolygonRasterizer::Span &span, rasterizer.getSpans(extent[0], extent[1], extent[2], extent[3]))
     {
-        DEBUG_LOG(QString("EL NOMBRE D'INTERSECCIONS ENTRE EL RAIG I LA ROI ÉS IMPARELL!!: %1").arg(intersectionPoints.count()));
+        rowValues.resize(span.lastX - span.firstX + 1);
+        pixelData.getRowValues(span.firstX, span.lastX, span.y, z, rowValues.data());
+        roiData.addValues(rowValues.constData(), rowValues.size());
     }
 }
 
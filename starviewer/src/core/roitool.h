@@ -18,7 +18,9 @@
 #include "measurementtool.h"
 #include "volume.h"
 #include "line3d.h"
+#include "vector3.h"
 #include <QPointer>
+#include <QVector>
 
 namespace udg {
 
@@ -63,19 +65,9 @@ private:
     /// The key is the index of the input on the viewer corresponding to the mapped ROIData
     QMap<int, ROIData> computeROIData();
     
-    /// Computes the voxel values contained inside polygonSegments corresponding to inputNumber volume. It will use the sweepLine algorithm, 
-    /// begining with the line defined with the given points and will end at sweepLineEnd height and returns them in a ROIData object
-    ROIData computeVoxelValues(const QList<Line3D> &polygonSegments, Point3D sweepLineBeginPoint, Point3D sweepLineEndPoint, double sweepLineEnd, int inputNumber);
-    
-    /// Returns a list with the indices of the corresponding segments of the given list which crosses the given height, that is, those segments
-    /// which its initial and end point are between the specified heigh on the heightIndex
-    QList<int> getIndexOfSegmentsCrossingAtHeight(const QList<Line3D> &segments, double height, int heightIndex);
-
-    /// Gets the points that intersect with polygonSegments and the given sweepLine and orders them by the xIndex of view
-    QList<double*> getIntersectionPoints(const QList<Line3D> &polygonSegments, const Line3D &sweepLine, const OrthogonalPlane &view);
-
-    /// Adds the voxels that are in the path of the intersection points to the given ROIData
-    void addVoxelsFromIntersections(const QList<double*> &intersectionPoints, const OrthogonalPlane &view, SliceOrientedVolumePixelData &pixelData, ROIData &roiData);
+    /// Accumulates in roiData the values of the voxels of pixelData whose centres are inside the given polygon, in world coordinates.
+    /// It is thread-safe, so different inputs can be computed at the same time.
+    static void computeVoxelValues(const QVector<Vector3> &polygon, SliceOrientedVolumePixelData &pixelData, ROIData &roiData);
 
     /// Returns the appropiate ROIDataPrinter for the given roi data
     AbstractROIDataPrinter* getROIDataPrinter(const QMap<int, ROIData> &roiDataMap);
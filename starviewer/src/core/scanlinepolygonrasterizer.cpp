@@ -0,0 +1,123 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#include "scanlinepolygonrasterizer.h"
+
+#include <qmath.h>
+
+#include <algorithm>
+
+namespace udg {
+
+ScanlinePolygonRasterizer::ScanlinePolygonRasterizer(const QVector<QPointF> &polygon)
+{
+    for (int i = 0; i < polygon.size(); i++)
+    {
+        QPointF begin = polygon.at(i);
+        QPointF end = polygon.at((i + 1) % polygon.size());
+
+        if (begin.y() == end.y())
+        {
+            continue;
+        }
+
+        if (begin.y() > end.y())
+        {
+            qSwap(begin, end);
+        }
+
+        // Rows whose centre line is in [begin.y, end.y)
+        Edge edge;
+        edge.firstRow = qCeil(begin.y());
+        edge.lastRow = qCeil(end.y()) - 1;
+        edge.slope = (end.x() - begin.x()) / (end.y() - begin.y());
+        edge.xAtOrigin = begin.x() - begin.y() * edge.slope;
+
+        if (edge.firstRow <= edge.lastRow)
+        {
+            m_edges.append(edge);
+        }
+    }
+
+    std::sort(m_edges.begin(), m_edges.end(), [](const Edge &edge1, const Edge &edge2) { return edge1.firstRow < edge2.firstRow; });
+}
+
+QVector<ScanlinePolygonRasterizer::Span> ScanlinePolygonRasterizer::getSpans(int minX, int maxX, int minY, int maxY) const
+{
+    QVector<Span> spans;
+
+    if (m_edges.isEmpty())
+    {
+        return spans;
+    }
+
+    int lastRow = minY - 1;
+    foreach (const Edge &edge, m_edges)
+    {
+        lastRow = qMax(lastRow, edge.lastRow);
+    }
+    lastRow = qMin(lastRow, maxY);
+
+    QVector<const Edge*> activeEdges;
+    QVector<double> intersections;
+    int nextEdge = 0;
+
+    for (int y = qMax(minY, m_edges.first().firstRow); y <= lastRow; y++)
+    {
+        // Update the active edge table
+        while (nextEdge < m_edges.size() && m_edges.at(nextEdge).firstRow <= y)
+        {
+            activeEdges.append(&m_edges.at(nextEdge));
+            nextEdge++;
+        }
+
+        int activeEdge = 0;
+        while (activeEdge < activeEdges.size())
+        {
+            if (activeEdges.at(activeEdge)->lastRow < y)
+            {
+                activeEdges.remove(activeEdge);
+            }
+            else
+            {
+                activeEdge++;
+            }
+        }
+
+        intersections.resize(0);
+        foreach (const Edge *edge, activeEdges)
+        {
+            intersections.append(edge->xAtOrigin + y * edge->slope);
+        }
+        std::sort(intersections.begin(), intersections.end());
+
+        // The pixels between each pair of intersections are inside
+        for (int i = 0; i + 1 < intersections.size(); i += 2)
+        {
+            Span span;
+            span.y = y;
+            span.firstX = qMax(minX, qCeil(intersections.at(i)));
+            span.lastX = qMin(maxX, qFloor(intersections.at(i + 1)));
+
+            if (span.firstX <= span.lastX)
+            {
+                spans.append(span);
+            }
+        }
+    }
+
+    return spans;
+}
+
+} // namespace udg
@@ -0,0 +1,62 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#ifndef UDG_SCANLINEPOLYGONRASTERIZER_H
+#define UDG_SCANLINEPOLYGONRASTERIZER_H
+
+#include <QPointF>
+#include <QVector>
+
+namespace udg {
+
+/**
+ * @brief The ScanlinePolygonRasterizer class finds the pixels of a grid whose centres are inside a polygon, as horizontal spans of consecutive pixels.
+ *
+ * The polygon is given in pixel coordinates, where the centre of pixel (x, y) is at (x, y), and it is closed implicitly. Inside is defined with the
+ * even-odd rule. The rows are swept with an active edge table, so the cost is linear in the number of rows, edges and spans, and not in the area.
+ */
+class ScanlinePolygonRasterizer
+{
+public:
+    /// Pixels firstX to lastX, both included, of row y.
+    struct Span
+    {
+        int y;
+        int firstX;
+        int lastX;
+    };
+
+    explicit ScanlinePolygonRasterizer(const QVector<QPointF> &polygon);
+
+    /// Returns the spans inside the polygon and inside [minX, maxX] x [minY, maxY], ordered by row and then by x.
+    QVector<Span> getSpans(int minX, int maxX, int minY, int maxY) const;
+
+private:
+    /// Non horizontal edge of the polygon, oriented from its lowest to its highest y.
+    struct Edge
+    {
+        /// First and last rows crossed by the edge. The upper end is excluded so that vertices are counted once.
+        int firstRow;
+        int lastRow;
+        /// x at y = 0 and its increment per row.
+        double xAtOrigin;
+        double slope;
+    };
+
+    QVector<Edge> m_edges;
+};
+
+} // namespace udg
+
+#endif // UDG_SCANLINEPOLYGONRASTERIZER_H
@@ -51,6 +51,12 @@ void SliceHandler::setVolume(Volume *volume)
     reset();
 }
 
+void SliceHandler::replaceVolume(Volume *volume)
+{
+    // The ranges only depend on the geometry, so they are still valid
+    m_volume = volume;
+}
+
 void SliceHandler::setViewPlane(const OrthogonalPlane &viewPlane)
 {
     m_viewPlane = viewPlane;
@@ -33,6 +33,8 @@ public:
     ~SliceHandler();
 
     void setVolume(Volume *volume);
+    /// Replaces the volume by another one with the same geometry, keeping the view plane, slice, phase and slab thickness.
+    void replaceVolume(Volume *volume);
 
     void setViewPlane(const OrthogonalPlane &viewPlane);
     const OrthogonalPlane& getViewPlane() const;
@@ -16,6 +16,7 @@
 
 #include "logging.h"
 #include "volumepixeldata.h"
+#include "volumepixeldataiterator.h"
 #include "voxel.h"
 #include "voxelindex.h"
 
@@ -44,7 +45,7 @@ void getSliceToDataIndices(const OrthogonalPlane &plane, int &x, int &y, int &z)
 }
 
 SliceOrientedVolumePixelData::SliceOrientedVolumePixelData()
-    : m_volumePixelData(nullptr)
+    : m_volumePixelData(nullptr), m_phase(0), m_numberOfPhases(1)
 {
     m_dataToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();    // identity
     m_worldToDataMatrix = vtkSmartPointer<vtkMatrix4x4>::New();    // identity
@@ -69,6 +70,20 @@ SliceOrientedVolumePixelData& SliceOrientedVolumePixelData::setDataToWorldMatrix
     return *this;
 }
 
+SliceOrientedVolumePixelData& SliceOrientedVolumePixelData::setPhase(int phase, int numberOfPhases)
+{
+    if (numberOfPhases < 1 || phase < 0 || phase >= numberOfPhases)
+    {
+        DEBUG_LOG(QString("Invalid phase %1 of %2, the whole pixel data will be used").arg(phase).arg(numberOfPhases));
+        phase = 0;
+        numberOfPhases = 1;
+    }
+
+    m_phase = phase;
+    m_numberOfPhases = numberOfPhases;
+    return *this;
+}
+
 const OrthogonalPlane& SliceOrientedVolumePixelData::getOrthogonalPlane() const
 {
     return m_orthogonalPlane;
@@ -87,7 +102,7 @@ vtkMatrix4x4* SliceOrientedVolumePixelData::getWorldToDataMatrix() const
 std::array<int, 6> SliceOrientedVolumePixelData::getExtent()
 {
     int extent[6];
-    m_volumePixelData->getExtent(extent);
+    getDataExtent(extent);
     int x, y, z;
     getDataToSliceIndices(m_orthogonalPlane, x, y, z);
     return {{extent[2*x], extent[2*x+1], extent[2*y], extent[2*y+1], extent[2*z], extent[2*z+1]}};
@@ -123,11 +138,7 @@ VoxelIndex SliceOrientedVolumePixelData::getVoxelIndex(const Vector3 &wc)
         index[i] = qRound((pixelDataCoordinate[i] - origin[i]) / spacing[i]);
     }
 
-    int *extent = m_volumePixelData->getVtkData()->GetExtent();
-
-    if (index[0] >= extent[0] && index[0] <= extent[1] &&
-        index[1] >= extent[2] && index[1] <= extent[3] &&
-        index[2] >= extent[4] && index[2] <= extent[5])
+    if (isInsideDataExtent(index))
     {
         int x, y, z;
         getDataToSliceIndices(m_orthogonalPlane, x, y, z);
@@ -139,11 +150,44 @@ VoxelIndex SliceOrientedVolumePixelData::getVoxelIndex(const Vector3 &wc)
     }
 }
 
+Vector3 SliceOrientedVolumePixelData::getVoxelCoordinate(const Vector3 &wc)
+{
+    if (!m_volumePixelData->getVtkData())
+    {
+        DEBUG_LOG("No data");
+        return Vector3();
+    }
+
+    double worldCoordinate[4] = { wc.x, wc.y, wc.z, 1.0 };
+    double pixelDataCoordinate[4];
+    m_worldToDataMatrix->MultiplyPoint(worldCoordinate, pixelDataCoordinate);
+
+    double *origin = m_volumePixelData->getVtkData()->GetOrigin();
+    double *spacing = m_volumePixelData->getVtkData()->GetSpacing();
+    double coordinate[3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        coordinate[i] = (pixelDataCoordinate[i] - origin[i]) / spacing[i];
+    }
+
+    int x, y, z;
+    getDataToSliceIndices(m_orthogonalPlane, x, y, z);
+    return Vector3(coordinate[x], coordinate[y], coordinate[z]);
+}
+
 Voxel SliceOrientedVolumePixelData::getVoxelValue(const VoxelIndex &index)
 {
     int x, y, z;
     getSliceToDataIndices(m_orthogonalPlane, x, y, z);
     int dataIndex[3] = { index[x], index[y], index[z] };
+
+    if (!isInsideDataExtent(dataIndex))
+    {
+        return Voxel();
+    }
+
+    dataIndex[2] = getPixelDataZIndex(dataIndex[2]);
     return m_volumePixelData->getVoxelValue(dataIndex);
 }
 
@@ -152,6 +196,25 @@ Voxel SliceOrientedVolumePixelData::getVoxelValue(const Vector3 &worldCoordinate
     return getVoxelValue(getVoxelIndex(worldCoordinate));
 }
 
+void SliceOrientedVolumePixelData::getRowValues(int firstX, int lastX, int row, int slice, double *values)
+{
+    int x, y, z;
+    getSliceToDataIndices(m_orthogonalPlane, x, y, z);
+    int sliceIndex[3] = { firstX, row, slice };
+    VolumePixelDataIterator iterator = m_volumePixelData->getIterator(sliceIndex[x], sliceIndex[y], getPixelDataZIndex(sliceIndex[z]));
+
+    // Consecutive voxels along the slice x axis are separated by the increment of the corresponding data axis, which is never z in an orthogonal plane,
+    // so the interleaved phases don't need to be skipped
+    getDataToSliceIndices(m_orthogonalPlane, x, y, z);
+    int increment = m_volumePixelData->getVtkData()->GetIncrements()[x];
+
+    for (int i = 0; i <= lastX - firstX; i++)
+    {
+        values[i] = iterator.get<double>();
+        iterator += increment;
+    }
+}
+
 Vector3 SliceOrientedVolumePixelData::getWorldCoordinate(const VoxelIndex &index)
 {
     if (!m_volumePixelData->getVtkData())
@@ -162,12 +225,9 @@ Vector3 SliceOrientedVolumePixelData::getWorldCoordinate(const VoxelIndex &index
 
     int x, y, z;
     getSliceToDataIndices(m_orthogonalPlane, x, y, z);
-    VoxelIndex trueIndex(index[x], index[y], index[z]);
-    int *extent = m_volumePixelData->getVtkData()->GetExtent();
+    int trueIndex[3] = { index[x], index[y], index[z] };
 
-    if (trueIndex[0] >= extent[0] && trueIndex[0] <= extent[1] &&
-        trueIndex[1] >= extent[2] && trueIndex[1] <= extent[3] &&
-        trueIndex[2] >= extent[4] && trueIndex[2] <= extent[5])
+    if (isInsideDataExtent(trueIndex))
     {
         double *origin = m_volumePixelData->getVtkData()->GetOrigin();
         double *spacing = m_volumePixelData->getVtkData()->GetSpacing();
@@ -190,4 +250,31 @@ Vector3 SliceOrientedVolumePixelData::getWorldCoordinate(const VoxelIndex &index
     }
 }
 
+void SliceOrientedVolumePixelData::getDataExtent(int extent[6])
+{
+    m_volumePixelData->getExtent(extent);
+
+    // The phases are interleaved along z, so each phase has one of every numberOfPhases slices
+    int depth = extent[5] - extent[4] + 1;
+    extent[5] = extent[4] + depth / m_numberOfPhases - 1;
+}
+
+bool SliceOrientedVolumePixelData::isInsideDataExtent(const int index[3])
+{
+    int extent[6];
+    getDataExtent(extent);
+
+    return index[0] >= extent[0] && index[0] <= extent[1] &&
+           index[1] >= extent[2] && index[1] <= extent[3] &&
+           index[2] >= extent[4] && index[2] <= extent[5];
+}
+
+int SliceOrientedVolumePixelData::getPixelDataZIndex(int z)
+{
+    int extent[6];
+    m_volumePixelData->getExtent(extent);
+
+    return extent[4] + (z - extent[4]) * m_numberOfPhases + m_phase;
+}
+
 } // namespace udg
@@ -43,6 +43,10 @@ public:
     SliceOrientedVolumePixelData& setOrthogonalPlane(OrthogonalPlane plane);
     /// Sets the given data-to-world matrix and its inverse as world-to-data to this object and returns the object.
     SliceOrientedVolumePixelData& setDataToWorldMatrix(vtkMatrix4x4 *dataToWorldMatrix);
+    /// Restricts this object to the given phase of a pixel data that interleaves the given number of phases along its z axis, and returns the object.
+    /// Indices, extent and world coordinates are then those of the phase alone, as in the output of VtkImageExtractPhase, but the voxels are read in place
+    /// from the whole pixel data without copying them.
+    SliceOrientedVolumePixelData& setPhase(int phase, int numberOfPhases);
 
     /// Returns the orthogonal plane that defines the slice orientation with respect to the volume pixel data.
     const OrthogonalPlane& getOrthogonalPlane() const;
@@ -58,13 +62,26 @@ public:
 
     /// Returns the slice oriented voxel index corresponding to the given world coordinate.
     VoxelIndex getVoxelIndex(const Vector3 &worldCoordinate);
+    /// Returns the slice oriented continuous voxel coordinates, without rounding to an index, corresponding to the given world coordinate.
+    Vector3 getVoxelCoordinate(const Vector3 &worldCoordinate);
     /// Returns the voxel value at the given slice oriented voxel index.
     Voxel getVoxelValue(const VoxelIndex &index);
     /// Returns the voxel value at the given world coordinate.
     Voxel getVoxelValue(const Vector3 &worldCoordinate);
+    /// Writes into values the first component of the voxels from firstX to lastX of the given row and slice, all of them slice oriented indices.
+    /// The voxels must be inside the extent and values must have room for all of them.
+    void getRowValues(int firstX, int lastX, int row, int slice, double *values);
     /// Returns the world coordinate corresponding to the given slice oriented voxel index.
     Vector3 getWorldCoordinate(const VoxelIndex &index);
 
+private:
+    /// Writes into extent the pixel data extent seen through the current phase, in pixel data axes.
+    void getDataExtent(int extent[6]);
+    /// Returns true if the given pixel data index, in phase coordinates, is inside the extent of the current phase.
+    bool isInsideDataExtent(const int index[3]);
+    /// Returns the z index in the whole pixel data corresponding to the given z index in the current phase.
+    int getPixelDataZIndex(int z);
+
 private:
     /// The underlying volume pixel data.
     VolumePixelData *m_volumePixelData;
@@ -74,6 +91,9 @@ private:
     vtkSmartPointer<vtkMatrix4x4> m_dataToWorldMatrix;
     /// Inverse of the data-to-world matrix.
     vtkSmartPointer<vtkMatrix4x4> m_worldToDataMatrix;
+    /// Phase seen through this object and number of phases interleaved in the pixel data.
+    int m_phase;
+    int m_numberOfPhases;
 
 };
 
@@ -28,7 +28,7 @@
 namespace udg {
 
 Volume::Volume(QObject *parent)
-: QObject(parent), m_checkedImagesAnatomicalPlane(false)
+: QObject(parent), m_checkedImagesAnatomicalPlane(false), m_pixelDataIsReadFromImages(false), m_pixelDataUnloaded(false)
 {
     m_numberOfPhases = 1;
     m_numberOfSlicesPerPhase = 1;
@@ -55,19 +55,38 @@ vtkImageData* Volume::getVtkData()
 void Volume::setData(ItkImageTypePointer itkImage)
 {
     m_volumePixelData->setData(itkImage);
+    m_pixelDataIsReadFromImages = false;
+    m_pixelDataUnloaded = false;
 }
 
 void Volume::setData(vtkImageData *vtkImage)
 {
     m_volumePixelData->setData(vtkImage);
+    m_pixelDataIsReadFromImages = false;
+    m_pixelDataUnloaded = false;
 }
 
 void Volume::setPixelData(VolumePixelData *pixelData)
 {
     Q_ASSERT(pixelData != 0);
-    m_volumePixelData = pixelData;
+
+    if (m_pixelDataUnloaded && pixelData != m_volumePixelData)
+    {
+        // The pixel data is being read again after having been unloaded. Others may still keep pointers to the unloaded object, so the read data is moved
+        // into it instead of replacing it
+        m_volumePixelData->takeData(pixelData);
+        delete pixelData;
+    }
+    else
+    {
+        m_volumePixelData = pixelData;
+    }
+    m_pixelDataUnloaded = false;
     // Set the number of phases to the new pixel data
     m_volumePixelData->setNumberOfPhases(m_numberOfPhases);
+    // Only the volume readers set the pixel data
+    m_pixelDataIsReadFromImages = true;
+    emit pixelDataLoaded();
 }
 
 VolumePixelData* Volume::getPixelData()
@@ -677,6 +696,7 @@ double Volume::getScalarValue(int x, int y, int z)
 void Volume::convertToNeutralVolume()
 {
     m_volumePixelData->convertToNeutralPixelData();
+    m_pixelDataIsReadFromImages = false;
 
     // Quan creem el volum neutre indiquem que només tenim 1 sola fase
     // TODO Potser s'haurien de crear tantes fases com les que indiqui la sèrie?
@@ -832,4 +852,22 @@ bool Volume::areAllImagesInTheSameAnatomicalPlane() const
     return m_allImagesAreInTheSameAnatomicalPlane;
 }
 
+bool Volume::canUnloadPixelData() const
+{
+    return m_pixelDataIsReadFromImages && isPixelDataLoaded() && !m_volumePixelData->isDataShared();
+}
+
+void Volume::unloadPixelData()
+{
+    if (!canUnloadPixelData())
+    {
+        return;
+    }
+
+    // The object is kept because others may have pointers to it, only its data is freed
+    m_volumePixelData->unloadData();
+    m_pixelDataIsReadFromImages = false;
+    m_pixelDataUnloaded = true;
+}
+
 };
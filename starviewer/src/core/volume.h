@@ -66,6 +66,7 @@ public:
 
     /// Assigna/Retorna el Volume Pixel Data
     /// L'assignació no accepta punters nuls.
+    /// If the pixel data had been unloaded, the data of pixelData is moved into the current object and pixelData is deleted.
     void setPixelData(VolumePixelData *pixelData);
     VolumePixelData* getPixelData();
 
@@ -216,12 +217,21 @@ public:
 
     /// Returns true if all the images in this volume are in the same anatomical plane.
     bool areAllImagesInTheSameAnatomicalPlane() const;
+
+    /// Returns true if the pixel data is loaded, has been read from the images, so that it can be read again when needed, and is not referenced by anyone else.
+    bool canUnloadPixelData() const;
+    /// Frees the pixel data if canUnloadPixelData() is true. It will be read again from the images the next time it's needed. The VolumePixelData object is
+    /// kept, so pointers to it stay valid and will see the data when it's read again.
+    void unloadPixelData();
     
 signals:
     /// Emet l'estat del progrés en el que es troba la càrrega de dades del volum
     /// @param progress progrés de la càrrega en una escala de 1 a 100
     void progress(int);
 
+    /// Emitted when the pixel data has been read from the images. It can be emitted from the thread that reads the volume.
+    void pixelDataLoaded();
+
 private:
 
     virtual VolumeReader* createVolumeReader();
@@ -246,6 +256,10 @@ private:
 
     /// Pixel data del volume
     VolumePixelData *m_volumePixelData;
+    /// True if the current pixel data has been read from the images
+    bool m_pixelDataIsReadFromImages;
+    /// True if the pixel data has been unloaded and not read again yet
+    bool m_pixelDataUnloaded;
 
     /// TODO membre temporal per la transició al tractament de fases
     int m_numberOfPhases;
@@ -18,6 +18,7 @@
 #include "slicehandler.h"
 #include "sliceorientedvolumepixeldata.h"
 #include "volume.h"
+#include "volumerepository.h"
 #include "voilutpresetstooldata.h"
 #include "volumepixeldata.h"
 #include "image.h"
@@ -55,6 +56,7 @@ VolumeDisplayUnit::VolumeDisplayUnit()
 
 VolumeDisplayUnit::~VolumeDisplayUnit()
 {
+    VolumeRepository::getRepository()->releaseVolume(m_volume);
     delete m_imagePipeline;
     m_imageSlice->Delete();
     m_mapper->Delete();
@@ -81,6 +83,9 @@ Volume* VolumeDisplayUnit::getVolume() const
 
 void VolumeDisplayUnit::setVolume(Volume *volume)
 {
+    // Retain first in case it's the same volume so that it's never left unretained
+    VolumeRepository::getRepository()->retainVolume(volume);
+    VolumeRepository::getRepository()->releaseVolume(m_volume);
     m_volume = volume;
     m_sliceHandler->setVolume(volume);
 
@@ -89,6 +94,17 @@ void VolumeDisplayUnit::setVolume(Volume *volume)
     m_imageSlice->GetMapper()->SetInputConnection(m_imagePipeline->getOutput().getVtkAlgorithmOutput());
 }
 
+void VolumeDisplayUnit::replaceVolume(Volume *volume)
+{
+    VolumeRepository::getRepository()->retainVolume(volume);
+    VolumeRepository::getRepository()->releaseVolume(m_volume);
+    m_volume = volume;
+    m_sliceHandler->replaceVolume(volume);
+
+    // The rest of the pipeline and the mapper keep their settings
+    m_imagePipeline->setInput(m_volume->getVtkData());
+}
+
 void VolumeDisplayUnit::setVoiLutData(VoiLutPresetsToolData *voiLutData)
 {
     m_voiLutData = voiLutData;
@@ -187,14 +203,9 @@ SliceOrientedVolumePixelData VolumeDisplayUnit::getCurrentPixelData()
     }
     else if (m_sliceHandler->getNumberOfPhases() > 1)
     {
-        if (!m_auxiliarCurrentVolumePixelData)
-        {
-            m_auxiliarCurrentVolumePixelData = new VolumePixelData();
-        }
-
-        m_auxiliarCurrentVolumePixelData->setData(m_imagePipeline->getPhaseOutput());
-
-        return SliceOrientedVolumePixelData().setVolumePixelData(m_auxiliarCurrentVolumePixelData).setOrthogonalPlane(getViewPlane());
+        // The current phase is read in place from the whole volume, without running the phase filter
+        return SliceOrientedVolumePixelData().setVolumePixelData(m_volume->getPixelData()).setOrthogonalPlane(getViewPlane())
+                                              .setPhase(m_sliceHandler->getCurrentPhase(), m_sliceHandler->getNumberOfPhases());
     }
     else
     {
@@ -55,6 +55,9 @@ public:
     Volume* getVolume() const;
     /// Sets a new volume and resets display properties (pipeline and slice handler).
     void setVolume(Volume *volume);
+    /// Replaces the volume by another one with the same geometry, e.g. the completed volume of a progressive load, keeping the view plane, slice, phase,
+    /// slab and VOI LUT.
+    void replaceVolume(Volume *volume);
 
     /// Returns the VOI LUT data.
     VoiLutPresetsToolData* getVoiLutData() const;
@@ -20,6 +20,8 @@
 
 #include <vtkImageChangeInformation.h>
 #include <vtkImageData.h>
+#include <vtkImageExport.h>
+#include <vtkPointData.h>
 
 #include "logging.h"
 
@@ -127,6 +129,71 @@ bool VolumePixelData::isLoaded() const
     return m_loaded;
 }
 
+bool VolumePixelData::isDataShared() const
+{
+    if (!m_imageDataVTK)
+    {
+        return false;
+    }
+
+    // Our own filters also keep references to the image: the ITK to VTK one to its output and the VTK to ITK one to its input
+    int ownReferences = 1;
+    if (m_itkToVtkFilter->GetOutput() == m_imageDataVTK.GetPointer())
+    {
+        ownReferences++;
+    }
+    if (m_vtkToItkFilter->GetExporter()->GetInput() == m_imageDataVTK.GetPointer())
+    {
+        ownReferences++;
+
+        // The ITK image given by getItkData() uses the same buffer
+        if (m_vtkToItkFilter->GetImporter()->GetOutput()->GetReferenceCount() > 1)
+        {
+            return true;
+        }
+    }
+
+    if (m_imageDataVTK->GetReferenceCount() > ownReferences)
+    {
+        return true;
+    }
+
+    // Filters that pass the data through (e.g. vtkImageChangeInformation) only reference the scalars array
+    vtkDataArray *scalars = m_imageDataVTK->GetPointData()->GetScalars();
+    return scalars && scalars->GetReferenceCount() > 1;
+}
+
+void VolumePixelData::unloadData()
+{
+    // The image data is not released, since someone could still be using it: dropping the reference frees it when it's the last one
+    m_imageDataVTK = vtkSmartPointer<vtkImageData>::New();
+    m_itkToVtkFilter = ItkToVtkFilterType::New();
+    m_vtkToItkFilter = VtkToItkFilterType::New();
+    m_loaded = false;
+}
+
+void VolumePixelData::takeData(VolumePixelData *pixelData)
+{
+    Q_ASSERT(pixelData != 0);
+
+    if (pixelData == this)
+    {
+        return;
+    }
+
+    // The output of the ITK to VTK filter shares the buffer of the ITK image it has been created from, so the filters must be moved along with the data
+    m_imageDataVTK = pixelData->m_imageDataVTK;
+    m_itkToVtkFilter = pixelData->m_itkToVtkFilter;
+    m_vtkToItkFilter = pixelData->m_vtkToItkFilter;
+    m_loaded = pixelData->m_loaded;
+    setNumberOfPhases(pixelData->m_numberOfPhases);
+
+    pixelData->m_imageDataVTK = vtkSmartPointer<vtkImageData>::New();
+    pixelData->m_itkToVtkFilter = ItkToVtkFilterType::New();
+    pixelData->m_vtkToItkFilter = VtkToItkFilterType::New();
+    pixelData->m_loaded = false;
+}
+
 void* VolumePixelData::getScalarPointer(int x, int y, int z)
 {
     return this->getVtkData()->GetScalarPointer(x, y, z);
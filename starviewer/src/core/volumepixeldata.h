@@ -74,6 +74,13 @@ public:
     /// Retorna cert si conté dades carregades.
     bool isLoaded() const;
 
+    /// Returns true if the image data or its scalars are referenced from outside this object, e.g. by a VTK pipeline or an ITK image.
+    bool isDataShared() const;
+    /// Drops the reference to the image data and leaves this object as not loaded. The memory is freed only if no one else references it.
+    void unloadData();
+    /// Moves the data of pixelData into this object, leaving pixelData empty. Pointers to this object stay valid and see the new data.
+    void takeData(VolumePixelData *pixelData);
+
     /// Returns a pointer to the raw pixel data at index [x, y, z]. Avoid its use if possible and prefer using an iterator instead.
     void* getScalarPointer(int x, int y, int z);
     /// Returns a pointer to the raw pixel data. Avoid its use if possible and prefer using an iterator instead.
@@ -31,6 +31,11 @@ void VolumePixelDataReader::setFrameNumbers(const QList<int> &frameNumbers)
     m_frameNumbers = frameNumbers;
 }
 
+void VolumePixelDataReader::setPriorityFrames(const QList<int> &frameIndices)
+{
+    m_priorityFrames = frameIndices;
+}
+
 VolumePixelData* VolumePixelDataReader::getVolumePixelData()
 {
     return m_volumePixelData;
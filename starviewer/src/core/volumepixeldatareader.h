@@ -17,6 +17,8 @@
 
 #include <QObject>
 
+class vtkImageData;
+
 namespace udg {
 
 class VolumePixelData;
@@ -40,6 +42,10 @@ public:
     /// Sets the list of frame numbers in the order they must be read from a multiframe file.
     void setFrameNumbers(const QList<int> &frameNumbers);
 
+    /// Sets the frames, as slice indices in the volume, that should be read before the others. Readers that support progressive reading read them first,
+    /// emit priorityFramesLoaded() and then read the rest emitting framesLoaded() as they arrive. The other readers ignore it.
+    void setPriorityFrames(const QList<int> &frameIndices);
+
     /// Donada una llista de noms de fitxer, la llegeix i omple
     /// l'estructura d'imatge que fem servir internament.
     /// Ens retorna un enter que ens indicarà si hi ha hagut alguna mena d'error en el
@@ -58,10 +64,19 @@ signals:
     /// Ens indica el progrés del procés de lectura
     void progress(int progress);
 
+    /// Emitted in progressive reads when the priority frames have been read. The given image data shares its scalars with the data that is being read,
+    /// where the frames not read yet are zero. It's emitted from the reading thread, so receivers must take a reference to the image data before returning.
+    void priorityFramesLoaded(vtkImageData *imageData);
+    /// Emitted in progressive reads, after priorityFramesLoaded(), with the frames that have been read since the previous emission.
+    void framesLoaded(const QList<int> &frameIndices);
+
 protected:
     /// List of frame numbers in the order they must be read from a multiframe file. Can be ignored for single-frame files.
     QList<int> m_frameNumbers;
 
+    /// Frames that should be read before the others in progressive reads. Can be ignored by readers that don't support progressive reading.
+    QList<int> m_priorityFrames;
+
     /// Les dades d'imatge en format vtk
     VolumePixelData *m_volumePixelData;
 
@@ -14,6 +14,7 @@
 
 #include "volumepixeldatareadervtkdcmtk.h"
 
+#include "coresettings.h"
 #include "logging.h"
 #include "volumepixeldata.h"
 #include "vtkdcmtkimagereader.h"
@@ -21,6 +22,9 @@
 #include <QStringList>
 
 #include <vtkEventQtSlotConnect.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
 #include <vtkStringArray.h>
 
 namespace udg {
@@ -30,9 +34,16 @@ VolumePixelDataReaderVTKDCMTK::VolumePixelDataReaderVTKDCMTK(QObject *parent) :
 {
     m_reader = VtkDcmtkImageReader::New();
 
+    Settings settings;
+    m_reader->setNumberOfThreads(settings.getValue(CoreSettings::NumberOfThreadsForVtkDcmtkImageReader).toInt());
+
     // VTK progress
     m_vtkQtConnections = vtkEventQtSlotConnect::New();
     m_vtkQtConnections->Connect(m_reader, vtkCommand::ProgressEvent, this, SLOT(progressSlot()));
+    // Progressive read events
+    m_vtkQtConnections->Connect(m_reader, VtkDcmtkImageReader::PriorityFramesLoadedEvent, this,
+                                SLOT(priorityFramesLoadedSlot(vtkObject*, unsigned long, void*, void*)));
+    m_vtkQtConnections->Connect(m_reader, VtkDcmtkImageReader::FramesLoadedEvent, this, SLOT(framesLoadedSlot(vtkObject*, unsigned long, void*, void*)));
 }
 
 VolumePixelDataReaderVTKDCMTK::~VolumePixelDataReaderVTKDCMTK()
@@ -74,6 +85,7 @@ int VolumePixelDataReaderVTKDCMTK::read(const QStringList &filenames)
 
     // Set frame numbers to the reader (needed for multiframe files)
     m_reader->setFrameNumbers(m_frameNumbers);
+    m_reader->setPriorityFrames(m_priorityFrames);
 
     try
     {
@@ -126,4 +138,27 @@ void VolumePixelDataReaderVTKDCMTK::progressSlot()
     emit progress(static_cast<int>(m_reader->GetProgress() * 100));
 }
 
+void VolumePixelDataReaderVTKDCMTK::priorityFramesLoadedSlot(vtkObject *object, unsigned long event, void *clientData, void *callData)
+{
+    Q_UNUSED(object)
+    Q_UNUSED(event)
+    Q_UNUSED(clientData)
+
+    vtkImageData *output = static_cast<vtkImageData*>(callData);
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->CopyStructure(output);
+    imageData->GetPointData()->SetScalars(output->GetPointData()->GetScalars());
+
+    emit priorityFramesLoaded(imageData);
+}
+
+void VolumePixelDataReaderVTKDCMTK::framesLoadedSlot(vtkObject *object, unsigned long event, void *clientData, void *callData)
+{
+    Q_UNUSED(object)
+    Q_UNUSED(event)
+    Q_UNUSED(clientData)
+
+    emit framesLoaded(*static_cast<QList<int>*>(callData));
+}
+
 } // end namespace udg
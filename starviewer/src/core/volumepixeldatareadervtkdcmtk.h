@@ -18,6 +18,7 @@
 #include "volumepixeldatareader.h"
 
 class vtkEventQtSlotConnect;
+class vtkObject;
 
 namespace udg {
 
@@ -45,6 +46,11 @@ private slots:
 
     /// Receives the VTK progress event from the reader and emits the Qt progress signal.
     void progressSlot();
+    /// Receives the VTK priority frames loaded event from the reader and emits priorityFramesLoaded() with a new image data that shares the scalars of the
+    /// reader output, so that it isn't affected if the reader reallocates its output.
+    void priorityFramesLoadedSlot(vtkObject *object, unsigned long event, void *clientData, void *callData);
+    /// Receives the VTK frames loaded event from the reader and emits framesLoaded().
+    void framesLoadedSlot(vtkObject *object, unsigned long event, void *clientData, void *callData);
 
 private:
 
@@ -35,10 +35,39 @@ int getFrameNumber(const Image *image)
     return image->getFrameNumber();
 }
 
+// Number of slices of the coarse subset read first in progressive reads. Volumes with less than twice this number of slices are read as usual.
+const int NumberOfCoarseSlices = 16;
+
+// Returns the slices to read first in a progressive read of a volume with the given number of slices: the first slice and a strided subset of the volume.
+QList<int> getPriorityFrames(int numberOfSlices, int firstSlice)
+{
+    QList<int> frames;
+
+    if (numberOfSlices < 2 * NumberOfCoarseSlices)
+    {
+        return frames;
+    }
+
+    firstSlice = qBound(0, firstSlice, numberOfSlices - 1);
+    frames << firstSlice;
+
+    int stride = numberOfSlices / NumberOfCoarseSlices;
+
+    for (int slice = firstSlice % stride; slice < numberOfSlices; slice += stride)
+    {
+        if (slice != firstSlice)
+        {
+            frames << slice;
+        }
+    }
+
+    return frames;
+}
+
 }
 
 VolumeReader::VolumeReader(QObject *parent)
-    : QObject(parent), m_volumePixelDataReader(0), m_abortRequested(false)
+    : QObject(parent), m_volumePixelDataReader(0), m_abortRequested(false), m_progressiveReading(false), m_firstSliceToRead(0)
 {
      m_lastError = VolumePixelDataReader::NoError;
 }
@@ -84,6 +113,12 @@ void VolumeReader::executePixelDataReader(Volume *volume)
         QList<int> frameNumbers = QtConcurrent::blockingMapped(volume->getImages(), getFrameNumber);
         m_volumePixelDataReader->setFrameNumbers(frameNumbers);
 
+        // Frame indices are slice indices only with one phase
+        if (m_progressiveReading && volume->getNumberOfPhases() == 1)
+        {
+            m_volumePixelDataReader->setPriorityFrames(getPriorityFrames(volume->getImages().size(), m_firstSliceToRead));
+        }
+
         if (m_abortRequested)
         {
             m_lastError = VolumePixelDataReader::ReadAborted;
@@ -120,6 +155,12 @@ bool VolumeReader::readWithoutShowingError(Volume *volume)
     return m_lastError == VolumePixelDataReader::NoError;
 }
 
+void VolumeReader::setProgressiveReading(bool enabled, int firstSlice)
+{
+    m_progressiveReading = enabled;
+    m_firstSliceToRead = firstSlice;
+}
+
 void VolumeReader::requestAbort()
 {
     if (m_volumePixelDataReader)
@@ -252,6 +293,8 @@ void VolumeReader::setUpReader(Volume *volume)
 
     // Connectem les senyals de notificació de progrés
     connect(m_volumePixelDataReader, SIGNAL(progress(int)), SIGNAL(progress(int)));
+    connect(m_volumePixelDataReader, SIGNAL(priorityFramesLoaded(vtkImageData*)), SIGNAL(priorityFramesLoaded(vtkImageData*)));
+    connect(m_volumePixelDataReader, SIGNAL(framesLoaded(QList<int>)), SIGNAL(framesLoaded(QList<int>)));
 }
 
 void VolumeReader::runPostprocessors(Volume *volume)
@@ -20,6 +20,8 @@
 #include <QQueue>
 #include <QSharedPointer>
 
+class vtkImageData;
+
 namespace udg {
 
 class Postprocessor;
@@ -49,6 +51,11 @@ public:
     /// Si no s'ha iniciat cap procés de lectura, no farà res. Un cop cridat la lectura retornarà amb error.
     void requestAbort();
 
+    /// Enables or disables progressive reading, disabled by default. When enabled, the given slice and a strided subset of the volume are read first and
+    /// priorityFramesLoaded() is emitted as soon as they are available; then the rest of slices are read, emitting framesLoaded() as they arrive.
+    /// Small volumes, volumes with more than one phase and volumes read with a reader that doesn't support it are read as usual.
+    void setProgressiveReading(bool enabled, int firstSlice = 0);
+
     /// Mostra per pantalla un message box informant de l'error que s'ha produit al llegir el volum.
     /// Si no s'ha produit cap error, no fa res.
     void showMessageBoxWithLastError() const;
@@ -63,6 +70,12 @@ signals:
     /// no tindrem cap tipus de progrés.
     void progress(int progress);
 
+    /// Emitted in progressive reads when the first slices have been read, with image data that will be filled with the rest of slices. It's emitted from
+    /// the reading thread, so receivers must take a reference to the image data before returning.
+    void priorityFramesLoaded(vtkImageData *imageData);
+    /// Emitted in progressive reads, after priorityFramesLoaded(), with the slices that have been read since the previous emission.
+    void framesLoaded(const QList<int> &frameIndices);
+
 private:
     /// Executa el pixel reader i llegeix el volume
     void executePixelDataReader(Volume *volume);
@@ -98,6 +111,11 @@ private:
     /// Used to know that abort has been requested before having the pixel data reader.
     bool m_abortRequested;
 
+    /// True if progressive reading is enabled.
+    bool m_progressiveReading;
+    /// Slice to read first in progressive reads.
+    int m_firstSliceToRead;
+
 };
 
 } // End namespace udg
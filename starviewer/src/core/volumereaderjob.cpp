@@ -18,6 +18,8 @@
 #include "volume.h"
 #include "logging.h"
 
+#include <vtkImageData.h>
+
 namespace udg {
 
 VolumeReaderJob::VolumeReaderJob(Volume *volume, QObject *parent)
@@ -28,6 +30,10 @@ VolumeReaderJob::VolumeReaderJob(Volume *volume, QObject *parent)
     m_volumeReadSuccessfully = false;
     m_lastErrorMessageToUser = "";
     m_abortRequested = false;
+    m_progressiveReading = false;
+    m_firstSliceToRead = 0;
+
+    qRegisterMetaType<QList<int> >("QList<int>");
 }
 
 VolumeReaderJob::~VolumeReaderJob()
@@ -59,6 +65,20 @@ QString VolumeReaderJob::getLastErrorMessageToUser() const
     return m_lastErrorMessageToUser;
 }
 
+void VolumeReaderJob::setProgressiveReading(bool enabled, int firstSlice)
+{
+    QMutexLocker locker(&m_volumeReaderToAbortMutex);
+
+    m_progressiveReading = enabled;
+    m_firstSliceToRead = firstSlice;
+}
+
+vtkSmartPointer<vtkImageData> VolumeReaderJob::getPartiallyLoadedImageData() const
+{
+    QMutexLocker locker(&m_partiallyLoadedImageDataMutex);
+    return m_partiallyLoadedImageData;
+}
+
 Volume* VolumeReaderJob::getVolume() const
 {
     return m_volumeToRead;
@@ -85,9 +105,13 @@ void VolumeReaderJob::run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *t
         // assegurar-nos que si salta una excepció s'alliberarà el lock.
         QMutexLocker locker(&m_volumeReaderToAbortMutex);
         m_volumeReaderToAbort = volumeReader;
+        volumeReader->setProgressiveReading(m_progressiveReading, m_firstSliceToRead);
     }
 
     connect(volumeReader, SIGNAL(progress(int)), SLOT(updateProgress(int)));
+    // Direct connections because the image data must be referenced before the reader continues
+    connect(volumeReader, SIGNAL(priorityFramesLoaded(vtkImageData*)), SLOT(setPartiallyLoadedImageData(vtkImageData*)), Qt::DirectConnection);
+    connect(volumeReader, SIGNAL(framesLoaded(QList<int>)), SLOT(updateLoadedFrames(QList<int>)), Qt::DirectConnection);
     m_volumeReadSuccessfully = volumeReader->readWithoutShowingError(m_volumeToRead);
     m_lastErrorMessageToUser = volumeReader->getLastErrorMessageToUser();
 
@@ -98,6 +122,11 @@ void VolumeReaderJob::run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *t
         delete volumeReader;
     }
 
+    {
+        QMutexLocker locker(&m_partiallyLoadedImageDataMutex);
+        m_partiallyLoadedImageData = 0;
+    }
+
     DEBUG_LOG(QString("End VolumeReaderJob::run() with Volume: %1 and result %2").arg(m_volumeIdentifier.getValue()).arg(m_volumeReadSuccessfully));
     if (!m_volumeReadSuccessfully)
     {
@@ -117,4 +146,19 @@ void VolumeReaderJob::updateProgress(int value)
     emit progress(this, value);
 }
 
+void VolumeReaderJob::setPartiallyLoadedImageData(vtkImageData *imageData)
+{
+    {
+        QMutexLocker locker(&m_partiallyLoadedImageDataMutex);
+        m_partiallyLoadedImageData = imageData;
+    }
+
+    emit priorityFramesLoaded(this);
+}
+
+void VolumeReaderJob::updateLoadedFrames(const QList<int> &frameIndices)
+{
+    emit framesLoaded(this, frameIndices);
+}
+
 } // End namespace udg
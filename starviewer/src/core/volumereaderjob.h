@@ -22,6 +22,10 @@
 #include <QPointer>
 #include <QMutex>
 
+#include <vtkSmartPointer.h>
+
+class vtkImageData;
+
 namespace udg {
 
 class Volume;
@@ -51,6 +55,14 @@ public:
     /// el codi d'error i és des de la interfície que es converteix en missatge a l'usuari.
     QString getLastErrorMessageToUser() const;
 
+    /// Enables progressive reading starting at the given slice (see VolumeReader::setProgressiveReading()). It only has effect if called before the job
+    /// starts running.
+    void setProgressiveReading(bool enabled, int firstSlice = 0);
+
+    /// Returns the image data that is being filled by a progressive read since priorityFramesLoaded() has been emitted until the job finishes.
+    /// Otherwise returns null.
+    vtkSmartPointer<vtkImageData> getPartiallyLoadedImageData() const;
+
     /// Retorna el volume
     Volume* getVolume() const;
     /// Returns the identifier of the volume, even if the volume is destructed.
@@ -60,6 +72,10 @@ signals:
     /// Signal que s'emet amb el progrés de lectura
     void progress(VolumeReaderJob*, int progress);
     void done(ThreadWeaver::JobPointer);
+    /// Emitted from the reading thread in progressive reads when the first slices are available through getPartiallyLoadedImageData().
+    void priorityFramesLoaded(VolumeReaderJob*);
+    /// Emitted from the reading thread in progressive reads, after priorityFramesLoaded(), with the slices read since the previous emission.
+    void framesLoaded(VolumeReaderJob*, const QList<int> &frameIndices);
 
 protected:
     /// Mètode on realment es fa la càrrega. S'executa en un thread de threadweaver.
@@ -69,6 +85,10 @@ protected:
 private slots:
     /// Slot to emit the current progress
     void updateProgress(int value);
+    /// Keeps the partially loaded image data and emits priorityFramesLoaded(). Must be called from the reading thread.
+    void setPartiallyLoadedImageData(vtkImageData *imageData);
+    /// Emits framesLoaded() for the given slices. Must be called from the reading thread.
+    void updateLoadedFrames(const QList<int> &frameIndices);
 private:
     Volume *m_volumeToRead;
     /// Keeps the identifier of the volume to have access to it even if the volume is deleted.
@@ -85,7 +105,18 @@ private:
     QPointer<VolumeReader> m_volumeReaderToAbort;
 
     /// Mutex per protegir els canvis de referència a m_volumeReaderToAbort en escenaris de multithreading.
+    /// It also protects the progressive reading options.
     QMutex m_volumeReaderToAbortMutex;
+
+    /// True if the volume must be read progressively.
+    bool m_progressiveReading;
+    /// Slice to read first in progressive reads.
+    int m_firstSliceToRead;
+
+    /// Image data being filled in a progressive read.
+    vtkSmartPointer<vtkImageData> m_partiallyLoadedImageData;
+    /// Protects m_partiallyLoadedImageData.
+    mutable QMutex m_partiallyLoadedImageDataMutex;
 };
 
 } // End namespace udg
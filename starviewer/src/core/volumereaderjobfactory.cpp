@@ -88,7 +88,7 @@ VolumeReaderJobFactory::~VolumeReaderJobFactory()
     DEBUG_LOG("VolumeReaderJobFactory is closed");
 }
 
-QSharedPointer<VolumeReaderJob> VolumeReaderJobFactory::read(Volume *volume)
+QSharedPointer<VolumeReaderJob> VolumeReaderJobFactory::read(Volume *volume, bool progressiveReading, int firstSlice)
 {
     DEBUG_LOG(QString("AsynchronousVolumeReader::read Begin volume: %1").arg(volume->getIdentifier().getValue()));
 
@@ -100,6 +100,7 @@ QSharedPointer<VolumeReaderJob> VolumeReaderJobFactory::read(Volume *volume)
     }
 
     VolumeReaderJob *volumeReaderJob = new VolumeReaderJob(volume);
+    volumeReaderJob->setProgressiveReading(progressiveReading, firstSlice);
     QSharedPointer<VolumeReaderJob> jobPointer(volumeReaderJob);
     assignResourceRestrictionPolicy(volumeReaderJob);
 
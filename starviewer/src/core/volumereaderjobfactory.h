@@ -44,7 +44,8 @@ class VolumeReaderJobFactory : public QObject, public SingletonPointer<VolumeRea
 Q_OBJECT
 public:
     /// Starts reading the given volume asynchronously. Returns the job that performs the reading.
-    QSharedPointer<VolumeReaderJob> read(Volume *volume);
+    /// If the volume isn't being read yet and progressive reading is requested, it's read progressively starting at the given slice.
+    QSharedPointer<VolumeReaderJob> read(Volume *volume, bool progressiveReading = false, int firstSlice = 0);
 
     /// Cancel·la la càrrega de volume i, un cop cancel·lada, esborra volume.
     /// Si volume no s'està carregant, l'esborrarà directament.
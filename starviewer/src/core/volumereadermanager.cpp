@@ -18,10 +18,12 @@
 #include "volumereaderjob.h"
 #include "volume.h"
 
+#include <vtkImageData.h>
+
 namespace udg {
 
 VolumeReaderManager::VolumeReaderManager(QObject *parent) :
-    QObject(parent)
+    QObject(parent), m_progressiveReading(false), m_firstSliceToRead(0)
 {
 }
 
@@ -40,6 +42,12 @@ void VolumeReaderManager::initialize()
     m_numberOfFinishedJobs = 0;
 }
 
+void VolumeReaderManager::setProgressiveReading(bool enabled, int firstSlice)
+{
+    m_progressiveReading = enabled;
+    m_firstSliceToRead = firstSlice;
+}
+
 void VolumeReaderManager::readVolume(Volume *volume)
 {
     QList<Volume*> volumes;
@@ -55,12 +63,14 @@ void VolumeReaderManager::readVolumes(const QList<Volume*> &volumes)
     foreach (Volume *volume, volumes)
     {
         VolumeReaderJobFactory *volumeReader = VolumeReaderJobFactory::instance();
-        QSharedPointer<VolumeReaderJob> job = volumeReader->read(volume);
+        QSharedPointer<VolumeReaderJob> job = volumeReader->read(volume, m_progressiveReading, m_firstSliceToRead);
         m_volumeReaderJobs << job;
         m_jobsProgress.insert(job.data(), 0);
         m_volumes << NULL;
         connect(job.data(), SIGNAL(done(ThreadWeaver::JobPointer)), SLOT(jobFinished(ThreadWeaver::JobPointer)));
         connect(job.data(), SIGNAL(progress(VolumeReaderJob*, int)), SLOT(updateProgress(VolumeReaderJob*, int)));
+        connect(job.data(), SIGNAL(priorityFramesLoaded(VolumeReaderJob*)), SLOT(jobPriorityFramesLoaded(VolumeReaderJob*)));
+        connect(job.data(), SIGNAL(framesLoaded(VolumeReaderJob*, QList<int>)), SLOT(jobFramesLoaded(VolumeReaderJob*, QList<int>)));
     }
 }
 
@@ -75,6 +85,8 @@ void VolumeReaderManager::cancelReading()
         {
             disconnect(job.data(), SIGNAL(done(ThreadWeaver::JobPointer)), this, SLOT(jobFinished(ThreadWeaver::JobPointer)));
             disconnect(job.data(), SIGNAL(progress(VolumeReaderJob*, int)), this, SLOT(updateProgress(VolumeReaderJob*, int)));
+            disconnect(job.data(), SIGNAL(priorityFramesLoaded(VolumeReaderJob*)), this, SLOT(jobPriorityFramesLoaded(VolumeReaderJob*)));
+            disconnect(job.data(), SIGNAL(framesLoaded(VolumeReaderJob*, QList<int>)), this, SLOT(jobFramesLoaded(VolumeReaderJob*, QList<int>)));
         }
         m_volumeReaderJobs[i].clear();
     }
@@ -145,4 +157,20 @@ void VolumeReaderManager::jobFinished(ThreadWeaver::JobPointer job)
     }
 }
 
+void VolumeReaderManager::jobPriorityFramesLoaded(VolumeReaderJob *job)
+{
+    // It may have finished in the meantime, then the whole volume will be available soon
+    vtkSmartPointer<vtkImageData> imageData = job->getPartiallyLoadedImageData();
+
+    if (imageData)
+    {
+        emit priorityFramesLoaded(job->getVolume(), imageData);
+    }
+}
+
+void VolumeReaderManager::jobFramesLoaded(VolumeReaderJob *job, const QList<int> &frameIndices)
+{
+    emit framesLoaded(job->getVolume(), frameIndices);
+}
+
 } // namespace udg
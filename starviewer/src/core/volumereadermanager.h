@@ -21,6 +21,8 @@
 
 #include "volumereaderjob.h"
 
+class vtkImageData;
+
 namespace udg {
 
 class Volume;
@@ -34,6 +36,10 @@ public:
     VolumeReaderManager(QObject *parent = 0);
     ~VolumeReaderManager();
 
+    /// Enables or disables progressive reading of the volumes read from now on, starting at the given slice. Disabled by default.
+    /// See VolumeReader::setProgressiveReading().
+    void setProgressiveReading(bool enabled, int firstSlice = 0);
+
     /// Starts the reading of a volume
     void readVolume(Volume *volume);
 
@@ -61,12 +67,21 @@ signals:
     void progress(int progress);
     /// Signal emitted at the end of the reading
     void readingFinished();
+    /// Emitted in progressive reads when the first slices of the given volume are available in the given image data, which will be filled with the rest of
+    /// slices. Receivers must take a reference to the image data to keep it.
+    void priorityFramesLoaded(Volume *volume, vtkImageData *imageData);
+    /// Emitted in progressive reads, after priorityFramesLoaded(), with the slices of the given volume read since the previous emission.
+    void framesLoaded(Volume *volume, const QList<int> &frameIndices);
 
 private slots:
     /// Updates the progress of the job and emits the global progress
     void updateProgress(VolumeReaderJob*, int);
     /// Slot executed when a job finished. It emits the signal readingFinished() if no jobs are reading.
     void jobFinished(ThreadWeaver::JobPointer job);
+    /// Emits priorityFramesLoaded() with the partially loaded image data of the given job, if it's still available.
+    void jobPriorityFramesLoaded(VolumeReaderJob *job);
+    /// Emits framesLoaded() for the volume of the given job.
+    void jobFramesLoaded(VolumeReaderJob *job, const QList<int> &frameIndices);
 
 private:
     /// Initialize internal helpers
@@ -90,6 +105,11 @@ private:
 
     /// It counts the number of finished jobs
     int m_numberOfFinishedJobs;
+
+    /// True if the volumes must be read progressively.
+    bool m_progressiveReading;
+    /// Slice to read first in progressive reads.
+    int m_firstSliceToRead;
 };
 
 } // namespace udg
@@ -16,11 +16,56 @@
 #include "volume.h"
 #include "logging.h"
 #include "volumereaderjobfactory.h"
+#include "volumepixeldata.h"
+#include "coresettings.h"
+#include "settings.h"
+
+#include <QMutexLocker>
+
+#include <algorithm>
+
+#include <vtkImageData.h>
 
 namespace udg {
 
+namespace {
+
+// Returns the memory used by the pixel data of the given volume in bytes, or 0 if it's not loaded
+qint64 getPixelDataMemorySize(Volume *volume)
+{
+    if (!volume->isPixelDataLoaded())
+    {
+        return 0;
+    }
+
+    vtkImageData *imageData = volume->getPixelData()->getVtkData();
+    return imageData ? static_cast<qint64>(imageData->GetActualMemorySize()) * 1024 : 0;
+}
+
+// Orders volumes by last use, the least recently used first
+class LeastRecentlyUsedFirst {
+public:
+    LeastRecentlyUsedFirst(const QHash<Volume*, quint64> &lastUse)
+        : m_lastUse(lastUse)
+    {
+    }
+
+    bool operator()(Volume *volume1, Volume *volume2) const
+    {
+        return m_lastUse.value(volume1) < m_lastUse.value(volume2);
+    }
+
+private:
+    const QHash<Volume*, quint64> &m_lastUse;
+};
+
+}
+
 VolumeRepository::VolumeRepository()
+    : m_useCounter(0), m_numberOfHits(0), m_numberOfMisses(0), m_numberOfReloads(0), m_numberOfEvictions(0)
 {
+    Settings settings;
+    m_memoryBudget = static_cast<qint64>(settings.getValue(CoreSettings::VolumeMemoryBudgetInMegaBytes).toLongLong()) * 1024 * 1024;
 }
 
 Identifier VolumeRepository::addVolume(Volume *model)
@@ -28,6 +73,8 @@ Identifier VolumeRepository::addVolume(Volume *model)
     Identifier id;
 
     id = this->addItem(model);
+    touch(model);
+    connect(model, SIGNAL(pixelDataLoaded()), SLOT(updateCache()), Qt::QueuedConnection);
     emit itemAdded(id);
     INFO_LOG("S'ha afegit al repositori el volum amb id: " + QString::number(id.getValue()));
     return id;
@@ -35,7 +82,14 @@ Identifier VolumeRepository::addVolume(Volume *model)
 
 Volume* VolumeRepository::getVolume(Identifier id)
 {
-    return this->getItem(id);
+    Volume *volume = this->getItem(id);
+
+    if (volume)
+    {
+        touch(volume);
+    }
+
+    return volume;
 }
 
 void VolumeRepository::deleteVolume(Identifier id)
@@ -50,6 +104,16 @@ void VolumeRepository::deleteVolume(Identifier id)
 
     // El treiem de la llista
     this->removeItem(id);
+    disconnect(volume, SIGNAL(pixelDataLoaded()), this, SLOT(updateCache()));
+
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        m_lastUse.remove(volume);
+        m_displayCount.remove(volume);
+        m_residentVolumes.remove(volume);
+        m_evictedVolumes.remove(volume);
+        m_loadedSinceLastRetain.remove(volume);
+    }
 
     // I l'eliminem
     VolumeReaderJobFactory *volumeReader = VolumeReaderJobFactory::instance();
@@ -64,4 +128,149 @@ int VolumeRepository::getNumberOfVolumes()
     return this->getNumberOfItems();
 }
 
+void VolumeRepository::retainVolume(Volume *volume)
+{
+    // Volumes that aren't in the repository, like the dummy and partially loaded volumes of the viewers, aren't tracked
+    if (!volume || this->getItem(volume->getIdentifier()) != volume)
+    {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        m_displayCount[volume]++;
+        m_lastUse[volume] = ++m_useCounter;
+
+        // A volume loaded since its last retain has already been counted as a miss
+        if (!m_loadedSinceLastRetain.remove(volume) && volume->isPixelDataLoaded())
+        {
+            m_numberOfHits++;
+        }
+    }
+}
+
+void VolumeRepository::releaseVolume(Volume *volume)
+{
+    if (!volume)
+    {
+        return;
+    }
+
+    bool noLongerDisplayed = false;
+
+    {
+        QMutexLocker locker(&m_cacheMutex);
+
+        if (!m_displayCount.contains(volume))
+        {
+            return;
+        }
+
+        m_lastUse[volume] = ++m_useCounter;
+
+        if (--m_displayCount[volume] <= 0)
+        {
+            m_displayCount.remove(volume);
+            noLongerDisplayed = true;
+        }
+    }
+
+    if (noLongerDisplayed)
+    {
+        // Queued so that the volume isn't freed while the caller is still switching to another one
+        QMetaObject::invokeMethod(this, "updateCache", Qt::QueuedConnection);
+    }
+}
+
+void VolumeRepository::setMemoryBudget(qint64 bytes)
+{
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        m_memoryBudget = bytes;
+    }
+
+    QMetaObject::invokeMethod(this, "updateCache", Qt::QueuedConnection);
+}
+
+qint64 VolumeRepository::getMemoryBudget() const
+{
+    QMutexLocker locker(&m_cacheMutex);
+    return m_memoryBudget;
+}
+
+void VolumeRepository::updateCache()
+{
+    QMutexLocker locker(&m_cacheMutex);
+
+    qint64 residentBytes = 0;
+    QList<Volume*> evictionCandidates;
+
+    foreach (Volume *volume, this->getItems())
+    {
+        if (!volume->isPixelDataLoaded())
+        {
+            m_residentVolumes.remove(volume);
+            continue;
+        }
+
+        if (!m_residentVolumes.contains(volume))
+        {
+            m_residentVolumes.insert(volume);
+            m_loadedSinceLastRetain.insert(volume);
+            m_numberOfMisses++;
+
+            if (m_evictedVolumes.remove(volume))
+            {
+                m_numberOfReloads++;
+            }
+        }
+
+        residentBytes += getPixelDataMemorySize(volume);
+
+        if (!m_displayCount.contains(volume) && volume->canUnloadPixelData())
+        {
+            evictionCandidates << volume;
+        }
+    }
+
+    if (m_memoryBudget > 0 && residentBytes > m_memoryBudget)
+    {
+        std::sort(evictionCandidates.begin(), evictionCandidates.end(), LeastRecentlyUsedFirst(m_lastUse));
+
+        foreach (Volume *volume, evictionCandidates)
+        {
+            if (residentBytes <= m_memoryBudget)
+            {
+                break;
+            }
+
+            qint64 volumeBytes = getPixelDataMemorySize(volume);
+            volume->unloadPixelData();
+            residentBytes -= volumeBytes;
+            m_residentVolumes.remove(volume);
+            m_loadedSinceLastRetain.remove(volume);
+            m_evictedVolumes.insert(volume);
+            m_numberOfEvictions++;
+            INFO_LOG(QString("Volume cache: freed the pixel data of volume %1 (%2 MB)").arg(volume->getIdentifier().getValue())
+                .arg(volumeBytes / (1024 * 1024)));
+        }
+
+        if (residentBytes > m_memoryBudget)
+        {
+            WARN_LOG(QString("Volume cache: the volumes being displayed need %1 MB, more than the budget of %2 MB")
+                .arg(residentBytes / (1024 * 1024)).arg(m_memoryBudget / (1024 * 1024)));
+        }
+    }
+
+    INFO_LOG(QString("Volume cache: %1 MB resident of %2 MB budget. Hits: %3, misses: %4 (reloads: %5), evictions: %6")
+        .arg(residentBytes / (1024 * 1024)).arg(m_memoryBudget / (1024 * 1024)).arg(m_numberOfHits).arg(m_numberOfMisses).arg(m_numberOfReloads)
+        .arg(m_numberOfEvictions));
+}
+
+void VolumeRepository::touch(Volume *volume)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    m_lastUse[volume] = ++m_useCounter;
+}
+
 }
@@ -20,6 +20,9 @@
 #include "identifier.h"
 
 #include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
 
 namespace udg {
 
@@ -58,6 +61,17 @@ public:
     /// Retorna el nombre de volums que hi ha al repositori
     int getNumberOfVolumes();
 
+    /// Indicates that the given volume is being displayed, so that its pixel data can't be freed to fit in the memory budget.
+    /// Each call must be paired with a call to releaseVolume().
+    void retainVolume(Volume *volume);
+    /// Indicates that the given volume has stopped being displayed by someone who had retained it.
+    void releaseVolume(Volume *volume);
+
+    /// Sets the maximum amount of memory in bytes for the pixel data of the loaded volumes. 0 means no limit.
+    void setMemoryBudget(qint64 bytes);
+    /// Returns the maximum amount of memory in bytes for the pixel data of the loaded volumes. 0 means no limit.
+    qint64 getMemoryBudget() const;
+
     /// Ens retorna l'única instància del repositori.
     static VolumeRepository* getRepository()
     {
@@ -72,9 +86,44 @@ signals:
     void itemAdded(Identifier id);
     void itemRemoved(Identifier id);
 
+private slots:
+    /// Updates the cache statistics and, if the memory budget is exceeded, frees the pixel data of the least recently used volumes that are not being
+    /// displayed until it fits again.
+    void updateCache();
+
 private:
     /// Ha de quedar amagat perquè no poguem crear instàncies
     VolumeRepository();
+
+    /// Marks the given volume as the most recently used.
+    void touch(Volume *volume);
+
+private:
+    /// Maximum amount of memory in bytes for the pixel data of the loaded volumes. 0 means no limit.
+    qint64 m_memoryBudget;
+
+    /// Counter used to order the volumes by last use
+    quint64 m_useCounter;
+    /// Last use of each volume, according to m_useCounter
+    QHash<Volume*, quint64> m_lastUse;
+    /// Number of times that each volume has been retained and not yet released
+    QHash<Volume*, int> m_displayCount;
+
+    /// Volumes whose pixel data was loaded the last time that the cache was updated
+    QSet<Volume*> m_residentVolumes;
+    /// Volumes whose pixel data has been freed to fit in the memory budget
+    QSet<Volume*> m_evictedVolumes;
+    /// Volumes that have been loaded and not retained since then, used to avoid counting their first retain as a hit
+    QSet<Volume*> m_loadedSinceLastRetain;
+
+    /// Cache statistics
+    int m_numberOfHits;
+    int m_numberOfMisses;
+    int m_numberOfReloads;
+    int m_numberOfEvictions;
+
+    /// Protects the cache bookkeeping
+    mutable QMutex m_cacheMutex;
 };
 
 }
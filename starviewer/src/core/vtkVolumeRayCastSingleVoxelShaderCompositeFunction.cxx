@@ -37,6 +37,7 @@
 
 #include <QColor>
 
+#include "emptyspacemap.h"
 #include "hdrcolor.h"
 #include "trilinearinterpolator.h"
 #include "vector3.h"
@@ -71,6 +72,7 @@ vtkVolumeRayCastSingleVoxelShaderCompositeFunction<VS>::vtkVolumeRayCastSingleVo
 {
     m_compositeMethod = ClassifyInterpolate;
     m_voxelShader = 0;
+    m_emptySpaceMap = 0;
     m_interpolator = new TrilinearInterpolator();
 }
 
@@ -156,22 +158,8 @@ void vtkVolumeRayCastSingleVoxelShaderCompositeFunction<VS>::CastRay( vtkVolumeR
 
     if ( INTERPOLATION ) m_interpolator->setIncrements( X_INC, Y_INC, Z_INC );
 
-    // Initialize the ray position and voxel location
+    // Initialize the ray position
     Vector3 rayPosition( RAY_START[0], RAY_START[1], RAY_START[2] );
-    int voxel[3];
-
-    if ( !INTERPOLATION )
-    {
-        voxel[0] = qRound( rayPosition.x );
-        voxel[1] = qRound( rayPosition.y );
-        voxel[2] = qRound( rayPosition.z );
-    }
-    else
-    {
-        voxel[0] = floor( rayPosition.x );
-        voxel[1] = floor( rayPosition.y );
-        voxel[2] = floor( rayPosition.z );
-    }
 
     // So far we haven't accumulated anything
     float accumulatedRedIntensity = 0.0f, accumulatedGreenIntensity = 0.0f, accumulatedBlueIntensity = 0.0f;
@@ -182,6 +170,21 @@ void vtkVolumeRayCastSingleVoxelShaderCompositeFunction<VS>::CastRay( vtkVolumeR
     // For each step along the ray
     for ( int step = 0; step < N_STEPS && remainingOpacity > MINIMUM_REMAINING_OPACITY; step++ )
     {
+        // Skip the samples inside an empty block, which would be transparent. The position is advanced step by step so that the next samples are the
+        // same as without skipping.
+        if ( m_emptySpaceMap )
+        {
+            int emptySamples = qMin( m_emptySpaceMap->getNumberOfEmptySamples( rayPosition, RAY_INCREMENT ), N_STEPS - step );
+
+            if ( emptySamples > 0 )
+            {
+                for ( int i = 0; i < emptySamples; i++ ) rayPosition += RAY_INCREMENT;
+                stepsThisRay += emptySamples;
+                step += emptySamples - 1;
+                continue;
+            }
+        }
+
         // We've taken another step
         stepsThisRay++;
 
@@ -189,7 +192,7 @@ void vtkVolumeRayCastSingleVoxelShaderCompositeFunction<VS>::CastRay( vtkVolumeR
 
         if ( !INTERPOLATION )
         {
-            int offset = voxel[0] * X_INC + voxel[1] * Y_INC + voxel[2] * Z_INC;
+            int offset = qRound( rayPosition.x ) * X_INC + qRound( rayPosition.y ) * Y_INC + qRound( rayPosition.z ) * Z_INC;
             color = m_voxelShader->nvShade( rayPosition, offset, direction, remainingOpacity, color );
         }
         else if ( CLASSIFY_INTERPOLATE )
@@ -223,21 +226,8 @@ void vtkVolumeRayCastSingleVoxelShaderCompositeFunction<VS>::CastRay( vtkVolumeR
         accumulatedBlueIntensity += f * color.blue;
         remainingOpacity *= ( 1.0f - opacity );
 
-        // Increment our position and compute our voxel location
+        // Increment our position
         rayPosition += RAY_INCREMENT;
-
-        if ( !INTERPOLATION )
-        {
-            voxel[0] = qRound( rayPosition.x );
-            voxel[1] = qRound( rayPosition.y );
-            voxel[2] = qRound( rayPosition.z );
-        }
-        else
-        {
-            voxel[0] = floor( rayPosition.x );
-            voxel[1] = floor( rayPosition.y );
-            voxel[2] = floor( rayPosition.z );
-        }
     }
 
     // Cap the intensity value at 1.0
@@ -269,6 +259,13 @@ void vtkVolumeRayCastSingleVoxelShaderCompositeFunction<VS>::SetVoxelShader( VS
 }
 
 
+template <class VS>
+void vtkVolumeRayCastSingleVoxelShaderCompositeFunction<VS>::SetEmptySpaceMap( const EmptySpaceMap *emptySpaceMap )
+{
+    m_emptySpaceMap = emptySpaceMap;
+}
+
+
 }
 
 
@@ -30,6 +30,7 @@
 
 namespace udg {
 
+class EmptySpaceMap;
 class TrilinearInterpolator;
 
 /**
@@ -60,6 +61,10 @@ public:
 
     void SetVoxelShader(VS *voxelShader);
 
+    /// Sets the map used to skip the empty space, or null to sample the whole ray. The voxel shader must give transparent colors wherever the transfer
+    /// function of the map has zero opacity.
+    void SetEmptySpaceMap(const EmptySpaceMap *emptySpaceMap);
+
 protected:
     vtkVolumeRayCastSingleVoxelShaderCompositeFunction();
     ~vtkVolumeRayCastSingleVoxelShaderCompositeFunction();
@@ -70,6 +75,7 @@ protected:
 
     CompositeMethod m_compositeMethod;
     VS *m_voxelShader;
+    const EmptySpaceMap *m_emptySpaceMap;
     TrilinearInterpolator *m_interpolator;
 
 private:
@@ -33,6 +33,7 @@
 
 #include <QColor>
 
+#include "emptyspacemap.h"
 #include "trilinearinterpolator.h"
 #include "vector3.h"
 #include "voxelshader.h"
@@ -48,6 +49,7 @@ const float vtkVolumeRayCastVoxelShaderCompositeFunction::MINIMUM_REMAINING_OPAC
 vtkVolumeRayCastVoxelShaderCompositeFunction::vtkVolumeRayCastVoxelShaderCompositeFunction()
 {
     m_compositeMethod = ClassifyInterpolate;
+    m_emptySpaceMap = 0;
     m_interpolator = new TrilinearInterpolator();
 }
 
@@ -135,22 +137,8 @@ void vtkVolumeRayCastVoxelShaderCompositeFunction::CastRay( vtkVolumeRayCastDyna
 
     if ( INTERPOLATION ) m_interpolator->setIncrements( X_INC, Y_INC, Z_INC );
 
-    // Initialize the ray position and voxel location
+    // Initialize the ray position
     Vector3 rayPosition( RAY_START[0], RAY_START[1], RAY_START[2] );
-    int voxel[3];
-
-    if ( !INTERPOLATION )
-    {
-        voxel[0] = qRound( rayPosition.x );
-        voxel[1] = qRound( rayPosition.y );
-        voxel[2] = qRound( rayPosition.z );
-    }
-    else
-    {
-        voxel[0] = floor( rayPosition.x );
-        voxel[1] = floor( rayPosition.y );
-        voxel[2] = floor( rayPosition.z );
-    }
 
     // So far we haven't accumulated anything
     float accumulatedRedIntensity = 0.0f, accumulatedGreenIntensity = 0.0f, accumulatedBlueIntensity = 0.0f;
@@ -161,6 +149,21 @@ void vtkVolumeRayCastVoxelShaderCompositeFunction::CastRay( vtkVolumeRayCastDyna
     // For each step along the ray
     for ( int step = 0; step < N_STEPS && remainingOpacity > MINIMUM_REMAINING_OPACITY; step++ )
     {
+        // Skip the samples inside an empty block, which would be transparent. The position is advanced step by step so that the next samples are the
+        // same as without skipping.
+        if ( m_emptySpaceMap )
+        {
+            int emptySamples = qMin( m_emptySpaceMap->getNumberOfEmptySamples( rayPosition, RAY_INCREMENT ), N_STEPS - step );
+
+            if ( emptySamples > 0 )
+            {
+                for ( int i = 0; i < emptySamples; i++ ) rayPosition += RAY_INCREMENT;
+                stepsThisRay += emptySamples;
+                step += emptySamples - 1;
+                continue;
+            }
+        }
+
         // We've taken another step
         stepsThisRay++;
 
@@ -168,7 +171,7 @@ void vtkVolumeRayCastVoxelShaderCompositeFunction::CastRay( vtkVolumeRayCastDyna
 
         if ( !INTERPOLATION )
         {
-            int offset = voxel[0] * X_INC + voxel[1] * Y_INC + voxel[2] * Z_INC;
+            int offset = qRound( rayPosition.x ) * X_INC + qRound( rayPosition.y ) * Y_INC + qRound( rayPosition.z ) * Z_INC;
             for ( int i = 0; i < nShaders; i++ ) color = m_voxelShaderList.at( i )->shade( rayPosition, offset, direction, remainingOpacity, color );
         }
         else if ( CLASSIFY_INTERPOLATE )
@@ -206,21 +209,8 @@ void vtkVolumeRayCastVoxelShaderCompositeFunction::CastRay( vtkVolumeRayCastDyna
         accumulatedBlueIntensity += f * color.blue;
         remainingOpacity *= ( 1.0f - opacity );
 
-        // Increment our position and compute our voxel location
+        // Increment our position
         rayPosition += RAY_INCREMENT;
-
-        if ( !INTERPOLATION )
-        {
-            voxel[0] = qRound( rayPosition.x );
-            voxel[1] = qRound( rayPosition.y );
-            voxel[2] = qRound( rayPosition.z );
-        }
-        else
-        {
-            voxel[0] = floor( rayPosition.x );
-            voxel[1] = floor( rayPosition.y );
-            voxel[2] = floor( rayPosition.z );
-        }
     }
 
     // Cap the intensity value at 1.0
@@ -283,4 +273,10 @@ void vtkVolumeRayCastVoxelShaderCompositeFunction::RemoveAllVoxelShaders()
 }
 
 
+void vtkVolumeRayCastVoxelShaderCompositeFunction::SetEmptySpaceMap( const EmptySpaceMap *emptySpaceMap )
+{
+    m_emptySpaceMap = emptySpaceMap;
+}
+
+
 }
@@ -32,6 +32,7 @@
 
 namespace udg {
 
+class EmptySpaceMap;
 class TrilinearInterpolator;
 class VoxelShader;
 
@@ -66,6 +67,10 @@ public:
     void RemoveVoxelShader(VoxelShader *voxelShader);
     void RemoveAllVoxelShaders();
 
+    /// Sets the map used to skip the empty space, or null to sample the whole ray. The voxel shaders must give transparent colors wherever the transfer
+    /// function of the map has zero opacity.
+    void SetEmptySpaceMap(const EmptySpaceMap *emptySpaceMap);
+
 protected:
     vtkVolumeRayCastVoxelShaderCompositeFunction();
     ~vtkVolumeRayCastVoxelShaderCompositeFunction();
@@ -76,6 +81,7 @@ protected:
 
     CompositeMethod m_compositeMethod;
     QList<VoxelShader*> m_voxelShaderList;
+    const EmptySpaceMap *m_emptySpaceMap;
     TrilinearInterpolator *m_interpolator;
 
 private:
@@ -23,11 +23,17 @@
 #include "photometricinterpretation.h"
 #include "imageorientation.h"
 
-#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QMutexLocker>
+#include <QWriteLocker>
 #include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+
+#include <exception>
 
 #include <vtkDataArray.h>
-#include <vtkImageCast.h>
 #include <vtkImageData.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
@@ -227,6 +233,35 @@ size_t voxelSize(int scalarType, int numberOfComponents)
     return componentSize * numberOfComponents;
 }
 
+// Copies the given number of values from the source buffer to the destination buffer converting them to the destination type. Conversion is a plain
+// static_cast, like vtkImageCast without clamping, because the caller only converts when all values fit in the destination type. The loop is kept free of
+// branches and calls so that the compiler can vectorize it.
+template <typename SourceType, typename DestinationType>
+void convertScalars(const SourceType *source, DestinationType *destination, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        destination[i] = static_cast<DestinationType>(source[i]);
+    }
+}
+
+// Copies the given number of values from the source buffer to the destination buffer, that has the given VTK scalar type, converting them to that type.
+template <typename SourceType>
+void convertScalars(const SourceType *source, void *destination, int destinationScalarType, size_t count)
+{
+    switch (destinationScalarType)
+    {
+        case VTK_UNSIGNED_CHAR: convertScalars(source, static_cast<unsigned char*>(destination), count); break;
+        case VTK_SIGNED_CHAR: convertScalars(source, static_cast<signed char*>(destination), count); break;
+        case VTK_UNSIGNED_SHORT: convertScalars(source, static_cast<unsigned short*>(destination), count); break;
+        case VTK_SHORT: convertScalars(source, static_cast<short*>(destination), count); break;
+        case VTK_UNSIGNED_INT: convertScalars(source, static_cast<unsigned int*>(destination), count); break;
+        case VTK_INT: convertScalars(source, static_cast<int*>(destination), count); break;
+        case VTK_FLOAT: convertScalars(source, static_cast<float*>(destination), count); break;
+        default: throw std::invalid_argument("Unexpected destination scalar type");  // Should not happen
+    }
+}
+
 // Returns a DcmDataset initialized from the given filename.
 QSharedPointer<DcmDataset> getDataset(const char *filename)
 {
@@ -242,6 +277,41 @@ QSharedPointer<DcmDataset> getDataset(const char *filename)
     return QSharedPointer<DcmDataset>(dicomFile.getAndRemoveDataset());
 }
 
+// Time in milliseconds between progress updates while the calling thread waits for the decoding threads to finish.
+const int ParallelLoadProgressInterval = 50;
+// Time in milliseconds between checks for the priority frames in progressive reads, shorter than the above to show the first image as soon as possible.
+const int PriorityFramesCheckInterval = 5;
+
+// State shared between the threads that decode frames in parallel.
+struct ParallelLoadState
+{
+    ParallelLoadState() :
+        nextFrameIndex(0), numberOfLoadedFrames(0), numberOfLoadedPriorityFrames(0), stop(0), mustChangeScalarType(false), newScalarType(VTK_VOID)
+    {
+    }
+
+    // Position in the decoding order of the next frame to decode.
+    QAtomicInt nextFrameIndex;
+    // Number of frames already decoded.
+    QAtomicInt numberOfLoadedFrames;
+    // Number of priority frames already decoded in progressive reads.
+    QAtomicInt numberOfLoadedPriorityFrames;
+    // Protects the list below.
+    QMutex newlyLoadedFramesMutex;
+    // Frames decoded since the last FramesLoadedEvent in progressive reads, as indices in the whole extent.
+    QList<int> newlyLoadedFrames;
+    // Becomes different than 0 when a thread has found an error and the other threads must stop.
+    QAtomicInt stop;
+    // Protects the error information below.
+    QMutex errorMutex;
+    // True if a thread has requested a scalar type change.
+    bool mustChangeScalarType;
+    // The scalar type requested by the first thread that requested a change.
+    int newScalarType;
+    // Any other exception thrown by a thread.
+    std::exception_ptr exception;
+};
+
 const char* booleanToString(bool b)
 {
     return b ? "yes" : "no";
@@ -261,6 +331,7 @@ void VtkDcmtkImageReader::PrintSelf(std::ostream &os, vtkIndent indent)
     os << indent << "Frame size: " << m_frameSize << " bytes\n";
     os << indent << "Maximum voxel value: " << m_maximumVoxelValue << "\n";
     os << indent << "Needs float scalar type: " << booleanToString(m_needsFloatScalarType) << "\n";
+    os << indent << "Number of threads: " << getNumberOfThreads() << "\n";
 }
 
 void VtkDcmtkImageReader::setFrameNumbers(const QList<int> &frameNumbers)
@@ -268,7 +339,44 @@ void VtkDcmtkImageReader::setFrameNumbers(const QList<int> &frameNumbers)
     m_frameNumbers = frameNumbers;
 }
 
-VtkDcmtkImageReader::VtkDcmtkImageReader()
+void VtkDcmtkImageReader::setNumberOfThreads(int numberOfThreads)
+{
+    m_numberOfThreads = numberOfThreads;
+}
+
+int VtkDcmtkImageReader::getNumberOfThreads() const
+{
+    return m_numberOfThreads > 0 ? m_numberOfThreads : qMax(QThread::idealThreadCount(), 1);
+}
+
+void VtkDcmtkImageReader::setPriorityFrames(const QList<int> &frameIndices)
+{
+    m_priorityFrames = frameIndices;
+}
+
+void VtkDcmtkImageReader::convertScalars(const void *source, int sourceScalarType, void *destination, int destinationScalarType, size_t count)
+{
+    switch (sourceScalarType)
+    {
+        case VTK_UNSIGNED_CHAR: udg::convertScalars(static_cast<const unsigned char*>(source), destination, destinationScalarType, count); break;
+        case VTK_SIGNED_CHAR: udg::convertScalars(static_cast<const signed char*>(source), destination, destinationScalarType, count); break;
+        case VTK_UNSIGNED_SHORT: udg::convertScalars(static_cast<const unsigned short*>(source), destination, destinationScalarType, count); break;
+        case VTK_SHORT: udg::convertScalars(static_cast<const short*>(source), destination, destinationScalarType, count); break;
+        case VTK_UNSIGNED_INT: udg::convertScalars(static_cast<const unsigned int*>(source), destination, destinationScalarType, count); break;
+        case VTK_INT: udg::convertScalars(static_cast<const int*>(source), destination, destinationScalarType, count); break;
+        case VTK_FLOAT: udg::convertScalars(static_cast<const float*>(source), destination, destinationScalarType, count); break;
+        default: throw std::invalid_argument("Unexpected source scalar type");  // Should not happen
+    }
+}
+
+QReadWriteLock* VtkDcmtkImageReader::getProgressiveReadLock()
+{
+    static QReadWriteLock lock;
+    return &lock;
+}
+
+VtkDcmtkImageReader::VtkDcmtkImageReader() :
+    m_isReadingProgressively(false), m_numberOfThreads(0)
 {
     this->SetNumberOfInputPorts(0);
     this->SetNumberOfOutputPorts(1);
@@ -665,7 +773,29 @@ bool VtkDcmtkImageReader::loadData(int updateExtent[6])
 
     void *scalarPointer = output->GetScalarPointerForExtent(updateExtent);
 
-    if (this->FileName)
+    if (!this->FileName && !(this->FileNames && this->FileNames->GetNumberOfValues() > 0))
+    {
+        ERROR_LOG("No filename given");
+        return false;
+    }
+
+    int numberOfFrames = updateExtent[5] - updateExtent[4] + 1;
+    bool isProgressive = !m_priorityFrames.isEmpty() && numberOfFrames > 1;
+    // The output can be shown while it's being filled, so the frames are copied to it holding the progressive read lock
+    m_isReadingProgressively = isProgressive;
+
+    if (isProgressive)
+    {
+        // The output is shown while it's being filled, so the frames not decoded yet must not contain garbage
+        memset(scalarPointer, 0, numberOfFrames * m_frameSize);
+    }
+
+    // Progressive reads always use the decoding threads so that the calling thread can invoke the events as the frames arrive
+    if ((getNumberOfThreads() > 1 || isProgressive) && numberOfFrames > 1 && (!this->FileName || m_isMultiframe))
+    {
+        this->loadFramesInParallel(scalarPointer, updateExtent);
+    }
+    else if (this->FileName)
     {
         if (!m_isMultiframe)
         {
@@ -676,9 +806,9 @@ bool VtkDcmtkImageReader::loadData(int updateExtent[6])
             this->loadMultiframeFile(this->FileName, scalarPointer, updateExtent);
         }
     }
-    else if (this->FileNames && this->FileNames->GetNumberOfValues() > 0)
+    else
     {
-        double total = updateExtent[5] - updateExtent[4] + 1;
+        double total = numberOfFrames;
         this->UpdateProgress(0.0);
 
         for (int i = updateExtent[4]; i <= updateExtent[5] && !this->AbortExecute; i++)
@@ -688,11 +818,6 @@ bool VtkDcmtkImageReader::loadData(int updateExtent[6])
             this->UpdateProgress((i - updateExtent[4] + 1) / total);
         }
     }
-    else
-    {
-        ERROR_LOG("No filename given");
-        return false;
-    }
 
     return !this->AbortExecute;
 }
@@ -708,7 +833,6 @@ void VtkDcmtkImageReader::loadSingleFrameFile(const char *filename, void *buffer
 void VtkDcmtkImageReader::loadMultiframeFile(const char *filename, void *buffer, int updateExtent[6])
 {
     QSharedPointer<DcmDataset> dataset = getDataset(filename);
-    unsigned long flags = CIF_UsePartialAccessToPixelData | (m_needsFloatScalarType ? CIF_UseFloatingInternalRepresentation : 0);
     double total = updateExtent[5] - updateExtent[4] + 1;
     this->UpdateProgress(0.0);
 
@@ -720,22 +844,226 @@ void VtkDcmtkImageReader::loadMultiframeFile(const char *filename, void *buffer,
 
     for (int frameIndex = updateExtent[4]; frameIndex <= updateExtent[5] && !this->AbortExecute; frameIndex++)
     {
-        int frameNumberInFile = m_frameNumbers.isEmpty() ? frameIndex : m_frameNumbers[frameIndex];
+        loadMultiframeFrame(dataset.data(), frameIndex, buffer);
+        buffer = static_cast<char*>(buffer) + m_frameSize;
+        this->UpdateProgress((frameIndex - updateExtent[4] + 1) / total);
+    }
+}
+
+void VtkDcmtkImageReader::loadMultiframeFrame(DcmDataset *dataset, int frameIndex, void *buffer)
+{
+    unsigned long flags = CIF_UsePartialAccessToPixelData | (m_needsFloatScalarType ? CIF_UseFloatingInternalRepresentation : 0);
+    int frameNumberInFile = m_frameNumbers.isEmpty() ? frameIndex : m_frameNumbers[frameIndex];
+
+    if (m_hasPerFrameRescale)
+    {
+        const Rescale &rescale = m_perFrameRescale.at(frameNumberInFile);
+        DicomImage image(dataset, dataset->getOriginalXfer(), rescale.slope, rescale.intercept, flags, frameNumberInFile, 1);
+        copyDcmtkImageToBuffer(buffer, image);
+    }
+    else
+    {
+        DicomImage image(dataset, dataset->getOriginalXfer(), flags, frameNumberInFile, 1);
+        copyDcmtkImageToBuffer(buffer, image);
+    }
+}
+
+void VtkDcmtkImageReader::loadFramesInParallel(void *buffer, int updateExtent[6])
+{
+    const int firstFrame = updateExtent[4];
+    const int numberOfFrames = updateExtent[5] - updateExtent[4] + 1;
+    const double total = numberOfFrames;
+    this->UpdateProgress(0.0);
+
+    if (m_isMultiframe && m_frameNumbers.isEmpty())
+    {
+        // The frames are still decoded in parallel, but each slice takes the frame with its same index in the file
+        DEBUG_LOG("Reading multiframe file without frame numbers specified. Frames will be taken in file order.");
+        WARN_LOG("Reading multiframe file without frame numbers specified. Frames will be taken in file order.");
+    }
+
+    ParallelLoadState state;
+    int numberOfPriorityFrames;
+    const QVector<int> frameOrder = getFrameDecodingOrder(firstFrame, numberOfFrames, numberOfPriorityFrames);
+    const bool isProgressive = numberOfPriorityFrames > 0;
+
+    // Each thread takes the next pending frame until there are no more frames, an error is found or the read is aborted.
+    // Dynamic assignment of frames keeps all the threads busy even when some frames take longer to decode than others.
+    auto decodeFrames = [this, &state, &frameOrder, buffer, firstFrame, numberOfFrames, numberOfPriorityFrames, isProgressive]()
+    {
+        QSharedPointer<DcmDataset> multiframeDataset;
+
+        try
+        {
+            int position;
+
+            while (!this->AbortExecute && state.stop.load() == 0 && (position = state.nextFrameIndex.fetchAndAddOrdered(1)) < numberOfFrames)
+            {
+                int frame = frameOrder.at(position);
+                loadFrame(firstFrame + frame, static_cast<char*>(buffer) + frame * m_frameSize, multiframeDataset);
+                state.numberOfLoadedFrames.fetchAndAddOrdered(1);
+
+                if (isProgressive)
+                {
+                    if (position < numberOfPriorityFrames)
+                    {
+                        state.numberOfLoadedPriorityFrames.fetchAndAddOrdered(1);
+                    }
+
+                    QMutexLocker locker(&state.newlyLoadedFramesMutex);
+                    state.newlyLoadedFrames << firstFrame + frame;
+                }
+            }
+        }
+        catch (const ChangeScalarTypeException &exception)
+        {
+            QMutexLocker locker(&state.errorMutex);
+
+            // The first requested scalar type is kept. If it's not enough, another change will be requested when reading again.
+            if (!state.mustChangeScalarType)
+            {
+                state.mustChangeScalarType = true;
+                state.newScalarType = exception.getNewScalarType();
+            }
+
+            state.stop.store(1);
+        }
+        catch (...)
+        {
+            QMutexLocker locker(&state.errorMutex);
+
+            if (!state.exception)
+            {
+                state.exception = std::current_exception();
+            }
+
+            state.stop.store(1);
+        }
+    };
+
+    // A private pool is used so that the decoding threads can't be delayed by (or delay) unrelated tasks running in the global pool
+    QThreadPool threadPool;
+    int numberOfThreads = qMin(getNumberOfThreads(), numberOfFrames);
+    threadPool.setMaxThreadCount(numberOfThreads);
+
+    for (int i = 0; i < numberOfThreads; i++)
+    {
+        QtConcurrent::run(&threadPool, decodeFrames);
+    }
+
+    bool priorityFramesLoadedEventInvoked = false;
 
-        if (m_hasPerFrameRescale)
+    // Invokes the progressive read events that correspond to the frames decoded until now
+    auto invokeProgressiveReadEvents = [this, &state, &priorityFramesLoadedEventInvoked, numberOfPriorityFrames, isProgressive]()
+    {
+        if (!isProgressive || state.stop.load() != 0)
         {
-            const Rescale &rescale = m_perFrameRescale.at(frameNumberInFile);
-            DicomImage image(dataset.data(), dataset->getOriginalXfer(), rescale.slope, rescale.intercept, flags, frameNumberInFile, 1);
-            copyDcmtkImageToBuffer(buffer, image);
+            return;
         }
-        else
+
+        if (!priorityFramesLoadedEventInvoked && state.numberOfLoadedPriorityFrames.load() == numberOfPriorityFrames)
         {
-            DicomImage image(dataset.data(), dataset->getOriginalXfer(), flags, frameNumberInFile, 1);
-            copyDcmtkImageToBuffer(buffer, image);
+            priorityFramesLoadedEventInvoked = true;
+            this->InvokeEvent(PriorityFramesLoadedEvent, this->GetOutput(0));
         }
 
-        buffer = static_cast<char*>(buffer) + m_frameSize;
-        this->UpdateProgress((frameIndex - updateExtent[4] + 1) / total);
+        // Frames decoded before PriorityFramesLoadedEvent, including the priority ones, are reported in the first FramesLoadedEvent after it
+        if (priorityFramesLoadedEventInvoked)
+        {
+            QList<int> newlyLoadedFrames;
+
+            {
+                QMutexLocker locker(&state.newlyLoadedFramesMutex);
+                newlyLoadedFrames.swap(state.newlyLoadedFrames);
+            }
+
+            if (!newlyLoadedFrames.isEmpty())
+            {
+                this->InvokeEvent(FramesLoadedEvent, &newlyLoadedFrames);
+            }
+        }
+    };
+
+    // VTK events must be invoked from the calling thread
+    while (!threadPool.waitForDone(isProgressive && !priorityFramesLoadedEventInvoked ? PriorityFramesCheckInterval : ParallelLoadProgressInterval))
+    {
+        this->UpdateProgress(state.numberOfLoadedFrames.load() / total);
+        invokeProgressiveReadEvents();
+    }
+
+    if (state.exception)
+    {
+        std::rethrow_exception(state.exception);
+    }
+
+    if (state.mustChangeScalarType)
+    {
+        throw ChangeScalarTypeException(state.newScalarType);
+    }
+
+    this->UpdateProgress(state.numberOfLoadedFrames.load() / total);
+    invokeProgressiveReadEvents();
+}
+
+QVector<int> VtkDcmtkImageReader::getFrameDecodingOrder(int firstFrame, int numberOfFrames, int &numberOfPriorityFrames) const
+{
+    QVector<int> frameOrder;
+    frameOrder.reserve(numberOfFrames);
+    QVector<bool> isInOrder(numberOfFrames, false);
+
+    foreach (int frameIndex, m_priorityFrames)
+    {
+        int frame = frameIndex - firstFrame;
+
+        if (frame >= 0 && frame < numberOfFrames && !isInOrder[frame])
+        {
+            frameOrder << frame;
+            isInOrder[frame] = true;
+        }
+    }
+
+    numberOfPriorityFrames = frameOrder.size();
+
+    // The rest of frames go in order of proximity to the first priority frame, so that the ones next to the first displayed frame arrive earlier.
+    // Without priority frames this is the natural order.
+    int center = frameOrder.isEmpty() ? 0 : frameOrder.first();
+
+    for (int distance = 0; frameOrder.size() < numberOfFrames; distance++)
+    {
+        int after = center + distance;
+        int before = center - distance;
+
+        if (after < numberOfFrames && !isInOrder[after])
+        {
+            frameOrder << after;
+            isInOrder[after] = true;
+        }
+
+        if (before >= 0 && !isInOrder[before])
+        {
+            frameOrder << before;
+            isInOrder[before] = true;
+        }
+    }
+
+    return frameOrder;
+}
+
+void VtkDcmtkImageReader::loadFrame(int frameIndex, void *frameBuffer, QSharedPointer<DcmDataset> &multiframeDataset)
+{
+    if (m_isMultiframe)
+    {
+        // Each thread needs its own dataset because partial access to pixel data is not thread-safe
+        if (!multiframeDataset)
+        {
+            multiframeDataset = getDataset(this->FileName);
+        }
+
+        loadMultiframeFrame(multiframeDataset.data(), frameIndex, frameBuffer);
+    }
+    else
+    {
+        loadSingleFrameFile(this->FileNames->GetValue(frameIndex), frameBuffer);
     }
 }
 
@@ -754,9 +1082,17 @@ void VtkDcmtkImageReader::copyDcmtkImageToBuffer(void *buffer, DicomImage &dicom
         double minimum, maximum;
         dicomImage.getMinMaxValues(minimum, maximum);
 
-        if (maximum > m_maximumVoxelValue)
+        double maximumVoxelValue;
+
         {
-            m_maximumVoxelValue = maximum;
+            QMutexLocker locker(&m_maximumVoxelValueMutex);
+
+            if (maximum > m_maximumVoxelValue)
+            {
+                m_maximumVoxelValue = maximum;
+            }
+
+            maximumVoxelValue = m_maximumVoxelValue;
         }
 
         int dcmtkInternalDataScalarType = dcmtkRepresentationToVtkScalarType(dcmtkInternalData->getRepresentation());
@@ -764,43 +1100,30 @@ void VtkDcmtkImageReader::copyDcmtkImageToBuffer(void *buffer, DicomImage &dicom
         if (dcmtkInternalDataScalarType == this->DataScalarType)
         {
             // Internal data scalar type is the same as the image data scalar type, only need to copy
+            QWriteLocker locker(m_isReadingProgressively ? getProgressiveReadLock() : 0);
             memcpy(buffer, dcmtkInternalData->getData(), m_frameSize);
         }
         else if (canConvertScalarType(dcmtkInternalDataScalarType, this->DataScalarType, maximum))
         {
+            QWriteLocker locker(m_isReadingProgressively ? getProgressiveReadLock() : 0);
+
             // Internal data scalar type is different from the image data scalar type but can be converted to it
-            // Need to create temporal image data, cast it to the current image data scalar type and copy
-            vtkImageData *temporalImageData = vtkImageData::New();
-            int frameExtent[6];
-            this->GetDataExtent(frameExtent);
-            frameExtent[4] = frameExtent[5] = 0;
-            temporalImageData->SetExtent(frameExtent);
-            temporalImageData->AllocateScalars(dcmtkInternalDataScalarType, 1);
-            void *temporalImageDataBuffer = temporalImageData->GetScalarPointer();
-
-            size_t readSize = dcmtkInternalData->getCount() * voxelSize(dcmtkInternalDataScalarType, 1);
-            memcpy(temporalImageDataBuffer, dcmtkInternalData->getData(), readSize);
-
-            vtkImageCast *imageCast = vtkImageCast::New();
-            imageCast->SetInputData(temporalImageData);
-            imageCast->SetOutputScalarType(this->DataScalarType);
-            imageCast->Update();
-            memcpy(buffer, imageCast->GetOutput()->GetScalarPointer(), m_frameSize);
-
-            imageCast->Delete();
-            temporalImageData->Delete();
+            // Convert directly into the buffer in a single pass
+            size_t count = qMin(static_cast<size_t>(dcmtkInternalData->getCount()), m_frameSize / voxelSize(this->DataScalarType, 1));
+            convertScalars(dcmtkInternalData->getData(), dcmtkInternalDataScalarType, buffer, this->DataScalarType, count);
         }
         else
         {
             // Internal data scalar type is different from the image data scalar type and can't be converted to it
             // Need to find a new scalar type suitable for both and restart read
-            int newScalarType = decideNewScalarType(this->DataScalarType, dcmtkInternalDataScalarType, m_maximumVoxelValue);
+            int newScalarType = decideNewScalarType(this->DataScalarType, dcmtkInternalDataScalarType, maximumVoxelValue);
             throw ChangeScalarTypeException(newScalarType);
         }
     }
     else
     {
         // Color image, use 8-bit RGB
+        QWriteLocker locker(m_isReadingProgressively ? getProgressiveReadLock() : 0);
         dicomImage.getOutputData(buffer, m_frameSize, 8);
     }
 }
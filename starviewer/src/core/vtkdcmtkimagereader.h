@@ -17,10 +17,16 @@
 
 #include <stdexcept>
 
+#include <vtkCommand.h>
 #include <vtkImageReader2.h>
 
 #include <QList>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QSharedPointer>
+#include <QVector>
 
+class DcmDataset;
 class DicomImage;
 
 namespace udg {
@@ -36,6 +42,9 @@ public:
 
     class CantReadImageException;
 
+    /// Events invoked during progressive reads (see setPriorityFrames()).
+    enum ProgressiveReadEvent { PriorityFramesLoadedEvent = vtkCommand::UserEvent + 1, FramesLoadedEvent };
+
 public:
 
     vtkTypeMacro(VtkDcmtkImageReader, vtkImageReader2);
@@ -50,6 +59,28 @@ public:
     /// Sets the list of frame numbers in the order they must be read from a multiframe file. No need to specify for single-frame files.
     void setFrameNumbers(const QList<int> &frameNumbers);
 
+    /// Sets the number of threads used to decode the frames. With 1 frames are decoded sequentially in the calling thread. A value lower than 1 means that
+    /// the ideal number of threads for the current machine will be used.
+    void setNumberOfThreads(int numberOfThreads);
+    /// Returns the number of threads that will be used to decode the frames.
+    int getNumberOfThreads() const;
+
+    /// Sets the frames, as indices in the whole extent, that must be decoded before the others. If any is set the read is progressive: the output is
+    /// filled with zeros, PriorityFramesLoadedEvent is invoked with the output as call data as soon as the priority frames are decoded, and then the rest of
+    /// frames are decoded in order of proximity to the first priority frame, invoking FramesLoadedEvent with a pointer to a QList<int> with the indices of
+    /// the newly decoded frames as call data. Events are invoked from the thread that updates the reader. If the scalar type has to change during the read
+    /// the output is reallocated and PriorityFramesLoadedEvent is invoked again.
+    void setPriorityFrames(const QList<int> &frameIndices);
+
+    /// Returns the lock that protects the outputs of progressive reads, which are shown while the decoding threads are still writing frames into them.
+    /// The decoding threads hold it for writing while they copy each frame to the output, so a progressive output may only be read, e.g. rendered, while
+    /// holding it for reading. It's shared by all the readers, so it must be held only for short periods.
+    static QReadWriteLock* getProgressiveReadLock();
+
+    /// Copies the given number of values from the source buffer, that has the given VTK scalar type, to the destination buffer, that has the given VTK scalar
+    /// type, converting them to the destination type. Used to copy DCMTK internal data to the output when its representation is different.
+    static void convertScalars(const void *source, int sourceScalarType, void *destination, int destinationScalarType, size_t count);
+
 protected:
 
     VtkDcmtkImageReader();
@@ -92,6 +123,17 @@ private:
     void loadSingleFrameFile(const char *filename, void *buffer);
     /// Loads image data from a multiframe file, for the given update extent, into the given buffer.
     void loadMultiframeFile(const char *filename, void *buffer, int updateExtent[6]);
+    /// Loads the frame with the given index (relative to the whole extent) from the given multiframe dataset into the given buffer.
+    void loadMultiframeFrame(DcmDataset *dataset, int frameIndex, void *buffer);
+    /// Loads image data for the given update extent into the given buffer decoding several frames at the same time. Each frame is decoded directly into its
+    /// own region of the buffer. Progress is reported, progressive read events are invoked and abort requests are attended from the calling thread.
+    void loadFramesInParallel(void *buffer, int updateExtent[6]);
+    /// Returns the order in which the frames of the given range must be decoded, as indices relative to the first frame, and the number of priority frames
+    /// at the beginning of the order.
+    QVector<int> getFrameDecodingOrder(int firstFrame, int numberOfFrames, int &numberOfPriorityFrames) const;
+    /// Loads the frame with the given index (relative to the whole extent) into the given frame buffer, from the corresponding single frame file or from the
+    /// multiframe file. The given dataset is loaded on first use for multiframe files and must be kept by the caller between calls from the same thread.
+    void loadFrame(int frameIndex, void *frameBuffer, QSharedPointer<DcmDataset> &multiframeDataset);
     /// Copies the image data stored in the given dicom image into the given buffer.
     void copyDcmtkImageToBuffer(void *buffer, DicomImage &dicomImage);
 
@@ -106,6 +148,10 @@ private:
 
     /// List of frame numbers in the order they must be read from a multiframe file. Not used for single-frame files.
     QList<int> m_frameNumbers;
+    /// Frames, as indices in the whole extent, that must be decoded before the others in progressive reads.
+    QList<int> m_priorityFrames;
+    /// True while the output is filled in a progressive read.
+    bool m_isReadingProgressively;
 
     /// True if reading a multiframe volume.
     bool m_isMultiframe;
@@ -121,6 +167,10 @@ private:
     double m_maximumVoxelValue;
     /// If it's true, a float scalar type will be used.
     bool m_needsFloatScalarType;
+    /// Protects the maximum voxel value when frames are decoded in parallel.
+    QMutex m_maximumVoxelValueMutex;
+    /// Number of threads used to decode the frames.
+    int m_numberOfThreads;
 
 };
 
@@ -16,10 +16,12 @@
 
 #include "logging.h"
 
+#include <vtkDataArray.h>
 #include <vtkImageData.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
 #include <vtkObjectFactory.h>
+#include <vtkPointData.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
 
 namespace udg {
@@ -105,6 +107,27 @@ int VtkImageExtractPhase::RequestUpdateExtent(vtkInformation *vtkNotUsed(request
     return 1;
 }
 
+int VtkImageExtractPhase::RequestData(vtkInformation *request, vtkInformationVector **inputVector, vtkInformationVector *outputVector)
+{
+    vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+    vtkInformation *outInfo = outputVector->GetInformationObject(0);
+    vtkImageData *input = vtkImageData::SafeDownCast(inInfo->Get(vtkDataObject::DATA_OBJECT()));
+    vtkImageData *output = vtkImageData::SafeDownCast(outInfo->Get(vtkDataObject::DATA_OBJECT()));
+
+    int outExtent[6];
+    outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), outExtent);
+
+    if (input && output && outExtent[4] == outExtent[5] && canExtractPhase(inInfo) && shareInputSlice(input, output, outExtent))
+    {
+        return 1;
+    }
+
+    // The output gets its own copy of the voxels, so the input scalars are no longer needed
+    m_sharedInputScalars = 0;
+
+    return this->Superclass::RequestData(request, inputVector, outputVector);
+}
+
 namespace {
 
 // Executes the algorithm for a specific data type.
@@ -189,6 +212,45 @@ bool VtkImageExtractPhase::canExtractPhase(vtkInformation *inInfo) const
     return m_numberOfPhases > 0 && m_phase >= 0 && m_phase < m_numberOfPhases && depth % m_numberOfPhases == 0;
 }
 
+bool VtkImageExtractPhase::shareInputSlice(vtkImageData *input, vtkImageData *output, const int outExtent[6])
+{
+    vtkDataArray *inputScalars = input->GetPointData()->GetScalars();
+
+    if (!inputScalars || !inputScalars->HasStandardMemoryLayout())
+    {
+        return false;
+    }
+
+    int inExtent[6];
+    computeInputExtentFromOutputExtent(inExtent, outExtent);
+    const int *inDataExtent = input->GetExtent();
+
+    // Whole rows are shared even if only a part of them has been requested, because only then the slice is contiguous
+    if (inExtent[0] < inDataExtent[0] || inExtent[1] > inDataExtent[1] || inExtent[2] < inDataExtent[2] || inExtent[3] > inDataExtent[3] ||
+        inExtent[4] < inDataExtent[4] || inExtent[4] > inDataExtent[5])
+    {
+        return false;
+    }
+
+    int sharedExtent[6] = { inDataExtent[0], inDataExtent[1], inDataExtent[2], inDataExtent[3], outExtent[4], outExtent[5] };
+    vtkIdType numberOfValues = static_cast<vtkIdType>(sharedExtent[1] - sharedExtent[0] + 1) * (sharedExtent[3] - sharedExtent[2] + 1) *
+                               inputScalars->GetNumberOfComponents();
+
+    vtkSmartPointer<vtkDataArray> outputScalars = vtkSmartPointer<vtkDataArray>::Take(inputScalars->NewInstance());
+    outputScalars->SetName(inputScalars->GetName());
+    outputScalars->SetNumberOfComponents(inputScalars->GetNumberOfComponents());
+    // The last argument tells the array not to free the memory, which belongs to the input scalars
+    outputScalars->SetVoidArray(input->GetScalarPointer(inDataExtent[0], inDataExtent[2], inExtent[4]), numberOfValues, 1);
+
+    output->SetExtent(sharedExtent);
+    output->GetPointData()->SetScalars(outputScalars);
+
+    // The filter keeps a reference to the input scalars, so the shared memory isn't freed if the input releases or replaces its data before the next update
+    m_sharedInputScalars = inputScalars;
+
+    return true;
+}
+
 void VtkImageExtractPhase::computeInputExtentFromOutputExtent(int inExtent[6], const int outExtent[6]) const
 {
     for (int i = 0; i < 4; i++)
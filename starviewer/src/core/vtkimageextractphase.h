@@ -15,14 +15,21 @@
 #ifndef UDG_VTKIMAGEEXTRACTPHASE_H
 #define UDG_VTKIMAGEEXTRACTPHASE_H
 
+#include <vtkSmartPointer.h>
 #include <vtkThreadedImageAlgorithm.h>
 
+class vtkDataArray;
+
 namespace udg {
 
 /**
  * @brief The VtkImageExtractPhase class is a filter that returns the selected phase from a multi-phase image.
  *
  * Currently, all phases must have the same number of slices.
+ *
+ * The phases are interleaved slice by slice, so a single slice of a phase is contiguous in the input. When only one slice is requested, as the reslice mapper
+ * does while streaming an axial view, the output is a view that shares the memory of the input instead of a copy. Other requests copy the voxels.
+ * A shared slice stays valid until the next update of the filter or its destruction, as with the output of any other filter.
  */
 class VtkImageExtractPhase : public vtkThreadedImageAlgorithm
 {
@@ -53,6 +60,9 @@ protected:
     /// Sets the input update extent corresponding to the output update extent.
     virtual int RequestUpdateExtent(vtkInformation *request, vtkInformationVector **inputVector, vtkInformationVector *outputVector) override;
 
+    /// Makes the output share the memory of the input if only one slice is requested, otherwise lets the superclass copy the voxels.
+    virtual int RequestData(vtkInformation *request, vtkInformationVector **inputVector, vtkInformationVector *outputVector) override;
+
     /// Copies the selected phase from the input data to the output data.
     virtual void ThreadedRequestData(vtkInformation *request, vtkInformationVector **inputVector, vtkInformationVector *outputVector, vtkImageData ***inData,
                                      vtkImageData **outData, int outExtent[6], int threadId) override;
@@ -64,11 +74,17 @@ private:
     /// Computes the input extent corresponding to the given output extent.
     void computeInputExtentFromOutputExtent(int inExtent[6], const int outExtent[6]) const;
 
+    /// Makes the output a view of the input slice corresponding to the given output extent, which must be a single slice, and returns true.
+    /// Returns false without modifying the output if the input memory can't be shared.
+    bool shareInputSlice(vtkImageData *input, vtkImageData *output, const int outExtent[6]);
+
 private:
     /// Number of phases in the image.
     int m_numberOfPhases;
     /// The index of the phase to be extracted.
     int m_phase;
+    /// Input scalars whose memory is shared by the output, or null if the output has its own copy.
+    vtkSmartPointer<vtkDataArray> m_sharedInputScalars;
 
 };
 
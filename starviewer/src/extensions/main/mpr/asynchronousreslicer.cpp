@@ -0,0 +1,184 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#include "asynchronousreslicer.h"
+
+#include "logging.h"
+
+#include <QtConcurrentRun>
+
+#include <algorithm>
+
+#include <vtkImageData.h>
+#include <vtkImageReslice.h>
+#include <vtkMatrix4x4.h>
+
+namespace udg {
+
+AsynchronousReslicer::AsynchronousReslicer(QObject *parent)
+ : QObject(parent), m_isRunning(false), m_hasPendingRequest(false), m_numberOfFrames(0), m_numberOfCoalescedRequests(0), m_totalResliceTime(0),
+   m_maximumResliceTime(0), m_totalLatency(0), m_maximumLatency(0)
+{
+    m_reslice = vtkSmartPointer<vtkImageReslice>::New();
+    // So that the output extent is big enough to hold all the data
+    m_reslice->AutoCropOutputOn();
+    m_reslice->SetInterpolationModeToCubic();
+    m_reslice->SetOutputOrigin(0.0, 0.0, 0.0);
+
+    m_output = vtkSmartPointer<vtkImageData>::New();
+
+    connect(&m_futureWatcher, SIGNAL(finished()), SLOT(applyResult()));
+}
+
+AsynchronousReslicer::~AsynchronousReslicer()
+{
+    m_futureWatcher.waitForFinished();
+}
+
+void AsynchronousReslicer::setInputData(vtkImageData *data)
+{
+    m_hasPendingRequest = false;
+    m_futureWatcher.waitForFinished();
+    m_isRunning = false;
+
+    // Each reslicer gets its own shallow copy of the input so that several reslicers can share the voxels and update in parallel without sharing pipeline
+    // objects
+    vtkSmartPointer<vtkImageData> input = vtkSmartPointer<vtkImageData>::New();
+    input->ShallowCopy(data);
+    m_reslice->SetInputData(input);
+}
+
+vtkImageData* AsynchronousReslicer::getOutput() const
+{
+    return m_output;
+}
+
+void AsynchronousReslicer::reslice(vtkMatrix4x4 *resliceAxes, const double spacing[3], const int extent[6], bool preview)
+{
+    Request request;
+    std::copy(*resliceAxes->Element, *resliceAxes->Element + 16, request.resliceAxes);
+    std::copy(spacing, spacing + 3, request.spacing);
+    std::copy(extent, extent + 6, request.extent);
+    request.preview = preview;
+    request.requestTime.start();
+
+    if (m_isRunning)
+    {
+        if (m_hasPendingRequest)
+        {
+            m_numberOfCoalescedRequests++;
+        }
+        m_pendingRequest = request;
+        m_hasPendingRequest = true;
+    }
+    else
+    {
+        start(request);
+    }
+}
+
+void AsynchronousReslicer::waitForFinished()
+{
+    while (m_isRunning)
+    {
+        m_futureWatcher.waitForFinished();
+        applyResult();
+    }
+}
+
+void AsynchronousReslicer::logStatistics(const QString &name)
+{
+    if (m_numberOfFrames > 0)
+    {
+        INFO_LOG(QString("MPR %1: %2 frames, reslice %3 ms on average (max %4 ms), latency %5 ms on average (max %6 ms), %7 requests coalesced")
+                 .arg(name).arg(m_numberOfFrames).arg(m_totalResliceTime / m_numberOfFrames).arg(m_maximumResliceTime)
+                 .arg(m_totalLatency / m_numberOfFrames).arg(m_maximumLatency).arg(m_numberOfCoalescedRequests));
+    }
+
+    m_numberOfFrames = 0;
+    m_numberOfCoalescedRequests = 0;
+    m_totalResliceTime = 0;
+    m_maximumResliceTime = 0;
+    m_totalLatency = 0;
+    m_maximumLatency = 0;
+}
+
+void AsynchronousReslicer::start(const Request &request)
+{
+    m_runningRequest = request;
+    m_isRunning = true;
+    m_futureWatcher.setFuture(QtConcurrent::run(this, &AsynchronousReslicer::execute, request));
+}
+
+int AsynchronousReslicer::execute(const Request &request)
+{
+    QTime time;
+    time.start();
+
+    vtkSmartPointer<vtkMatrix4x4> resliceAxes = vtkSmartPointer<vtkMatrix4x4>::New();
+    resliceAxes->DeepCopy(request.resliceAxes);
+    m_reslice->SetResliceAxes(resliceAxes);
+
+    if (request.preview)
+    {
+        m_reslice->SetInterpolationModeToNearestNeighbor();
+    }
+    else
+    {
+        m_reslice->SetInterpolationModeToCubic();
+    }
+
+    m_reslice->SetOutputSpacing(request.spacing[0], request.spacing[1], request.spacing[2]);
+    m_reslice->SetOutputExtent(request.extent[0], request.extent[1], request.extent[2], request.extent[3], request.extent[4], request.extent[5]);
+    m_reslice->Update();
+
+    return time.elapsed();
+}
+
+void AsynchronousReslicer::applyResult()
+{
+    // When waitForFinished() has already applied the result the finished signal may still arrive
+    if (!m_isRunning)
+    {
+        return;
+    }
+
+    m_isRunning = false;
+
+    int resliceTime = m_futureWatcher.result();
+    int latency = m_runningRequest.requestTime.elapsed();
+
+    // The output shares the scalars with the reslice output. Releasing the reslice output data leaves the output as the only owner, so the next reslice
+    // allocates new scalars instead of writing on the ones that may be being rendered.
+    m_output->ShallowCopy(m_reslice->GetOutput());
+    m_reslice->GetOutput()->ReleaseData();
+    m_output->Modified();
+
+    m_numberOfFrames++;
+    m_totalResliceTime += resliceTime;
+    m_maximumResliceTime = qMax(m_maximumResliceTime, resliceTime);
+    m_totalLatency += latency;
+    m_maximumLatency = qMax(m_maximumLatency, latency);
+    DEBUG_LOG(QString("%1 reslice: %2 ms, latency %3 ms").arg(m_runningRequest.preview ? "Preview" : "Full").arg(resliceTime).arg(latency));
+
+    if (m_hasPendingRequest)
+    {
+        m_hasPendingRequest = false;
+        start(m_pendingRequest);
+    }
+
+    emit resliced();
+}
+
+}
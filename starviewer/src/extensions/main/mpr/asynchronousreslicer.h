@@ -0,0 +1,117 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#ifndef UDGASYNCHRONOUSRESLICER_H
+#define UDGASYNCHRONOUSRESLICER_H
+
+#include <QObject>
+
+#include <QFutureWatcher>
+#include <QTime>
+
+#include <vtkSmartPointer.h>
+
+class vtkImageData;
+class vtkImageReslice;
+class vtkMatrix4x4;
+
+namespace udg {
+
+/**
+    Reslices a volume in a worker thread, so that the thread that owns the object (usually the GUI thread) is never blocked while reslicing.
+
+    Requests made while a reslice is in progress are coalesced: only the newest one is kept and computed when the current one finishes, so the output always
+    catches up with the last requested pose without queuing stale work. Preview requests use nearest neighbour interpolation, the rest use cubic
+    interpolation.
+
+    The output image is only modified from the thread that owns the object, when a reslice has finished, and then resliced() is emitted. It can be given to
+    a viewer as input and is safe to render at any moment.
+  */
+class AsynchronousReslicer : public QObject {
+Q_OBJECT
+public:
+    AsynchronousReslicer(QObject *parent = 0);
+    ~AsynchronousReslicer();
+
+    /// Sets the volume data to reslice. Waits for the reslice in progress, if any, and discards the pending request.
+    void setInputData(vtkImageData *data);
+
+    /// Returns the image that holds the last resliced plane.
+    vtkImageData* getOutput() const;
+
+    /// Requests a reslice with the given reslice axes, output spacing and output extent. The output origin is always (0, 0, 0).
+    void reslice(vtkMatrix4x4 *resliceAxes, const double spacing[3], const int extent[6], bool preview);
+
+    /// Waits until the reslice in progress and the pending request, if any, have been computed and applied to the output.
+    void waitForFinished();
+
+    /// Writes to the log the frame time statistics gathered since the last call with the given name identifying the plane, and resets them.
+    void logStatistics(const QString &name);
+
+signals:
+    /// Emitted each time the output has been updated.
+    void resliced();
+
+private:
+    /// Parameters of a reslice request.
+    struct Request
+    {
+        double resliceAxes[16];
+        double spacing[3];
+        int extent[6];
+        bool preview;
+        /// Time when the request was made, to measure the latency until the result is shown.
+        QTime requestTime;
+    };
+
+    /// Starts computing the given request in a worker thread.
+    void start(const Request &request);
+
+    /// Configures the reslice with the given request and updates it. Returns the time spent in ms. Runs in a worker thread.
+    int execute(const Request &request);
+
+private slots:
+    /// Applies the result of the finished reslice to the output and starts the pending request, if any.
+    void applyResult();
+
+private:
+    /// Filter that does the reslicing. It's only used from the worker thread while a reslice is running.
+    vtkSmartPointer<vtkImageReslice> m_reslice;
+
+    /// Image with the last applied result.
+    vtkSmartPointer<vtkImageData> m_output;
+
+    /// Watches the reslice running in the worker thread.
+    QFutureWatcher<int> m_futureWatcher;
+
+    /// True while a reslice has been started and its result has not been applied yet.
+    bool m_isRunning;
+
+    /// Request being computed and newest request made while computing it.
+    Request m_runningRequest;
+    Request m_pendingRequest;
+    bool m_hasPendingRequest;
+
+    /// Frame time statistics, in ms.
+    int m_numberOfFrames;
+    int m_numberOfCoalescedRequests;
+    int m_totalResliceTime;
+    int m_maximumResliceTime;
+    int m_totalLatency;
+    int m_maximumLatency;
+};
+
+}
+
+#endif
@@ -6,10 +6,12 @@
 FORMS += qmprextensionbase.ui
 
 HEADERS += qmprextension.h \
+           asynchronousreslicer.h \
            mprsettings.h \
            mprextensionmediator.h
 
 SOURCES += qmprextension.cpp \
+           asynchronousreslicer.cpp \
            mprsettings.cpp \
            mprextensionmediator.cpp
 
@@ -17,3 +19,5 @@ RESOURCES += mpr.qrc
 
 EXTENSION_DIR = $$PWD
 include(../../basicconfextensions.pri)
+
+QT += concurrent
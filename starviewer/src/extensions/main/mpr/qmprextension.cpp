@@ -14,6 +14,7 @@
 
 #include "qmprextension.h"
 
+#include "asynchronousreslicer.h"
 #include "drawer.h"
 #include "drawerpoint.h"
 #include "logging.h"
@@ -38,7 +39,7 @@
 #include <vtkCommand.h>
 // Per portar a l'origen
 #include <vtkImageChangeInformation.h>
-#include <vtkImageReslice.h>
+#include <vtkMatrix4x4.h>
 #include <vtkPlaneSource.h>
 #include <vtkProperty2D.h>
 #include <vtkRenderWindowInteractor.h>
@@ -48,6 +49,7 @@
 namespace udg {
 
 const double QMPRExtension::PickingDistanceThreshold = 7.0;
+const int QMPRExtension::PreviewDownsamplingFactor = 2;
 
 QMPRExtension::QMPRExtension(QWidget *parent)
  : QWidget(parent), m_axialZeroSliceCoordinate(.0)
@@ -86,15 +88,6 @@ QMPRExtension::QMPRExtension(QWidget *parent)
 QMPRExtension::~QMPRExtension()
 {
     writeSettings();
-    // Fent això o no sembla que s'allibera la mateixa memòria gràcies als smart pointers
-    if (m_sagitalReslice)
-    {
-        m_sagitalReslice->Delete();
-    }
-    if (m_coronalReslice)
-    {
-        m_coronalReslice->Delete();
-    }
 
     m_transform->Delete();
 
@@ -119,11 +112,6 @@ QMPRExtension::~QMPRExtension()
     m_coronalPlaneSource->Delete();
     m_thickSlabPlaneSource->Delete();
 
-    if (m_pickedActorReslice)
-    {
-        m_pickedActorReslice->Delete();
-    }
-
     if (m_mipViewer)
     {
         delete m_mipViewer;
@@ -150,8 +138,10 @@ void QMPRExtension::init()
     m_thickSlabPlaneSource->SetXResolution(1);
     m_thickSlabPlaneSource->SetYResolution(1);
 
-    m_sagitalReslice = 0;
-    m_coronalReslice = 0;
+    m_volume = 0;
+    // The reslicers are children of the extension and wait for their reslice in progress when destroyed
+    m_sagitalReslicer = new AsynchronousReslicer(this);
+    m_coronalReslicer = new AsynchronousReslicer(this);
 
     // Configurem les annotacions que volem veure
     m_sagital2DView->removeAnnotation(PatientOrientationAnnotation | MainInformationAnnotation | SliceAnnotation);
@@ -171,7 +161,7 @@ void QMPRExtension::init()
     m_transform = vtkTransform::New();
 
     m_pickedActorPlaneSource = 0;
-    m_pickedActorReslice = 0;
+    m_pickedActorReslicer = 0;
     m_mipViewer = 0;
 
     m_extensionToolsList << "ZoomTool" << "SlicingMouseTool" << "TranslateTool" << "VoxelInformationTool" << "WindowLevelTool" << "ScreenShotTool"
@@ -313,6 +303,10 @@ void QMPRExtension::createConnections()
     connect(m_axial2DView, SIGNAL(eventReceived(unsigned long)), SLOT(handleAxialViewEvents(unsigned long)));
     connect(m_sagital2DView, SIGNAL(eventReceived(unsigned long)), SLOT(handleSagitalViewEvents(unsigned long)));
 
+    // Each view is rendered again when its reslice has been computed
+    connect(m_sagitalReslicer, SIGNAL(resliced()), m_sagital2DView, SLOT(render()));
+    connect(m_coronalReslicer, SIGNAL(resliced()), m_coronal2DView, SLOT(render()));
+
     connect(m_thickSlabSpinBox, SIGNAL(valueChanged(double)), SLOT(updateThickSlab(double)));
     connect(m_thickSlabSlider, SIGNAL(valueChanged(int)), SLOT(updateThickSlab(int)));
 
@@ -499,7 +493,7 @@ void QMPRExtension::switchToMIPLayout(bool isMIPChecked)
         Volume *mipInput = new Volume;
         // TODO Això es necessari perquè tingui la informació de la sèrie, estudis, pacient...
         mipInput->setImages(m_volume->getImages());
-        mipInput->setData(m_coronalReslice->GetOutput());
+        mipInput->setData(m_coronalReslicer->getOutput());
         m_mipViewer->setInput(mipInput);
         m_mipViewer->render();
         m_mipViewer->show();
@@ -656,14 +650,13 @@ bool QMPRExtension::detectAxialViewAxisActor()
         if (distanceToCoronal < distanceToSagital)
         {
             m_pickedActorPlaneSource = m_coronalPlaneSource;
-            m_pickedActorReslice = m_coronalReslice;
+            m_pickedActorReslicer = m_coronalReslicer;
         }
         else
         {
             m_pickedActorPlaneSource = m_sagitalPlaneSource;
-            m_pickedActorReslice = m_sagitalReslice;
+            m_pickedActorReslicer = m_sagitalReslicer;
         }
-        m_pickedActorReslice->SetInterpolationModeToNearestNeighbor();
         // Desactivem les tools que puguin estar actives
         m_toolManager->disableAllToolsTemporarily();
         m_initialPickX = clickedWorldPoint[0];
@@ -718,22 +711,12 @@ void QMPRExtension::rotateAxialViewAxisActor()
 
 void QMPRExtension::releaseAxialViewAxisActor()
 {
-    if (m_pickedActorReslice)
+    if (m_pickedActorReslicer)
     {
-        m_pickedActorReslice->SetInterpolationModeToCubic();
         // TODO No seria millor un restoreOverrideCursor?
         m_axial2DView->unsetCursor();
-        if (m_pickedActorPlaneSource == m_sagitalPlaneSource)
-        {
-            m_sagital2DView->render();
-        }
-        else
-        {
-            m_coronal2DView->render();
-        }
-        m_state = None;
-        m_pickedActorReslice = 0;
-        m_pickedActorPlaneSource = 0;
+        finishPlanesManipulation();
+        m_pickedActorReslicer = 0;
         // Reactivem les tools
         m_toolManager->undoDisableAllToolsTemporarily();
     }
@@ -764,8 +747,7 @@ void QMPRExtension::detectSagitalViewAxisActor()
     // Donem una "tolerància" mínima
     if (distanceToCoronal < PickingDistanceThreshold)
     {
-        m_pickedActorReslice = m_coronalReslice;
-        m_pickedActorReslice->SetInterpolationModeToNearestNeighbor();
+        m_pickedActorReslicer = m_coronalReslicer;
         m_pickedActorPlaneSource = m_coronalPlaneSource;
         // Desactivem les tools que puguin estar actives
         m_toolManager->disableAllToolsTemporarily();
@@ -836,14 +818,11 @@ void QMPRExtension::rotateSagitalViewAxisActor()
 
 void QMPRExtension::releaseSagitalViewAxisActor()
 {
-    if (m_pickedActorReslice)
+    if (m_pickedActorReslicer)
     {
         m_sagital2DView->unsetCursor();
-        m_pickedActorReslice->SetInterpolationModeToCubic();
-        m_coronal2DView->render();
-        m_state = None;
-        m_pickedActorReslice = 0;
-        m_pickedActorPlaneSource = 0;
+        finishPlanesManipulation();
+        m_pickedActorReslicer = 0;
         // Reactivem les tools
         m_toolManager->undoDisableAllToolsTemporarily();
     }
@@ -952,12 +931,12 @@ void QMPRExtension::detectPushSagitalViewAxisActor()
         if (distanceToCoronal < distanceToAxial)
         {
             m_pickedActorPlaneSource = m_coronalPlaneSource;
-            m_pickedActorReslice = m_coronalReslice;
+            m_pickedActorReslicer = m_coronalReslicer;
         }
         else
         {
             m_pickedActorPlaneSource = m_axialPlaneSource;
-            m_pickedActorReslice = m_sagitalReslice;
+            m_pickedActorReslicer = m_sagitalReslicer;
         }
         m_state = Pushing;
         m_initialPickX = clickedWorldPoint[0];
@@ -1017,24 +996,8 @@ void QMPRExtension::setInput(Volume *input)
 
     m_volume->getSpacing(m_axialSpacing);
 
-    if (m_sagitalReslice)
-    {
-        m_sagitalReslice->Delete();
-    }
-    m_sagitalReslice = vtkImageReslice::New();
-    // Perquè l'extent d'output sigui suficient i no es "mengi" dades
-    m_sagitalReslice->AutoCropOutputOn();
-    m_sagitalReslice->SetInterpolationModeToCubic();
-    m_sagitalReslice->SetInputData(m_volume->getVtkData());
-
-    if (m_coronalReslice)
-    {
-        m_coronalReslice->Delete();
-    }
-    m_coronalReslice = vtkImageReslice::New();
-    m_coronalReslice->AutoCropOutputOn();
-    m_coronalReslice->SetInterpolationModeToCubic();
-    m_coronalReslice->SetInputData(m_volume->getVtkData());
+    m_sagitalReslicer->setInputData(m_volume->getVtkData());
+    m_coronalReslicer->setInputData(m_volume->getVtkData());
 
     // Faltaria refrescar l'input dels 3 mpr
     // HACK To make universal scrolling work properly. Issue #2019. We have to disconnect and reconnect the signal to avoid infinite loops
@@ -1052,11 +1015,14 @@ void QMPRExtension::setInput(Volume *input)
 
     // Posta a punt dels planeSource
     initOrientation();
+    // The viewers need the first reslices to set up their input
+    m_sagitalReslicer->waitForFinished();
+    m_coronalReslicer->waitForFinished();
 
     Volume *sagitalResliced = new Volume;
     // TODO Això es necessari perquè tingui la informació de la sèrie, estudis, pacient...
     sagitalResliced->setImages(m_volume->getImages());
-    sagitalResliced->setData(m_sagitalReslice->GetOutput());
+    sagitalResliced->setData(m_sagitalReslicer->getOutput());
     sagitalResliced->setNumberOfPhases(1);
     sagitalResliced->setNumberOfSlicesPerPhase(1);
 
@@ -1065,7 +1031,7 @@ void QMPRExtension::setInput(Volume *input)
     Volume *coronalResliced = new Volume;
     // TODO Això es necessari perquè tingui la informació de la sèrie, estudis, pacient...
     coronalResliced->setImages(m_volume->getImages());
-    coronalResliced->setData(m_coronalReslice->GetOutput());
+    coronalResliced->setData(m_coronalReslicer->getOutput());
     coronalResliced->setNumberOfPhases(1);
     coronalResliced->setNumberOfSlicesPerPhase(1);
 
@@ -1450,13 +1416,25 @@ void QMPRExtension::updateControls()
 
 void QMPRExtension::updatePlanes()
 {
-    updatePlane(m_sagitalPlaneSource, m_sagitalReslice, m_sagitalExtentLength);
-    updatePlane(m_coronalPlaneSource, m_coronalReslice, m_coronalExtentLength);
+    // Both planes are resliced at the same time in different worker threads
+    updatePlane(m_sagitalPlaneSource, m_sagitalReslicer, m_sagitalExtentLength);
+    updatePlane(m_coronalPlaneSource, m_coronalReslicer, m_coronalExtentLength);
 }
 
-void QMPRExtension::updatePlane(vtkPlaneSource *planeSource, vtkImageReslice *reslice, int extentLength[2])
+void QMPRExtension::finishPlanesManipulation()
 {
-    if (!reslice || !(vtkImageData::SafeDownCast(reslice->GetInput())))
+    m_state = None;
+    m_pickedActorPlaneSource = 0;
+    // Refine the previews computed during the manipulation
+    updatePlanes();
+
+    m_sagitalReslicer->logStatistics("sagital");
+    m_coronalReslicer->logStatistics("coronal");
+}
+
+void QMPRExtension::updatePlane(vtkPlaneSource *planeSource, AsynchronousReslicer *reslicer, int extentLength[2])
+{
+    if (!m_volume)
     {
         return;
     }
@@ -1568,17 +1546,25 @@ void QMPRExtension::updatePlane(vtkPlaneSource *planeSource, vtkImageReslice *re
     resliceAxes->SetElement(1, 3, neworiginXYZW[1]);
     resliceAxes->SetElement(2, 3, neworiginXYZW[2]);
 
-    reslice->SetResliceAxes(resliceAxes);
+    // While a plane is being manipulated a preview with fewer pixels and nearest neighbour interpolation is computed, covering the same plane size
+    bool preview = m_state != None;
+    int outputLength[2] = { extentLength[0], extentLength[1] };
 
-    resliceAxes->Delete();
+    if (preview)
+    {
+        outputLength[0] = qMax(1, extentLength[0] / PreviewDownsamplingFactor);
+        outputLength[1] = qMax(1, extentLength[1] / PreviewDownsamplingFactor);
+    }
 
-    reslice->SetOutputSpacing(planeSizeX / extentLength[0], planeSizeY / extentLength[1], 1.0);
-    reslice->SetOutputOrigin(0.0, 0.0, 0.0);
+    double outputSpacing[3] = { planeSizeX / outputLength[0], planeSizeY / outputLength[1], 1.0 };
     // TODO Li passem thickSlab que és double però això només accepta int's! Buscar si aquesta és la manera adequada. Potsre si volem fer servir doubles
     // ho hauríem de combinar amb l'outputSpacing
     // Obtenim una única llesca
-    reslice->SetOutputExtent(0, extentLength[0] - 1, 0, extentLength[1] - 1, 0, static_cast<int>(m_thickSlab));
-    reslice->Update();
+    int outputExtent[6] = { 0, outputLength[0] - 1, 0, outputLength[1] - 1, 0, static_cast<int>(m_thickSlab) };
+
+    reslicer->reslice(resliceAxes, outputSpacing, outputExtent, preview);
+
+    resliceAxes->Delete();
 }
 
 void QMPRExtension::getSagitalXVector(double x[3])
@@ -1706,7 +1692,7 @@ void QMPRExtension::updateThickSlab(double value)
 {
     m_thickSlab = value;
     m_thickSlabSlider->setValue((int) value);
-    updatePlane(m_coronalPlaneSource, m_coronalReslice, m_coronalExtentLength);
+    updatePlane(m_coronalPlaneSource, m_coronalReslicer, m_coronalExtentLength);
     updateControls();
 }
 
@@ -1714,7 +1700,7 @@ void QMPRExtension::updateThickSlab(int value)
 {
     m_thickSlab = (double) value;
     m_thickSlabSpinBox->setValue(m_thickSlab);
-    updatePlane(m_coronalPlaneSource, m_coronalReslice, m_coronalExtentLength);
+    updatePlane(m_coronalPlaneSource, m_coronalReslicer, m_coronalExtentLength);
     updateControls();
 }
 
@@ -21,13 +21,13 @@
 class QAction;
 class QStringList;
 class vtkAxisActor2D;
-class vtkImageReslice;
 class vtkPlaneSource;
 class vtkTransform;
 
 namespace udg {
 
 // FWD declarations
+class AsynchronousReslicer;
 class DrawerPoint;
 class ToolManager;
 class Q3DViewer;
@@ -92,8 +92,12 @@ private:
     /// TODO: separar en dos mètodes diferenciats segons quin pla????
     void updatePlanes();
 
-    /// Actualitza els valors del pla donat amb el reslice associat
-    void updatePlane(vtkPlaneSource *planeSource, vtkImageReslice *reslice, int extentLength[2]);
+    /// Updates the given plane and requests the associated reslice. While a plane is being manipulated a lower resolution preview is requested, which is
+    /// refined when the manipulation ends.
+    void updatePlane(vtkPlaneSource *planeSource, AsynchronousReslicer *reslicer, int extentLength[2]);
+
+    /// Ends the manipulation of the planes: requests the full resolution reslices and logs the frame times of the manipulation.
+    void finishPlanesManipulation();
 
     /// Inicialitza les orientacions dels plans de tall correctament perquè tinguin un espaiat, dimensions i límits correctes
     void initOrientation();
@@ -193,8 +197,11 @@ private:
     /// considerar-se prou proper per fer una operació de picking
     static const double PickingDistanceThreshold;
 
-    /// El reslice de cada vista
-    vtkImageReslice *m_sagitalReslice, *m_coronalReslice;
+    /// Factor by which the resolution of the preview reslices is reduced while the planes are being manipulated.
+    static const int PreviewDownsamplingFactor;
+
+    /// Reslicers of each view. They are computed in parallel outside the GUI thread.
+    AsynchronousReslicer *m_sagitalReslicer, *m_coronalReslicer;
 
     /// La tranformació que apliquem
     vtkTransform *m_transform;
@@ -236,7 +243,7 @@ private:
     /// Cosetes per controlar el moviment del plans a partir de l'interacció de l'usuari
     double m_initialPickX, m_initialPickY;
     vtkPlaneSource *m_pickedActorPlaneSource;
-    vtkImageReslice *m_pickedActorReslice;
+    AsynchronousReslicer *m_pickedActorReslicer;
 
     /// Gruix del thickSlab que servirà per al MIP
     double m_thickSlab;
@@ -26,6 +26,7 @@ HEADERS += experimental3dextensionmediator.h \
     vomicoolwarmvoxelshader.h \
     coolwarmvoxelshader.h \
     viewpointinformationchannel.h \
+    voxelprobabilitiesperviewstore.h \
     filteringambientocclusionvoxelshader.h \
     filteringambientocclusionmapvoxelshader.h \
     vomigammavoxelshader.h \
@@ -60,6 +61,7 @@ SOURCES += experimental3dextensionmediator.cpp \
     vomicoolwarmvoxelshader.cpp \
     coolwarmvoxelshader.cpp \
     viewpointinformationchannel.cpp \
+    voxelprobabilitiesperviewstore.cpp \
     filteringambientocclusionvoxelshader.cpp \
     filteringambientocclusionmapvoxelshader.cpp \
     vomigammavoxelshader.cpp \
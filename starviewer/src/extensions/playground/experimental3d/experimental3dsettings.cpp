@@ -1,5 +1,9 @@
 #include "experimental3dsettings.h"
 
+#include "settingsregistry.h"
+
+#include <QDir>
+
 namespace udg {
 
 // Definició de les claus
@@ -42,6 +46,8 @@ const QString Experimental3DSettings::ViewpointMutualInformationIntensityDir(Key
 const QString Experimental3DSettings::MutualInformationIntensityDir(KeyPrefix + "miiDir");
 const QString Experimental3DSettings::ViewpointUnstabilitiesIntensityDir(KeyPrefix + "viewpointUnstabilitiesIDir");
 const QString Experimental3DSettings::IntensityMutualInformationDir(KeyPrefix + "imiDir");
+const QString Experimental3DSettings::ScratchDir(KeyPrefix + "scratchDir");
+const QString Experimental3DSettings::HalfPrecisionVoxelProbabilities(KeyPrefix + "halfPrecisionVoxelProbabilities");
 
 Experimental3DSettings::Experimental3DSettings()
 {
@@ -53,6 +59,9 @@ Experimental3DSettings::~Experimental3DSettings()
 
 void Experimental3DSettings::init()
 {
+    SettingsRegistry *settingsRegistry = SettingsRegistry::instance();
+    settingsRegistry->addSetting(ScratchDir, QDir::tempPath());
+    settingsRegistry->addSetting(HalfPrecisionVoxelProbabilities, false);
 }
 
 } // end namespace udg
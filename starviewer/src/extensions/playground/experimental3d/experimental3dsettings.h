@@ -53,6 +53,10 @@ public:
     static const QString MutualInformationIntensityDir;
     static const QString ViewpointUnstabilitiesIntensityDir;
     static const QString IntensityMutualInformationDir;
+    /// Directory where the probabilities p(Z|V) are stored while the information channel is computed
+    static const QString ScratchDir;
+    /// If true the probabilities p(Z|V) are stored in half precision
+    static const QString HalfPrecisionVoxelProbabilities;
 
 };
 
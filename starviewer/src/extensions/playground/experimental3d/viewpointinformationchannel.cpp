@@ -9,11 +9,15 @@
 #include <QSet>
 #include <QThread>
 
+#include <cmath>
 #include <limits>
 
 #ifndef CUDA_AVAILABLE
+#include "experimental3dsettings.h"
 #include "mathtools.h"
-#include <QTemporaryFile>
+#include "settings.h"
+#include "voxelprobabilitiesperviewstore.h"
+#include <QtConcurrentMap>
 #else // CUDA_AVAILABLE
 #include "camera.h"
 #include "cudaviewpointinformationchannel.h"
@@ -26,6 +30,9 @@ ViewpointInformationChannel::ViewpointInformationChannel(const ViewpointGenerato
                                                          QExperimental3DViewer *viewer, const TransferFunction &transferFunction)
     : QObject(), m_viewpointGenerator(viewpointGenerator), m_volume(volume), m_viewer(viewer), m_transferFunction(transferFunction)
 {
+#ifndef CUDA_AVAILABLE
+    m_voxelProbabilitiesPerView = 0;
+#endif
     m_backgroundColor = m_viewer->getBackgroundColor();
     m_viewpoints = m_viewpointGenerator.viewpoints();
 }
@@ -656,8 +663,8 @@ void ViewpointInformationChannel::computeCpu(bool computeViewProbabilities, bool
     int step = 0;
     emit totalProgress(step);
 
-    createVoxelProbabilitiesPerViewFiles();
-    if (m_voxelProbabilitiesPerViewFiles.isEmpty())
+    createVoxelProbabilitiesPerViewStore();
+    if (!m_voxelProbabilitiesPerView)
     {
         return; // caldria llançar alguna excepció o retornar error
     }
@@ -753,60 +760,42 @@ void ViewpointInformationChannel::computeCpu(bool computeViewProbabilities, bool
         QCoreApplication::processEvents();  // necessari perquè el procés vagi fluid
     }
 
-    deleteVoxelProbabilitiesPerViewFiles();
+    deleteVoxelProbabilitiesPerViewStore();
 }
 
-void ViewpointInformationChannel::createVoxelProbabilitiesPerViewFiles()
+void ViewpointInformationChannel::createVoxelProbabilitiesPerViewStore()
 {
     DEBUG_LOG("Creem p(Z|V)");
 
-    int nViewpoints = m_viewpoints.size();
-    m_voxelProbabilitiesPerViewFiles.resize(nViewpoints);
+    Settings settings;
+    QString scratchDir = settings.getValue(Experimental3DSettings::ScratchDir).toString();
+    bool halfPrecision = settings.getValue(Experimental3DSettings::HalfPrecisionVoxelProbabilities).toBool();
 
-    for (int i = 0; i < nViewpoints; i++)
-    {
-        m_voxelProbabilitiesPerViewFiles[i] = new QTemporaryFile("pZvXXXXXX.tmp");    // els fitxers temporals es creen al directori de treball
+    m_voxelProbabilitiesPerView = new VoxelProbabilitiesPerViewStore(m_viewpoints.size(), m_volume->getSize(), scratchDir, halfPrecision);
 
-        if (!m_voxelProbabilitiesPerViewFiles.at(i)->open())
-        {
-            DEBUG_LOG(QString("No s'ha pogut obrir el fitxer: error %1").arg(m_voxelProbabilitiesPerViewFiles.at(i)->errorString()));
-            for (int j = 0; j < i; j++)
-            {
-                m_voxelProbabilitiesPerViewFiles.at(j)->close();
-            }
-            m_voxelProbabilitiesPerViewFiles.clear();   // el deixarem buit si hi ha hagut problemes
-            break;
-        }
+    if (!m_voxelProbabilitiesPerView->isValid())
+    {
+        ERROR_LOG(QString("Could not create the p(Z|V) file in %1: %2").arg(scratchDir).arg(m_voxelProbabilitiesPerView->errorString()));
+        deleteVoxelProbabilitiesPerViewStore();
     }
 }
 
 QVector<float> ViewpointInformationChannel::voxelProbabilitiesInViewCpu(int i)
 {
-    QVector<float> pZv(m_volume->getSize());
-    m_voxelProbabilitiesPerViewFiles.at(i)->reset();  // reset per tornar al principi
-    m_voxelProbabilitiesPerViewFiles.at(i)->read(reinterpret_cast<char*>(pZv.data()), pZv.size() * sizeof(float)); // llegim...
-    // ... i després fem un reset per tornar al principi i buidar el buffer (amb un peek queda el buffer ple, i es gasta molta memòria)
-    m_voxelProbabilitiesPerViewFiles.at(i)->reset();
-    return pZv;
+    return m_voxelProbabilitiesPerView->view(i);
 }
 
-void ViewpointInformationChannel::deleteVoxelProbabilitiesPerViewFiles()
+void ViewpointInformationChannel::deleteVoxelProbabilitiesPerViewStore()
 {
     DEBUG_LOG("Destruïm p(Z|V)");
 
-    for (int i = 0; i < m_voxelProbabilitiesPerViewFiles.size(); i++)
-    {
-        m_voxelProbabilitiesPerViewFiles.at(i)->close();
-        delete m_voxelProbabilitiesPerViewFiles.at(i);
-    }
-
-    m_voxelProbabilitiesPerViewFiles.clear();
+    delete m_voxelProbabilitiesPerView;
+    m_voxelProbabilitiesPerView = 0;
 }
 
 float ViewpointInformationChannel::rayCastingCpu(bool computeViewProbabilities)
 {
     int nViewpoints = m_viewpoints.size();
-    int nVoxels = m_volume->getSize();
     double totalViewedVolume = 0.0;
 
     if (computeViewProbabilities)
@@ -826,7 +815,7 @@ float ViewpointInformationChannel::rayCastingCpu(bool computeViewProbabilities)
 
         // p(Z|V)
         QVector<float> voxelProbabilitiesInView = m_volume->finishVmiSecondPass();  // p(Z|v)
-        m_voxelProbabilitiesPerViewFiles.at(i)->write(reinterpret_cast<const char*>(voxelProbabilitiesInView.data()), nVoxels * sizeof(float));
+        m_voxelProbabilitiesPerView->setView(i, voxelProbabilitiesInView);
 
         // p(V)
         if (computeViewProbabilities)
@@ -982,6 +971,50 @@ void ViewpointInformationChannel::computeVoxelProbabilitiesAndEntropyCpu(bool co
     }
 }
 
+namespace {
+
+// Returns D_KL(p(Z|v) || Q) like InformationTheory::kullbackLeiblerDivergence(p(Z|v), Q, true), reading p(Z|v) in blocks from the store
+double kullbackLeiblerDivergenceSkippingZeroQ(const VoxelProbabilitiesPerViewStore &voxelProbabilitiesPerView, int view,
+                                               const QVector<float> &probabilitiesQ)
+{
+    int size = voxelProbabilitiesPerView.numberOfVoxels();
+
+    double sumP = 0.0;
+    for (VoxelProbabilitiesPerViewStore::BlockIterator it(voxelProbabilitiesPerView, view, 0, size); !it.atEnd(); it.next())
+    {
+        const float *probabilitiesP = it.block();
+        for (int j = 0; j < it.blockSize(); j++)
+        {
+            if (probabilitiesQ.at(it.blockStart() + j) > 0.0f)
+            {
+                sumP += probabilitiesP[j];
+            }
+        }
+    }
+
+    double kullbackLeiblerDivergence = 0.0;
+    for (VoxelProbabilitiesPerViewStore::BlockIterator it(voxelProbabilitiesPerView, view, 0, size); !it.atEnd(); it.next())
+    {
+        const float *probabilitiesP = it.block();
+        for (int j = 0; j < it.blockSize(); j++)
+        {
+            double p = probabilitiesP[j] / sumP;
+            if (p > 0.0)
+            {
+                double q = probabilitiesQ.at(it.blockStart() + j);
+                if (q > 0.0)
+                {
+                    kullbackLeiblerDivergence += p * log(p / q);
+                }
+            }
+        }
+    }
+
+    return kullbackLeiblerDivergence / log(2.0);
+}
+
+}
+
 void ViewpointInformationChannel::computeViewMeasuresCpu(bool computeHZv, bool computeHZV, bool computeVmi, bool computeVmi2, bool computeMi,
                                                          bool computeViewpointUnstabilities, bool computeViewpointVomi, bool computeViewpointVomi2,
                                                          bool computeEvmiOpacity, bool computeEvmiVomi)
@@ -1147,9 +1180,17 @@ void ViewpointInformationChannel::computeViewMeasuresCpu(bool computeHZv, bool c
     emit partialProgress(0);
     QCoreApplication::processEvents();  // necessari perquè el procés vagi fluid
 
+    // p(Z|v) is read from the store only for the measures that use it here; EVMI streams it below
+    bool needsVoxelProbabilitiesInView = computeHZv || computeVmi || computeViewpointUnstabilities || computeViewpointVomi || computeViewpointVomi2;
+
     for (int i = 0; i < nViewpoints; i++)
     {
-        QVector<float> voxelProbabilitiesInView = this->voxelProbabilitiesInView(i);
+        QVector<float> voxelProbabilitiesInView;
+
+        if (needsVoxelProbabilitiesInView)
+        {
+            voxelProbabilitiesInView = this->voxelProbabilitiesInView(i);
+        }
 
         if (computeHZv)
         {
@@ -1262,24 +1303,48 @@ void ViewpointInformationChannel::computeViewMeasuresCpu(bool computeHZv, bool c
             }
         }
 
-        if (computeEvmiOpacity)
+        emit partialProgress(100 * (i + 1) / nViewpoints);
+        QCoreApplication::processEvents();  // necessari perquè el procés vagi fluid
+    }
+
+    if (computeEvmiOpacity || computeEvmiVomi)
+    {
+        // EVMI only depends on each view, so all the views are computed in parallel, streaming p(Z|v) from the store
+        QVector<int> viewpoints(nViewpoints);
+        for (int i = 0; i < nViewpoints; i++)
         {
-            float evmiOpacity = InformationTheory::kullbackLeiblerDivergence(voxelProbabilitiesInView, ppZOpacity, true);
-            Q_ASSERT(!MathTools::isNaN(evmiOpacity));
-            m_evmiOpacity[i] = evmiOpacity;
-            DEBUG_LOG(QString("EVMI_O(v%1) = %2").arg(i + 1).arg(evmiOpacity));
+            viewpoints[i] = i;
         }
 
-        if (computeEvmiVomi)
+        const VoxelProbabilitiesPerViewStore &voxelProbabilitiesPerView = *m_voxelProbabilitiesPerView;
+        float *evmiOpacity = computeEvmiOpacity ? m_evmiOpacity.data() : 0;
+        float *evmiVomi = computeEvmiVomi ? m_evmiVomi.data() : 0;
+
+        QtConcurrent::blockingMap(viewpoints, [&](int i)
         {
-            float evmiVomi = InformationTheory::kullbackLeiblerDivergence(voxelProbabilitiesInView, ppZVomi, true);
-            Q_ASSERT(!MathTools::isNaN(evmiVomi));
-            m_evmiVomi[i] = evmiVomi;
-            DEBUG_LOG(QString("EVMI_V(v%1) = %2").arg(i + 1).arg(evmiVomi));
-        }
+            if (evmiOpacity)
+            {
+                evmiOpacity[i] = kullbackLeiblerDivergenceSkippingZeroQ(voxelProbabilitiesPerView, i, ppZOpacity);
+            }
+            if (evmiVomi)
+            {
+                evmiVomi[i] = kullbackLeiblerDivergenceSkippingZeroQ(voxelProbabilitiesPerView, i, ppZVomi);
+            }
+        });
 
-        emit partialProgress(100 * (i + 1) / nViewpoints);
-        QCoreApplication::processEvents();  // necessari perquè el procés vagi fluid
+        for (int i = 0; i < nViewpoints; i++)
+        {
+            if (computeEvmiOpacity)
+            {
+                Q_ASSERT(!MathTools::isNaN(m_evmiOpacity.at(i)));
+                DEBUG_LOG(QString("EVMI_O(v%1) = %2").arg(i + 1).arg(m_evmiOpacity.at(i)));
+            }
+            if (computeEvmiVomi)
+            {
+                Q_ASSERT(!MathTools::isNaN(m_evmiVomi.at(i)));
+                DEBUG_LOG(QString("EVMI_V(v%1) = %2").arg(i + 1).arg(m_evmiVomi.at(i)));
+            }
+        }
     }
 
     if (computeHZV)
@@ -1419,61 +1484,80 @@ void ViewpointInformationChannel::computeVmi3Cpu()
 
 void ViewpointInformationChannel::computeVomiCpu(bool computeHVz, bool computeVomi, bool computeColorVomi)
 {
+    // Each thread streams the probabilities of its voxels directly from the p(Z|V) store for a batch of views,
+    // so a view is never loaded as a whole
     class VomiThread : public QThread {
     public:
-        VomiThread(const QVector<float> &voxelProbabilities, bool computeHVz, QVector<float> &HVz, bool computeVomi, QVector<float> &vomi,
-                   bool computeColorVomi, QVector<Vector3Float> &colorVomi, int start, int end)
-            : m_viewProbability(0.0f), m_voxelProbabilities(voxelProbabilities), m_computeHVz(computeHVz), m_HVz(HVz), m_computeVomi(computeVomi), m_vomi(vomi),
-              m_computeColorVomi(computeColorVomi), m_viewColor(1.0f, 1.0f, 1.0f), m_colorVomi(colorVomi), m_start(start), m_end(end)
-        {
-        }
-        void setViewData(float viewProbability, const QVector<float> &voxelProbabilitiesInView)
+        VomiThread(const VoxelProbabilitiesPerViewStore &voxelProbabilitiesPerView, const QVector<float> &viewProbabilities,
+                   const QVector<float> &voxelProbabilities, bool computeHVz, QVector<float> &HVz, bool computeVomi, QVector<float> &vomi,
+                   bool computeColorVomi, const QVector<Vector3Float> &viewpointColors, QVector<Vector3Float> &colorVomi, int start, int end)
+            : m_voxelProbabilitiesPerView(voxelProbabilitiesPerView), m_viewProbabilities(viewProbabilities), m_voxelProbabilities(voxelProbabilities),
+              m_computeHVz(computeHVz), m_HVz(HVz), m_computeVomi(computeVomi), m_vomi(vomi), m_computeColorVomi(computeColorVomi),
+              m_viewpointColors(viewpointColors), m_colorVomi(colorVomi), m_start(start), m_end(end), m_firstView(0), m_endView(0)
         {
-            m_viewProbability = viewProbability;
-            m_voxelProbabilitiesInView = voxelProbabilitiesInView;
         }
-        void setViewColor(const Vector3Float &viewColor)
+        void setViews(int firstView, int endView)
         {
-            m_viewColor = viewColor;
+            m_firstView = firstView;
+            m_endView = endView;
         }
     protected:
         virtual void run()
         {
-            Vector3Float color = Vector3Float(1.0f, 1.0f, 1.0f) - m_viewColor;
-            for (int i = m_start; i < m_end; i++)
+            for (int v = m_firstView; v < m_endView; v++)
             {
-                float pz = m_voxelProbabilities.at(i);
-                float pzv = m_voxelProbabilitiesInView.at(i);
-                float pvz = m_viewProbability * pzv / pz;
-                if (pvz > 0.0f)
+                float pv = m_viewProbabilities.at(v);
+                if (pv == 0.0f)
                 {
-                    if (m_computeHVz)
-                    {
-                        m_HVz[i] -= pvz * MathTools::logTwo(pvz);
-                    }
-                    if (m_computeVomi)
-                    {
-                        m_vomi[i] += pvz * MathTools::logTwo(pvz / m_viewProbability);
-                    }
-                    if (m_computeColorVomi)
+                    continue;
+                }
+
+                Vector3Float color = m_computeColorVomi ? Vector3Float(1.0f, 1.0f, 1.0f) - m_viewpointColors.at(v) : Vector3Float();
+
+                for (VoxelProbabilitiesPerViewStore::BlockIterator it(m_voxelProbabilitiesPerView, v, m_start, m_end); !it.atEnd(); it.next())
+                {
+                    const float *voxelProbabilitiesInView = it.block();
+                    int blockStart = it.blockStart();
+                    int blockSize = it.blockSize();
+
+                    for (int j = 0; j < blockSize; j++)
                     {
-                        m_colorVomi[i] += pvz * MathTools::logTwo(pvz / m_viewProbability) * color;
+                        int i = blockStart + j;
+                        float pz = m_voxelProbabilities.at(i);
+                        float pzv = voxelProbabilitiesInView[j];
+                        float pvz = pv * pzv / pz;
+                        if (pvz > 0.0f)
+                        {
+                            if (m_computeHVz)
+                            {
+                                m_HVz[i] -= pvz * MathTools::logTwo(pvz);
+                            }
+                            if (m_computeVomi)
+                            {
+                                m_vomi[i] += pvz * MathTools::logTwo(pvz / pv);
+                            }
+                            if (m_computeColorVomi)
+                            {
+                                m_colorVomi[i] += pvz * MathTools::logTwo(pvz / pv) * color;
+                            }
+                        }
                     }
                 }
             }
         }
     private:
-        float m_viewProbability;
+        const VoxelProbabilitiesPerViewStore &m_voxelProbabilitiesPerView;
+        const QVector<float> &m_viewProbabilities;
         const QVector<float> &m_voxelProbabilities;
-        QVector<float> m_voxelProbabilitiesInView;
         bool m_computeHVz;
         QVector<float> &m_HVz;
         bool m_computeVomi;
         QVector<float> &m_vomi;
         bool m_computeColorVomi;
-        Vector3Float m_viewColor;
+        const QVector<Vector3Float> &m_viewpointColors;
         QVector<Vector3Float> &m_colorVomi;
         int m_start, m_end;
+        int m_firstView, m_endView;
     };
 
     int nViewpoints = m_viewpoints.size();
@@ -1507,7 +1591,8 @@ void ViewpointInformationChannel::computeVomiCpu(bool computeHVz, bool computeVo
 
     for (int k = 0; k < nThreads; k++)
     {
-        vomiThreads[k] = new VomiThread(m_voxelProbabilities, computeHVz, m_HVz, computeVomi, m_vomi, computeColorVomi, m_colorVomi, start, end);
+        vomiThreads[k] = new VomiThread(*m_voxelProbabilitiesPerView, m_viewProbabilities, m_voxelProbabilities, computeHVz, m_HVz, computeVomi, m_vomi,
+                                        computeColorVomi, m_viewpointColors, m_colorVomi, start, end);
         start += nVoxelsPerThread;
         end += nVoxelsPerThread;
         if (end > nVoxels)
@@ -1516,23 +1601,16 @@ void ViewpointInformationChannel::computeVomiCpu(bool computeHVz, bool computeVo
         }
     }
 
-    for (int i = 0; i < nViewpoints; i++)
-    {
-        float pv = m_viewProbabilities.at(i);
-        if (pv == 0.0f)
-        {
-            continue;
-        }
+    // Views are processed in batches only to report the progress
+    const int ViewsPerBatch = 8;
 
-        QVector<float> voxelProbabilitiesInView = this->voxelProbabilitiesInView(i);
+    for (int firstView = 0; firstView < nViewpoints; firstView += ViewsPerBatch)
+    {
+        int endView = qMin(firstView + ViewsPerBatch, nViewpoints);
 
         for (int k = 0; k < nThreads; k++)
         {
-            vomiThreads[k]->setViewData(m_viewProbabilities.at(i), voxelProbabilitiesInView);
-            if (computeColorVomi)
-            {
-                vomiThreads[k]->setViewColor(m_viewpointColors.at(i));
-            }
+            vomiThreads[k]->setViews(firstView, endView);
             vomiThreads[k]->start();
         }
 
@@ -1541,7 +1619,7 @@ void ViewpointInformationChannel::computeVomiCpu(bool computeHVz, bool computeVo
             vomiThreads[k]->wait();
         }
 
-        emit partialProgress(100 * (i + 1) / nViewpoints);
+        emit partialProgress(100 * endView / nViewpoints);
         QCoreApplication::processEvents();  // necessari perquè el procés vagi fluid
     }
 
@@ -9,15 +9,15 @@
 #include <QColor>
 #include <QPair>
 
-#ifndef CUDA_AVAILABLE
-class QTemporaryFile;
-#endif
-
 namespace udg {
 
 class Experimental3DVolume;
 class QExperimental3DViewer;
 
+#ifndef CUDA_AVAILABLE
+class VoxelProbabilitiesPerViewStore;
+#endif
+
 #ifdef CUDA_AVAILABLE
 class Matrix4;
 #endif
@@ -93,9 +93,9 @@ private:
                     bool computeHZV, bool computeVmi, bool computeVmi2, bool computeVmi3, bool computeMi, bool computeViewpointUnstabilities, bool computeVomi,
                     bool computeVomi2, bool computeVomi3, bool computeViewpointVomi, bool computeViewpointVomi2, bool computeColorVomi, bool computeEvmiOpacity,
                     bool computeEvmiVomi, bool computeBestViews, bool computeGuidedTour, bool computeExploratoryTour);
-    void createVoxelProbabilitiesPerViewFiles();
+    void createVoxelProbabilitiesPerViewStore();
     QVector<float> voxelProbabilitiesInViewCpu(int i);
-    void deleteVoxelProbabilitiesPerViewFiles();
+    void deleteVoxelProbabilitiesPerViewStore();
     float rayCastingCpu(bool computeViewProbabilities);
     void computeViewProbabilitiesAndEntropyCpu(float totalViewedVolume, bool computeHV);
     void computeVoxelProbabilitiesAndEntropyCpu(bool computeHZ);
@@ -137,7 +137,7 @@ private:
     QVector<Vector3> m_viewpoints;
 
 #ifndef CUDA_AVAILABLE
-    QVector<QTemporaryFile*> m_voxelProbabilitiesPerViewFiles;  // p(Z|V)
+    VoxelProbabilitiesPerViewStore *m_voxelProbabilitiesPerView;    // p(Z|V)
 #endif
 
     QVector<float> m_viewedVolume;          // volum vist des de cada vista
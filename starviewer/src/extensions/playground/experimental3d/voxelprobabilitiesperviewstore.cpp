@@ -0,0 +1,404 @@
+#include "voxelprobabilitiesperviewstore.h"
+
+#include "logging.h"
+
+#include <QDir>
+#include <QMutexLocker>
+#include <QTemporaryFile>
+
+#include <cstring>
+
+namespace udg {
+
+const qint64 VoxelProbabilitiesPerViewStore::MaximumChunkSize = Q_INT64_C(256) * 1024 * 1024;
+const int VoxelProbabilitiesPerViewStore::MaximumNumberOfUnusedMappedChunks = 4;
+const int VoxelProbabilitiesPerViewStore::BlockSize = 16384;
+const float VoxelProbabilitiesPerViewStore::HalfPrecisionMaximum = 32768.0f;
+
+VoxelProbabilitiesPerViewStore::VoxelProbabilitiesPerViewStore(int numberOfViews, int numberOfVoxels, const QString &directory, bool halfPrecision)
+    : VoxelProbabilitiesPerViewStore(numberOfViews, numberOfVoxels, directory, halfPrecision, MaximumChunkSize)
+{
+}
+
+VoxelProbabilitiesPerViewStore::VoxelProbabilitiesPerViewStore(int numberOfViews, int numberOfVoxels, const QString &directory, bool halfPrecision,
+                                                               qint64 maximumChunkSize)
+    : m_numberOfViews(numberOfViews), m_numberOfVoxels(numberOfVoxels), m_halfPrecision(halfPrecision), m_file(0), m_useCounter(0)
+{
+    m_bytesPerView = static_cast<qint64>(m_numberOfVoxels) * (m_halfPrecision ? sizeof(unsigned short) : sizeof(float));
+    m_viewsPerChunk = qMax(1, static_cast<int>(maximumChunkSize / qMax(m_bytesPerView, Q_INT64_C(1))));
+    Chunk unmappedChunk = { 0, 0, 0 };
+    m_chunks.fill(unmappedChunk, (m_numberOfViews + m_viewsPerChunk - 1) / m_viewsPerChunk);
+    m_inverseScales.fill(1.0f, m_numberOfViews);
+
+    m_file = new QTemporaryFile(QDir(directory).filePath("pZVXXXXXX.tmp"));
+
+    if (!m_file->open())
+    {
+        m_errorString = m_file->errorString();
+        delete m_file;
+        m_file = 0;
+        return;
+    }
+
+    // The file is sparse until the views are written, so this doesn't need the whole size on disk yet
+    if (!m_file->resize(m_bytesPerView * m_numberOfViews))
+    {
+        m_errorString = m_file->errorString();
+        delete m_file;
+        m_file = 0;
+        return;
+    }
+
+    DEBUG_LOG(QString("p(Z|V) store: %1 views x %2 voxels in %3 (%4 MB, %5)").arg(m_numberOfViews).arg(m_numberOfVoxels).arg(m_file->fileName())
+              .arg(m_bytesPerView * m_numberOfViews / (1024 * 1024)).arg(m_halfPrecision ? "fp16" : "fp32"));
+}
+
+VoxelProbabilitiesPerViewStore::~VoxelProbabilitiesPerViewStore()
+{
+    if (m_file)
+    {
+        foreach (const Chunk &chunk, m_chunks)
+        {
+            if (chunk.data)
+            {
+                m_file->unmap(chunk.data);
+            }
+        }
+
+        m_file->close();
+        delete m_file;
+    }
+}
+
+bool VoxelProbabilitiesPerViewStore::isValid() const
+{
+    return m_file != 0;
+}
+
+QString VoxelProbabilitiesPerViewStore::errorString() const
+{
+    return m_errorString;
+}
+
+int VoxelProbabilitiesPerViewStore::numberOfViews() const
+{
+    return m_numberOfViews;
+}
+
+int VoxelProbabilitiesPerViewStore::numberOfVoxels() const
+{
+    return m_numberOfVoxels;
+}
+
+bool VoxelProbabilitiesPerViewStore::isHalfPrecision() const
+{
+    return m_halfPrecision;
+}
+
+bool VoxelProbabilitiesPerViewStore::setView(int view, const QVector<float> &voxelProbabilities)
+{
+    Q_ASSERT(voxelProbabilities.size() == m_numberOfVoxels);
+
+    unsigned char *data = acquireView(view);
+
+    if (!data)
+    {
+        return false;
+    }
+
+    if (!m_halfPrecision)
+    {
+        memcpy(data, voxelProbabilities.constData(), m_bytesPerView);
+        releaseView(view);
+        return true;
+    }
+
+    float maximum = 0.0f;
+    for (int i = 0; i < m_numberOfVoxels; i++)
+    {
+        maximum = qMax(maximum, voxelProbabilities.at(i));
+    }
+
+    float scale = maximum > 0.0f ? HalfPrecisionMaximum / maximum : 1.0f;
+    m_inverseScales[view] = 1.0f / scale;
+
+    unsigned short *halfData = reinterpret_cast<unsigned short*>(data);
+    for (int i = 0; i < m_numberOfVoxels; i++)
+    {
+        halfData[i] = floatToHalf(voxelProbabilities.at(i) * scale);
+    }
+
+    releaseView(view);
+
+    return true;
+}
+
+QVector<float> VoxelProbabilitiesPerViewStore::view(int view) const
+{
+    QVector<float> voxelProbabilities(m_numberOfVoxels);
+    const unsigned char *data = acquireView(view);
+
+    if (!data)
+    {
+        voxelProbabilities.fill(0.0f);
+        return voxelProbabilities;
+    }
+    else if (!m_halfPrecision)
+    {
+        memcpy(voxelProbabilities.data(), data, m_bytesPerView);
+    }
+    else
+    {
+        const unsigned short *halfData = reinterpret_cast<const unsigned short*>(data);
+        float inverseScale = m_inverseScales.at(view);
+        for (int i = 0; i < m_numberOfVoxels; i++)
+        {
+            voxelProbabilities[i] = halfToFloat(halfData[i]) * inverseScale;
+        }
+    }
+
+    releaseView(view);
+
+    return voxelProbabilities;
+}
+
+unsigned char* VoxelProbabilitiesPerViewStore::acquireView(int view) const
+{
+    Q_ASSERT(view >= 0 && view < m_numberOfViews);
+
+    if (!m_file)
+    {
+        return 0;
+    }
+
+    int chunkIndex = view / m_viewsPerChunk;
+
+    QMutexLocker locker(&m_chunksMutex);
+    Chunk &chunk = m_chunks[chunkIndex];
+
+    if (!chunk.data)
+    {
+        int firstView = chunkIndex * m_viewsPerChunk;
+        int nViews = qMin(m_viewsPerChunk, m_numberOfViews - firstView);
+        chunk.data = m_file->map(firstView * m_bytesPerView, nViews * m_bytesPerView);
+
+        if (!chunk.data)
+        {
+            ERROR_LOG(QString("Could not map the p(Z|V) file: %1").arg(m_file->errorString()));
+            return 0;
+        }
+    }
+
+    chunk.users++;
+
+    return chunk.data + (view % m_viewsPerChunk) * m_bytesPerView;
+}
+
+void VoxelProbabilitiesPerViewStore::releaseView(int view) const
+{
+    QMutexLocker locker(&m_chunksMutex);
+    Chunk &chunk = m_chunks[view / m_viewsPerChunk];
+
+    Q_ASSERT(chunk.users > 0);
+    chunk.users--;
+    chunk.lastUse = ++m_useCounter;
+
+    if (chunk.users == 0)
+    {
+        unmapLeastRecentlyUsedChunks();
+    }
+}
+
+void VoxelProbabilitiesPerViewStore::unmapLeastRecentlyUsedChunks() const
+{
+    while (true)
+    {
+        int numberOfUnusedMappedChunks = 0;
+        int leastRecentlyUsedChunk = -1;
+
+        for (int i = 0; i < m_chunks.size(); i++)
+        {
+            const Chunk &chunk = m_chunks.at(i);
+
+            if (chunk.data && chunk.users == 0)
+            {
+                numberOfUnusedMappedChunks++;
+
+                if (leastRecentlyUsedChunk < 0 || chunk.lastUse < m_chunks.at(leastRecentlyUsedChunk).lastUse)
+                {
+                    leastRecentlyUsedChunk = i;
+                }
+            }
+        }
+
+        if (numberOfUnusedMappedChunks <= MaximumNumberOfUnusedMappedChunks)
+        {
+            return;
+        }
+
+        m_file->unmap(m_chunks[leastRecentlyUsedChunk].data);
+        m_chunks[leastRecentlyUsedChunk].data = 0;
+    }
+}
+
+unsigned short VoxelProbabilitiesPerViewStore::floatToHalf(float value)
+{
+    quint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    unsigned short sign = (bits >> 16) & 0x8000;
+    int exponent = static_cast<int>((bits >> 23) & 0xff) - 127 + 15;
+    quint32 mantissa = bits & 0x7fffff;
+
+    if (((bits >> 23) & 0xff) == 0xff)
+    {
+        // Infinity or NaN
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    }
+    if (exponent >= 31)
+    {
+        return sign | 0x7c00;
+    }
+    if (exponent <= 0)
+    {
+        // Subnormal or zero
+        if (exponent < -10)
+        {
+            return sign;
+        }
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        quint32 half = mantissa >> shift;
+        quint32 remainder = mantissa & ((1u << shift) - 1);
+        quint32 halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1)))
+        {
+            half++;
+        }
+        return static_cast<unsigned short>(sign | half);
+    }
+
+    // Round to nearest even; a carry into the exponent gives the right result
+    quint32 half = (static_cast<quint32>(exponent) << 10) | (mantissa >> 13);
+    quint32 remainder = mantissa & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+    {
+        half++;
+    }
+    return static_cast<unsigned short>(sign | half);
+}
+
+float VoxelProbabilitiesPerViewStore::halfToFloat(unsigned short value)
+{
+    quint32 sign = static_cast<quint32>(value & 0x8000) << 16;
+    quint32 exponent = (value >> 10) & 0x1f;
+    quint32 mantissa = value & 0x3ff;
+    quint32 bits;
+
+    if (exponent == 0)
+    {
+        if (mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // Subnormal: normalise it
+            exponent = 127 - 15 + 1;
+            while (!(mantissa & 0x400))
+            {
+                mantissa <<= 1;
+                exponent--;
+            }
+            mantissa &= 0x3ff;
+            bits = sign | (exponent << 23) | (mantissa << 13);
+        }
+    }
+    else if (exponent == 31)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+VoxelProbabilitiesPerViewStore::BlockIterator::BlockIterator(const VoxelProbabilitiesPerViewStore &store, int view, int start, int end)
+    : m_store(store), m_view(view), m_viewData(store.acquireView(view)), m_scale(store.m_inverseScales.at(view)), m_start(start), m_end(end), m_blockStart(start),
+      m_blockSize(0), m_block(0)
+{
+    if (!m_viewData)
+    {
+        m_blockStart = m_end;
+    }
+
+    load();
+}
+
+VoxelProbabilitiesPerViewStore::BlockIterator::~BlockIterator()
+{
+    if (m_viewData)
+    {
+        m_store.releaseView(m_view);
+    }
+}
+
+bool VoxelProbabilitiesPerViewStore::BlockIterator::atEnd() const
+{
+    return m_blockStart >= m_end;
+}
+
+void VoxelProbabilitiesPerViewStore::BlockIterator::next()
+{
+    m_blockStart += m_blockSize;
+    load();
+}
+
+int VoxelProbabilitiesPerViewStore::BlockIterator::blockStart() const
+{
+    return m_blockStart;
+}
+
+int VoxelProbabilitiesPerViewStore::BlockIterator::blockSize() const
+{
+    return m_blockSize;
+}
+
+const float* VoxelProbabilitiesPerViewStore::BlockIterator::block() const
+{
+    return m_block;
+}
+
+void VoxelProbabilitiesPerViewStore::BlockIterator::load()
+{
+    if (atEnd())
+    {
+        m_blockSize = 0;
+        m_block = 0;
+        return;
+    }
+
+    m_blockSize = qMin(BlockSize, m_end - m_blockStart);
+
+    if (!m_store.m_halfPrecision)
+    {
+        // In single precision the blocks point directly to the mapped file
+        m_block = reinterpret_cast<const float*>(m_viewData) + m_blockStart;
+        return;
+    }
+
+    m_buffer.resize(m_blockSize);
+    const unsigned short *halfData = reinterpret_cast<const unsigned short*>(m_viewData) + m_blockStart;
+    for (int i = 0; i < m_blockSize; i++)
+    {
+        m_buffer[i] = halfToFloat(halfData[i]) * m_scale;
+    }
+    m_block = m_buffer.constData();
+}
+
+} // namespace udg
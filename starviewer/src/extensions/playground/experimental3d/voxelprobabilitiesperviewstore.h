@@ -0,0 +1,140 @@
+#ifndef UDGVOXELPROBABILITIESPERVIEWSTORE_H
+#define UDGVOXELPROBABILITIESPERVIEWSTORE_H
+
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+class QTemporaryFile;
+
+namespace udg {
+
+/**
+    Out-of-core storage of the probabilities p(Z|V) of all the viewpoints.
+
+    All the views are kept in a single temporary file in a scratch directory, one contiguous record per view. The file is memory-mapped in chunks of
+    whole views when they are used, so reading a view does not go through QFile buffers and the operating system can page it in and out as needed.
+    Chunks stay mapped while they are used and a few more are kept in LRU order, so that the mapped size is bounded however many views there are.
+    Optionally the probabilities are stored as half-precision floats, scaled per view so that the maximum of each view uses the whole fp16 range.
+
+    After all the views have been written the store can be read from several threads at the same time, either whole views with view() or in blocks
+    with a BlockIterator.
+ */
+class VoxelProbabilitiesPerViewStore {
+
+public:
+
+    /// Creates the store for \p numberOfViews views of \p numberOfVoxels voxels in \p directory. If \p halfPrecision is true the probabilities
+    /// are stored as fp16. Check isValid() before using it.
+    VoxelProbabilitiesPerViewStore(int numberOfViews, int numberOfVoxels, const QString &directory, bool halfPrecision = false);
+    ~VoxelProbabilitiesPerViewStore();
+
+    /// Returns true if the backing file has been created successfully.
+    bool isValid() const;
+    /// Returns the description of the last error.
+    QString errorString() const;
+
+    int numberOfViews() const;
+    int numberOfVoxels() const;
+    bool isHalfPrecision() const;
+
+    /// Stores the probabilities of the view \p view. Returns false if they can't be written.
+    bool setView(int view, const QVector<float> &voxelProbabilities);
+    /// Returns a copy of the probabilities of the view \p view.
+    QVector<float> view(int view) const;
+
+    /// Iterates over the probabilities of the voxels [start, end) of a view in consecutive blocks, reading directly from the mapped file.
+    /// Each iterator has its own conversion buffer, so several threads can iterate over the same store at the same time.
+    class BlockIterator {
+    public:
+        BlockIterator(const VoxelProbabilitiesPerViewStore &store, int view, int start, int end);
+        ~BlockIterator();
+
+        /// Returns true when all the blocks have been visited.
+        bool atEnd() const;
+        /// Advances to the next block.
+        void next();
+
+        /// Index of the first voxel of the current block.
+        int blockStart() const;
+        /// Number of voxels of the current block.
+        int blockSize() const;
+        /// Probabilities of the current block.
+        const float* block() const;
+
+    private:
+        void load();
+
+    private:
+        Q_DISABLE_COPY(BlockIterator)
+
+        const VoxelProbabilitiesPerViewStore &m_store;
+        int m_view;
+        const unsigned char *m_viewData;
+        float m_scale;
+        int m_start, m_end;
+        int m_blockStart, m_blockSize;
+        const float *m_block;
+        QVector<float> m_buffer;
+    };
+
+protected:
+    /// Creates the store like the public constructor but mapping the file in chunks of at most \p maximumChunkSize bytes.
+    VoxelProbabilitiesPerViewStore(int numberOfViews, int numberOfVoxels, const QString &directory, bool halfPrecision, qint64 maximumChunkSize);
+
+    /// Number of voxels of each block returned by a BlockIterator.
+    static const int BlockSize;
+
+private:
+    /// Returns the mapped record of the view \p view, mapping its chunk if it is not mapped yet, and keeps the chunk mapped until releaseView() is
+    /// called. Returns null if it can't be mapped, in which case releaseView() must not be called.
+    unsigned char* acquireView(int view) const;
+    /// Tells that the record of the view \p view returned by acquireView() is no longer used.
+    void releaseView(int view) const;
+    /// Unmaps the least recently used chunks that are not being used until there are at most MaximumNumberOfUnusedMappedChunks. Must be called with
+    /// the chunks mutex locked.
+    void unmapLeastRecentlyUsedChunks() const;
+
+    static unsigned short floatToHalf(float value);
+    static float halfToFloat(unsigned short value);
+
+private:
+    /// Maximum size of each mapped region.
+    static const qint64 MaximumChunkSize;
+    /// Maximum number of chunks that are kept mapped when they are not being used.
+    static const int MaximumNumberOfUnusedMappedChunks;
+    /// Value to which the maximum of each view is scaled when using half precision.
+    static const float HalfPrecisionMaximum;
+
+    int m_numberOfViews;
+    int m_numberOfVoxels;
+    bool m_halfPrecision;
+    qint64 m_bytesPerView;
+    int m_viewsPerChunk;
+
+    QTemporaryFile *m_file;
+    QString m_errorString;
+
+    /// A region of the file with whole views.
+    struct Chunk
+    {
+        /// Mapped memory, null if it's not mapped.
+        unsigned char *data;
+        /// Number of acquired views from this chunk that have not been released yet.
+        int users;
+        /// Value of the use counter when it was last released, to find the least recently used one.
+        qint64 lastUse;
+    };
+
+    mutable QVector<Chunk> m_chunks;
+    /// Incremented each time a view is released.
+    mutable qint64 m_useCounter;
+    mutable QMutex m_chunksMutex;
+    /// Inverse of the scale of each view when using half precision.
+    QVector<float> m_inverseScales;
+
+};
+
+} // namespace udg
+
+#endif // UDGVOXELPROBABILITIESPERVIEWSTORE_H
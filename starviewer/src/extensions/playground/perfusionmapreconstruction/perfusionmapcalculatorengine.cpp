@@ -0,0 +1,517 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2007 by Grup de Gràfics de Girona                  *
+ *   http://iiia.udg.es/GGG/index.html?langu=uk                            *
+ *                                                                         *
+ *   Universitat de Girona                                                 *
+ ***************************************************************************/
+
+#include "perfusionmapcalculatorengine.h"
+
+#include "logging.h"
+#include "mathtools.h" // pel PI
+
+// Qt
+#include <QtConcurrentMap>
+// ITK
+#include <vnl/algo/vnl_fft_1d.h>
+#include <vnl/vnl_vector.h>
+
+#include <cmath>
+
+namespace udg {
+
+const double PerfusionMapCalculatorEngine::TE = 25.0;
+const double PerfusionMapCalculatorEngine::TR = 1.5;
+const int PerfusionMapCalculatorEngine::BaselineStart = 1;
+const int PerfusionMapCalculatorEngine::BaselineEnd = 10;
+const int PerfusionMapCalculatorEngine::VoxelsPerBlock = 1024;
+
+PerfusionMapCalculatorEngine::PerfusionMapCalculatorEngine(QObject *parent)
+ : QObject(parent), m_sizeX(0), m_sizeY(0), m_sizeZ(0), m_sizeT(0), m_rowsPerBlock(1), m_blocksPerSlice(0), m_m0Aif(0.0), m_regularizationFactor(1.0),
+   m_regularizationExponent(2.0), m_cancelled(0)
+{
+}
+
+PerfusionMapCalculatorEngine::~PerfusionMapCalculatorEngine()
+{
+}
+
+void PerfusionMapCalculatorEngine::setDSCImage(ImageType::Pointer image, int sizeX, int sizeY, int sizeZ, int sizeT)
+{
+    m_DSCImage = image;
+    m_sizeX = sizeX;
+    m_sizeY = sizeY;
+    m_sizeZ = sizeZ;
+    m_sizeT = sizeT;
+
+    m_rowsPerBlock = qBound(1, VoxelsPerBlock / qMax(m_sizeX, 1), qMax(m_sizeY, 1));
+    m_blocksPerSlice = (m_sizeY + m_rowsPerBlock - 1) / m_rowsPerBlock;
+
+    m_blocks.resize(m_blocksPerSlice * m_sizeZ);
+    for (int i = 0; i < m_blocks.size(); i++)
+    {
+        m_blocks[i] = i;
+    }
+}
+
+bool PerfusionMapCalculatorEngine::computeDeltaRAndMoments(BoolImageType::Pointer checkImage, DoubleTemporalImageType::Pointer deltaRImage,
+                                                           DoubleImageType::Pointer m0Image, DoubleImageType::Pointer m1Image,
+                                                           DoubleImageType::Pointer m2Image, QVector<QVector<double> > &meanDeltaRPerSlice)
+{
+    Q_ASSERT(m_DSCImage);
+
+    if (m_sizeT < BaselineEnd)
+    {
+        ERROR_LOG(QString("The series only has %1 phases and at least %2 are needed for the baseline").arg(m_sizeT).arg(BaselineEnd));
+        return false;
+    }
+
+    m_checkImage = checkImage;
+    m_deltaRImage = deltaRImage;
+    m_m0Image = m0Image;
+    m_m1Image = m1Image;
+    m_m2Image = m2Image;
+    m_blockDeltaRSums = QVector<QVector<double> >(m_blocks.size());
+    m_blockValidVoxels = QVector<int>(m_blocks.size(), 0);
+
+    bool finished = runBlocks(&PerfusionMapCalculatorEngine::computeDeltaRAndMomentsBlock, 0, 50);
+
+    if (finished)
+    {
+        meanDeltaRPerSlice = QVector<QVector<double> >(m_sizeZ, QVector<double>(m_sizeT, 0.0));
+        QVector<int> validVoxelsPerSlice(m_sizeZ, 0);
+
+        for (int block = 0; block < m_blocks.size(); block++)
+        {
+            int slice = block / m_blocksPerSlice;
+            validVoxelsPerSlice[slice] += m_blockValidVoxels.at(block);
+            for (int t = 0; t < m_sizeT; t++)
+            {
+                meanDeltaRPerSlice[slice][t] += m_blockDeltaRSums.at(block).at(t);
+            }
+        }
+
+        for (int k = 0; k < m_sizeZ; k++)
+        {
+            for (int t = 0; t < m_sizeT; t++)
+            {
+                meanDeltaRPerSlice[k][t] /= static_cast<double>(validVoxelsPerSlice.at(k));
+            }
+        }
+    }
+
+    m_blockDeltaRSums.clear();
+    m_blockValidVoxels.clear();
+
+    return finished;
+}
+
+bool PerfusionMapCalculatorEngine::setAIF(const QVector<double> &aif, double m0Aif)
+{
+    typedef std::complex<double> complexd;
+
+    int size = aif.size();
+    m_m0Aif = m0Aif;
+    m_deconvolutionFilter.clear();
+
+    if (!isValidFFTSize(size))
+    {
+        ERROR_LOG(QString("Can't compute the FFT of a curve with %1 phases").arg(size));
+        return false;
+    }
+
+    // AIF spectrum
+    vnl_fft_1d<double> fft(size);
+    vnl_vector<complexd> aifSpectrum(size);
+    for (int t = 0; t < size; t++)
+    {
+        aifSpectrum[t] = complexd(aif.at(t), 0.0);
+    }
+    fft.fwd_transform(aifSpectrum);
+
+    // Omega axis for dt = 1
+    QVector<double> omega(size);
+    int index = static_cast<int>(ceil(size / 2.0)) + 1;
+    for (int i = 0; i < index && i < size; i++)
+    {
+        omega[i] = static_cast<double>(i) / static_cast<double>(index - 1) * MathTools::PiNumber;
+    }
+    for (int i = index; i < size; i++)
+    {
+        omega[i] = -static_cast<double>(size - i) / static_cast<double>(index - 1) * MathTools::PiNumber;
+    }
+
+    // The regularized inverse of the AIF spectrum is the same for all the voxels, so it's computed only once
+    m_deconvolutionFilter.resize(size);
+    for (int i = 0; i < size; i++)
+    {
+        complexd aifValue = aifSpectrum[i];
+
+        if ((m_regularizationFactor > 1e-6) || ((fabs(aifValue.real()) + fabs(aifValue.imag())) > 1e-6))
+        {
+            m_deconvolutionFilter[i] = conj(aifValue) / (aifValue * conj(aifValue) + m_regularizationFactor * pow(-1, m_regularizationExponent)
+                                                         * pow(omega.at(i), 2 * m_regularizationExponent));
+        }
+        else
+        {
+            m_deconvolutionFilter[i] = complexd(0.0, 0.0);
+        }
+    }
+
+    return true;
+}
+
+bool PerfusionMapCalculatorEngine::computePerfusion(BoolImageType::Pointer checkImage, DoubleTemporalImageType::Pointer deltaRImage,
+                                                    DoubleImageType::Pointer m0Image, DoubleImageType::Pointer cbvImage, DoubleImageType::Pointer cbfImage,
+                                                    DoubleImageType::Pointer mttImage, ImageType::Pointer cbvMapImage, ImageType::Pointer cbfMapImage,
+                                                    ImageType::Pointer mttMapImage)
+{
+    if (m_deconvolutionFilter.size() != m_sizeT)
+    {
+        ERROR_LOG("No valid AIF has been set for the series");
+        return false;
+    }
+
+    m_checkImage = checkImage;
+    m_deltaRImage = deltaRImage;
+    m_m0Image = m0Image;
+    m_cbvImage = cbvImage;
+    m_cbfImage = cbfImage;
+    m_mttImage = mttImage;
+    m_cbvMapImage = cbvMapImage;
+    m_cbfMapImage = cbfMapImage;
+    m_mttMapImage = mttMapImage;
+
+    return runBlocks(&PerfusionMapCalculatorEngine::computePerfusionBlock, 50, 100);
+}
+
+void PerfusionMapCalculatorEngine::computeMoments(const QVector<double> &curve, double &m0, double &m1, double &m2)
+{
+    int size = curve.size();
+    m0 = 0.0;
+    m1 = 0.0;
+    m2 = 0.0;
+
+    for (int t = 0; t < size; t++)
+    {
+        m0 += curve[t];
+        m1 += t * curve[t];
+    }
+    if (m1 > 0 && m1 < m0 * static_cast<double>(size))
+    {
+        m1 = m1 / m0;
+    }
+    else
+    {
+        m1 = 0;
+    }
+
+    for (int t = 0; t < size; t++)
+    {
+        m2 += (t - m1) * (t - m1) * curve[t];
+    }
+    if (m2 > 0)
+    {
+        m2 = sqrt(m2 / m0);
+    }
+    else
+    {
+        m2 = 0;
+    }
+    if (m2 > static_cast<double>(size) / 2.0)
+    {
+        m2 = 0;
+    }
+}
+
+void PerfusionMapCalculatorEngine::cancel()
+{
+    m_cancelled.store(1);
+}
+
+void PerfusionMapCalculatorEngine::clearCancel()
+{
+    m_cancelled.store(0);
+}
+
+bool PerfusionMapCalculatorEngine::runBlocks(BlockFunction function, int firstPercent, int lastPercent)
+{
+    int numberOfBlocks = m_blocks.size();
+    QAtomicInt numberOfProcessedBlocks(0);
+
+    // The progress is emitted by the blocks themselves, so the calling thread just waits without polling
+    QtConcurrent::blockingMap(m_blocks, [&](int block)
+    {
+        // Once cancelled the block functions return immediately
+        (this->*function)(block);
+
+        int processedBlocks = numberOfProcessedBlocks.fetchAndAddOrdered(1) + 1;
+        int percent = firstPercent + (lastPercent - firstPercent) * processedBlocks / numberOfBlocks;
+
+        // Only when the percentage changes, so that not every block posts an event
+        if (percent != firstPercent + (lastPercent - firstPercent) * (processedBlocks - 1) / numberOfBlocks)
+        {
+            emit progress(percent);
+        }
+    });
+
+    if (m_cancelled.load())
+    {
+        DEBUG_LOG("Perfusion computation cancelled");
+        return false;
+    }
+
+    emit progress(lastPercent);
+    return true;
+}
+
+void PerfusionMapCalculatorEngine::getBlock(int block, int &slice, int &firstVoxel, int &numberOfVoxels) const
+{
+    slice = block / m_blocksPerSlice;
+    int firstRow = (block % m_blocksPerSlice) * m_rowsPerBlock;
+    int numberOfRows = qMin(m_rowsPerBlock, m_sizeY - firstRow);
+    firstVoxel = firstRow * m_sizeX;
+    numberOfVoxels = numberOfRows * m_sizeX;
+}
+
+void PerfusionMapCalculatorEngine::computeDeltaRAndMomentsBlock(int block)
+{
+    if (m_cancelled.load())
+    {
+        return;
+    }
+
+    int slice, firstVoxel, n;
+    getBlock(block, slice, firstVoxel, n);
+
+    int sliceSize = m_sizeX * m_sizeY;
+    int tend = m_sizeT;
+    // In the DSC image the phases of each slice are consecutive, so each phase of the block is a contiguous row of n voxels
+    const ImageType::PixelType *dsc = m_DSCImage->GetBufferPointer() + static_cast<qint64>(slice) * tend * sliceSize + firstVoxel;
+
+    // Baseline and valid voxels
+    QVector<double> minimum(n, 10e6), meanBaseline(n, 0.0), deviationBaseline(n, 0.0);
+    for (int t = 0; t < tend; t++)
+    {
+        const ImageType::PixelType *phase = dsc + static_cast<qint64>(t) * sliceSize;
+        for (int v = 0; v < n; v++)
+        {
+            minimum[v] = qMin(minimum[v], static_cast<double>(phase[v]));
+        }
+    }
+    for (int t = BaselineStart; t < BaselineEnd; t++)
+    {
+        const ImageType::PixelType *phase = dsc + static_cast<qint64>(t) * sliceSize;
+        for (int v = 0; v < n; v++)
+        {
+            meanBaseline[v] += phase[v];
+        }
+    }
+    for (int v = 0; v < n; v++)
+    {
+        meanBaseline[v] /= static_cast<double>(BaselineEnd - BaselineStart);
+    }
+    for (int t = BaselineStart; t < BaselineEnd; t++)
+    {
+        const ImageType::PixelType *phase = dsc + static_cast<qint64>(t) * sliceSize;
+        for (int v = 0; v < n; v++)
+        {
+            double difference = phase[v] - meanBaseline[v];
+            deviationBaseline[v] += difference * difference;
+        }
+    }
+
+    bool *check = m_checkImage->GetBufferPointer() + static_cast<qint64>(slice) * sliceSize + firstVoxel;
+    for (int v = 0; v < n; v++)
+    {
+        double deviation = sqrt(deviationBaseline[v] / static_cast<double>(BaselineEnd - BaselineStart - 1));
+        // SNR of 10 at least --> else the voxel is discarded
+        check[v] = (meanBaseline[v] > 10 * deviation) && (deviation > 0) && (minimum[v] > 3 * deviation);
+    }
+
+    // ΔR, phase by phase
+    QVector<double> deltaR(tend * n);
+    for (int t = 0; t < tend; t++)
+    {
+        const ImageType::PixelType *phase = dsc + static_cast<qint64>(t) * sliceSize;
+        double *deltaRPhase = deltaR.data() + t * n;
+        for (int v = 0; v < n; v++)
+        {
+            deltaRPhase[v] = check[v] ? -log(phase[v] / meanBaseline[v]) / TE : 0.0;
+        }
+    }
+
+    // Moments
+    QVector<double> m0(n, 0.0), m1(n, 0.0), m2(n, 0.0);
+    for (int t = 0; t < tend; t++)
+    {
+        const double *deltaRPhase = deltaR.constData() + t * n;
+        for (int v = 0; v < n; v++)
+        {
+            m0[v] += deltaRPhase[v];
+            m1[v] += t * deltaRPhase[v];
+        }
+    }
+    for (int v = 0; v < n; v++)
+    {
+        m1[v] = (m1[v] > 0 && m1[v] < m0[v] * static_cast<double>(tend)) ? m1[v] / m0[v] : 0.0;
+    }
+    for (int t = 0; t < tend; t++)
+    {
+        const double *deltaRPhase = deltaR.constData() + t * n;
+        for (int v = 0; v < n; v++)
+        {
+            m2[v] += (t - m1[v]) * (t - m1[v]) * deltaRPhase[v];
+        }
+    }
+
+    qint64 firstVoxelInVolume = static_cast<qint64>(slice) * sliceSize + firstVoxel;
+    double *m0Output = m_m0Image->GetBufferPointer() + firstVoxelInVolume;
+    double *m1Output = m_m1Image->GetBufferPointer() + firstVoxelInVolume;
+    double *m2Output = m_m2Image->GetBufferPointer() + firstVoxelInVolume;
+    for (int v = 0; v < n; v++)
+    {
+        double moment2 = m2[v] > 0 ? sqrt(m2[v] / m0[v]) : 0.0;
+        if (moment2 > static_cast<double>(tend) / 2.0)
+        {
+            moment2 = 0.0;
+        }
+
+        if (check[v] && m0[v] > 0.0)
+        {
+            m0Output[v] = m0[v];
+            m1Output[v] = m1[v];
+            m2Output[v] = moment2;
+        }
+        else
+        {
+            m0Output[v] = 0.0;
+            m1Output[v] = 0.0;
+            m2Output[v] = 0.0;
+        }
+    }
+
+    // The ΔR image keeps the phases of each voxel together
+    double *deltaROutput = m_deltaRImage->GetBufferPointer() + firstVoxelInVolume * tend;
+    QVector<double> deltaRSum(tend, 0.0);
+    int validVoxels = 0;
+    for (int v = 0; v < n; v++)
+    {
+        for (int t = 0; t < tend; t++)
+        {
+            deltaROutput[v * tend + t] = deltaR[t * n + v];
+        }
+        if (check[v])
+        {
+            validVoxels++;
+        }
+    }
+    for (int t = 0; t < tend; t++)
+    {
+        const double *deltaRPhase = deltaR.constData() + t * n;
+        for (int v = 0; v < n; v++)
+        {
+            deltaRSum[t] += deltaRPhase[v];
+        }
+    }
+
+    // Each block only writes its own entry
+    m_blockDeltaRSums[block] = deltaRSum;
+    m_blockValidVoxels[block] = validVoxels;
+}
+
+void PerfusionMapCalculatorEngine::computePerfusionBlock(int block)
+{
+    typedef std::complex<double> complexd;
+
+    if (m_cancelled.load())
+    {
+        return;
+    }
+
+    int slice, firstVoxel, n;
+    getBlock(block, slice, firstVoxel, n);
+
+    int tend = m_sizeT;
+    qint64 firstVoxelInVolume = static_cast<qint64>(slice) * m_sizeX * m_sizeY + firstVoxel;
+    const bool *check = m_checkImage->GetBufferPointer() + firstVoxelInVolume;
+    const double *deltaR = m_deltaRImage->GetBufferPointer() + firstVoxelInVolume * tend;
+    const double *m0 = m_m0Image->GetBufferPointer() + firstVoxelInVolume;
+    double *cbv = m_cbvImage->GetBufferPointer() + firstVoxelInVolume;
+    double *cbf = m_cbfImage->GetBufferPointer() + firstVoxelInVolume;
+    double *mtt = m_mttImage->GetBufferPointer() + firstVoxelInVolume;
+    ImageType::PixelType *cbvMap = m_cbvMapImage->GetBufferPointer() + firstVoxelInVolume;
+    ImageType::PixelType *cbfMap = m_cbfMapImage->GetBufferPointer() + firstVoxelInVolume;
+    ImageType::PixelType *mttMap = m_mttMapImage->GetBufferPointer() + firstVoxelInVolume;
+
+    // A single FFT plan and buffer for all the voxels of the block
+    vnl_fft_1d<double> fft(tend);
+    vnl_vector<complexd> signal(tend);
+    const complexd *filter = m_deconvolutionFilter.constData();
+
+    for (int v = 0; v < n; v++)
+    {
+        if (!check[v])
+        {
+            cbv[v] = 0.0;
+            cbf[v] = 0.0;
+            mtt[v] = 0.0;
+            cbvMap[v] = 0;
+            cbfMap[v] = 0;
+            mttMap[v] = 0;
+            continue;
+        }
+
+        const double *tissue = deltaR + static_cast<qint64>(v) * tend;
+        for (int t = 0; t < tend; t++)
+        {
+            signal[t] = complexd(tissue[t], 0.0);
+        }
+
+        fft.fwd_transform(signal);
+        for (int t = 0; t < tend; t++)
+        {
+            signal[t] *= filter[t];
+        }
+        fft.bwd_transform(signal);
+
+        // The inverse transform is not normalized
+        double max = signal[0].real();
+        for (int t = 1; t < tend; t++)
+        {
+            max = qMax(max, signal[t].real());
+        }
+        max /= tend;
+
+        double valueCbv = 100 * 0.7 * m0[v] / m_m0Aif; //in ml/100g --> Peter dixit!!
+        double valueCbf = max * 100 * 60 * 0.7 / TR; //ml/100g*min --> Peter dixit!!
+        double valueMtt = (60 * valueCbv) / valueCbf; // TR (in sec.)
+        cbv[v] = 10.0 * valueCbv;   //JUST FOR A GOOD VISUALIZATION!!!!!!
+        cbvMap[v] = static_cast<int>(10 * valueCbv);
+        cbf[v] = valueCbf;
+        cbfMap[v] = static_cast<int>(valueCbf);
+        mtt[v] = 10.0 * valueMtt;   //JUST FOR A GOOD VISUALIZATION!!!!!!
+        mttMap[v] = static_cast<int>(10 * valueMtt);
+    }
+}
+
+bool PerfusionMapCalculatorEngine::isValidFFTSize(int size)
+{
+    if (size <= 0)
+    {
+        return false;
+    }
+
+    const int Factors[] = { 2, 3, 5 };
+    for (int i = 0; i < 3; i++)
+    {
+        while (size % Factors[i] == 0)
+        {
+            size /= Factors[i];
+        }
+    }
+
+    return size == 1;
+}
+
+}
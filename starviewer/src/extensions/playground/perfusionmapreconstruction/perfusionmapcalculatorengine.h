@@ -0,0 +1,129 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2007 by Grup de Gràfics de Girona                  *
+ *   http://iiia.udg.es/GGG/index.html?langu=uk                            *
+ *                                                                         *
+ *   Universitat de Girona                                                 *
+ ***************************************************************************/
+
+#ifndef UDGPERFUSIONMAPCALCULATORENGINE_H
+#define UDGPERFUSIONMAPCALCULATORENGINE_H
+
+#include "volume.h"
+
+#include <itkImage.h>
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QVector>
+
+#include <complex>
+
+namespace udg {
+
+/**
+ * Computes the voxel-wise steps of the perfusion maps: the valid voxels, ΔR, its moments and the deconvolution with the AIF.
+ *
+ * The voxels are processed in blocks of consecutive rows of a slice on the global thread pool. Within a block the time curves are kept as
+ * structure of arrays (all the voxels of a phase together), so the loops over the voxels are contiguous. The deconvolution filter derived from the
+ * AIF spectrum is computed once in setAIF() and each block reuses a single FFT plan for all its voxels.
+ *
+ * Each compute method emits progress() while it runs and returns false if cancel() has been called in the meantime.
+ */
+class PerfusionMapCalculatorEngine : public QObject {
+
+    Q_OBJECT
+
+public:
+    typedef Volume::ItkImageType ImageType;
+    typedef itk::Image<bool, 3> BoolImageType;
+    typedef itk::Image<double, 3> DoubleImageType;
+    typedef itk::Image<double, 4> DoubleTemporalImageType;
+
+    PerfusionMapCalculatorEngine(QObject *parent = 0);
+    virtual ~PerfusionMapCalculatorEngine();
+
+    /// Sets the DSC series. The phases of each slice must be consecutive along z, as in the DSC volumes.
+    void setDSCImage(ImageType::Pointer image, int sizeX, int sizeY, int sizeZ, int sizeT);
+
+    /// Computes in a single pass the valid voxels, ΔR, the moments of ΔR of each valid voxel and the mean ΔR of the valid voxels of each slice.
+    /// The images must be already allocated with the size of the series.
+    bool computeDeltaRAndMoments(BoolImageType::Pointer checkImage, DoubleTemporalImageType::Pointer deltaRImage, DoubleImageType::Pointer m0Image,
+                                 DoubleImageType::Pointer m1Image, DoubleImageType::Pointer m2Image, QVector<QVector<double> > &meanDeltaRPerSlice);
+
+    /// Sets the arterial input function and its moment 0 and precomputes the deconvolution filter.
+    /// Returns false if the number of phases can't be transformed with the FFT.
+    bool setAIF(const QVector<double> &aif, double m0Aif);
+
+    /// Deconvolves ΔR of each valid voxel with the AIF and fills the perfusion images and their integer maps.
+    bool computePerfusion(BoolImageType::Pointer checkImage, DoubleTemporalImageType::Pointer deltaRImage, DoubleImageType::Pointer m0Image,
+                          DoubleImageType::Pointer cbvImage, DoubleImageType::Pointer cbfImage, DoubleImageType::Pointer mttImage,
+                          ImageType::Pointer cbvMapImage, ImageType::Pointer cbfMapImage, ImageType::Pointer mttMapImage);
+
+    /// Computes the moments of the curve \p curve.
+    static void computeMoments(const QVector<double> &curve, double &m0, double &m1, double &m2);
+
+public slots:
+    /// Cancels the current computation. Can be called from any thread.
+    void cancel();
+    /// Clears a previous cancellation. Must be called before starting a new computation, not from it, so that a cancellation requested meanwhile isn't lost.
+    void clearCancel();
+
+signals:
+    void progress(int percent);
+
+private:
+    typedef void (PerfusionMapCalculatorEngine::*BlockFunction)(int block);
+
+    /// Runs \p function for all the blocks on the global thread pool and waits for them, emitting the progress between \p firstPercent and
+    /// \p lastPercent as the blocks finish. Returns false if it has been cancelled.
+    bool runBlocks(BlockFunction function, int firstPercent, int lastPercent);
+    /// Gives the slice, the first voxel within the slice and the number of voxels of the block \p block.
+    void getBlock(int block, int &slice, int &firstVoxel, int &numberOfVoxels) const;
+
+    void computeDeltaRAndMomentsBlock(int block);
+    void computePerfusionBlock(int block);
+
+    /// Returns true if \p size only has 2, 3 and 5 as prime factors, as required by the vnl FFT.
+    static bool isValidFFTSize(int size);
+
+private:
+    static const double TE;
+    static const double TR;
+    static const int BaselineStart;
+    static const int BaselineEnd;
+    /// Approximate number of voxels of each block.
+    static const int VoxelsPerBlock;
+
+    ImageType::Pointer m_DSCImage;
+    int m_sizeX, m_sizeY, m_sizeZ, m_sizeT;
+    int m_rowsPerBlock, m_blocksPerSlice;
+    QVector<int> m_blocks;
+
+    BoolImageType::Pointer m_checkImage;
+    DoubleTemporalImageType::Pointer m_deltaRImage;
+    DoubleImageType::Pointer m_m0Image;
+    DoubleImageType::Pointer m_m1Image;
+    DoubleImageType::Pointer m_m2Image;
+    DoubleImageType::Pointer m_cbvImage;
+    DoubleImageType::Pointer m_cbfImage;
+    DoubleImageType::Pointer m_mttImage;
+    ImageType::Pointer m_cbvMapImage;
+    ImageType::Pointer m_cbfMapImage;
+    ImageType::Pointer m_mttMapImage;
+
+    /// Sum of ΔR of the valid voxels and number of valid voxels of each block, to compute the mean per slice.
+    QVector<QVector<double> > m_blockDeltaRSums;
+    QVector<int> m_blockValidVoxels;
+
+    double m_m0Aif;
+    /// Factor by which the spectrum of each tissue curve is multiplied to deconvolve it.
+    QVector<std::complex<double> > m_deconvolutionFilter;
+    double m_regularizationFactor, m_regularizationExponent;
+
+    QAtomicInt m_cancelled;
+
+};
+
+}
+
+#endif
@@ -8,6 +8,8 @@
 #ifndef UDGPERFUSIONMAPCALCULATORMAINTHREAD_H
 #define UDGPERFUSIONMAPCALCULATORMAINTHREAD_H
 
+#include "volume.h"
+
 #include <itkImage.h>
 
 #include <QThread>
@@ -15,9 +17,12 @@
 
 namespace udg {
 
-class Volume;
+class PerfusionMapCalculatorEngine;
 /**
  * Thread principal per al càlcul d'obscurances. Controla els altres threads.
+ *
+ * run() does all the computation and can be called from a worker thread, e.g. with QtConcurrent::run(), while stop() is called from the GUI thread.
+ * The map volumes are created afterwards by createMapVolumes() in the thread of this object, since they are shown by the viewers.
  */
 class PerfusionMapCalculatorMainThread : public QObject {
 
@@ -48,8 +53,14 @@ public:
 
 public slots:
 
+    /// Prepares a new computation. Must be called before run() from the thread that can stop it.
+    void prepare();
+    /// Stops the computation being run. Can be called from any thread.
     void stop();
-    void run();
+    /// Computes the perfusion maps of the DSC volume. Returns false if it has been stopped or has failed.
+    bool run();
+    /// Creates the map volumes from the maps computed by the last successful run() and emits computed(). Must be called from the thread of this object.
+    void createMapVolumes();
 
     void setAIFIndex(double x,double y,double z)
             {m_aifIndex[0]=x;m_aifIndex[1]=y;m_aifIndex[2]=z;m_AIFIsSet=true;}
@@ -66,17 +77,12 @@ private:
     static const double TE;
     static const double TR;
 
-    void computeDeltaR();
-    void computeMeanDeltaRPerSlice();
-    void computeMoments();
-    //Xapussa: posem directament el tipus dels voxels del Volume
-    void computeMomentsVoxel(QVector<double> v, double &m0, double &m1, double &m2);
+    /// Computes the check image, deltaR, its moments and the mean deltaR per slice. Returns false if it has been stopped.
+    bool computeDeltaRAndMoments();
     void findAIF();
     void updateAIF();
-    void fftAIF();
-    void getOmega();
-    void computePerfusion();
-    void deconvolve(QVector<double> tissue, QVector<double>& residuefunc);
+    /// Returns false if it has been stopped.
+    bool computePerfusion();
     void changeMap(int value);
 
 
@@ -95,19 +101,17 @@ private:
     DoubleImageType::Pointer cbfImage;
     DoubleImageType::Pointer cbvImage;
     DoubleImageType::Pointer mttImage;
+    Volume::ItkImageType::Pointer m_map0Image;
+    Volume::ItkImageType::Pointer m_map1Image;
+    Volume::ItkImageType::Pointer m_map2Image;
 
     QVector<double> m_aif;
     QVector<int> m_aifIndex;
     double m_m0aif;
-    QVector<double> fftaifreal;
-    QVector<double> fftaifimag;
-    QVector<double> omega;
 
     QVector<QVector<double> > m_meanseries;
 
-    double reg_fact, reg_exp;
-
-    bool m_stopped;
+    PerfusionMapCalculatorEngine *m_engine;
 
     bool m_AIFIsSet;
 
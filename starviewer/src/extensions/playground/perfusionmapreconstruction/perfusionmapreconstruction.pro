@@ -8,13 +8,13 @@ FORMS += qperfusionmapreconstructionextensionbase.ui \
 HEADERS += qperfusionmapreconstructionextension.h \
            perfusionmapreconstructionextensionmediator.h  \
            perfusionmapreconstructionsettings.h \
-           perfusionmapcalculatorthread.h \
+           perfusionmapcalculatorengine.h \
            perfusionmapcalculatormainthread.h \
            qgraphicplotwidget.h
 SOURCES += qperfusionmapreconstructionextension.cpp \
            perfusionmapreconstructionextensionmediator.cpp  \
            perfusionmapreconstructionsettings.cpp \
-           perfusionmapcalculatorthread.cpp \
+           perfusionmapcalculatorengine.cpp \
            perfusionmapcalculatormainthread.cpp \
            qgraphicplotwidget.cpp
 RESOURCES += perfusionmapreconstruction.qrc
@@ -22,3 +22,4 @@ RESOURCES += perfusionmapreconstruction.qrc
 EXTENSION_DIR = $$PWD
 include(../../basicconfextensions.pri)
 
+QT += concurrent
@@ -45,6 +45,7 @@
 #include <QFile>
 #include <QMultiMap>
 #include <QTextStream>
+#include <QtConcurrentRun>
 // VTK
 #include <vtkCommand.h>
 #include <vtkLookupTable.h>
@@ -86,6 +87,10 @@ QPerfusionMapReconstructionExtension::QPerfusionMapReconstructionExtension(QWidg
 
 QPerfusionMapReconstructionExtension::~QPerfusionMapReconstructionExtension()
 {
+    // The calculator can't be destroyed while it's running
+    m_mapCalculator->stop();
+    m_mapCalculatorWatcher.waitForFinished();
+
     delete m_toolManager;
     writeSettings();
 }
@@ -149,6 +154,8 @@ void QPerfusionMapReconstructionExtension::createConnections()
   //connect(m_filterPushButton, SIGNAL(clicked()), SLOT(applyFilterMapImage()));
   connect(m_mapViewComboBox, SIGNAL(currentIndexChanged (int)), SLOT(changeMap(int)));
   connect(m_mapCalculator, SIGNAL(computed()), SLOT(paintMap()));
+  connect(m_mapCalculator, SIGNAL(progress(int)), m_perfusionProgressBar, SLOT(setValue(int)));
+  connect(&m_mapCalculatorWatcher, SIGNAL(finished()), SLOT(endComputePerfusionMap()));
 }
 
 void QPerfusionMapReconstructionExtension::setInput(Volume *input)
@@ -229,7 +236,14 @@ void QPerfusionMapReconstructionExtension::changeMap(int value)
 
 void QPerfusionMapReconstructionExtension::computePerfusionMap()
 {
-    QApplication::setOverrideCursor(Qt::WaitCursor);
+    if (m_mapCalculatorWatcher.isRunning())
+    {
+        m_mapCalculator->stop();
+        m_computePerfusionPushButton->setText(tr("Stopping perfusion..."));
+        m_computePerfusionPushButton->setEnabled(false);
+        return;
+    }
+
     if(m_seedToolData)
     {
         if(m_seedToolData->getPoint())
@@ -246,7 +260,27 @@ void QPerfusionMapReconstructionExtension::computePerfusionMap()
         }
     }
     m_mapCalculator->setDSCVolume(m_DSCVolume);
-    m_mapCalculator->run();
+
+    m_computePerfusionPushButton->setText(tr("Stop Perfusion"));
+    m_perfusionProgressBar->setValue(0);
+    m_mapCalculator->prepare();
+    m_mapCalculatorWatcher.setFuture(QtConcurrent::run(m_mapCalculator, &PerfusionMapCalculatorMainThread::run));
+}
+
+void QPerfusionMapReconstructionExtension::endComputePerfusionMap()
+{
+    m_computePerfusionPushButton->setText(tr("Compute Perfusion"));
+    m_computePerfusionPushButton->setEnabled(true);
+
+    if (!m_mapCalculatorWatcher.result())
+    {
+        m_perfusionProgressBar->setValue(0);
+        return;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+
+    m_mapCalculator->createMapVolumes();
 
     m_meanseries = m_mapCalculator->getMeanDeltaRPerSlice();
 
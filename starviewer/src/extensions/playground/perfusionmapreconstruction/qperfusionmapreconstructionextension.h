@@ -12,6 +12,7 @@
 #include <itkImage.h>
 #include <volume.h>
 
+#include <QFutureWatcher>
 #include <QString>
 #include <QVector>
 
@@ -65,7 +66,10 @@ private:
 
 private slots:
 
+    /// Starts computing the perfusion maps in a worker thread, or stops the computation if it's already running.
     void computePerfusionMap();
+    /// Shows the perfusion maps when their computation has finished, or just restores the interface if it has been stopped.
+    void endComputePerfusionMap();
     void paintMap();
     void changeMap(int value);
 
@@ -123,6 +127,8 @@ private:
     
     ///Calculadora de mapes de perfusió
     PerfusionMapCalculatorMainThread* m_mapCalculator;
+    /// Watches the computation of the maps, which runs the calculator in a worker thread.
+    QFutureWatcher<bool> m_mapCalculatorWatcher;
 
     DrawerPoint* m_aifDrawPoint;
     int m_aifIndex[3];
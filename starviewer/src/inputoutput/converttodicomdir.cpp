@@ -17,6 +17,10 @@
 #include <QProgressDialog>
 #include <QTextStream>
 #include <QFile>
+#include <QAtomicInt>
+#include <QEventLoop>
+#include <QFutureWatcher>
+#include <QtConcurrentMap>
 
 #include "logging.h"
 #include "status.h"
@@ -37,7 +41,6 @@ ConvertToDicomdir::ConvertToDicomdir()
 {
     m_study = 0;
     m_series = 0;
-    m_currentItemNumber = 0;
     m_patient = 0;
 
     m_convertDicomdirImagesToLittleEndian = false;
@@ -181,6 +184,12 @@ Status ConvertToDicomdir::convert(const QString &dicomdirPath, CreateDicomdir::r
         m_DICOMAnonymizer->setReplacePatientIDInsteadOfRemove(true);
         m_DICOMAnonymizer->setReplaceStudyIDInsteadOfRemove(true);
         m_DICOMAnonymizer->setRemovePrivateTags(true);
+
+        // The files are anonymized in parallel, so the anonymized IDs are assigned beforehand in the order of the studies
+        foreach (const StudyToConvert &studyToConvert, m_studiesToConvert)
+        {
+            m_DICOMAnonymizer->reserveAnonymizedIDs(studyToConvert.patientId, studyToConvert.studyUID);
+        }
     }
     else
     {
@@ -313,6 +322,7 @@ Status ConvertToDicomdir::copyStudiesToDicomdirPath(QList<Study*> studyList)
     Study *study;
 
     m_patient = 0;
+    m_imagesToCopy.clear();
 
     // Agrupem estudis1 per pacient, com que tenim la llista ordenada per patientId
     while (!m_studiesToConvert.isEmpty())
@@ -353,6 +363,11 @@ Status ConvertToDicomdir::copyStudiesToDicomdirPath(QList<Study*> studyList)
         m_OldPatientId = studyToConvert.patientId;
     }
 
+    if (state.good())
+    {
+        state = copyImagesToDicomdirPath();
+    }
+
     return state;
 }
 
@@ -401,15 +416,14 @@ Status ConvertToDicomdir::copySeriesToDicomdirPath(Series *series)
     m_dicomDirSeriesPath = m_dicomDirStudyPath + seriesName;
     seriesDir.mkdir(m_dicomDirSeriesPath);
 
-    state = copyImages(series->getImages());
+    addImagesToCopy(series->getImages());
 
     return state;
 }
 
-Status ConvertToDicomdir::copyImages(QList<Image*> images)
+void ConvertToDicomdir::addImagesToCopy(const QList<Image*> &images)
 {
-    Status state;
-    m_currentItemNumber = 0;
+    int imageNumber = 0;
     // HACK per evitar els casos en que siguin imatges procedents d'un multiframe
     // que copiem més d'una vegada un arxiu
     QString lastPath;
@@ -418,38 +432,87 @@ Status ConvertToDicomdir::copyImages(QList<Image*> images)
         if (lastPath != imageToCopy->getPath())
         {
             lastPath = imageToCopy->getPath();
-            
-            m_currentItemNumber++;
-            state = copyImageToDicomdirPath(imageToCopy);
-            
-            // La barra de progrés avança
-            m_progress->setValue(m_progress->value() + 1);
-            m_progress->repaint();
-            
-            if (!state.good())
-            {
-                break;
-            }
+            imageNumber++;
+
+            ImageToCopy file;
+            file.sourceFile = imageToCopy->getPath();
+            file.destinationFile = getImageOutputPath(imageNumber);
+            // Files skipped after a failure keep this status, so only the files that have actually failed are reported
+            file.status.setStatus("", true, 0);
+            m_imagesToCopy.append(file);
         }
     }
+}
+
+Status ConvertToDicomdir::copyImagesToDicomdirPath()
+{
+    // Hem assignat com a valor de progressbar Numero Imatges +1, el +1 és el pas de convertir els fitxers a dicomdir
+    if (m_progress)
+    {
+        m_progress->setMaximum(m_imagesToCopy.count() + 1);
+    }
+
+    // The names have already been assigned in order, so the files can be converted, anonymized and written by several threads at once.
+    // Once a file has failed the remaining ones are skipped.
+    QAtomicInt failed(0);
+    auto copyImage = [this, &failed](ImageToCopy &file)
+    {
+        if (failed.load())
+        {
+            return;
+        }
+
+        file.status = copyImageToDicomdirPath(file.sourceFile, file.destinationFile);
+
+        if (!file.status.good())
+        {
+            failed.store(1);
+        }
+    };
+
+    // The progress is received through signals while the local event loop keeps the progress dialog responsive
+    QFutureWatcher<void> watcher;
+    QEventLoop eventLoop;
+    connect(&watcher, SIGNAL(progressValueChanged(int)), SLOT(updateCopyProgress(int)));
+    connect(&watcher, SIGNAL(finished()), &eventLoop, SLOT(quit()));
+    watcher.setFuture(QtConcurrent::map(m_imagesToCopy, copyImage));
+    if (!watcher.isFinished())
+    {
+        eventLoop.exec(QEventLoop::ExcludeUserInputEvents);
+    }
+    watcher.waitForFinished();
+
+    updateCopyProgress(m_imagesToCopy.count());
+
+    Status state;
+    state.setStatus("", true, 0);
+    // The first failure in the order of the files is the one reported, the same one that would have stopped a sequential copy
+    foreach (const ImageToCopy &file, m_imagesToCopy)
+    {
+        if (!file.status.good())
+        {
+            state = file.status;
+            break;
+        }
+    }
+
+    m_imagesToCopy.clear();
 
     return state;
 }
 
-Status ConvertToDicomdir::copyImageToDicomdirPath(Image *image)
+Status ConvertToDicomdir::copyImageToDicomdirPath(const QString &sourceFile, const QString &destinationFile) const
 {
-    // Creem el nom del fitxer de l'imatge, el format és IMGXXXXX, on XXXXX és el numero d'imatge dins la sèrie
-    QString imageOutputPath = getCurrentItemOutputPath();
     Status state;
 
-    if (getConvertDicomdirImagesToLittleEndian())
+    if (m_convertDicomdirImagesToLittleEndian)
     {
         // Convertim la imatge a littleEndian, demanat per la normativa DICOM i la guardem al directori desti
-        state = ConvertDicomToLittleEndian().convert(image->getPath(), imageOutputPath);
+        state = ConvertDicomToLittleEndian().convert(sourceFile, destinationFile);
 
         if (m_anonymizeDICOMDIR && state.good())
         {
-            anonymizeFile(imageOutputPath, imageOutputPath, state, true);
+            anonymizeFile(destinationFile, destinationFile, state, true);
         }
     }
     else
@@ -459,11 +522,11 @@ Status ConvertToDicomdir::copyImageToDicomdirPath(Image *image)
         // que no s'han de convertir a LittleEndian és més ràpid.
         if (m_anonymizeDICOMDIR)
         {
-            anonymizeFile(image->getPath(), imageOutputPath, state, false);
+            anonymizeFile(sourceFile, destinationFile, state, false);
         }
         else
         {
-            copyFileToDICOMDIRDestination(image->getPath(), imageOutputPath, state);
+            copyFileToDICOMDIRDestination(sourceFile, destinationFile, state);
         }
     }
 
@@ -475,12 +538,21 @@ QString ConvertToDicomdir::getDICOMDIROutputFilenamePrefix() const
     return "IMG";
 }
 
-QString ConvertToDicomdir::getCurrentItemOutputPath()
+QString ConvertToDicomdir::getImageOutputPath(int imageNumber) const
 {
-    return m_dicomDirSeriesPath + QString("/%1%2").arg(getDICOMDIROutputFilenamePrefix()).arg(m_currentItemNumber, 5, 10, QChar('0'));
+    // Creem el nom del fitxer de l'imatge, el format és IMGXXXXX, on XXXXX és el numero d'imatge dins la sèrie
+    return m_dicomDirSeriesPath + QString("/%1%2").arg(getDICOMDIROutputFilenamePrefix()).arg(imageNumber, 5, 10, QChar('0'));
+}
+
+void ConvertToDicomdir::updateCopyProgress(int numberOfCopiedImages)
+{
+    if (m_progress)
+    {
+        m_progress->setValue(numberOfCopiedImages);
+    }
 }
 
-void ConvertToDicomdir::copyFileToDICOMDIRDestination(const QString &sourceFile, const QString &destinationFile, Status &status)
+void ConvertToDicomdir::copyFileToDICOMDIRDestination(const QString &sourceFile, const QString &destinationFile, Status &status) const
 {
     if (QFile::copy(sourceFile, destinationFile))
     {
@@ -494,7 +566,7 @@ void ConvertToDicomdir::copyFileToDICOMDIRDestination(const QString &sourceFile,
     }
 }
 
-void ConvertToDicomdir::anonymizeFile(const QString &sourceFile, const QString &destinationFile, Status &status, bool isLittleEndian)
+void ConvertToDicomdir::anonymizeFile(const QString &sourceFile, const QString &destinationFile, Status &status, bool isLittleEndian) const
 {
     if (m_DICOMAnonymizer->anonymizeDICOMFile(sourceFile, destinationFile))
     {
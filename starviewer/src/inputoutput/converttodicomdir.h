@@ -17,8 +17,10 @@
 
 #include <QObject>
 #include <QStringList>
+#include <QVector>
 
 #include "createdicomdir.h"
+#include "status.h"
 
 // Fordward declarations
 class QProgressDialog;
@@ -26,7 +28,6 @@ class QProgressDialog;
 namespace udg {
 
 // Fordward declarations
-class Status;
 class Study;
 class Series;
 class Image;
@@ -78,6 +79,30 @@ public:
     /// Aquest mètode ens comprova que es compleixi aquest requeriment.
     bool AreValidRequirementsOfFolderContentToCopyToDICOMDIR(QString path);
 
+protected:
+    /// File to copy to the DICOMDIR, with its final name already assigned, and the result of copying it.
+    struct ImageToCopy
+    {
+        QString sourceFile;
+        QString destinationFile;
+        Status status;
+    };
+
+    /// Adds the files of the given images to the list of files to copy to the current series directory, assigning them their output name.
+    /// Files shared by several images, as in multiframe images, are only added once.
+    void addImagesToCopy(const QList<Image*> &images);
+
+    /// Copies all the files added with addImagesToCopy() to the DICOMDIR in parallel. Returns the status of the first file that failed, in the order in
+    /// which they were added, or a good status if all of them have been copied.
+    Status copyImagesToDicomdirPath();
+
+protected:
+    /// Directory of the series whose images are being added to copy.
+    QString m_dicomDirSeriesPath;
+
+    /// Files to copy to the DICOMDIR, in the order in which they have been named.
+    QVector<ImageToCopy> m_imagesToCopy;
+
 private:
     /// Estructura que conté la informació d'un estudi a convertir a dicomdir.
     /// És necessari guardar el Patient ID perquè segons la normativa de l'IHE,
@@ -97,40 +122,41 @@ private:
     /// Copia els estudis seleccionats per passar a dicomdir, al directori desti
     Status copyStudiesToDicomdirPath(QList<Study*> studyList);
 
-    /// Converteix un estudi al format littleendian, i la copia al directori dicomdir
-    /// @param studyUID Uid de l'estudi a convertir
+    /// Creates the directories of the study and its series in the DICOMDIR and adds their images to the files to copy
+    /// @param study
     /// @return Indica l'estat en què finalitza el mètode
     Status copyStudyToDicomdirPath(Study *study);
 
-    /// Converteix una sèrie al format littleendian, i la copia al directori dicomdir
+    /// Creates the directory of the series in the DICOMDIR and adds its images to the files to copy
     /// @param series
     /// @return Indica l'estat en què finalitza el mètode
     Status copySeriesToDicomdirPath(Series *series);
 
-    /// Does the process of copying a list of images to the corresponding DICOMDIR destination 
-    Status copyImages(QList<Image*> images);
-    
-    /// Converteix una imatge al format littleendian, i la copia al directori dicomdir
-    /// @param image
+    /// Copies the given file to its destination in the DICOMDIR, converting it to little endian and anonymizing it if needed.
+    /// It can be called from several threads at once.
     /// @return Indica l'estat en què finalitza el mètode
-    Status copyImageToDicomdirPath(Image *image);
+    Status copyImageToDicomdirPath(const QString &sourceFile, const QString &destinationFile) const;
 
     /// Gets the corresponding output prefix name
     QString getDICOMDIROutputFilenamePrefix() const;
 
-    /// Gets the corresponding output path for the current item to be copied
-    QString getCurrentItemOutputPath();
+    /// Gets the output path of the image with the given number in the current series
+    QString getImageOutputPath(int imageNumber) const;
     
     /// Copies source file to destination file and sets the Status for the operation
-    void copyFileToDICOMDIRDestination(const QString &sourceFile, const QString &destinationFile, Status &status);
+    void copyFileToDICOMDIRDestination(const QString &sourceFile, const QString &destinationFile, Status &status) const;
 
     /// Anonymizes sourceFile and puts the result in destinationFile.
     /// isLittleEndian is needed in order to give an accurate message in status in case there are some error.
-    void anonymizeFile(const QString &sourceFile, const QString &destinationFile, Status &status, bool isLittleEndian);
+    void anonymizeFile(const QString &sourceFile, const QString &destinationFile, Status &status, bool isLittleEndian) const;
     
     /// Starviewer té l'opció de copiar el contingut d'una carpeta al DICOMDIR. Aquest mètode copia el contingut de la carpeta al DICOMDIR
     bool copyFolderContentToDICOMDIR();
 
+private slots:
+    /// Advances the progress dialog to the given number of copied images.
+    void updateCopyProgress(int numberOfCopiedImages);
+
 private:
     QList<StudyToConvert> m_studiesToConvert;
     QProgressDialog *m_progress;
@@ -138,7 +164,6 @@ private:
 
     QString m_dicomDirPath;
     QString m_dicomDirStudyPath;
-    QString m_dicomDirSeriesPath;
     QString m_oldPatientId;
     QString m_dicomdirPatientPath;
 
@@ -147,8 +172,6 @@ private:
     int m_patient;
     int m_study;
     int m_series;
-    /// Holds the number of the item being copied
-    int m_currentItemNumber;
 
     /// És necessari crear-la global per mantenir la consistència dels UID dels fitxers DICOM
     DICOMAnonymizer *m_DICOMAnonymizer;
@@ -19,16 +19,26 @@
 
 #include <QSqlDatabase>
 #include <QSqlError>
+#include <QThread>
 
 namespace udg {
 
+QMutex DatabaseConnection::m_transactionMutex(QMutex::Recursive);
+
 DatabaseConnection::DatabaseConnection()
+ : m_transactionInProgress(false)
 {
     m_databasePath = LocalDatabaseManager::getDatabaseFilePath();
 }
 
 DatabaseConnection::~DatabaseConnection()
 {
+    if (m_transactionInProgress)
+    {
+        // An exception has been thrown in the middle of the transaction
+        rollbackTransaction();
+    }
+
     close();
 }
 
@@ -44,7 +54,7 @@ QSqlDatabase DatabaseConnection::getConnection()
         open();
     }
 
-    return QSqlDatabase::database();
+    return QSqlDatabase::database(getConnectionName());
 }
 
 QSqlError DatabaseConnection::getLastError()
@@ -59,20 +69,23 @@ QString DatabaseConnection::getLastErrorMessage()
 
 void DatabaseConnection::beginTransaction()
 {
-    m_mutex.lock();
+    m_transactionMutex.lock();
+    m_transactionInProgress = true;
     getConnection().transaction();
 }
 
 void DatabaseConnection::commitTransaction()
 {
     getConnection().commit();
-    m_mutex.unlock();
+    m_transactionInProgress = false;
+    m_transactionMutex.unlock();
 }
 
 void DatabaseConnection::rollbackTransaction()
 {
     getConnection().rollback();
-    m_mutex.unlock();
+    m_transactionInProgress = false;
+    m_transactionMutex.unlock();
     INFO_LOG("Transaction in the database rolled back.");
 }
 
@@ -83,7 +96,7 @@ void DatabaseConnection::open()
         return;
     }
 
-    QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE");
+    QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", getConnectionName());
     database.setDatabaseName(m_databasePath);
     database.setConnectOptions("QSQLITE_BUSY_TIMEOUT=15000");
 
@@ -100,7 +113,7 @@ void DatabaseConnection::close()
         QString name;
 
         {
-            QSqlDatabase database = QSqlDatabase::database();
+            QSqlDatabase database = QSqlDatabase::database(getConnectionName());
             name = database.connectionName();
             database.close();
         }
@@ -111,7 +124,12 @@ void DatabaseConnection::close()
 
 bool DatabaseConnection::isConnected()
 {
-    return QSqlDatabase::database().isOpen();
+    return QSqlDatabase::contains(getConnectionName()) && QSqlDatabase::database(getConnectionName()).isOpen();
+}
+
+QString DatabaseConnection::getConnectionName()
+{
+    return QString("DatabaseConnection%1").arg(reinterpret_cast<quintptr>(QThread::currentThreadId()));
 }
 
 }
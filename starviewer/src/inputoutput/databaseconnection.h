@@ -26,7 +26,8 @@ namespace udg {
 /**
  * @brief The DatabaseConnection class provides the connection to the database.
  *
- * This class automatically opens the database connection when getConnection() is called and closes it in its destructor.
+ * This class automatically opens the database connection when getConnection() is called and closes it in its destructor. Each thread uses its own connection
+ * to the database, because SQL connections can only be used from the thread that created them.
  */
 class DatabaseConnection {
 
@@ -53,7 +54,7 @@ public:
     void beginTransaction();
     /// Commits the current transaction in the database.
     void commitTransaction();
-    /// Rolls back the current transaction in the database. If the connexion is closed, the current transaction is rolled back automatically.
+    /// Rolls back the current transaction in the database. If the connexion is destroyed, the current transaction is rolled back automatically.
     void rollbackTransaction();
 
 private:
@@ -66,12 +67,18 @@ private:
     /// Returns true if the connection is open and false otherwise.
     bool isConnected();
 
+    /// Returns the name of the connection of the current thread.
+    static QString getConnectionName();
+
 private:
     /// Path to the database file.
     QString m_databasePath;
 
-    /// SQLite doesn't support simultaneous transactions with the same connection, thus a mutex is needed for transactions.
-    QMutex m_mutex;
+    /// SQLite doesn't handle well simultaneous write transactions from different connections, thus a mutex shared by all the connections is needed
+    /// for transactions.
+    static QMutex m_transactionMutex;
+    /// True between beginTransaction() and commitTransaction() or rollbackTransaction().
+    bool m_transactionInProgress;
 
 };
 
@@ -26,6 +26,7 @@
 #include <QFile>
 #include <QMessageBox>
 #include <QProgressDialog>
+#include <QRegularExpression>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QTextStream>
@@ -34,6 +35,37 @@ namespace udg {
 
 namespace {
 
+// Splits the given SQL script into its commands. Commands are separated by ';', except inside the body of triggers, which is kept with its trigger.
+QStringList splitSqlScript(const QString &sqlScript)
+{
+    QRegularExpression createTriggerRegularExpression("\\bCREATE\\s+TRIGGER\\b", QRegularExpression::CaseInsensitiveOption);
+    QRegularExpression triggerEndRegularExpression("\\bEND\\s*$", QRegularExpression::CaseInsensitiveOption);
+    QStringList commands;
+    QString currentCommand;
+
+    foreach (const QString &part, sqlScript.split(';', QString::SkipEmptyParts))
+    {
+        currentCommand += part;
+
+        if (currentCommand.contains(createTriggerRegularExpression) && !currentCommand.contains(triggerEndRegularExpression))
+        {
+            currentCommand += ';';
+        }
+        else
+        {
+            commands << currentCommand;
+            currentCommand.clear();
+        }
+    }
+
+    if (!currentCommand.isEmpty())
+    {
+        commands << currentCommand;
+    }
+
+    return commands;
+}
+
 // Returns the UpgradeDatabaseXMLParser filled with the upgrade XML.
 UpgradeDatabaseXMLParser getUpgradeDatabaseXmlParser()
 {
@@ -168,7 +200,7 @@ bool DatabaseInstallation::createDatabase(DatabaseConnection &databaseConnection
     sqlTablesScriptFile.close();
 
     // Trimmed to remove newline at end of file
-    QStringList sqlCommands = sqlTablesScript.trimmed().split(';', QString::SkipEmptyParts);
+    QStringList sqlCommands = splitSqlScript(sqlTablesScript.trimmed());
 
     QSqlQuery query(databaseConnection.getConnection());
 
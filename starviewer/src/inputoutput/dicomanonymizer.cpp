@@ -21,6 +21,7 @@
 #include <gdcmDefs.h>
 #include <QCoreApplication>
 #include <QDir>
+#include <QMutexLocker>
 #include <dcuid.h>
 
 #include "logging.h"
@@ -158,10 +159,36 @@ bool DICOMAnonymizer::anonymizeDICOMFile(const QString &inputPathFile, const QSt
     QString originalPatientID = readTagValue(&gdcmFile, gdcm::Tag(0x0010, 0x0020));
     QString originalStudyInstanceUID = readTagValue(&gdcmFile, gdcm::Tag(0x0020, 0x000d));
 
+    if (!anonymizeDataSet(gdcmFile, originalPatientID, originalStudyInstanceUID))
+    {
+        ERROR_LOG("No s'ha pogut anonimitzar el fitxer " + inputPathFile);
+        return false;
+    }
+
+    // Regenerem la capçalera DICOM amb el nou SOP Instance UID
+    gdcm::FileMetaInformation gdcmFileMetaInformation = gdcmFile.GetHeader();
+    gdcmFileMetaInformation.Clear();
+
+    gdcm::Writer gdcmWriter;
+    gdcmWriter.SetFileName(qPrintable(outputPathFile));
+    gdcmWriter.SetFile(gdcmFile);
+    if (!gdcmWriter.Write())
+    {
+        ERROR_LOG("No s'ha pogut generar el fitxer anonimitzat de " + inputPathFile + " a " + outputPathFile);
+        return false;
+    }
+
+    return true;
+}
+
+bool DICOMAnonymizer::anonymizeDataSet(gdcm::File &gdcmFile, const QString &originalPatientID, const QString &originalStudyInstanceUID)
+{
+    // The gdcm anonymizer keeps the UIDs already generated to keep them consistent between files, so it can't be used from several threads at once
+    QMutexLocker locker(&m_anonymizerMutex);
+
     m_gdcmAnonymizer->SetFile(gdcmFile);
     if (!m_gdcmAnonymizer->BasicApplicationLevelConfidentialityProfile(true))
     {
-        ERROR_LOG("No s'ha pogut anonimitzar el fitxer " + inputPathFile);
         return false;
     }
 
@@ -184,25 +211,20 @@ bool DICOMAnonymizer::anonymizeDICOMFile(const QString &inputPathFile, const QSt
     {
         if (!m_gdcmAnonymizer->RemovePrivateTags())
         {
-            ERROR_LOG("No s'ha pogut treure els tags privats del fitxer " + inputPathFile);
+            ERROR_LOG("Could not remove the private tags");
             return false;
         }
     }
 
-    // Regenerem la capçalera DICOM amb el nou SOP Instance UID
-    gdcm::FileMetaInformation gdcmFileMetaInformation = gdcmFile.GetHeader();
-    gdcmFileMetaInformation.Clear();
+    return true;
+}
 
-    gdcm::Writer gdcmWriter;
-    gdcmWriter.SetFileName(qPrintable(outputPathFile));
-    gdcmWriter.SetFile(gdcmFile);
-    if (!gdcmWriter.Write())
-    {
-        ERROR_LOG("No s'ha pogut generar el fitxer anonimitzat de " + inputPathFile + " a " + outputPathFile);
-        return false;
-    }
+void DICOMAnonymizer::reserveAnonymizedIDs(const QString &originalPatientID, const QString &originalStudyInstanceUID)
+{
+    QMutexLocker locker(&m_anonymizerMutex);
 
-    return true;
+    getAnonimyzedPatientID(originalPatientID);
+    getAnonymizedStudyID(originalStudyInstanceUID);
 }
 
 QString DICOMAnonymizer::getAnonimyzedPatientID(const QString &originalPatientID)
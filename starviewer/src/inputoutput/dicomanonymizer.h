@@ -16,6 +16,7 @@
 #define UDGDICOMANONYMIZER_H
 
 #include <QHash>
+#include <QMutex>
 #include <QString>
 
 #include "gdcmanonymizerstarviewer.h"
@@ -45,8 +46,13 @@ public:
     /// Atenció!!! si utilitzem aquesta opció per anonimitzar diversos fitxers d'un mateix estudi, aquests fitxers s'han d'anonimitzar utilitzant la mateixa
     /// instància del DICOMAnonymizer per mantenir la consitència de Tags com Study Instance UID, Series Instance UID, Frame Of Reference, Image Reference ...
     /// Si no es respecta aquest requisit passarà que imatges d'un mateix estudi després de ser anonimitzades tindran Study Instance UID diferents.
+    /// It can be called from several threads at once: files are read and written in parallel and only the modification of the tags is serialized.
     bool anonymizeDICOMFile(const QString &inputPathFile, const QString &outputPathFile);
 
+    /// Assigns the anonymized Patient ID and Study ID of the given original values, if they don't have one yet. Calling it for each study in order
+    /// before anonymizing their files in parallel makes the anonymized IDs independent of the order in which the files are processed.
+    void reserveAnonymizedIDs(const QString &originalPatientID, const QString &originalStudyInstanceUID);
+
     /// Ens indica quin nom de pacient han de tenir els estudis anonimitzats. El nom no pot tenir més de 64 caràcters seguint la normativa DICOM per a tags de
     /// tipus PN (Person Name) si es passa un nom de més de 64 caràcters es trunca.
     void setPatientNameAnonymized(const QString &patientNameAnonymized);
@@ -74,6 +80,9 @@ private:
     /// Inicialitza les variables de gdcm necessàries per anonimitzar
     void initializeGDCM();
 
+    /// Anonymizes the data set of the given file in place. Serialized with m_anonymizerMutex.
+    bool anonymizeDataSet(gdcm::File &gdcmFile, const QString &originalPatientID, const QString &originalStudyInstanceUID);
+
     /// Retorna el valor de PatientID anonimitzat a partir del PatientID original del fitxer. Aquest mètode és consistent de manera que si li passem
     /// una o més vegades el mateix PatientID sempre retornarà el mateix valor com a PatientID anonimitzat.
     QString getAnonimyzedPatientID(const QString &originalPatientID);
@@ -95,6 +104,9 @@ private:
     QHash<QString, QString> m_hashOriginalStudyInstanceUIDToAnonimyzedStudyID;
 
     gdcm::gdcmAnonymizerStarviewer *m_gdcmAnonymizer;
+
+    /// Protects m_gdcmAnonymizer and the hashes of anonymized IDs, which are shared by all the files.
+    QMutex m_anonymizerMutex;
 };
 
 };
@@ -250,7 +250,7 @@ bool DICOMDIRImporter::copyDicomdirImageToLocal(QString dicomdirImagePath, QStri
                 WARN_LOG("No hem pogut canviar els permisos de lectura/escriptura pel fitxer importat [" + localImagePath + "]");
         }
         // TODO perquè cal fer aquest DICOMTagReader? Encara es fa servir la cache de dicom tag reader????
-        DICOMTagReader *dicomTagReader = new DICOMTagReader(localImagePath);
+        DICOMTagReader *dicomTagReader = new DICOMTagReader(localImagePath, DICOMTagReader::MetadataOnly);
         emit imageImportedToDisk(dicomTagReader);
 
         m_qprogressDialog->setValue(m_qprogressDialog->value() + 1);
@@ -47,6 +47,7 @@ HEADERS += databaseconnection.h \
     qadvancedsearchwidget.h \
     qbasicsearchwidget.h \
     localdatabasemanager.h \
+    thumbnailcache.h \
     localdatabasebasedal.h \
     localdatabasedisplayshutterdal.h \
     localdatabaseimagedal.h \
@@ -81,6 +82,7 @@ HEADERS += databaseconnection.h \
     senddicomfilestopacsjob.h \
     pacsrequeststatus.h \
     retrievedicomfilesfrompacsjob.h \
+    retrievedicomfilesfrompacsqueuepolicy.h \
     echotopacs.h \
     gdcmanonymizerstarviewer.h \
     dicomanonymizer.h \
@@ -124,6 +126,7 @@ SOURCES += databaseconnection.cpp \
     qadvancedsearchwidget.cpp \
     qbasicsearchwidget.cpp \
     localdatabasemanager.cpp \
+    thumbnailcache.cpp \
     localdatabasebasedal.cpp \
     localdatabasedisplayshutterdal.cpp \
     localdatabaseimagedal.cpp \
@@ -157,6 +160,7 @@ SOURCES += databaseconnection.cpp \
     pacsjob.cpp \
     senddicomfilestopacsjob.cpp  \
     retrievedicomfilesfrompacsjob.cpp \
+    retrievedicomfilesfrompacsqueuepolicy.cpp \
     echotopacs.cpp \
     gdcmanonymizerstarviewer.cpp \
     dicomanonymizer.cpp \
@@ -195,4 +199,5 @@ include(../threadweaver.pri)
 QT += xml \
     network \
     widgets \
-    sql
+    sql \
+    concurrent
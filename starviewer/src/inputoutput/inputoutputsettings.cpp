@@ -30,6 +30,10 @@ namespace udg {
 const QString CacheBase("PACS/cache/");
 const QString InputOutputSettings::DatabaseAbsoluteFilePath(CacheBase + "sdatabasePath");
 const QString InputOutputSettings::CachePath(CacheBase + "imagePath");
+const QString InputOutputSettings::ThumbnailCachePath(CacheBase + "thumbnailPath");
+const QString InputOutputSettings::ThumbnailCacheMaximumSizeInMegaBytes(CacheBase + "thumbnailCacheMaximumSizeInMegaBytes");
+const QString InputOutputSettings::LocalDatabaseIngestJournalMode(CacheBase + "ingestJournalMode");
+const QString InputOutputSettings::LocalDatabaseIngestSynchronous(CacheBase + "ingestSynchronous");
 const QString InputOutputSettings::DeleteLeastRecentlyUsedStudiesInDaysCriteria(CacheBase + "deleteOldStudiesHasNotViewedInDays");
 const QString InputOutputSettings::DeleteLeastRecentlyUsedStudiesNoFreeSpaceCriteria(CacheBase + "deleteOldStudiesIfNotEnoughSpaceAvailable");
 const QString InputOutputSettings::MinimumDaysUnusedToDeleteStudy(CacheBase + "MaximumDaysNotViewedStudy");
@@ -69,6 +73,10 @@ const QString InputOutputSettings::IncomingDICOMConnectionsPort(PACSParametersBa
 const QString InputOutputSettings::LocalAETitle(PACSParametersBase + "AETitle");
 const QString InputOutputSettings::PACSConnectionTimeout(PACSParametersBase + "timeout");
 const QString InputOutputSettings::MaximumPACSConnections(PACSParametersBase + "MaxConnects");
+const QString InputOutputSettings::MaximumConcurrentRetrieves(PACSParametersBase + "MaximumConcurrentRetrieves");
+const QString InputOutputSettings::MaximumConcurrentRetrievesPerPACS(PACSParametersBase + "MaximumConcurrentRetrievesPerPACS");
+const QString InputOutputSettings::MaximumDICOMFilesPendingToWrite(PACSParametersBase + "MaximumDICOMFilesPendingToWrite");
+const QString InputOutputSettings::MaximumMegaBytesPendingToWrite(PACSParametersBase + "MaximumMegaBytesPendingToWrite");
 
 //TODO: Clau duplicada a CoreSettings
 const QString InputOutputSettings::PacsListConfigurationSectionName = "PacsList";
@@ -110,6 +118,10 @@ void InputOutputSettings::init()
 
     settingsRegistry->addSetting(DatabaseAbsoluteFilePath, UserDataRootPath + "pacs/database/dicom.sdb", Settings::Parseable);
     settingsRegistry->addSetting(CachePath, UserDataRootPath + "pacs/dicom/", Settings::Parseable);
+    settingsRegistry->addSetting(ThumbnailCachePath, UserDataRootPath + "pacs/thumbnails/", Settings::Parseable);
+    settingsRegistry->addSetting(ThumbnailCacheMaximumSizeInMegaBytes, 256);
+    settingsRegistry->addSetting(LocalDatabaseIngestJournalMode, "WAL");
+    settingsRegistry->addSetting(LocalDatabaseIngestSynchronous, "NORMAL");
 
     settingsRegistry->addSetting(DeleteLeastRecentlyUsedStudiesInDaysCriteria, true);
     settingsRegistry->addSetting(DeleteLeastRecentlyUsedStudiesNoFreeSpaceCriteria, true);
@@ -128,6 +140,10 @@ void InputOutputSettings::init()
     settingsRegistry->addSetting(LocalAETitle, QHostInfo::localHostName(), Settings::Parseable);
     settingsRegistry->addSetting(PACSConnectionTimeout, 20);
     settingsRegistry->addSetting(MaximumPACSConnections, 3);
+    settingsRegistry->addSetting(MaximumConcurrentRetrieves, 3);
+    settingsRegistry->addSetting(MaximumConcurrentRetrievesPerPACS, 1);
+    settingsRegistry->addSetting(MaximumDICOMFilesPendingToWrite, 64);
+    settingsRegistry->addSetting(MaximumMegaBytesPendingToWrite, 256);
 
     settingsRegistry->addSetting(ConvertDICOMDIRImagesToLittleEndianKey, false);
 #if defined(Q_OS_WIN)
@@ -31,6 +31,13 @@ public:
     static const QString DatabaseAbsoluteFilePath;
     /// Path del directori de la cache
     static const QString CachePath;
+    /// Path of the directory of the persistent thumbnail cache and maximum size in megabytes of its contents
+    static const QString ThumbnailCachePath;
+    static const QString ThumbnailCacheMaximumSizeInMegaBytes;
+    /// SQLite journal mode (DELETE, TRUNCATE, PERSIST, MEMORY, WAL or OFF) and synchronous level (OFF, NORMAL, FULL or EXTRA) set when saving retrieved
+    /// or imported objects to the local database. If empty, SQLite defaults are kept.
+    static const QString LocalDatabaseIngestJournalMode;
+    static const QString LocalDatabaseIngestSynchronous;
     /// Polítiques d'autogestió de cache
     static const QString DeleteLeastRecentlyUsedStudiesInDaysCriteria;
     static const QString DeleteLeastRecentlyUsedStudiesNoFreeSpaceCriteria;
@@ -70,6 +77,13 @@ public:
     static const QString IncomingDICOMConnectionsPort;
     static const QString PACSConnectionTimeout;
     static const QString MaximumPACSConnections;
+    /// Maximum number of studies retrieved at the same time, in total and from the same PACS
+    static const QString MaximumConcurrentRetrieves;
+    static const QString MaximumConcurrentRetrievesPerPACS;
+    /// Maximum number of retrieved DICOM files waiting to be written to disk. With 0 files are written before answering the store request.
+    static const QString MaximumDICOMFilesPendingToWrite;
+    /// Maximum amount of memory in megabytes used by retrieved DICOM files waiting to be written to disk
+    static const QString MaximumMegaBytesPendingToWrite;
 
     /// Llista de PACS
     //TODO: Clau duplicada a CoreSettings
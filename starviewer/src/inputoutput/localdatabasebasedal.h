@@ -15,6 +15,7 @@
 #ifndef UDGLOCALDATABASEBASEDAL_H
 #define UDGLOCALDATABASEBASEDAL_H
 
+#include <QPair>
 #include <QSqlError>
 
 class QSqlQuery;
@@ -30,6 +31,9 @@ class DatabaseConnection;
 class LocalDatabaseBaseDAL {
 
 public:
+    /// Identifies an image in the database by its SOP Instance UID and frame number.
+    typedef QPair<QString, int> ImageKey;
+
     LocalDatabaseBaseDAL(DatabaseConnection &databaseConnection);
 
     /// Returns the last error.
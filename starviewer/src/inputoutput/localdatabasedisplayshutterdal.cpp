@@ -165,4 +165,22 @@ QList<DisplayShutter> LocalDatabaseDisplayShutterDAL::query(const DicomMask &mas
     return shutterList;
 }
 
+QHash<LocalDatabaseBaseDAL::ImageKey, QList<DisplayShutter> > LocalDatabaseDisplayShutterDAL::queryGroupedByImage(const DicomMask &mask)
+{
+    QSqlQuery query = getNewQuery();
+    prepareQueryWithMask(query, mask, "SELECT Shape, ShutterValue, PointsList, ImageInstanceUID, ImageFrameNumber FROM DisplayShutter");
+    QHash<ImageKey, QList<DisplayShutter> > shuttersByImage;
+
+    if (executeQueryAndLogError(query))
+    {
+        while (query.next())
+        {
+            ImageKey image(query.value("ImageInstanceUID").toString(), query.value("ImageFrameNumber").toInt());
+            shuttersByImage[image] << getDisplayShutter(query);
+        }
+    }
+
+    return shuttersByImage;
+}
+
 }
@@ -17,6 +17,8 @@
 
 #include "localdatabasebasedal.h"
 
+#include <QHash>
+
 namespace udg {
 
 class DicomMask;
@@ -43,6 +45,8 @@ public:
 
     /// Retrieves from the database the display shutters that match the given mask and returns them in a list.
     QList<DisplayShutter> query(const DicomMask &mask);
+    /// Retrieves from the database the display shutters that match the given mask with a single query and returns them grouped by the image they belong to.
+    QHash<ImageKey, QList<DisplayShutter> > queryGroupedByImage(const DicomMask &mask);
 
 };
 
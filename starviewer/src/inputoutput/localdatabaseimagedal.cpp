@@ -28,6 +28,7 @@
 
 #include <QDate>
 #include <QSqlQuery>
+#include <QStringList>
 #include <QVariant>
 #include <QVector2D>
 
@@ -35,6 +36,46 @@ namespace udg {
 
 namespace {
 
+// Columns of the Image table in the order of the values returned by LocalDatabaseImageDAL::getValues().
+const char ImageColumns[] = "SOPInstanceUID, FrameNumber, StudyInstanceUID, SeriesInstanceUID, InstanceNumber, ImageOrientationPatient, "
+                            "PatientOrientation, PixelSpacing, SliceThickness, PatientPosition, SamplesPerPixel, Rows, Columns, BitsAllocated, "
+                            "BitsStored, PixelRepresentation, RescaleSlope, WindowLevelWidth, WindowLevelCenter, WindowLevelExplanations, "
+                            "SliceLocation, RescaleIntercept, PhotometricInterpretation, ImageType, ViewPosition, ImageLaterality, ViewCodeMeaning, "
+                            "PhaseNumber, ImageTime, VolumeNumberInSeries, OrderNumberInVolume, RetrievedDate, RetrievedTime, State, "
+                            "NumberOfOverlays, RetrievedPACSID, ImagerPixelSpacing, EstimatedRadiographicMagnificationFactor, TransferSyntaxUID";
+// Named placeholders of the values returned by LocalDatabaseImageDAL::getValues(), in the same order.
+const char* const ImagePlaceholders[] = { ":sopInstanceUID", ":frameNumber", ":studyInstanceUID", ":seriesInstanceUID", ":instanceNumber",
+                                          ":imageOrientationPatient", ":patientOrientation", ":pixelSpacing", ":sliceThickness", ":patientPosition",
+                                          ":samplesPerPixel", ":rows", ":columns", ":bitsAllocated", ":bitsStored", ":pixelRepresentation",
+                                          ":rescaleSlope", ":windowLevelWidth", ":windowLevelCenter", ":windowLevelExplanations", ":sliceLocation",
+                                          ":rescaleIntercept", ":photometricInterpretation", ":imageType", ":viewPosition", ":imageLaterality",
+                                          ":viewCodeMeaning", ":phaseNumber", ":imageTime", ":volumeNumberInSeries", ":orderNumberInVolume",
+                                          ":retrievedDate", ":retrievedTime", ":state", ":numberOfOverlays", ":retrievedPacsId", ":imagerPixelSpacing",
+                                          ":estimatedRadiographicMagnificationFactor", ":transferSyntaxUID" };
+const int NumberOfImageColumns = sizeof(ImagePlaceholders) / sizeof(ImagePlaceholders[0]);
+// Maximum number of images inserted by a single multi-row insert. SQLite allows at most 999 parameters per statement by default.
+const int MaximumImagesPerInsert = 999 / NumberOfImageColumns;
+
+// Returns the SQL command to insert the given number of images with positional parameters.
+QString getMultiRowInsertSql(int numberOfImages)
+{
+    QStringList columnPlaceholders;
+
+    for (int i = 0; i < NumberOfImageColumns; i++)
+    {
+        columnPlaceholders << "?";
+    }
+
+    QStringList rows;
+
+    for (int i = 0; i < numberOfImages; i++)
+    {
+        rows << "(" + columnPlaceholders.join(", ") + ")";
+    }
+
+    return QString("INSERT INTO Image (%1) VALUES %2").arg(ImageColumns).arg(rows.join(", "));
+}
+
 // Returns pixel spacing formatted as a DICOM string, with values separated by "\\".
 QString pixelSpacingToDicomString(const PixelSpacing2D &pixelSpacing)
 {
@@ -180,6 +221,48 @@ bool LocalDatabaseImageDAL::insert(const Image *image)
     return executeQueryAndLogError(query);
 }
 
+bool LocalDatabaseImageDAL::insert(const QList<Image*> &images)
+{
+    // Full batches reuse the same prepared statement, only the last one may need a shorter statement
+    QSqlQuery fullBatchQuery = getNewQuery();
+    bool fullBatchQueryPrepared = false;
+
+    for (int firstImage = 0; firstImage < images.size(); firstImage += MaximumImagesPerInsert)
+    {
+        int numberOfImages = qMin(MaximumImagesPerInsert, images.size() - firstImage);
+        QSqlQuery lastBatchQuery = getNewQuery();
+        QSqlQuery *query = &fullBatchQuery;
+
+        if (numberOfImages < MaximumImagesPerInsert)
+        {
+            query = &lastBatchQuery;
+            query->prepare(getMultiRowInsertSql(numberOfImages));
+        }
+        else if (!fullBatchQueryPrepared)
+        {
+            query->prepare(getMultiRowInsertSql(numberOfImages));
+            fullBatchQueryPrepared = true;
+        }
+
+        int position = 0;
+
+        for (int i = firstImage; i < firstImage + numberOfImages; i++)
+        {
+            foreach (const QVariant &value, getValues(images.at(i)))
+            {
+                query->bindValue(position++, value);
+            }
+        }
+
+        if (!executeQueryAndLogError(*query))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 bool LocalDatabaseImageDAL::update(const Image *image)
 {
     QSqlQuery query = getNewQuery();
@@ -225,22 +308,20 @@ QList<Image*> LocalDatabaseImageDAL::query(const DicomMask &mask)
 
     if (executeQueryAndLogError(query))
     {
+        // Get display shutters and VOI LUTs of all the images at once instead of querying them for each image
         LocalDatabaseDisplayShutterDAL shutterDAL(m_databaseConnection);
+        QHash<ImageKey, QList<DisplayShutter> > shuttersByImage = shutterDAL.queryGroupedByImage(mask);
         LocalDatabaseVoiLutDAL voiLutDAL(m_databaseConnection);
+        QHash<ImageKey, QList<VoiLut> > voiLutsByImage = voiLutDAL.queryGroupedByImage(mask);
 
         while (query.next())
         {
             Image *image = getImage(query);
+            ImageKey imageKey(image->getSOPInstanceUID(), image->getFrameNumber());
 
-            // Get display shutters
-            DicomMask mask;
-            mask.setSOPInstanceUID(image->getSOPInstanceUID());
-            mask.setImageNumber(QString::number(image->getFrameNumber()));
-            image->setDisplayShutters(shutterDAL.query(mask));
+            image->setDisplayShutters(shuttersByImage.value(imageKey));
 
-            // Get VOI LUTs
-            QList<VoiLut> voiLuts = voiLutDAL.query(mask);
-            foreach (const VoiLut &voiLut, voiLuts)
+            foreach (const VoiLut &voiLut, voiLutsByImage.value(imageKey))
             {
                 image->addVoiLut(voiLut);
             }
@@ -252,6 +333,23 @@ QList<Image*> LocalDatabaseImageDAL::query(const DicomMask &mask)
     return imageList;
 }
 
+QSet<LocalDatabaseBaseDAL::ImageKey> LocalDatabaseImageDAL::queryKeys(const DicomMask &mask)
+{
+    QSqlQuery query = getNewQuery();
+    prepareQueryWithMask(query, mask, "SELECT SOPInstanceUID, FrameNumber FROM Image");
+    QSet<ImageKey> keys;
+
+    if (executeQueryAndLogError(query))
+    {
+        while (query.next())
+        {
+            keys.insert(ImageKey(query.value("SOPInstanceUID").toString(), query.value("FrameNumber").toInt()));
+        }
+    }
+
+    return keys;
+}
+
 int LocalDatabaseImageDAL::count(const DicomMask &mask)
 {
     QSqlQuery query = getNewQuery();
@@ -269,47 +367,61 @@ int LocalDatabaseImageDAL::count(const DicomMask &mask)
 
 void LocalDatabaseImageDAL::bindValues(QSqlQuery &query, const Image *image)
 {
-    query.bindValue(":sopInstanceUID", image->getSOPInstanceUID());
-    query.bindValue(":frameNumber", image->getFrameNumber());
-    query.bindValue(":studyInstanceUID", image->getParentSeries()->getParentStudy()->getInstanceUID());
-    query.bindValue(":seriesInstanceUID", image->getParentSeries()->getInstanceUID());
-    query.bindValue(":instanceNumber", image->getInstanceNumber());
-    query.bindValue(":imageOrientationPatient", image->getImageOrientationPatient().getDICOMFormattedImageOrientation());
-    query.bindValue(":patientOrientation", image->getPatientOrientation().getDICOMFormattedPatientOrientation());
-    query.bindValue(":pixelSpacing", pixelSpacingToDicomString(image->getPixelSpacing()));
-    query.bindValue(":sliceThickness", image->getSliceThickness());
-    query.bindValue(":patientPosition", imagePositionPatientToDicomString(image->getImagePositionPatient()));
-    query.bindValue(":samplesPerPixel", image->getSamplesPerPixel());
-    query.bindValue(":rows", image->getRows());
-    query.bindValue(":columns", image->getColumns());
-    query.bindValue(":bitsAllocated", image->getBitsAllocated());
-    query.bindValue(":bitsStored", image->getBitsStored());
-    query.bindValue(":pixelRepresentation", image->getPixelRepresentation());
-    query.bindValue(":rescaleSlope", image->getRescaleSlope());
+    QList<QVariant> values = getValues(image);
+
+    for (int i = 0; i < NumberOfImageColumns; i++)
+    {
+        query.bindValue(ImagePlaceholders[i], values.at(i));
+    }
+}
+
+QList<QVariant> LocalDatabaseImageDAL::getValues(const Image *image)
+{
     QString windowWidth, windowCenter, windowExplanation;
     windowLevelInformationToDicomStrings(image, windowWidth, windowCenter, windowExplanation);
-    query.bindValue(":windowLevelWidth", windowWidth);
-    query.bindValue(":windowLevelCenter", windowCenter);
-    query.bindValue(":windowLevelExplanations", windowExplanation);
-    query.bindValue(":sliceLocation", image->getSliceLocation());
-    query.bindValue(":rescaleIntercept", image->getRescaleIntercept());
-    query.bindValue(":photometricInterpretation", image->getPhotometricInterpretation().getAsQString());
-    query.bindValue(":imageType", image->getImageType());
-    query.bindValue(":viewPosition", image->getViewPosition());
-    query.bindValue(":imageLaterality", convertToQString(image->getImageLaterality()));
-    query.bindValue(":viewCodeMeaning", image->getViewCodeMeaning());
-    query.bindValue(":phaseNumber", image->getPhaseNumber());
-    query.bindValue(":imageTime", image->getImageTime());
-    query.bindValue(":volumeNumberInSeries", image->getVolumeNumberInSeries());
-    query.bindValue(":orderNumberInVolume", image->getOrderNumberInVolume());
-    query.bindValue(":retrievedDate", image->getRetrievedDate().toString("yyyyMMdd"));
-    query.bindValue(":retrievedTime", image->getRetrievedTime().toString("hhmmss"));
-    query.bindValue(":state", 0);
-    query.bindValue(":numberOfOverlays", image->getNumberOfOverlays());
-    query.bindValue(":retrievedPacsId", getDatabasePacsId(image->getDICOMSource()));
-    query.bindValue(":imagerPixelSpacing", pixelSpacingToDicomString(image->getImagerPixelSpacing()));
-    query.bindValue(":estimatedRadiographicMagnificationFactor", QString::number(image->getEstimatedRadiographicMagnificationFactor()));
-    query.bindValue(":transferSyntaxUID", image->getTransferSyntaxUID());
+
+    QList<QVariant> values;
+    values << image->getSOPInstanceUID();
+    values << image->getFrameNumber();
+    values << image->getParentSeries()->getParentStudy()->getInstanceUID();
+    values << image->getParentSeries()->getInstanceUID();
+    values << image->getInstanceNumber();
+    values << image->getImageOrientationPatient().getDICOMFormattedImageOrientation();
+    values << image->getPatientOrientation().getDICOMFormattedPatientOrientation();
+    values << pixelSpacingToDicomString(image->getPixelSpacing());
+    values << image->getSliceThickness();
+    values << imagePositionPatientToDicomString(image->getImagePositionPatient());
+    values << image->getSamplesPerPixel();
+    values << image->getRows();
+    values << image->getColumns();
+    values << image->getBitsAllocated();
+    values << image->getBitsStored();
+    values << image->getPixelRepresentation();
+    values << image->getRescaleSlope();
+    values << windowWidth;
+    values << windowCenter;
+    values << windowExplanation;
+    values << image->getSliceLocation();
+    values << image->getRescaleIntercept();
+    values << image->getPhotometricInterpretation().getAsQString();
+    values << image->getImageType();
+    values << image->getViewPosition();
+    values << convertToQString(image->getImageLaterality());
+    values << image->getViewCodeMeaning();
+    values << image->getPhaseNumber();
+    values << image->getImageTime();
+    values << image->getVolumeNumberInSeries();
+    values << image->getOrderNumberInVolume();
+    values << image->getRetrievedDate().toString("yyyyMMdd");
+    values << image->getRetrievedTime().toString("hhmmss");
+    values << 0;
+    values << image->getNumberOfOverlays();
+    values << getDatabasePacsId(image->getDICOMSource());
+    values << pixelSpacingToDicomString(image->getImagerPixelSpacing());
+    values << QString::number(image->getEstimatedRadiographicMagnificationFactor());
+    values << image->getTransferSyntaxUID();
+
+    return values;
 }
 
 Image* LocalDatabaseImageDAL::getImage(const QSqlQuery &query)
@@ -18,6 +18,8 @@
 #include "localdatabasebasedal.h"
 
 #include <QHash>
+#include <QSet>
+#include <QVariant>
 
 class QVector2D;
 
@@ -39,6 +41,10 @@ public:
     /// Inserts to the database the given image. Returns true if successful and false otherwise.
     bool insert(const Image *image);
 
+    /// Inserts to the database all the given images with multi-row inserts, reusing the prepared statement between batches. None of the images may already
+    /// exist in the database. Returns true if successful and false otherwise.
+    bool insert(const QList<Image*> &images);
+
     /// Updates in the database the given image. Returns true if successful and false otherwise.
     bool update(const Image *image);
 
@@ -50,6 +56,9 @@ public:
     /// and returns them in a list.
     QList<Image*> query(const DicomMask &mask);
 
+    /// Returns the SOP Instance UID and frame number of the images that match the given mask (only StudyUID, SeriesUID and SOPInstanceUID are considered).
+    QSet<ImageKey> queryKeys(const DicomMask &mask);
+
     /// Counts and returns the number of images that match the given mask (only StudyUID, SeriesUID and SOPInstanceUID are considered).
     /// Returns -1 in case of error.
     int count(const DicomMask &mask);
@@ -58,6 +67,9 @@ private:
     /// Binds the necessary values of the given query with the information of the given image.
     void bindValues(QSqlQuery &query, const Image *image);
 
+    /// Returns the values to store in the database for the given image, in the order of the columns of the Image table.
+    QList<QVariant> getValues(const Image *image);
+
     /// Creates and returns an image with the information of the current row of the given query.
     Image* getImage(const QSqlQuery &query);
 
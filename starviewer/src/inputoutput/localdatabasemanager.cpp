@@ -16,6 +16,7 @@
 
 #include "databaseconnection.h"
 #include "dicommask.h"
+#include "dicomtagreader.h"
 #include "directoryutilities.h"
 #include "harddiskinformation.h"
 #include "image.h"
@@ -29,14 +30,117 @@
 #include "localdatabaseutildal.h"
 #include "localdatabasevoilutdal.h"
 #include "patient.h"
+#include "thumbnailcache.h"
 #include "thumbnailcreator.h"
 
+#include <QAtomicInt>
+#include <QDateTime>
 #include <QDir>
+#include <QDirIterator>
+#include <QImage>
+#include <QMutex>
+#include <QThreadPool>
+#include <QTime>
+#include <QtConcurrentRun>
 
 namespace udg {
 
 namespace {
 
+// Protects the list of studies being retrieved, since several retrieves can be executed at the same time
+QMutex StudiesBeingRetrievedMutex;
+
+// Thread pool where thumbnails of saved objects are created. When it's destroyed at exit the pending thumbnails are discarded, since series without a stored
+// thumbnail create it from their images when it's needed. Only the thumbnails being created at that moment are waited for.
+class ThumbnailsThreadPoolType : public QThreadPool {
+public:
+    ~ThumbnailsThreadPoolType()
+    {
+        clear();
+        waitForDone();
+    }
+};
+
+Q_GLOBAL_STATIC(ThumbnailsThreadPoolType, ThumbnailsThreadPool)
+
+// Set when the application is being closed, so that the directory being deleted is left as it is
+QAtomicInt FileDeletionStopped;
+
+// Thread pool where the files of deleted studies are deleted. When it's destroyed at exit it doesn't wait for the pending deletions: the directories are kept
+// in the deleted studies directory and deleteOldStudies() deletes them at the next startup. Only the file being deleted at that moment is waited for.
+class FileDeletionThreadPoolType : public QThreadPool {
+public:
+    ~FileDeletionThreadPoolType()
+    {
+        clear();
+        FileDeletionStopped.storeRelease(1);
+        waitForDone();
+    }
+};
+
+Q_GLOBAL_STATIC(FileDeletionThreadPoolType, FileDeletionThreadPool)
+
+// Number of studies deleted from the database in each transaction when deleting several studies
+const int StudiesPerDeletionBatch = 50;
+
+// Returns the directory where the directories of deleted studies are moved until their files are deleted.
+QString getDeletedStudiesPath()
+{
+    // Study UIDs can't begin with a dot, so this can't be the directory of a study
+    return LocalDatabaseManager::getCachePath() + ".deleted";
+}
+
+// Deletes the given directory and its contents file by file, stopping as soon as the application is being closed. Returns false if it has not been deleted.
+bool deleteDirectoryUnlessStopped(const QString &directoryPath)
+{
+    QDirIterator iterator(directoryPath, QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+
+    while (iterator.hasNext())
+    {
+        if (FileDeletionStopped.loadAcquire())
+        {
+            return false;
+        }
+
+        QFile::remove(iterator.next());
+    }
+
+    // Only empty directories are left
+    return DirectoryUtilities().deleteDirectory(directoryPath, true);
+}
+
+// Deletes the given directory and its contents in a background thread. Directories are deleted one at a time in the order they are requested.
+void deleteDirectoryInBackground(const QString &directoryPath)
+{
+    FileDeletionThreadPool()->setMaxThreadCount(1);
+    QtConcurrent::run(FileDeletionThreadPool(), [=]()
+    {
+        if (!deleteDirectoryUnlessStopped(directoryPath) && !FileDeletionStopped.loadAcquire())
+        {
+            WARN_LOG("Could not delete the directory of a deleted study: " + directoryPath);
+        }
+    });
+}
+
+// Sets the SQLite pragmas configured for saving retrieved or imported objects. Objects are saved anyway if they can't be set.
+void setIngestPragmas(DatabaseConnection &databaseConnection)
+{
+    Settings settings;
+    QString journalMode = settings.getValue(InputOutputSettings::LocalDatabaseIngestJournalMode).toString();
+    QString synchronous = settings.getValue(InputOutputSettings::LocalDatabaseIngestSynchronous).toString();
+    LocalDatabaseUtilDAL utilDAL(databaseConnection);
+
+    if (!journalMode.isEmpty())
+    {
+        utilDAL.setJournalMode(journalMode);
+    }
+
+    if (!synchronous.isEmpty())
+    {
+        utilDAL.setSynchronous(synchronous);
+    }
+}
+
 // Saves all the display shutters in the given list from the given image to the database.
 void insertDisplayShutters(DatabaseConnection &databaseConnection, const QList<DisplayShutter> &shuttersList, const Image *image)
 {
@@ -126,13 +230,61 @@ void saveImage(DatabaseConnection &databaseConnection, const Image *image)
     insertVoiLuts(databaseConnection, image);
 }
 
-// Saves the images in the given list to the database, inserting or updating them as necessary.
+// Saves the images in the given list, which must belong to the same series, to the database, inserting or updating them as necessary.
+// New images are inserted all at once and the ones that already exist are updated one by one.
 void saveImages(DatabaseConnection &databaseConnection, const QList<Image*> &imageList, const QDate &currentDate, const QTime &currentTime)
 {
+    if (imageList.isEmpty())
+    {
+        return;
+    }
+
+    LocalDatabaseImageDAL imageDAL(databaseConnection);
+    DicomMask mask;
+    mask.setStudyInstanceUID(imageList.first()->getParentSeries()->getParentStudy()->getInstanceUID());
+    mask.setSeriesInstanceUID(imageList.first()->getParentSeries()->getInstanceUID());
+    QSet<LocalDatabaseBaseDAL::ImageKey> savedImageKeys = imageDAL.queryKeys(mask);
+
+    if (imageDAL.getLastError().isValid())
+    {
+        throw imageDAL.getLastError();
+    }
+
+    QList<Image*> newImages;
+    QList<Image*> existingImages;
+
     foreach (Image *image, imageList)
     {
         image->setRetrievedDate(currentDate);
         image->setRetrievedTime(currentTime);
+
+        LocalDatabaseBaseDAL::ImageKey imageKey(image->getSOPInstanceUID(), image->getFrameNumber());
+
+        // An image can be repeated in the list if the same file has been received twice
+        if (savedImageKeys.contains(imageKey))
+        {
+            existingImages.append(image);
+        }
+        else
+        {
+            savedImageKeys.insert(imageKey);
+            newImages.append(image);
+        }
+    }
+
+    if (!imageDAL.insert(newImages))
+    {
+        throw imageDAL.getLastError();
+    }
+
+    foreach (Image *image, newImages)
+    {
+        insertDisplayShutters(databaseConnection, image->getDisplayShutters(), image);
+        insertVoiLuts(databaseConnection, image);
+    }
+
+    foreach (Image *image, existingImages)
+    {
         saveImage(databaseConnection, image);
     }
 }
@@ -244,6 +396,13 @@ void saveStudy(DatabaseConnection &databaseConnection, const Study *study)
         ok = studyDAL.update(study, QDate::currentDate());
     }
 
+    // Keep the size of the study on disk to know how much space is freed by deleting it
+    if (ok)
+    {
+        ok = studyDAL.updateSizeInBytes(study->getInstanceUID(),
+                                        HardDiskInformation::getDirectorySizeInBytes(LocalDatabaseManager::getStudyPath(study->getInstanceUID())));
+    }
+
     if (!ok)
     {
         throw studyDAL.getLastError();
@@ -368,6 +527,31 @@ void deleteSeriesStructureFromDatabase(DatabaseConnection &databaseConnection, c
     deleteEncapsulatedDocumentsFromDatabase(databaseConnection, mask);
 }
 
+// Returns the SOP Instance UIDs of the images of the given series.
+QStringList querySOPInstanceUIDs(DatabaseConnection &databaseConnection, const QString &studyInstanceUID, const QString &seriesInstanceUID)
+{
+    DicomMask mask;
+    mask.setStudyInstanceUID(studyInstanceUID);
+    mask.setSeriesInstanceUID(seriesInstanceUID);
+    LocalDatabaseImageDAL imageDAL(databaseConnection);
+    QSet<LocalDatabaseBaseDAL::ImageKey> imageKeys = imageDAL.queryKeys(mask);
+
+    if (imageDAL.getLastError().isValid())
+    {
+        throw imageDAL.getLastError();
+    }
+
+    // Multiframe images have a key for each frame
+    QSet<QString> sopInstanceUIDs;
+
+    foreach (const LocalDatabaseBaseDAL::ImageKey &imageKey, imageKeys)
+    {
+        sopInstanceUIDs.insert(imageKey.first);
+    }
+
+    return sopInstanceUIDs.toList();
+}
+
 // Deletes from the database the patient, study, series and images from the study with the given UID.
 void deleteStudyStructureFromDatabase(DatabaseConnection &databaseConnection, const QString &studyInstanceUID)
 {
@@ -419,44 +603,137 @@ void deleteRetrievedObjects(const Series *series)
     }
 }
 
-// Returns the full path of the thumbnail file for the given series and study instance UID.
+// Returns the full path of the thumbnail file that older versions stored for the given series in the directory of its images.
 QString getSeriesThumbnailPath(const QString &studyInstanceUID, const Series *series)
 {
     return LocalDatabaseManager::getStudyPath(studyInstanceUID) + "/" + series->getInstanceUID() + "/thumbnail.png";
 }
 
-// Creates and saves a thumbnail for the given series in the directory of the series' images.
-void createSeriesThumbnail(const Series *series)
+// Thumbnail to store in the thumbnail cache. It doesn't depend on the patient tree, which can be destroyed before the thumbnail is created.
+struct PendingThumbnail
+{
+    /// UID the thumbnail is stored with.
+    QString uid;
+    /// Thumbnail already rendered by the volume filler step while processing the retrieved or imported files, if it exists.
+    QString renderedThumbnailPath;
+    /// DICOM file the thumbnail has to be created from if there isn't a rendered thumbnail.
+    QString dicomFilePath;
+    /// Thumbnail that doesn't need any file, such as the icons of non-image series.
+    QImage thumbnail;
+};
+
+// Returns the preview of the given series and the thumbnail of each of its volumes, keyed by the SOP Instance UID of the first image of the volume, that
+// are not in the given thumbnail cache yet.
+QList<PendingThumbnail> getPendingThumbnails(const ThumbnailCache &thumbnailCache, const Series *series)
 {
-    QString thumbnailFilePath = getSeriesThumbnailPath(series->getParentStudy()->getInstanceUID(), series);
+    QString studyInstanceUID = series->getParentStudy()->getInstanceUID();
+    QList<PendingThumbnail> pendingThumbnails;
 
-    // Create thumbnail only if it doesn't already exist
-    if (!QFileInfo(thumbnailFilePath).exists())
+    if (!thumbnailCache.contains(studyInstanceUID, series->getInstanceUID()))
     {
-        ThumbnailCreator().getThumbnail(series).save(thumbnailFilePath, "PNG");
+        PendingThumbnail pendingThumbnail;
+        pendingThumbnail.uid = series->getInstanceUID();
+        pendingThumbnail.renderedThumbnailPath = getSeriesThumbnailPath(studyInstanceUID, series);
+
+        // Same image that ThumbnailCreator would use. The rest of series get an icon, which is cheap to create now.
+        QString modality = series->getModality();
+
+        if (series->hasImages() && modality != "KO" && modality != "PR" && modality != "SR")
+        {
+            pendingThumbnail.dicomFilePath = series->getImages().at(series->getImages().size() / 2)->getPath();
+        }
+        else
+        {
+            pendingThumbnail.thumbnail = ThumbnailCreator().getThumbnail(series);
+        }
+
+        pendingThumbnails.append(pendingThumbnail);
     }
+
+    int volumeNumber = -1;
+
+    foreach (Image *image, series->getImages())
+    {
+        if (image->getVolumeNumberInSeries() == volumeNumber)
+        {
+            continue;
+        }
+
+        volumeNumber = image->getVolumeNumberInSeries();
+
+        if (!thumbnailCache.contains(studyInstanceUID, image->getSOPInstanceUID()))
+        {
+            PendingThumbnail pendingThumbnail;
+            pendingThumbnail.uid = image->getSOPInstanceUID();
+            pendingThumbnail.renderedThumbnailPath = QString("%1/thumbnail%2.png").arg(QFileInfo(image->getPath()).absolutePath()).arg(volumeNumber);
+            pendingThumbnail.dicomFilePath = image->getPath();
+            pendingThumbnails.append(pendingThumbnail);
+        }
+    }
+
+    return pendingThumbnails;
 }
 
-// Creates and saves a thumbnail for each series in the given study.
-void createStudyThumbnails(const Study *study)
+// Creates the given thumbnails of the study with the given UID, stores them in the thumbnail cache and keeps the cache within its maximum size.
+void createThumbnails(const QString &studyInstanceUID, const QList<PendingThumbnail> &pendingThumbnails)
 {
-    foreach (Series *series, study->getSeries())
+    ThumbnailCache thumbnailCache;
+
+    foreach (const PendingThumbnail &pendingThumbnail, pendingThumbnails)
     {
-        createSeriesThumbnail(series);
+        QImage thumbnail = pendingThumbnail.thumbnail;
+
+        if (thumbnail.isNull())
+        {
+            thumbnail.load(pendingThumbnail.renderedThumbnailPath);
+        }
+
+        if (thumbnail.isNull() && !pendingThumbnail.dicomFilePath.isEmpty())
+        {
+            DICOMTagReader reader(pendingThumbnail.dicomFilePath);
+            thumbnail = ThumbnailCreator().getThumbnail(&reader);
+        }
+
+        thumbnailCache.storeThumbnail(studyInstanceUID, pendingThumbnail.uid, thumbnail);
     }
+
+    thumbnailCache.enforceMaximumSize(studyInstanceUID);
+}
+
+// Creates the thumbnails of the given series of the study with the given UID in a background thread, so that saving objects doesn't wait for them to be
+// decoded. The thumbnails are created one study at a time in the order they are requested.
+void createThumbnailsInBackground(const QString &studyInstanceUID, const QList<Series*> &seriesList)
+{
+    ThumbnailCache thumbnailCache;
+    QList<PendingThumbnail> pendingThumbnails;
+
+    foreach (Series *series, seriesList)
+    {
+        pendingThumbnails.append(getPendingThumbnails(thumbnailCache, series));
+    }
+
+    ThumbnailsThreadPool()->setMaxThreadCount(1);
+    QtConcurrent::run(ThumbnailsThreadPool(), [=]() { createThumbnails(studyInstanceUID, pendingThumbnails); });
 }
 
 // Loads and sets the thumbnails of the given series from the study with the given UID.
 void loadSeriesThumbnails(const QString &studyInstanceUID, const QList<Series*> &seriesList)
 {
+    ThumbnailCache thumbnailCache;
+
     foreach (Series *series, seriesList)
     {
-        QString thumbnailPath = getSeriesThumbnailPath(studyInstanceUID, series);
-        QFileInfo thumbnailFile(thumbnailPath);
+        QImage thumbnail = thumbnailCache.getThumbnail(studyInstanceUID, series->getInstanceUID());
 
-        if (thumbnailFile.exists())
+        // Studies retrieved by older versions only have the thumbnail in the directory of the images
+        if (thumbnail.isNull())
         {
-            series->setThumbnail(QPixmap(thumbnailPath));
+            thumbnail.load(getSeriesThumbnailPath(studyInstanceUID, series));
+        }
+
+        if (!thumbnail.isNull())
+        {
+            series->setThumbnail(QPixmap::fromImage(thumbnail));
         }
     }
 }
@@ -507,6 +784,7 @@ void LocalDatabaseManager::save(Series *series)
     try
     {
         DatabaseConnection databaseConnection;
+        setIngestPragmas(databaseConnection);
         databaseConnection.beginTransaction();
 
         Study *study = series->getParentStudy();
@@ -524,7 +802,7 @@ void LocalDatabaseManager::save(Series *series)
 
         databaseConnection.commitTransaction();
 
-        createSeriesThumbnail(series);
+        createThumbnailsInBackground(study->getInstanceUID(), seriesList);
 
         m_lastError = Ok;
     }
@@ -548,8 +826,11 @@ QList<Patient*> LocalDatabaseManager::queryPatientsAndStudies(const DicomMask &m
 {
     DatabaseConnection databaseConnection;
     LocalDatabaseStudyDAL studyDAL(databaseConnection);
+    QTime time;
+    time.start();
     QList<Patient*> patientList = studyDAL.queryPatientStudy(mask, QDate(), LastAccessDateSelectedStudies);
     setLastError(studyDAL.getLastError());
+    INFO_LOG(QString("Patients and studies queried from the local database in %1 ms (%2 results)").arg(time.elapsed()).arg(patientList.size()));
     return patientList;
 }
 
@@ -752,10 +1033,12 @@ void LocalDatabaseManager::deleteSeries(const QString &studyInstanceUID, const Q
         {
             DatabaseConnection databaseConnection;
             databaseConnection.beginTransaction();
+            // The volume thumbnails are keyed by SOP Instance UID, which can only be known before deleting the images
+            QStringList sopInstanceUIDs = querySOPInstanceUIDs(databaseConnection, studyInstanceUID, seriesInstanceUID);
             deleteSeriesStructureFromDatabase(databaseConnection, studyInstanceUID, seriesInstanceUID);
             databaseConnection.commitTransaction();
 
-            deleteSeriesFromHardDisk(studyInstanceUID, seriesInstanceUID);
+            deleteSeriesFromHardDisk(studyInstanceUID, seriesInstanceUID, sopInstanceUIDs);
 
             m_lastError = Ok;
         }
@@ -770,35 +1053,21 @@ void LocalDatabaseManager::deleteOldStudies()
 {
     m_lastError = Ok;
 
-    // If the setting is false don't do anything
-    if (!Settings().getValue(InputOutputSettings::DeleteLeastRecentlyUsedStudiesInDaysCriteria).toBool())
+    // Files of studies deleted before the application was closed may not have been deleted yet, since exiting doesn't wait for them
+    foreach (const QFileInfo &deletedStudy, QDir(getDeletedStudiesPath()).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
     {
-        return;
+        deleteDirectoryInBackground(deletedStudy.absoluteFilePath());
     }
 
-    DatabaseConnection databaseConnection;
-    LocalDatabaseStudyDAL studyDAL(databaseConnection);
-
-    INFO_LOG(QString("Deleting studies that haven't been open since %1").arg(LastAccessDateSelectedStudies.addDays(-1).toString("dd/MM/yyyy")));
-
-    QList<Study*> studiesToDelete = studyDAL.query(DicomMask(), LastAccessDateSelectedStudies);
-
-    if (studyDAL.getLastError().isValid())
+    // If the setting is false don't do anything
+    if (!Settings().getValue(InputOutputSettings::DeleteLeastRecentlyUsedStudiesInDaysCriteria).toBool())
     {
-        setLastError(studyDAL.getLastError());
         return;
     }
 
-    if (studiesToDelete.isEmpty())
-    {
-        INFO_LOG("No studies to delete.");
-    }
+    INFO_LOG(QString("Deleting studies that haven't been open since %1").arg(LastAccessDateSelectedStudies.addDays(-1).toString("dd/MM/yyyy")));
 
-    foreach (Study *study, studiesToDelete)
-    {
-        deleteStudy(study->getInstanceUID());
-        delete study;
-    }
+    deleteLeastValuableStudies(LastAccessDateSelectedStudies, -1);
 }
 
 void LocalDatabaseManager::compact()
@@ -880,12 +1149,33 @@ bool LocalDatabaseManager::thereIsAvailableSpaceOnHardDisk()
 
 void LocalDatabaseManager::setStudyBeingRetrieved(const QString &studyInstanceUID)
 {
-    Settings().setValue(InputOutputSettings::RetrievingStudy, studyInstanceUID);
+    QMutexLocker locker(&StudiesBeingRetrievedMutex);
+    Settings settings;
+    QStringList studiesBeingRetrieved = settings.getValue(InputOutputSettings::RetrievingStudy).toStringList();
+
+    if (!studiesBeingRetrieved.contains(studyInstanceUID))
+    {
+        studiesBeingRetrieved.append(studyInstanceUID);
+    }
+
+    settings.setValue(InputOutputSettings::RetrievingStudy, studiesBeingRetrieved);
 }
 
-void LocalDatabaseManager::setNoStudyBeingRetrieved()
+void LocalDatabaseManager::setNoStudyBeingRetrieved(const QString &studyInstanceUID)
 {
-    Settings().remove(InputOutputSettings::RetrievingStudy);
+    QMutexLocker locker(&StudiesBeingRetrievedMutex);
+    Settings settings;
+    QStringList studiesBeingRetrieved = settings.getValue(InputOutputSettings::RetrievingStudy).toStringList();
+    studiesBeingRetrieved.removeAll(studyInstanceUID);
+
+    if (studiesBeingRetrieved.isEmpty())
+    {
+        settings.remove(InputOutputSettings::RetrievingStudy);
+    }
+    else
+    {
+        settings.setValue(InputOutputSettings::RetrievingStudy, studiesBeingRetrieved);
+    }
 }
 
 bool LocalDatabaseManager::isAStudyBeingRetrieved() const
@@ -899,28 +1189,31 @@ void LocalDatabaseManager::deleteStudyBeingRetrieved()
 
     if (isAStudyBeingRetrieved())
     {
-        Settings settings;
-        QString studyInstanceUID = settings.getValue(InputOutputSettings::RetrievingStudy).toString();
+        // Older versions stored a single UID, which is read as a list of one element
+        QStringList studiesBeingRetrieved = Settings().getValue(InputOutputSettings::RetrievingStudy).toStringList();
 
-        INFO_LOG(QString("Study %1 was being downloaded when Starviewer finished. Its images will be deleted to maintain local cache integrity.")
-                 .arg(studyInstanceUID));
-
-        // The study could have really been fully downloaded and the application have finished just before clearing the setting,
-        // so we must delete the study if it exists in the database.
-        if (studyExists(studyInstanceUID))
-        {
-            deleteStudy(studyInstanceUID);
-        }
-        else
+        foreach (const QString &studyInstanceUID, studiesBeingRetrieved)
         {
-            // Check if the directory really exists. It might not exist if not a single image was downloaded.
-            if (QDir().exists(getStudyPath(studyInstanceUID)))
+            INFO_LOG(QString("Study %1 was being downloaded when Starviewer finished. Its images will be deleted to maintain local cache integrity.")
+                     .arg(studyInstanceUID));
+
+            // The study could have really been fully downloaded and the application have finished just before clearing the setting,
+            // so we must delete the study if it exists in the database.
+            if (studyExists(studyInstanceUID))
             {
-                deleteStudyFromHardDisk(studyInstanceUID);
+                deleteStudy(studyInstanceUID);
+            }
+            else
+            {
+                // Check if the directory really exists. It might not exist if not a single image was downloaded.
+                if (QDir().exists(getStudyPath(studyInstanceUID)))
+                {
+                    deleteStudyFromHardDisk(studyInstanceUID);
+                }
             }
-        }
 
-        setNoStudyBeingRetrieved();
+            setNoStudyBeingRetrieved(studyInstanceUID);
+        }
     }
 }
 
@@ -947,15 +1240,19 @@ void LocalDatabaseManager::save(Patient *patient)
 
     try {
         DatabaseConnection databaseConnection;
+        setIngestPragmas(databaseConnection);
         databaseConnection.beginTransaction();
 
+        QTime time;
+        time.start();
         saveStudies(databaseConnection, patient->getStudies(), QDate::currentDate(), QTime::currentTime());
 
         databaseConnection.commitTransaction();
+        INFO_LOG(QString("Patient %1 saved to the local database in %2 ms").arg(patient->getFullName()).arg(time.elapsed()));
 
         foreach (Study *study, patient->getStudies())
         {
-            createStudyThumbnails(study);
+            createThumbnailsInBackground(study->getInstanceUID(), study->getSeries());
         }
 
         m_lastError = Ok;
@@ -969,48 +1266,105 @@ void LocalDatabaseManager::save(Patient *patient)
 
 void LocalDatabaseManager::freeUpSpaceDeletingStudies(quint64 megabytesToFreeUp)
 {
-    QList<Study*> studyList = getAllStudiesOrderedByLastAccessDate();
+    deleteLeastValuableStudies(QDate(), megabytesToFreeUp * 1024 * 1024);
 
-    if (getLastError() != Ok)
-    {
-        return;
-    }
+    // The space is not available until the files are really deleted
+    FileDeletionThreadPool()->waitForDone();
+}
 
-    quint64 megabytesErased = 0;
+qint64 LocalDatabaseManager::deleteLeastValuableStudies(const QDate &accessedBefore, qint64 bytesToFree)
+{
+    m_lastError = Ok;
 
-    while (!studyList.isEmpty() && megabytesErased < megabytesToFreeUp)
+    QTime time;
+    time.start();
+    int numberOfDeletedStudies = 0;
+    qint64 bytesFreed = 0;
+
+    while (m_lastError == Ok && (bytesToFree < 0 || bytesFreed < bytesToFree))
     {
-        Study *study = studyList.takeFirst();
-        emit studyWillBeDeleted(study->getInstanceUID());
-        megabytesErased += HardDiskInformation::getDirectorySizeInBytes(getCachePath() + study->getInstanceUID()) / 1024 / 1024;
-        deleteStudy(study->getInstanceUID());
-        delete study;
+        DatabaseConnection databaseConnection;
+        LocalDatabaseStudyDAL studyDAL(databaseConnection);
+        QList<QPair<QString, qint64> > studies = studyDAL.queryLeastValuable(accessedBefore, StudiesPerDeletionBatch);
+
+        if (studyDAL.getLastError().isValid())
+        {
+            setLastError(studyDAL.getLastError());
+            break;
+        }
+
+        if (studies.isEmpty())
+        {
+            break;
+        }
+
+        // Studies are deleted from the database in batches to keep the number of transactions low, and then their files are deleted in the background
+        QStringList deletedStudies;
+
+        try
+        {
+            databaseConnection.beginTransaction();
+
+            for (int i = 0; i < studies.size() && (bytesToFree < 0 || bytesFreed < bytesToFree); i++)
+            {
+                QString studyInstanceUID = studies.at(i).first;
+                qint64 sizeInBytes = studies.at(i).second;
+
+                // Studies saved by older versions don't have their size in the database
+                if (sizeInBytes < 0)
+                {
+                    sizeInBytes = HardDiskInformation::getDirectorySizeInBytes(getStudyPath(studyInstanceUID));
+                }
+
+                emit studyWillBeDeleted(studyInstanceUID);
+                deleteStudyStructureFromDatabase(databaseConnection, studyInstanceUID);
+                deletedStudies.append(studyInstanceUID);
+                bytesFreed += sizeInBytes;
+            }
 
-        if (getLastError() != Ok)
+            databaseConnection.commitTransaction();
+        }
+        catch (const QSqlError &error)
         {
+            setLastError(error);
             break;
         }
+
+        foreach (const QString &studyInstanceUID, deletedStudies)
+        {
+            deleteStudyFromHardDisk(studyInstanceUID);
+        }
+
+        numberOfDeletedStudies += deletedStudies.size();
     }
 
-    // Delete remaining studies (in case of error)
-    foreach (Study *study, studyList)
+    if (numberOfDeletedStudies == 0)
     {
-        delete study;
+        INFO_LOG("No studies to delete.");
+    }
+    else
+    {
+        INFO_LOG(QString("%1 studies (%2 MiB) deleted from the local database in %3 ms").arg(numberOfDeletedStudies).arg(bytesFreed / 1024 / 1024)
+                 .arg(time.elapsed()));
     }
-}
 
-QList<Study*> LocalDatabaseManager::getAllStudiesOrderedByLastAccessDate()
-{
-    DatabaseConnection databaseConnection;
-    LocalDatabaseStudyDAL studyDAL(databaseConnection);
-    QList<Study*> studyList = studyDAL.queryOrderByLastAccessDate(DicomMask(), QDate(), LastAccessDateSelectedStudies);
-    setLastError(studyDAL.getLastError());
-    return studyList;
+    return bytesFreed;
 }
 
 void LocalDatabaseManager::deleteStudyFromHardDisk(const QString &studyInstanceUID)
 {
-    if (DirectoryUtilities().deleteDirectory(getStudyPath(studyInstanceUID), true))
+    ThumbnailCache().removeStudy(studyInstanceUID);
+
+    // The directory is moved out of the cache, which is immediate, so that the study can be retrieved again while its old files are being deleted
+    QString studyPath = getStudyPath(studyInstanceUID);
+    QString deletedStudyPath = QString("%1/%2.%3").arg(getDeletedStudiesPath()).arg(studyInstanceUID).arg(QDateTime::currentMSecsSinceEpoch());
+
+    if (QDir().mkpath(getDeletedStudiesPath()) && QDir().rename(studyPath, deletedStudyPath))
+    {
+        deleteDirectoryInBackground(deletedStudyPath);
+        m_lastError = Ok;
+    }
+    else if (DirectoryUtilities().deleteDirectory(studyPath, true))
     {
         m_lastError = Ok;
     }
@@ -1020,8 +1374,12 @@ void LocalDatabaseManager::deleteStudyFromHardDisk(const QString &studyInstanceU
     }
 }
 
-void LocalDatabaseManager::deleteSeriesFromHardDisk(const QString &studyInstanceUID, const QString &seriesInstanceUID)
+void LocalDatabaseManager::deleteSeriesFromHardDisk(const QString &studyInstanceUID, const QString &seriesInstanceUID, const QStringList &sopInstanceUIDs)
 {
+    ThumbnailCache thumbnailCache;
+    thumbnailCache.removeThumbnail(studyInstanceUID, seriesInstanceUID);
+    thumbnailCache.removeThumbnails(studyInstanceUID, sopInstanceUIDs);
+
     if (DirectoryUtilities().deleteDirectory(getStudyPath(studyInstanceUID) + QDir::separator() + seriesInstanceUID, true))
     {
         m_lastError = Ok;
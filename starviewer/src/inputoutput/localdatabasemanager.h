@@ -16,6 +16,7 @@
 #define UDGLOCALDATABASEMANAGER_H
 
 #include <QObject>
+#include <QStringList>
 
 class QSqlError;
 
@@ -96,16 +97,16 @@ public:
     bool thereIsAvailableSpaceOnHardDisk();
 
     /// Saves a setting to know that a study with the given UID is being retrieved. This is saved in order to delete a half-downloaded study in case the
-    /// application crashes in the middle of a download. Note: only one study at a time can be marked as being retrieved.
+    /// application crashes in the middle of a download. Several studies can be marked as being retrieved at the same time.
     /// TODO should this really be here?
     void setStudyBeingRetrieved(const QString &studyInstanceUID);
-    /// Clears the setting set in the above method to indicated that no study is being retrieved.
+    /// Clears the mark set in the above method for the study with the given UID.
     /// TODO should this really be here?
-    void setNoStudyBeingRetrieved();
+    void setNoStudyBeingRetrieved(const QString &studyInstanceUID);
     /// Return true if a study is being retrieved.
     /// TODO should this really be here?
     bool isAStudyBeingRetrieved() const;
-    /// If there is a study marked as being retrieved, this method will delete its images and leave the database in a consistent state. This method is intended
+    /// If there are studies marked as being retrieved, this method will delete their images and leave the database in a consistent state. This method is intended
     /// to delete a half-downloaded study in case the application crashes in the middle of a download. It should be called at the start of the application.
     /// TODO should this really be here?
     void deleteStudyBeingRetrieved();
@@ -118,20 +119,24 @@ public slots:
     void save(Patient *patient);
 
 signals:
-    /// This signal is emitted before a study is deleted from the local database and the disk to free up space.
+    /// This signal is emitted before a study is deleted from the local database and the disk to free up space or because it's old.
     void studyWillBeDeleted(const QString &studyInstanceUID);
 
+protected:
+    /// Deletes the least valuable studies (see LocalDatabaseStudyDAL::queryLeastValuable()) last accessed before the given date, if valid, until their
+    /// files add up to the given number of bytes, or all of them if it's negative. Studies are deleted from the database in batches and their files are
+    /// deleted in a background thread. Returns the number of bytes of the deleted studies.
+    qint64 deleteLeastValuableStudies(const QDate &accessedBefore, qint64 bytesToFree);
+
 private:
-    /// Deletes old studies until the given number of megabytes have been deleted.
+    /// Deletes old studies until the given number of megabytes have been deleted. Returns when their files have been deleted.
     void freeUpSpaceDeletingStudies(quint64 megbytesToFreeUp);
 
-    /// Returns all the studies sorted by last access date.
-    QList<Study*> getAllStudiesOrderedByLastAccessDate();
-
-    /// Deletes the study with the given UID from the disk.
+    /// Deletes the study with the given UID from the disk. The files are deleted in a background thread if possible.
     void deleteStudyFromHardDisk(const QString &studyInstanceUID);
-    /// Deletes the series with the given UID from the study with the given UID from the disk.
-    void deleteSeriesFromHardDisk(const QString &studyInstanceUID, const QString &seriesInstanceUID);
+    /// Deletes the series with the given UID from the study with the given UID from the disk, along with its preview and the thumbnails of the images with
+    /// the given SOP Instance UIDs.
+    void deleteSeriesFromHardDisk(const QString &studyInstanceUID, const QString &seriesInstanceUID, const QStringList &sopInstanceUIDs);
 
     /// Sets the last error according to the given SQL error.
     void setLastError(const QSqlError &error);
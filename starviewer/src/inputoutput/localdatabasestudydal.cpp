@@ -103,18 +103,46 @@ void prepareSelectFromStudyPatient(QSqlQuery &query, const DicomMask &mask, cons
                           "Patient.ID AS Patient_ID, Patient.DICOMPatientId AS Patient_DICOMPatientId, Patient.Name AS Patient_Name, "
                           "Patient.BirthDate AS Patient_BirthDate, Patient.Sex AS Patient_Sex "
                    "FROM Study, Patient");
-    QString where(" WHERE PatientID = Patient_ID");
+    // Both join conditions are equivalent, but each one allows to use an index in one direction: the first one the index on Study.PatientID (which is
+    // TEXT) and the second one the primary key of Patient (which is INTEGER)
+    QString where(" WHERE Study.PatientID = CAST(Patient.ID AS TEXT) AND Patient.ID = Study.PatientID");
+    QString patientID = mask.getPatientID();
+    QString patientName = mask.getPatientName();
+    QString studyDescription = mask.getStudyDescription();
+    bool filterByPatientID = !patientID.isEmpty() && patientID != "*";
+    bool filterByPatientName = !patientName.isEmpty() && patientName != "*";
+    bool filterByStudyDescription = !studyDescription.isEmpty() && studyDescription != "*";
+
     if (!mask.getStudyInstanceUID().isEmpty())
     {
         where += " AND InstanceUID = :instanceUID";
     }
-    if (!mask.getPatientID().isEmpty() && mask.getPatientID() != "*")
+    if (filterByPatientID)
     {
-        where += " AND Patient_DICOMPatientId LIKE :patient_dicomPatientId";
+        // A prefix LIKE can use the NOCASE index on DICOMPatientId, any other mask is matched as a substring as it always has been
+        where += " AND Patient.DICOMPatientId LIKE :patient_dicomPatientId ESCAPE '\\'";
     }
-    if (!mask.getPatientName().isEmpty() && mask.getPatientName() != "*")
+    if (filterByPatientName)
     {
-        where += " AND Patient_Name LIKE :patient_patientName";
+        if (LocalDatabaseStudyDAL::canUseFullTextSearch(patientName))
+        {
+            where += " AND Patient.ID IN (SELECT docid FROM PatientNameSearch WHERE PatientNameSearch MATCH :patient_patientName)";
+        }
+        else
+        {
+            where += " AND Patient.Name LIKE :patient_patientName ESCAPE '\\'";
+        }
+    }
+    if (filterByStudyDescription)
+    {
+        if (LocalDatabaseStudyDAL::canUseFullTextSearch(studyDescription))
+        {
+            where += " AND Study.rowid IN (SELECT docid FROM StudyDescriptionSearch WHERE StudyDescriptionSearch MATCH :description)";
+        }
+        else
+        {
+            where += " AND Description LIKE :description ESCAPE '\\'";
+        }
     }
     if (mask.getStudyDateMinimum().isValid())
     {
@@ -144,13 +172,21 @@ void prepareSelectFromStudyPatient(QSqlQuery &query, const DicomMask &mask, cons
     {
         query.bindValue(":instanceUID", mask.getStudyInstanceUID());
     }
-    if (!mask.getPatientID().isEmpty() && mask.getPatientID() != "*")
+    if (filterByPatientID)
     {
-        query.bindValue(":patient_dicomPatientId", QString("%%1%").arg(mask.getPatientID().replace("*", "")));
+        query.bindValue(":patient_dicomPatientId", LocalDatabaseStudyDAL::isStartsWithMask(patientID) ? LocalDatabaseStudyDAL::getStartsWithLikePattern(patientID)
+                                                                                                      : LocalDatabaseStudyDAL::getContainsLikePattern(patientID));
     }
-    if (!mask.getPatientName().isEmpty() && mask.getPatientName() != "*")
+    if (filterByPatientName)
     {
-        query.bindValue(":patient_patientName", QString("%%1%").arg(mask.getPatientName().replace("*", "")));
+        query.bindValue(":patient_patientName", LocalDatabaseStudyDAL::canUseFullTextSearch(patientName) ? LocalDatabaseStudyDAL::getFullTextQuery(patientName)
+                                                                                                         : LocalDatabaseStudyDAL::getContainsLikePattern(patientName));
+    }
+    if (filterByStudyDescription)
+    {
+        query.bindValue(":description", LocalDatabaseStudyDAL::canUseFullTextSearch(studyDescription)
+                                        ? LocalDatabaseStudyDAL::getFullTextQuery(studyDescription)
+                                        : LocalDatabaseStudyDAL::getContainsLikePattern(studyDescription));
     }
     if (mask.getStudyDateMinimum().isValid())
     {
@@ -261,6 +297,47 @@ bool LocalDatabaseStudyDAL::exists(const QString &studyInstanceUID)
     return executeQueryAndLogError(query) && query.next();
 }
 
+bool LocalDatabaseStudyDAL::updateSizeInBytes(const QString &studyInstanceUID, qint64 sizeInBytes)
+{
+    QSqlQuery query = getNewQuery();
+    query.prepare("UPDATE Study SET SizeInBytes = :sizeInBytes WHERE InstanceUID = :instanceUID");
+    query.bindValue(":sizeInBytes", sizeInBytes);
+    query.bindValue(":instanceUID", studyInstanceUID);
+    return executeQueryAndLogError(query);
+}
+
+QList<QPair<QString, qint64> > LocalDatabaseStudyDAL::queryLeastValuable(const QDate &accessedBefore, int maximumNumberOfStudies)
+{
+    QSqlQuery query = getNewQuery();
+    QString where;
+
+    if (accessedBefore.isValid())
+    {
+        where = " WHERE LastAccessDate < :accessedBefore";
+    }
+
+    query.prepare("SELECT InstanceUID, SizeInBytes FROM Study" + where + " ORDER BY LastAccessDate, SizeInBytes DESC LIMIT :limit");
+
+    if (accessedBefore.isValid())
+    {
+        query.bindValue(":accessedBefore", accessedBefore.toString("yyyyMMdd"));
+    }
+
+    query.bindValue(":limit", maximumNumberOfStudies);
+    QList<QPair<QString, qint64> > studies;
+
+    if (executeQueryAndLogError(query))
+    {
+        while (query.next())
+        {
+            qint64 sizeInBytes = query.value("SizeInBytes").isNull() ? -1 : query.value("SizeInBytes").toLongLong();
+            studies.append(qMakePair(query.value("InstanceUID").toString(), sizeInBytes));
+        }
+    }
+
+    return studies;
+}
+
 qlonglong LocalDatabaseStudyDAL::getPatientIDFromStudyInstanceUID(const QString &studyInstanceUID)
 {
     QSqlQuery query = getNewQuery();
@@ -277,6 +354,90 @@ qlonglong LocalDatabaseStudyDAL::getPatientIDFromStudyInstanceUID(const QString
     }
 }
 
+bool LocalDatabaseStudyDAL::canUseFullTextSearch(const QString &value)
+{
+    bool hasWords = false;
+
+    for (int i = 0; i < value.size(); i++)
+    {
+        bool isLastCharacter = i + 1 == value.size();
+
+        if (value.at(i) == '?')
+        {
+            return false;
+        }
+        else if (value.at(i) == '*')
+        {
+            // A '*' followed by a letter would be a wildcard at the beginning or in the middle of a word
+            if (!isLastCharacter && value.at(i + 1).isLetterOrNumber())
+            {
+                return false;
+            }
+        }
+        else if (value.at(i).isLetterOrNumber())
+        {
+            hasWords = true;
+
+            // Every word must end with '*', otherwise the user expects it to match anywhere in the value
+            if (isLastCharacter || (!value.at(i + 1).isLetterOrNumber() && value.at(i + 1) != '*'))
+            {
+                return false;
+            }
+        }
+    }
+
+    return hasWords;
+}
+
+QString LocalDatabaseStudyDAL::getFullTextQuery(const QString &value)
+{
+    QStringList terms;
+    QString word;
+
+    foreach (const QChar &character, value + ' ')
+    {
+        if (character.isLetterOrNumber())
+        {
+            word += character;
+        }
+        else if (!word.isEmpty())
+        {
+            terms << word + '*';
+            word.clear();
+        }
+    }
+
+    return terms.join(' ');
+}
+
+QString LocalDatabaseStudyDAL::getContainsLikePattern(const QString &value)
+{
+    return QString("%%1%").arg(toLikePattern(value));
+}
+
+bool LocalDatabaseStudyDAL::isStartsWithMask(const QString &value)
+{
+    if (value.size() < 2 || !value.endsWith('*'))
+    {
+        return false;
+    }
+
+    QString prefix = value.left(value.size() - 1);
+    return !prefix.contains('*') && !prefix.contains('?');
+}
+
+QString LocalDatabaseStudyDAL::getStartsWithLikePattern(const QString &value)
+{
+    return toLikePattern(value);
+}
+
+QString LocalDatabaseStudyDAL::toLikePattern(const QString &value)
+{
+    QString pattern = value;
+    pattern.replace('\\', "\\\\").replace('%', "\\%").replace('_', "\\_").replace('*', '%').replace('?', '_');
+    return pattern;
+}
+
 Study* LocalDatabaseStudyDAL::getStudy(const QSqlQuery &query)
 {
     Study *study = new Study();
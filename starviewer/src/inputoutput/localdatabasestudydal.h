@@ -18,6 +18,7 @@
 #include "localdatabasebasedal.h"
 
 #include <QDate>
+#include <QPair>
 
 namespace udg {
 
@@ -58,11 +59,39 @@ public:
     /// Returns true if there's a study with the given UID in the database, and false otherwise.
     bool exists(const QString &studyInstanceUID);
 
+    /// Stores the given size in bytes of the files of the study with the given UID. Returns true if successful and false otherwise.
+    bool updateSizeInBytes(const QString &studyInstanceUID, qint64 sizeInBytes);
+
+    /// Returns the UID and the size in bytes of the files of at most the given number of studies whose last access date is before \a accessedBefore (if it's
+    /// valid), ordered from the least valuable to keep: least recently accessed first and, among studies accessed the same day, biggest first.
+    /// The size is -1 for studies whose size is not known yet.
+    QList<QPair<QString, qint64> > queryLeastValuable(const QDate &accessedBefore, int maximumNumberOfStudies);
+
     /// Returns the PatientID field (referencing the database ID of a patient) from the study with the given StudyInstanceUID.
     /// If there is no such study, returns -1.
     qlonglong getPatientIDFromStudyInstanceUID(const QString &studyInstanceUID);
 
+    /// Returns true if the given DICOM matching value can be searched in a full-text index, i.e. if it has some word, doesn't contain '?' and every word
+    /// ends with '*'. Values without wildcards are matched as substrings instead, which the full-text index can't do.
+    static bool canUseFullTextSearch(const QString &value);
+
+    /// Returns a full-text query that matches the rows that contain words beginning with each of the words of the given value, in any order.
+    static QString getFullTextQuery(const QString &value);
+
+    /// Returns a LIKE pattern that matches the rows that contain the given DICOM matching value, translating its wildcards. Uses '\' as escape character.
+    static QString getContainsLikePattern(const QString &value);
+
+    /// Returns true if the given DICOM matching value is a prefix, i.e. it ends with '*' and doesn't contain any other wildcard.
+    static bool isStartsWithMask(const QString &value);
+
+    /// Returns a LIKE pattern that matches the rows that begin with the prefix given as a DICOM matching value. Uses '\' as escape character.
+    /// Since the pattern doesn't begin with a wildcard, SQLite can solve it with an index with NOCASE collation.
+    static QString getStartsWithLikePattern(const QString &value);
+
 private:
+    /// Returns the given DICOM matching value as a LIKE pattern, translating its wildcards and escaping '%', '_' and '\' with '\'.
+    static QString toLikePattern(const QString &value);
+
     /// Creates and returns a study with the information of the current row of the given query.
     static Study* getStudy(const QSqlQuery &query);
 
@@ -14,7 +14,10 @@
 
 #include "localdatabaseutildal.h"
 
+#include "logging.h"
+
 #include <QSqlQuery>
+#include <QStringList>
 #include <QVariant>
 
 namespace udg {
@@ -28,6 +31,14 @@ bool LocalDatabaseUtilDAL::compact()
 {
     QSqlQuery query = getNewQuery();
     query.prepare("VACUUM");
+
+    if (!executeQueryAndLogError(query))
+    {
+        return false;
+    }
+
+    // VACUUM can change the rowids of Study, which are the docids of its full-text index, so the index must be rebuilt
+    query.prepare("INSERT INTO StudyDescriptionSearch (StudyDescriptionSearch) VALUES ('rebuild')");
     return executeQueryAndLogError(query);
 }
 
@@ -54,4 +65,50 @@ bool LocalDatabaseUtilDAL::updateDatabaseRevision(int databaseRevision)
     return executeQueryAndLogError(query);
 }
 
+bool LocalDatabaseUtilDAL::setJournalMode(const QString &journalMode)
+{
+    // Pragma values can't be bound, so they are checked against the valid ones before building the command
+    QStringList validJournalModes;
+    validJournalModes << "DELETE" << "TRUNCATE" << "PERSIST" << "MEMORY" << "WAL" << "OFF";
+
+    if (!validJournalModes.contains(journalMode.toUpper()))
+    {
+        ERROR_LOG("Invalid SQLite journal mode: " + journalMode);
+        return false;
+    }
+
+    QSqlQuery query = getNewQuery();
+    query.prepare("PRAGMA journal_mode = " + journalMode.toUpper());
+
+    if (!executeQueryAndLogError(query))
+    {
+        return false;
+    }
+
+    // SQLite answers with the resulting journal mode, which is the previous one if it can't be changed
+    if (query.next() && query.value(0).toString().toUpper() == journalMode.toUpper())
+    {
+        return true;
+    }
+    else
+    {
+        WARN_LOG(QString("Could not set SQLite journal mode to %1.").arg(journalMode));
+        return false;
+    }
+}
+
+bool LocalDatabaseUtilDAL::setSynchronous(const QString &synchronous)
+{
+    QStringList validSynchronousLevels;
+    validSynchronousLevels << "OFF" << "NORMAL" << "FULL" << "EXTRA";
+
+    if (!validSynchronousLevels.contains(synchronous.toUpper()))
+    {
+        ERROR_LOG("Invalid SQLite synchronous level: " + synchronous);
+        return false;
+    }
+
+    return executeSql("PRAGMA synchronous = " + synchronous.toUpper());
+}
+
 }
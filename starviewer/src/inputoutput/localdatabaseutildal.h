@@ -27,7 +27,7 @@ class LocalDatabaseUtilDAL : public LocalDatabaseBaseDAL {
 public:
     LocalDatabaseUtilDAL(DatabaseConnection &databaseConnection);
 
-    /// Compacts the database. Returns true if successful and false otherwise.
+    /// Compacts the database and rebuilds the full-text indexes that depend on rowids. Returns true if successful and false otherwise.
     bool compact();
 
     /// Returns the database revision. If the database revision cannot be determined, returns -1.
@@ -36,6 +36,14 @@ public:
     /// Updates the database revision. Returns true if successful and false otherwise.
     bool updateDatabaseRevision(int databaseRevision);
 
+    /// Sets the journal mode of the database (DELETE, TRUNCATE, PERSIST, MEMORY, WAL or OFF). Returns true if successful and false otherwise, including
+    /// when the value is not valid or SQLite can't switch to it.
+    bool setJournalMode(const QString &journalMode);
+
+    /// Sets the synchronous level of the connection (OFF, NORMAL, FULL or EXTRA). Returns true if successful and false otherwise, including when the value
+    /// is not valid.
+    bool setSynchronous(const QString &synchronous);
+
 };
 
 }
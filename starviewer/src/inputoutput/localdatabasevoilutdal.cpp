@@ -122,4 +122,22 @@ QList<VoiLut> LocalDatabaseVoiLutDAL::query(const DicomMask &mask)
     return voiLutList;
 }
 
+QHash<LocalDatabaseBaseDAL::ImageKey, QList<VoiLut> > LocalDatabaseVoiLutDAL::queryGroupedByImage(const DicomMask &mask)
+{
+    QSqlQuery query = getNewQuery();
+    prepareQueryWithMask(query, mask, "SELECT Lut, ImageInstanceUID, ImageFrameNumber FROM VoiLut");
+    QHash<ImageKey, QList<VoiLut> > voiLutsByImage;
+
+    if (executeQueryAndLogError(query))
+    {
+        while (query.next())
+        {
+            ImageKey image(query.value("ImageInstanceUID").toString(), query.value("ImageFrameNumber").toInt());
+            voiLutsByImage[image].append(getVoiLut(query.value("Lut").toByteArray()));
+        }
+    }
+
+    return voiLutsByImage;
+}
+
 } // namespace udg
@@ -17,6 +17,8 @@
 
 #include "localdatabasebasedal.h"
 
+#include <QHash>
+
 namespace udg {
 
 class DicomMask;
@@ -39,6 +41,8 @@ public:
 
     /// Retrieves from the database the VOI LUTs that match the given mask and returns them in a list.
     QList<VoiLut> query(const DicomMask &mask);
+    /// Retrieves from the database the VOI LUTs that match the given mask with a single query and returns them grouped by the image they belong to.
+    QHash<ImageKey, QList<VoiLut> > queryGroupedByImage(const DicomMask &mask);
 
 };
 
@@ -18,6 +18,7 @@
 #include <ofcond.h>
 #include <assoc.h>
 #include <QHostInfo>
+#include <QMutex>
 #include <QStringList>
 
 #include "logging.h"
@@ -25,6 +26,15 @@
 
 namespace udg {
 
+namespace {
+
+// The incoming DICOM connections port can only be listened once, so the network that listens to it is shared by all the retrieves executed at the same time
+T_ASC_Network *IncomingDICOMConnectionsNetwork = NULL;
+int IncomingDICOMConnectionsNetworkUsers = 0;
+QMutex IncomingDICOMConnectionsNetworkMutex;
+
+}
+
 PACSConnection::PACSConnection(PacsDevice pacsDevice)
 {
     // Variable global de dcmtk per evitar el dnslookup, que dona problemes de lentitu a windows.
@@ -250,6 +260,13 @@ bool PACSConnection::connectToPACS(PACSServiceToRequest pacsServiceToRequest)
         {
             ERROR_LOG("El PACS no ens ha acceptat cap dels Presentation Context presentats. AE Title: " + m_pacs.getAETitle() + ", adreca: " +
                 constructPacsServerAddress(pacsServiceToRequest, m_pacs));
+
+            // The incoming DICOM connections port must be released so that it can be closed when no other retrieve is using it
+            if (pacsServiceToRequest == RetrieveDICOMFiles)
+            {
+                disconnect();
+            }
+
             return false;
         }
     }
@@ -285,6 +302,12 @@ void PACSConnection::disconnect()
         ERROR_LOG("Error al destruir la connexio amb el PACS, descripcio error: " + QString(condition.text()));
     }
 
+    if (m_associationNetwork != NULL && m_associationNetwork == IncomingDICOMConnectionsNetwork)
+    {
+        releaseIncomingDICOMConnectionsNetwork();
+        return;
+    }
+
     // Destrueix l'objecte i tanca el socket obert, fins que no es fa el drop de l'objecte no es tanca el socket
     condition = ASC_dropNetwork(&m_associationNetwork);
     if (condition.bad())
@@ -294,6 +317,12 @@ void PACSConnection::disconnect()
 
 }
 
+bool PACSConnection::isIncomingDICOMConnectionsNetworkInitialized()
+{
+    QMutexLocker locker(&IncomingDICOMConnectionsNetworkMutex);
+    return IncomingDICOMConnectionsNetwork != NULL;
+}
+
 QString PACSConnection::constructPacsServerAddress(PACSServiceToRequest pacsServiceToRequest, PacsDevice pacsDevice)
 {
     // The format is "server:port"
@@ -333,14 +362,18 @@ QString PACSConnection::constructPacsServerAddress(PACSServiceToRequest pacsServ
 
 T_ASC_Network* PACSConnection::initializeAssociationNetwork(PACSServiceToRequest pacsServiceToRequest)
 {
+    if (pacsServiceToRequest == RetrieveDICOMFiles)
+    {
+        return acquireIncomingDICOMConnectionsNetwork();
+    }
+
     Settings settings;
     // Si no es tracta d'una descarrega indiquem port 0
-    int networkPort = pacsServiceToRequest == RetrieveDICOMFiles ? settings.getValue(InputOutputSettings::IncomingDICOMConnectionsPort).toInt() : 0;
+    int networkPort = 0;
     int timeout = settings.getValue(InputOutputSettings::PACSConnectionTimeout).toInt();
-    T_ASC_NetworkRole networkRole = pacsServiceToRequest == RetrieveDICOMFiles ? NET_ACCEPTORREQUESTOR : NET_REQUESTOR;
     T_ASC_Network *associationNetwork;
 
-    OFCondition condition = ASC_initializeNetwork(networkRole, networkPort, timeout, &associationNetwork);
+    OFCondition condition = ASC_initializeNetwork(NET_REQUESTOR, networkPort, timeout, &associationNetwork);
     if (!condition.good())
     {
         ERROR_LOG("No s'ha pogut inicialitzar l'objecte network, despripcio error" + QString(condition.text()));
@@ -350,6 +383,48 @@ T_ASC_Network* PACSConnection::initializeAssociationNetwork(PACSServiceToRequest
     return associationNetwork;
 }
 
+T_ASC_Network* PACSConnection::acquireIncomingDICOMConnectionsNetwork()
+{
+    QMutexLocker locker(&IncomingDICOMConnectionsNetworkMutex);
+
+    if (IncomingDICOMConnectionsNetwork == NULL)
+    {
+        Settings settings;
+        int networkPort = settings.getValue(InputOutputSettings::IncomingDICOMConnectionsPort).toInt();
+        int timeout = settings.getValue(InputOutputSettings::PACSConnectionTimeout).toInt();
+
+        OFCondition condition = ASC_initializeNetwork(NET_ACCEPTORREQUESTOR, networkPort, timeout, &IncomingDICOMConnectionsNetwork);
+        if (!condition.good())
+        {
+            ERROR_LOG("No s'ha pogut inicialitzar l'objecte network, despripcio error" + QString(condition.text()));
+            IncomingDICOMConnectionsNetwork = NULL;
+            return NULL;
+        }
+    }
+
+    IncomingDICOMConnectionsNetworkUsers++;
+    return IncomingDICOMConnectionsNetwork;
+}
+
+void PACSConnection::releaseIncomingDICOMConnectionsNetwork()
+{
+    QMutexLocker locker(&IncomingDICOMConnectionsNetworkMutex);
+
+    m_associationNetwork = NULL;
+    IncomingDICOMConnectionsNetworkUsers--;
+
+    if (IncomingDICOMConnectionsNetworkUsers == 0)
+    {
+        // Destrueix l'objecte i tanca el socket obert, fins que no es fa el drop de l'objecte no es tanca el socket
+        OFCondition condition = ASC_dropNetwork(&IncomingDICOMConnectionsNetwork);
+        if (condition.bad())
+        {
+            ERROR_LOG("Error al tancar el port de connexions entrants, descripcio error: " + QString(condition.text()));
+        }
+        IncomingDICOMConnectionsNetwork = NULL;
+    }
+}
+
 void PACSConnection::getTransferSyntaxForFindOrMoveConnection(const char *transferSyntaxes[3])
 {
     // We prefer to use Explicitly encoded transfer syntaxes. If we are running on a Little Endian machine we prefer LittleEndianExplicitTransferSyntax
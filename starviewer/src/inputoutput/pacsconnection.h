@@ -58,6 +58,10 @@ public:
     /// This action close the session with PACS's machine and release all the resources
     void disconnect();
 
+    /// Returns true if the network that listens to the incoming DICOM connections port is open, i.e. if some retrieve is being executed. All the retrieves
+    /// executed at the same time share this network.
+    static bool isIncomingDICOMConnectionsNetworkInitialized();
+
 private:
     /// Aquesta funció és privada. És utilitzada per especificar en el PACS, que una de les possibles operacions que volem fer amb ell és un echo. Per defecte
     /// en qualsevol modalitat de connexió podrem fer un echo
@@ -94,6 +98,11 @@ private:
     /// de dcmtk ASC_requestAssociation dins del mètode connect connect();
     T_ASC_Network* initializeAssociationNetwork(PACSServiceToRequest modality);
 
+    /// Returns the network that listens to the incoming DICOM connections port, initializing it if no one else is using it
+    T_ASC_Network* acquireIncomingDICOMConnectionsNetwork();
+    /// Releases the network that listens to the incoming DICOM connections port, closing the port if no one else is using it
+    void releaseIncomingDICOMConnectionsNetwork();
+
     /// Omple l'array passada per paràmetres amb la transfer syntax a utilitzar per les connexions per fer FIND o Move
     void getTransferSyntaxForFindOrMoveConnection(const char *transferSyntaxes[3]);
 
@@ -23,6 +23,8 @@
 #include "querypacsjob.h"
 #include "pacsjob.h"
 #include "inputoutputsettings.h"
+#include "retrievedicomfilesfrompacsqueuepolicy.h"
+#include "retrievedicomfilesfrompacsjob.h"
 
 namespace udg {
 
@@ -46,9 +48,12 @@ PacsManager::PacsManager()
     m_sendDICOMFilesToPACSQueue = new ThreadWeaver::Queue();
     m_sendDICOMFilesToPACSQueue->setMaximumNumberOfThreads(settings.getValue(InputOutputSettings::MaximumPACSConnections).toInt());
 
+    // The queue limits the total number of concurrent retrieves and executes them by priority, and the policy limits the retrieves from the same PACS.
+    // All the retrieves share the port for incoming DICOM connections
     m_retrieveDICOMFilesFromPACSQueue = new ThreadWeaver::Queue();
-    // Només podem descarregar un estudi a la vegada del PACS, per això com a número màxim de threads especifiquem 1
-    m_retrieveDICOMFilesFromPACSQueue ->setMaximumNumberOfThreads(1);
+    m_retrieveDICOMFilesFromPACSQueue->setMaximumNumberOfThreads(qMax(1, settings.getValue(InputOutputSettings::MaximumConcurrentRetrieves).toInt()));
+    m_retrieveDICOMFilesFromPACSQueuePolicy = QSharedPointer<RetrieveDICOMFilesFromPACSQueuePolicy>(
+        new RetrieveDICOMFilesFromPACSQueuePolicy(settings.getValue(InputOutputSettings::MaximumConcurrentRetrievesPerPACS).toInt()));
 }
 
 void PacsManager::enqueuePACSJob(PACSJobPointer pacsJob)
@@ -61,6 +66,7 @@ void PacsManager::enqueuePACSJob(PACSJobPointer pacsJob)
             m_sendDICOMFilesToPACSQueue->enqueue(pacsJob);
             break;
         case PACSJob::RetrieveDICOMFilesFromPACSJobType:
+            pacsJob.objectCast<RetrieveDICOMFilesFromPACSJob>()->setQueuePolicy(m_retrieveDICOMFilesFromPACSQueuePolicy);
             m_retrieveDICOMFilesFromPACSQueue->enqueue(pacsJob);
             break;
         case PACSJob::QueryPACS:
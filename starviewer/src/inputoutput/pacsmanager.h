@@ -18,6 +18,7 @@
 
 #include <QList>
 #include <QHash>
+#include <QSharedPointer>
 #include <ThreadWeaver/Queue>
 
 #include "patient.h"
@@ -27,6 +28,7 @@
 namespace udg {
 
 class DicomMask;
+class RetrieveDICOMFilesFromPACSQueuePolicy;
 
 /**
     Classe manager que ens permet comunicar-nos amb el PACS
@@ -81,6 +83,9 @@ private:
     ThreadWeaver::Queue *m_queryQueue;
     ThreadWeaver::Queue *m_sendDICOMFilesToPACSQueue;
     ThreadWeaver::Queue *m_retrieveDICOMFilesFromPACSQueue;
+    /// Limits the concurrent retrieves from the same PACS and of the same study. The retrieve jobs share its ownership, because the queues are not destroyed
+    /// with the manager and their jobs may still be running after it.
+    QSharedPointer<RetrieveDICOMFilesFromPACSQueuePolicy> m_retrieveDICOMFilesFromPACSQueuePolicy;
 };
 
 };  //  end  namespace udg
@@ -21,9 +21,16 @@
 // Pels tags DcmTagKey DCM_xxxx
 #include <dctagkey.h>
 #include <dcdeftag.h>
+// Per esperar alhora les dades de les connexions i les connexions entrants
+#include <dcompat.h>
+#include <dcmtrans.h>
+#include <dul.h>
 
+#include <QAtomicInt>
 #include <QDir>
 #include <QString>
+#include <QVector>
+#include <QtConcurrentRun>
 
 #include "localdatabasemanager.h"
 #include "dicommask.h"
@@ -31,18 +38,92 @@
 #include "dicomtagreader.h"
 #include "pacsconnection.h"
 #include "pacsdevice.h"
+#include "inputoutputsettings.h"
 
 namespace udg {
 
 // Constant que contindrà quin Abanstract Syntax de Move utilitzem entre els diversos que hi ha utilitzem
 static const char *MoveAbstractSyntax = UID_MOVEStudyRootQueryRetrieveInformationModel;
 
+// Writing files is bound by the disk, more threads would only make the writes compete between them
+static const int NumberOfWriterThreads = 2;
+
+namespace {
+
+// Retrieves being executed. All of them listen to the same incoming DICOM connections network, so an association can be accepted by any of them and must
+// be handed to the retrieve that requested it, which is the only one that reads from it, answers it and aborts it if it's cancelled.
+QList<RetrieveDICOMFilesFromPACS*> RetrievesInProgress;
+QMutex RetrievesInProgressMutex;
+// Serializes the acceptance of incoming associations between the retrieves being executed
+QMutex AcceptSubAssociationMutex;
+// Last message ID given to a C-MOVE request. Each association has its own message IDs, but the PACS sends it back as the Move Originator Message ID of the
+// files, so it must be different for each retrieve being executed to know to which one the files belong.
+QAtomicInt LastMoveMessageID;
+// Milliseconds that a retrieve waits for a response, a file or a new association before checking again for a cancellation or the requests handed over by
+// another retrieve
+const int SubAssociationsPollingTimeout = 100;
+
+// Waits up to the given milliseconds until one of the given associations has data to read or a new association is waiting to be accepted in the given
+// network. Returns false on timeout. Otherwise returns true and sets to null the associations that have no data to read, as ASC_selectReadableAssociation()
+// does. ASC_selectReadableAssociation() can't be used alone because it doesn't watch the network and its timeout is in seconds.
+bool waitForReadableAssociations(T_ASC_Network *network, QVector<T_ASC_Association*> &associations, int timeout)
+{
+    // Data already received and buffered by DCMTK is not seen by select()
+    QVector<T_ASC_Association*> associationsWithBufferedData = associations;
+    if (ASC_selectReadableAssociation(associationsWithBufferedData.data(), associationsWithBufferedData.size(), 0))
+    {
+        associations = associationsWithBufferedData;
+        return true;
+    }
+
+    fd_set readableSockets;
+    FD_ZERO(&readableSockets);
+    int networkSocket = DUL_networkSocket(network->network);
+    FD_SET(networkSocket, &readableSockets);
+    int maximumSocket = networkSocket;
+
+    QVector<int> associationSockets(associations.size());
+    for (int i = 0; i < associations.size(); i++)
+    {
+        associationSockets[i] = DUL_getTransportConnection(associations.at(i)->DULassociation)->getSocket();
+        FD_SET(associationSockets[i], &readableSockets);
+        maximumSocket = qMax(maximumSocket, associationSockets[i]);
+    }
+
+    struct timeval timeoutValue;
+    timeoutValue.tv_sec = timeout / 1000;
+    timeoutValue.tv_usec = (timeout % 1000) * 1000;
+
+    if (select(maximumSocket + 1, &readableSockets, NULL, NULL, &timeoutValue) <= 0)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < associations.size(); i++)
+    {
+        if (!FD_ISSET(associationSockets[i], &readableSockets))
+        {
+            associations[i] = NULL;
+        }
+    }
+
+    // If only the network is readable all the associations are null, and the new association is accepted in the next iteration
+    return true;
+}
+
+}
+
 RetrieveDICOMFilesFromPACS::RetrieveDICOMFilesFromPACS(PacsDevice pacs)
- : DIMSECService()
+ : DIMSECService(), m_filesPendingToWrite(0), m_bytesPendingToWrite(0), m_writeFailed(false), m_moveMessageID(0)
 {
     m_pacs = pacs;
     m_abortIsRequested = false;
 
+    Settings settings;
+    m_maximumFilesPendingToWrite = settings.getValue(InputOutputSettings::MaximumDICOMFilesPendingToWrite).toInt();
+    m_maximumBytesPendingToWrite = settings.getValue(InputOutputSettings::MaximumMegaBytesPendingToWrite).toLongLong() * 1024 * 1024;
+    m_writersPool.setMaxThreadCount(NumberOfWriterThreads);
+
     this->setUpAsCMove();
 }
 
@@ -105,33 +186,6 @@ OFCondition RetrieveDICOMFilesFromPACS::acceptSubAssociation(T_ASC_Network *asso
     return condition;
 }
 
-void RetrieveDICOMFilesFromPACS::moveCallback(void *callbackData, T_DIMSE_C_MoveRQ *request, int responseCount, T_DIMSE_C_MoveRSP *response)
-{
-    Q_UNUSED(responseCount);
-    Q_UNUSED(response);
-    Q_UNUSED(request);
-    Q_UNUSED(callbackData);
-
-    // Aquest en teoria és el codi per cancel·lar una descàrrega però el PACS del l'UDIAT no suporta les requestCancel, per tant la única manera
-    // de fer-ho és com es fa en el mètode subOperationSCP que s'aborta la connexió amb el PACS.
-
-    //MoveSCPCallbackData *moveSCPCallbackData = (MoveSCPCallbackData*) callbackData;
-
-    //if (moveSCPCallbackData->retrieveDICOMFilesFromPACS->m_abortIsRequested)
-    //{
-    //    OFCondition condition = DIMSE_sendCancelRequest(moveSCPCallbackData->association, moveSCPCallbackData->presentationContextId, request->MessageID);
-
-    //    if (condition.good())
-    //    {
-    //        INFO_LOG("S'ha cancel·lat la descarrega");
-    //    }
-    //    else
-    //    {
-    //        ERROR_LOG("Error al intentar cancel.lar la descarrga. Descripcio error: " + QString(condition.text()));
-    //    }
-    //}
-}
-
 OFCondition RetrieveDICOMFilesFromPACS::echoSCP(T_ASC_Association *association, T_DIMSE_Message *dimseMessage,
                                                 T_ASC_PresentationContextID presentationContextID)
 {
@@ -166,53 +220,199 @@ void RetrieveDICOMFilesFromPACS::storeSCPCallback(void *callbackData, T_DIMSE_St
             RetrieveDICOMFilesFromPACS *retrieveDICOMFilesFromPACS = storeSCPCallbackData->retrieveDICOMFilesFromPACS;
             QString dicomFileAbsolutePath = retrieveDICOMFilesFromPACS->getAbsoluteFilePathCompositeInstance(*imageDataSet, storeSCPCallbackData->fileName);
 
-            // Guardem la imatge
-            OFCondition stateSaveImage = retrieveDICOMFilesFromPACS->save(storeSCPCallbackData->dcmFileFormat, dicomFileAbsolutePath);
+            // Should really check the image to make sure it is consistent, that its
+            // sopClass and sopInstance correspond with those in the request.
+            if (storeResponse->DimseStatus == STATUS_Success)
+            {
+                // Which SOP class and SOP instance?
+                if (!DU_findSOPClassAndInstanceInDataSet(*imageDataSet, sopClass, sopInstance, correctUIDPadding))
+                {
+                    storeResponse->DimseStatus = STATUS_STORE_Error_CannotUnderstand;
+                    ERROR_LOG(QString("No s'ha trobat la sop class i la sop instance per la imatge %1").arg(storeSCPCallbackData->fileName));
+                }
+                else if (strcmp(sopClass, storeRequest->AffectedSOPClassUID) != 0)
+                {
+                    storeResponse->DimseStatus = STATUS_STORE_Error_DataSetDoesNotMatchSOPClass;
+                    ERROR_LOG(QString("No concorda la sop class rebuda amb la sol.licitada per la imatge %1").arg(storeSCPCallbackData->fileName));
+                }
+                else if (strcmp(sopInstance, storeRequest->AffectedSOPInstanceUID) != 0)
+                {
+                    storeResponse->DimseStatus = STATUS_STORE_Error_DataSetDoesNotMatchSOPClass;
+                    ERROR_LOG(QString("No concorda sop instance rebuda amb la sol.licitada per la imatge %1").arg(storeSCPCallbackData->fileName));
+                }
+            }
 
-            if (stateSaveImage.bad())
+            // TODO:Té processar el fitxer si ha fallat alguna de les anteriors comprovacions ?
+            if (retrieveDICOMFilesFromPACS->m_abortIsRequested)
             {
+                // The files of a cancelled retrieve will be deleted, so there's no need to write them
                 storeResponse->DimseStatus = STATUS_STORE_Refused_OutOfResources;
-                DEBUG_LOG("No s'ha pogut guardar la imatge descarregada [" + dicomFileAbsolutePath + "], error: " + stateSaveImage.text());
-                ERROR_LOG("No s'ha pogut guardar la imatge descarregada [" + dicomFileAbsolutePath + "], error: " + stateSaveImage.text());
-                if (!QFile::remove(dicomFileAbsolutePath))
+            }
+            else if (retrieveDICOMFilesFromPACS->m_maximumFilesPendingToWrite <= 0)
+            {
+                // Guardem la imatge abans de respondre
+                if (retrieveDICOMFilesFromPACS->saveAndNotify(storeSCPCallbackData->dcmFileFormat, dicomFileAbsolutePath).bad())
                 {
-                    DEBUG_LOG("Ha fallat el voler esborrar el fitxer " + dicomFileAbsolutePath + " que havia fallat prèviament al voler guardar-se.");
-                    ERROR_LOG("Ha fallat el voler esborrar el fitxer " + dicomFileAbsolutePath + " que havia fallat prèviament al voler guardar-se.");
+                    storeResponse->DimseStatus = STATUS_STORE_Refused_OutOfResources;
                 }
             }
+            else if (retrieveDICOMFilesFromPACS->hasWriteFailed())
+            {
+                // A previous file could not be written, most probably the disk is full or not writable, so the following files are refused as they would be
+                // if they were written before answering
+                storeResponse->DimseStatus = STATUS_STORE_Refused_OutOfResources;
+                ERROR_LOG("Es refusa la imatge descarregada [" + dicomFileAbsolutePath + "] perque no s'ha pogut guardar una imatge anterior");
+            }
             else
             {
-                // Should really check the image to make sure it is consistent, that its
-                // sopClass and sopInstance correspond with those in the request.
-                if (storeResponse->DimseStatus == STATUS_Success)
-                {
-                    // Which SOP class and SOP instance?
-                    if (!DU_findSOPClassAndInstanceInDataSet(*imageDataSet, sopClass, sopInstance, correctUIDPadding))
-                    {
-                        storeResponse->DimseStatus = STATUS_STORE_Error_CannotUnderstand;
-                        ERROR_LOG(QString("No s'ha trobat la sop class i la sop instance per la imatge %1").arg(storeSCPCallbackData->fileName));
-                    }
-                    else if (strcmp(sopClass, storeRequest->AffectedSOPClassUID) != 0)
-                    {
-                        storeResponse->DimseStatus = STATUS_STORE_Error_DataSetDoesNotMatchSOPClass;
-                        ERROR_LOG(QString("No concorda la sop class rebuda amb la sol.licitada per la imatge %1").arg(storeSCPCallbackData->fileName));
-                    }
-                    else if (strcmp(sopInstance, storeRequest->AffectedSOPInstanceUID) != 0)
-                    {
-                        storeResponse->DimseStatus = STATUS_STORE_Error_DataSetDoesNotMatchSOPClass;
-                        ERROR_LOG(QString("No concorda sop instance rebuda amb la sol.licitada per la imatge %1").arg(storeSCPCallbackData->fileName));
-                    }
-                }
-
-                // TODO:Té processar el fitxer si ha fallat alguna de les anteriors comprovacions ?
-                retrieveDICOMFilesFromPACS->m_numberOfImagesRetrieved++;
-                DICOMTagReader *dicomTagReader = new DICOMTagReader(dicomFileAbsolutePath, storeSCPCallbackData->dcmFileFormat->getAndRemoveDataset());
-                emit retrieveDICOMFilesFromPACS->DICOMFileRetrieved(dicomTagReader, retrieveDICOMFilesFromPACS->m_numberOfImagesRetrieved);
+                // The store request is answered without waiting for the file to be written
+                retrieveDICOMFilesFromPACS->enqueueWrite(storeSCPCallbackData->dcmFileFormat, dicomFileAbsolutePath);
+                storeSCPCallbackData->dcmFileFormat = NULL;
             }
         }
     }
 }
 
+void RetrieveDICOMFilesFromPACS::registerRetrieveInProgress()
+{
+    QMutexLocker locker(&RetrievesInProgressMutex);
+
+    // Message IDs go from 1 to 65535
+    bool isMessageIDInUse;
+    do
+    {
+        m_moveMessageID = static_cast<unsigned short>(LastMoveMessageID.fetchAndAddOrdered(1) % 65535 + 1);
+
+        isMessageIDInUse = false;
+        foreach (RetrieveDICOMFilesFromPACS *retrieve, RetrievesInProgress)
+        {
+            isMessageIDInUse |= retrieve->m_moveMessageID == m_moveMessageID;
+        }
+    }
+    while (isMessageIDInUse);
+
+    RetrievesInProgress.append(this);
+}
+
+void RetrieveDICOMFilesFromPACS::unregisterRetrieveInProgress()
+{
+    QMutexLocker locker(&RetrievesInProgressMutex);
+    RetrievesInProgress.removeAll(this);
+    m_subAssociations.append(m_handedOverSubAssociations);
+    m_handedOverSubAssociations.clear();
+    locker.unlock();
+
+    // The PACS usually closes the associations before sending the final response, the ones still open are not needed anymore
+    for (int i = 0; i < m_subAssociations.size(); i++)
+    {
+        INFO_LOG("S'aborta una connexio entrant del PACS que continuava oberta en acabar la descarrega");
+        abortSubAssociation(m_subAssociations[i]);
+    }
+    m_subAssociations.clear();
+}
+
+void RetrieveDICOMFilesFromPACS::acceptSubAssociations()
+{
+    // Only one retrieve at a time accepts the waiting associations, otherwise the others would block until another association arrived
+    QMutexLocker locker(&AcceptSubAssociationMutex);
+    T_ASC_Network *associationNetwork = m_pacsConnection->getNetwork();
+
+    while (ASC_associationWaiting(associationNetwork, 0))
+    {
+        SubAssociation subAssociation;
+        subAssociation.association = NULL;
+        subAssociation.isOwnerConfirmed = false;
+        subAssociation.pendingCommand = NULL;
+        subAssociation.pendingCommandPresentationContextID = 0;
+
+        OFCondition condition = acceptSubAssociation(associationNetwork, &subAssociation.association);
+        if (!condition.good())
+        {
+            ERROR_LOG("S'ha produit un error negociant l'associacio de la connexio DICOM entrant, descripcio error: " + QString(condition.text()));
+            continue;
+        }
+
+        INFO_LOG("Rebuda solicitud de connexio pel port de connexions DICOM entrants del PACS.");
+
+        if (!handOverSubAssociation(subAssociation))
+        {
+            ERROR_LOG("La connexio entrant no correspon a cap descarrega en curs, s'aborta");
+            abortSubAssociation(subAssociation);
+        }
+    }
+}
+
+bool RetrieveDICOMFilesFromPACS::handOverSubAssociation(SubAssociation subAssociation)
+{
+    DIC_AE callingAETitle;
+    ASC_getAPTitles(subAssociation.association->params, callingAETitle, NULL, NULL);
+
+    QMutexLocker locker(&RetrievesInProgressMutex);
+
+    QList<RetrieveDICOMFilesFromPACS*> candidates;
+    foreach (RetrieveDICOMFilesFromPACS *retrieve, RetrievesInProgress)
+    {
+        if (retrieve->m_pacs.getAETitle() == QString(callingAETitle).trimmed())
+        {
+            candidates.append(retrieve);
+        }
+    }
+
+    // Some PACS send the files with another AE title
+    if (candidates.isEmpty())
+    {
+        candidates = RetrievesInProgress;
+    }
+
+    if (candidates.isEmpty())
+    {
+        return false;
+    }
+
+    subAssociation.isOwnerConfirmed = candidates.size() == 1;
+    candidates.first()->m_handedOverSubAssociations.append(subAssociation);
+    return true;
+}
+
+bool RetrieveDICOMFilesFromPACS::handOverSubAssociation(SubAssociation subAssociation, unsigned short moveMessageID)
+{
+    QMutexLocker locker(&RetrievesInProgressMutex);
+
+    foreach (RetrieveDICOMFilesFromPACS *retrieve, RetrievesInProgress)
+    {
+        if (retrieve->m_moveMessageID == moveMessageID)
+        {
+            subAssociation.isOwnerConfirmed = true;
+            retrieve->m_handedOverSubAssociations.append(subAssociation);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void RetrieveDICOMFilesFromPACS::takeHandedOverSubAssociations()
+{
+    QMutexLocker locker(&RetrievesInProgressMutex);
+    m_subAssociations.append(m_handedOverSubAssociations);
+    m_handedOverSubAssociations.clear();
+}
+
+void RetrieveDICOMFilesFromPACS::abortSubAssociation(SubAssociation &subAssociation)
+{
+    delete subAssociation.pendingCommand;
+    subAssociation.pendingCommand = NULL;
+
+    OFCondition condition = ASC_abortAssociation(subAssociation.association);
+    if (!condition.good())
+    {
+        ERROR_LOG("Error al abortar la connexio pel qual rebem les imatges" + QString(condition.text()));
+    }
+
+    ASC_dropAssociation(subAssociation.association);
+    ASC_destroyAssociation(&subAssociation.association);
+}
+
 OFCondition RetrieveDICOMFilesFromPACS::save(DcmFileFormat *fileRetrieved, QString dicomFileAbsolutePath)
 {
     // Indiquem que no fem servir meta-header
@@ -227,20 +427,99 @@ OFCondition RetrieveDICOMFilesFromPACS::save(DcmFileFormat *fileRetrieved, QStri
                                    filePadding, itemPadding, writeMode);
 }
 
+OFCondition RetrieveDICOMFilesFromPACS::saveAndNotify(DcmFileFormat *fileRetrieved, const QString &dicomFileAbsolutePath)
+{
+    OFCondition stateSaveImage = save(fileRetrieved, dicomFileAbsolutePath);
+
+    if (stateSaveImage.bad())
+    {
+        DEBUG_LOG("No s'ha pogut guardar la imatge descarregada [" + dicomFileAbsolutePath + "], error: " + stateSaveImage.text());
+        ERROR_LOG("No s'ha pogut guardar la imatge descarregada [" + dicomFileAbsolutePath + "], error: " + stateSaveImage.text());
+        if (!QFile::remove(dicomFileAbsolutePath))
+        {
+            DEBUG_LOG("Ha fallat el voler esborrar el fitxer " + dicomFileAbsolutePath + " que havia fallat prèviament al voler guardar-se.");
+            ERROR_LOG("Ha fallat el voler esborrar el fitxer " + dicomFileAbsolutePath + " que havia fallat prèviament al voler guardar-se.");
+        }
+    }
+    else
+    {
+        // The writer threads notify the files one at a time, so that the receivers see them in the same way as when they were written synchronously
+        QMutexLocker locker(&m_notificationMutex);
+        m_numberOfImagesRetrieved++;
+        // The file is already saved, so the pixel data can be released before passing the dataset to the fillers
+        DICOMTagReader *dicomTagReader = new DICOMTagReader(dicomFileAbsolutePath, fileRetrieved->getAndRemoveDataset(), DICOMTagReader::MetadataOnly);
+        emit DICOMFileRetrieved(dicomTagReader, m_numberOfImagesRetrieved);
+    }
+
+    return stateSaveImage;
+}
+
+void RetrieveDICOMFilesFromPACS::enqueueWrite(DcmFileFormat *fileRetrieved, const QString &dicomFileAbsolutePath)
+{
+    DcmDataset *dataset = fileRetrieved->getDataset();
+    qint64 size = dataset->getLength(dataset->getOriginalXfer());
+
+    QMutexLocker locker(&m_pendingWritesMutex);
+    // A file bigger than the limit is accepted when nothing else is pending, otherwise it could never be queued
+    while (m_filesPendingToWrite > 0 &&
+           (m_filesPendingToWrite >= m_maximumFilesPendingToWrite || m_bytesPendingToWrite + size > m_maximumBytesPendingToWrite))
+    {
+        m_pendingWriteFinished.wait(&m_pendingWritesMutex);
+    }
+
+    m_filesPendingToWrite++;
+    m_bytesPendingToWrite += size;
+    locker.unlock();
+
+    QtConcurrent::run(&m_writersPool, [=]() { write(fileRetrieved, dicomFileAbsolutePath, size); });
+}
+
+void RetrieveDICOMFilesFromPACS::write(DcmFileFormat *fileRetrieved, const QString &dicomFileAbsolutePath, qint64 size)
+{
+    OFCondition stateSaveImage = saveAndNotify(fileRetrieved, dicomFileAbsolutePath);
+    delete fileRetrieved;
+
+    QMutexLocker locker(&m_pendingWritesMutex);
+    if (stateSaveImage.bad())
+    {
+        m_writeFailed = true;
+    }
+    m_filesPendingToWrite--;
+    m_bytesPendingToWrite -= size;
+    m_pendingWriteFinished.wakeAll();
+}
+
+void RetrieveDICOMFilesFromPACS::waitForPendingWrites()
+{
+    QMutexLocker locker(&m_pendingWritesMutex);
+    while (m_filesPendingToWrite > 0)
+    {
+        m_pendingWriteFinished.wait(&m_pendingWritesMutex);
+    }
+}
+
+bool RetrieveDICOMFilesFromPACS::hasWriteFailed()
+{
+    QMutexLocker locker(&m_pendingWritesMutex);
+    return m_writeFailed;
+}
+
 OFCondition RetrieveDICOMFilesFromPACS::storeSCP(T_ASC_Association *association, T_DIMSE_Message *msg, T_ASC_PresentationContextID presentationContextID)
 {
     T_DIMSE_C_StoreRQ *storeRequest = &msg->msg.CStoreRQ;
     OFBool useMetaheader = OFTrue;
     StoreSCPCallbackData storeSCPCallbackData;
-    DcmFileFormat retrievedFile;
-    DcmDataset *retrievedDataset = retrievedFile.getDataset();
+    // The callback takes the ownership of the file if it queues it to be written asynchronously
+    DcmFileFormat *retrievedFile = new DcmFileFormat();
+    DcmDataset *retrievedDataset = retrievedFile->getDataset();
 
-    storeSCPCallbackData.dcmFileFormat = &retrievedFile;
+    storeSCPCallbackData.dcmFileFormat = retrievedFile;
     storeSCPCallbackData.retrieveDICOMFilesFromPACS = this;
     storeSCPCallbackData.fileName = storeRequest->AffectedSOPInstanceUID;
 
     OFCondition condition = DIMSE_storeProvider(association, presentationContextID, storeRequest, NULL, useMetaheader, &retrievedDataset, storeSCPCallback,
                                                 (void*) &storeSCPCallbackData, DIMSE_BLOCKING, 0);
+    delete storeSCPCallbackData.dcmFileFormat;
 
     if (condition.bad())
     {
@@ -252,29 +531,55 @@ OFCondition RetrieveDICOMFilesFromPACS::storeSCP(T_ASC_Association *association,
     return condition;
 }
 
-OFCondition RetrieveDICOMFilesFromPACS::subOperationSCP(T_ASC_Association **subAssociation)
+bool RetrieveDICOMFilesFromPACS::subOperationSCP(SubAssociation &subAssociation)
 {
     // Ens convertim com en un servei. El PACS ens fa peticions que nosaltres hem de respondre, ens pot demanar descarregar una imatge o fer un echo
     T_DIMSE_Message dimseMessage;
     T_ASC_PresentationContextID presentationContextID;
+    OFCondition condition = EC_Normal;
 
-    if (!ASC_dataWaiting(*subAssociation, 0))
+    if (subAssociation.pendingCommand)
     {
-        return DIMSE_NODATAAVAILABLE;
+        dimseMessage = *subAssociation.pendingCommand;
+        presentationContextID = subAssociation.pendingCommandPresentationContextID;
+        delete subAssociation.pendingCommand;
+        subAssociation.pendingCommand = NULL;
     }
+    else
+    {
+        condition = DIMSE_receiveCommand(subAssociation.association, DIMSE_BLOCKING, 0, &presentationContextID, &dimseMessage, NULL);
+    }
+
+    if (condition == EC_Normal && !subAssociation.isOwnerConfirmed && dimseMessage.CommandField == DIMSE_C_STORE_RQ)
+    {
+        subAssociation.isOwnerConfirmed = true;
+
+        // Several retrieves could have requested the association, the Move Originator Message ID tells which one did it
+        if ((dimseMessage.msg.CStoreRQ.opts & O_STORE_MOVEORIGINATORID) && dimseMessage.msg.CStoreRQ.MoveOriginatorID != m_moveMessageID)
+        {
+            SubAssociation otherSubAssociation = subAssociation;
+            otherSubAssociation.pendingCommand = new T_DIMSE_Message(dimseMessage);
+            otherSubAssociation.pendingCommandPresentationContextID = presentationContextID;
 
-    OFCondition condition = DIMSE_receiveCommand(*subAssociation, DIMSE_BLOCKING, 0, &presentationContextID, &dimseMessage, NULL);
+            if (handOverSubAssociation(otherSubAssociation, dimseMessage.msg.CStoreRQ.MoveOriginatorID))
+            {
+                return false;
+            }
+
+            delete otherSubAssociation.pendingCommand;
+        }
+    }
 
     if (condition == EC_Normal)
     {
         switch (dimseMessage.CommandField)
         {
             case DIMSE_C_STORE_RQ:
-                condition = storeSCP(*subAssociation, &dimseMessage, presentationContextID);
+                condition = storeSCP(subAssociation.association, &dimseMessage, presentationContextID);
                 break;
 
             case DIMSE_C_ECHO_RQ:
-                condition = echoSCP(*subAssociation, &dimseMessage, presentationContextID);
+                condition = echoSCP(subAssociation.association, &dimseMessage, presentationContextID);
                 break;
 
             default:
@@ -287,10 +592,10 @@ OFCondition RetrieveDICOMFilesFromPACS::subOperationSCP(T_ASC_Association **subA
     if (condition == DUL_PEERREQUESTEDRELEASE)
     {
         INFO_LOG("El PACS sol.licita tancar la connexio per on ens ha enviat els fitxers");
-        condition = ASC_acknowledgeRelease(*subAssociation);
-        ASC_dropSCPAssociation(*subAssociation);
-        ASC_destroyAssociation(subAssociation);
-        return condition;
+        ASC_acknowledgeRelease(subAssociation.association);
+        ASC_dropSCPAssociation(subAssociation.association);
+        ASC_destroyAssociation(&subAssociation.association);
+        return false;
     }
     else if (condition == DUL_PEERABORTEDASSOCIATION)
     {
@@ -299,65 +604,135 @@ OFCondition RetrieveDICOMFilesFromPACS::subOperationSCP(T_ASC_Association **subA
     else if (condition != EC_Normal)
     {
         ERROR_LOG("S'ha produit un error reben la peticio d'una suboperacio, descripcio error: " + QString(condition.text()));
-        condition = ASC_abortAssociation(*subAssociation);
+        condition = ASC_abortAssociation(subAssociation.association);
+    }
+
+    if (condition != EC_Normal)
+    {
+        ASC_dropAssociation(subAssociation.association);
+        ASC_destroyAssociation(&subAssociation.association);
+        return false;
     }
-    else if (m_abortIsRequested)
+
+    return true;
+}
+
+OFCondition RetrieveDICOMFilesFromPACS::move(T_ASC_Association *association, T_ASC_PresentationContextID presentationContextID,
+                                             T_DIMSE_C_MoveRQ *moveRequest, DcmDataset *datasetToRetrieve, T_DIMSE_C_MoveRSP *moveResponse,
+                                             DcmDataset **statusDetail)
+{
+    // DIMSE_moveUser can't be used because it serves the first association that arrives until the move finishes, even if it's of another retrieve
+    T_DIMSE_Message request;
+    memset(&request, 0, sizeof(request));
+    request.CommandField = DIMSE_C_MOVE_RQ;
+    request.msg.CMoveRQ = *moveRequest;
+
+    OFCondition condition = DIMSE_sendMessageUsingMemoryData(association, presentationContextID, &request, NULL, datasetToRetrieve, NULL, NULL);
+
+    while (condition.good())
     {
-        INFO_LOG("Abortarem les connexions amb el PACS, perque han sol.licitant cancel.lar la descarrega");
-        condition = ASC_abortAssociation(*subAssociation);
-        if (!condition.good())
+        if (m_abortIsRequested)
         {
-            ERROR_LOG("Error al abortar la connexio pel qual rebem les imatges" + QString(condition.text()));
+            INFO_LOG("Abortarem les connexions amb el PACS, perque han sol.licitant cancel.lar la descarrega");
+            takeHandedOverSubAssociations();
+            for (int i = 0; i < m_subAssociations.size(); i++)
+            {
+                abortSubAssociation(m_subAssociations[i]);
+            }
+            m_subAssociations.clear();
+
+            // Tanquem la connexió amb el PACS perquè segons indica la documentació DICOM al PS 3.4 (Baseline Behavior of SCP) C.4.2.3.1 si abortem
+            // la connexió per la qual rebem les imatges, el comportament del PACS és desconegut, per exemple DCM4CHEE tanca la connexió amb el PACS, però
+            // el RAIM_Server no la tanca i la manté fent que no sortim mai d'aquesta classe. Degut a que no es pot saber en aquesta situació com actuaran
+            // els PACS es tanca aquí la connexió amb el PACS.
+            condition = ASC_abortAssociation(association);
+            if (!condition.good())
+            {
+                ERROR_LOG("Error al abortar la connexio pel amb el PACS" + QString(condition.text()));
+            }
+            else
+            {
+                INFO_LOG("Abortada la connexio amb el PACS");
+            }
+
+            return condition;
         }
 
-        // Tanquem la connexió amb el PACS perquè segons indica la documentació DICOM al PS 3.4 (Baseline Behavior of SCP) C.4.2.3.1 si abortem
-        // la connexió per la qual rebem les imatges, el comportament del PACS és desconegut, per exemple DCM4CHEE tanca la connexió amb el PACS, però
-        // el RAIM_Server no la tanca i la manté fent que no sortim mai d'aquesta classe. Degut a que no es pot saber en aquesta situació com actuaran
-        // els PACS es tanca aquí la connexió amb el PACS.
-        condition = ASC_abortAssociation(m_pacsConnection->getConnection());
-        if (!condition.good())
+        acceptSubAssociations();
+        takeHandedOverSubAssociations();
+
+        // The requests already received by another retrieve are served before waiting for new data
+        QVector<T_ASC_Association*> readableAssociations;
+        readableAssociations.append(association);
+        bool hasPendingCommands = false;
+        foreach (const SubAssociation &subAssociation, m_subAssociations)
         {
-            ERROR_LOG("Error al abortar la connexio pel amb el PACS" + QString(condition.text()));
+            readableAssociations.append(subAssociation.association);
+            hasPendingCommands |= subAssociation.pendingCommand != NULL;
         }
-        else
+
+        if (!hasPendingCommands && !waitForReadableAssociations(m_pacsConnection->getNetwork(), readableAssociations, SubAssociationsPollingTimeout))
         {
-            INFO_LOG("Abortada la connexio amb el PACS");
+            continue;
         }
-    }
 
-    if (condition != EC_Normal)
-    {
-        ASC_dropAssociation(*subAssociation);
-        ASC_destroyAssociation(subAssociation);
-    }
-    return condition;
-}
+        for (int i = m_subAssociations.size() - 1; i >= 0; i--)
+        {
+            if ((hasPendingCommands && m_subAssociations[i].pendingCommand) || (!hasPendingCommands && readableAssociations.at(i + 1)))
+            {
+                if (!subOperationSCP(m_subAssociations[i]))
+                {
+                    m_subAssociations.removeAt(i);
+                }
+            }
+        }
 
-void RetrieveDICOMFilesFromPACS::subOperationCallback(void *subOperationCallbackData, T_ASC_Network *associationNetwork, T_ASC_Association **subAssociation)
-{
-    RetrieveDICOMFilesFromPACS *retrieveDICOMFilesFromPACS = (RetrieveDICOMFilesFromPACS*)subOperationCallbackData;
-    if (associationNetwork == NULL)
-    {
-        // Help no net !
-        return;
-    }
+        if (hasPendingCommands || !readableAssociations.first())
+        {
+            continue;
+        }
 
-    if (*subAssociation == NULL)
-    {
-        OFCondition condition = retrieveDICOMFilesFromPACS->acceptSubAssociation(associationNetwork, subAssociation);
-        if (!condition.good())
+        T_DIMSE_Message response;
+        T_ASC_PresentationContextID responsePresentationContextID;
+        condition = DIMSE_receiveCommand(association, DIMSE_BLOCKING, 0, &responsePresentationContextID, &response, statusDetail);
+        if (condition.bad())
         {
-            ERROR_LOG("S'ha produit un error negociant l'associacio de la connexio DICOM entrant, descripcio error: " + QString(condition.text()));
+            break;
         }
-        else
+
+        if (response.CommandField != DIMSE_C_MOVE_RSP)
         {
-            INFO_LOG("Rebuda solicitud de connexio pel port de connexions DICOM entrants del PACS.");
+            ERROR_LOG(QString("S'esperava una resposta al C-MOVE i s'ha rebut la comanda %1").arg(response.CommandField));
+            condition = DIMSE_BADCOMMANDTYPE;
+            break;
         }
+
+        *moveResponse = response.msg.CMoveRSP;
+        if (moveResponse->MessageIDBeingRespondedTo != moveRequest->MessageID)
+        {
+            ERROR_LOG("La resposta al C-MOVE no correspon a la peticio enviada");
+            condition = DIMSE_BADMESSAGE;
+            break;
+        }
+
+        if (moveResponse->DataSetType != DIMSE_DATASET_NULL)
+        {
+            DcmDataset *responseIdentifiers = NULL;
+            condition = DIMSE_receiveDataSetInMemory(association, DIMSE_BLOCKING, 0, &responsePresentationContextID, &responseIdentifiers, NULL, NULL);
+            delete responseIdentifiers;
+        }
+
+        if (moveResponse->DimseStatus != STATUS_Pending)
+        {
+            break;
+        }
+
+        // Only the status detail of the final response is kept
+        delete *statusDetail;
+        *statusDetail = NULL;
     }
-    else
-    {
-        retrieveDICOMFilesFromPACS->subOperationSCP(subAssociation);
-    }
+
+    return condition;
 }
 
 PACSRequestStatus::RetrieveRequestStatus RetrieveDICOMFilesFromPACS::retrieve(const QString &studyInstanceUID, const QString &seriesInstanceUID, const QString &sopInstanceUID)
@@ -367,9 +742,9 @@ PACSRequestStatus::RetrieveRequestStatus RetrieveDICOMFilesFromPACS::retrieve(co
     DcmDataset *statusDetail = NULL;
     m_pacsConnection = new PACSConnection(m_pacs);
     PACSRequestStatus::RetrieveRequestStatus retrieveRequestStatus;
-    MoveSCPCallbackData moveSCPCallbackData;
     DcmDataset *dcmDatasetToRetrieve = getDcmDatasetOfImagesToRetrieve(studyInstanceUID, seriesInstanceUID, sopInstanceUID);
     m_numberOfImagesRetrieved = 0;
+    m_writeFailed = false;
 
     // TODO S'hauria de comprovar que es tracti d'un PACS amb el servei de retrieve configurat
     if (!m_pacsConnection->connectToPACS(PACSConnection::RetrieveDICOMFiles))
@@ -384,22 +759,25 @@ PACSRequestStatus::RetrieveRequestStatus RetrieveDICOMFilesFromPACS::retrieve(co
     if (presentationContextID == 0)
     {
         ERROR_LOG("No s'ha trobat cap presentation context valid");
+        m_pacsConnection->disconnect();
         return PACSRequestStatus::RetrieveFailureOrRefused;
     }
 
-    moveSCPCallbackData.association = association;
-    moveSCPCallbackData.presentationContextId = presentationContextID;
-    moveSCPCallbackData.retrieveDICOMFilesFromPACS = this;
+    registerRetrieveInProgress();
 
     // Set the destination of the images to us
-    T_DIMSE_C_MoveRQ moveRequest = getConfiguredMoveRequest(association);
+    T_DIMSE_C_MoveRQ moveRequest = getConfiguredMoveRequest();
     ASC_getAPTitles(association->params, moveRequest.MoveDestination, NULL, NULL);
 
-    OFCondition condition = DIMSE_moveUser(association, presentationContextID, &moveRequest, dcmDatasetToRetrieve, moveCallback, &moveSCPCallbackData,
-                                           DIMSE_BLOCKING, 0, m_pacsConnection->getNetwork(), subOperationCallback, this, &moveResponse, &statusDetail,
-                                           NULL /*responseIdentifiers*/);
+    // If no response arrives the retrieve has failed
+    moveResponse.DimseStatus = STATUS_MOVE_Failed_UnableToProcess;
+    OFCondition condition = move(association, presentationContextID, &moveRequest, dcmDatasetToRetrieve, &moveResponse, &statusDetail);
 
-    if (condition.bad())
+    if (m_abortIsRequested)
+    {
+        moveResponse.DimseStatus = STATUS_MOVE_Cancel_SubOperationsTerminatedDueToCancelIndication;
+    }
+    else if (condition.bad())
     {
         ERROR_LOG(QString("El metode descarrega no ha finalitzat correctament. Codi error: %1, descripcio error: %2").arg(condition.code())
                      .arg(condition.text()));
@@ -407,7 +785,18 @@ PACSRequestStatus::RetrieveRequestStatus RetrieveDICOMFilesFromPACS::retrieve(co
 
     m_pacsConnection->disconnect();
 
+    // The retrieve is not finished until all the received files are on disk and have been notified. Once unregistered no more associations can be given
+    // to it
+    unregisterRetrieveInProgress();
+    waitForPendingWrites();
+
     retrieveRequestStatus = getDIMSEStatusCodeAsRetrieveRequestStatus(moveResponse.DimseStatus);
+    if (retrieveRequestStatus == PACSRequestStatus::RetrieveOk && hasWriteFailed())
+    {
+        // The PACS thinks that all the files have been stored because they were acknowledged before being written
+        ERROR_LOG("Alguna de les imatges descarregades no s'ha pogut guardar");
+        retrieveRequestStatus = PACSRequestStatus::RetrieveSomeDICOMFilesFailed;
+    }
     processServiceClassProviderResponseStatus(moveResponse.DimseStatus, statusDetail);
     
     // Dump status detail information if there is some
@@ -432,12 +821,12 @@ int RetrieveDICOMFilesFromPACS::getNumberOfDICOMFilesRetrieved()
     return m_numberOfImagesRetrieved;
 }
 
-T_DIMSE_C_MoveRQ RetrieveDICOMFilesFromPACS::getConfiguredMoveRequest(T_ASC_Association *association)
+T_DIMSE_C_MoveRQ RetrieveDICOMFilesFromPACS::getConfiguredMoveRequest()
 {
     T_DIMSE_C_MoveRQ moveRequest;
-    DIC_US messageId = association->nextMsgID++;
+    // The message ID identifies this retrieve among the ones being executed, see registerRetrieveInProgress()
 
-    moveRequest.MessageID = messageId;
+    moveRequest.MessageID = m_moveMessageID;
     strcpy(moveRequest.AffectedSOPClassUID, MoveAbstractSyntax);
     moveRequest.Priority = DIMSE_PRIORITY_MEDIUM;
     moveRequest.DataSetType = DIMSE_DATASET_PRESENT;
@@ -15,7 +15,11 @@
 #ifndef RETRIEVEDICOMFILESFROMPACS_H
 #define RETRIEVEDICOMFILESFROMPACS_H
 
+#include <QList>
 #include <QObject>
+#include <QMutex>
+#include <QThreadPool>
+#include <QWaitCondition>
 #include <ofcond.h>
 #include <assoc.h>
 
@@ -51,8 +55,7 @@ public:
     PACSRequestStatus::RetrieveRequestStatus retrieve(const QString &studyInstanceUID, const QString &seriesInstanceUID = "", const QString &sopInstanceUID = "");
 
     /// Cancel·la la descàrrega. La cancel·lació de la descàrrega és assíncrona, quan l'estudi s'ha cancel·lat es retorna l'Status RetrieveCancelled
-    /// El motiu de que sigui assíncron és perquè mentre s'està processant la descàrrega d'una imatge no es pot cancel·lar la descàrrega, només es pot
-    /// fer just després d'haver rebut una imatge.
+    /// The thread of the retrieve checks the request between files and at least once per second, and then aborts its connections with the PACS.
     void requestCancel();
 
     /// Retorna el número d'imatges descarregades
@@ -72,12 +75,57 @@ private:
     /// Responem a una petició per guardar una imatge
     OFCondition storeSCP(T_ASC_Association *association, T_DIMSE_Message *messagge, T_ASC_PresentationContextID presentationContextID);
 
-    /// Accepta la connexió que ens fa el PACS, per convertir-nos en un scp
-    OFCondition subOperationSCP(T_ASC_Association **subAssociation);
+    /// Sends the C-MOVE request and waits for its final response. Meanwhile it accepts the incoming associations, serves the ones of this retrieve and
+    /// aborts the connections if the cancellation is requested.
+    OFCondition move(T_ASC_Association *association, T_ASC_PresentationContextID presentationContextID, T_DIMSE_C_MoveRQ *moveRequest,
+                     DcmDataset *datasetToRetrieve, T_DIMSE_C_MoveRSP *moveResponse, DcmDataset **statusDetail);
 
     /// Guarda una composite instance descarregada
     OFCondition save(DcmFileFormat *fileRetrieved, QString dicomFileAbsolutePath);
 
+    /// Queues the given retrieved file to be written to disk by the writer threads, taking its ownership. If there are too many files or bytes pending to
+    /// be written it blocks until the writers have caught up, so that a slow disk throttles the association instead of making memory grow without limit.
+    void enqueueWrite(DcmFileFormat *fileRetrieved, const QString &dicomFileAbsolutePath);
+    /// Writes the given retrieved file to disk and notifies it with DICOMFileRetrieved. Deletes the file format. Executed by the writer threads.
+    void write(DcmFileFormat *fileRetrieved, const QString &dicomFileAbsolutePath, qint64 size);
+    /// Writes the given retrieved file to disk and, if it could be saved, notifies it with DICOMFileRetrieved. Returns the result of the save.
+    OFCondition saveAndNotify(DcmFileFormat *fileRetrieved, const QString &dicomFileAbsolutePath);
+    /// Blocks until all queued files have been written
+    void waitForPendingWrites();
+    /// Returns true if some retrieved file could not be written to disk
+    bool hasWriteFailed();
+
+    /// Registers this retrieve as being executed and assigns it a C-MOVE message ID that no other retrieve being executed has
+    void registerRetrieveInProgress();
+    /// Stops receiving associations for this retrieve and aborts the ones that are still open
+    void unregisterRetrieveInProgress();
+
+private:
+    /// Incoming association through which a PACS sends us files
+    struct SubAssociation
+    {
+        T_ASC_Association *association;
+        /// False while the association has been assigned to a retrieve only by the calling AE title and more than one retrieve could have requested it
+        bool isOwnerConfirmed;
+        /// Command already received by another retrieve before handing the association over, or null. It must be served before reading again.
+        T_DIMSE_Message *pendingCommand;
+        T_ASC_PresentationContextID pendingCommandPresentationContextID;
+    };
+
+    /// Accepts the associations waiting on the incoming DICOM connections network and hands them to the retrieves that requested them
+    void acceptSubAssociations();
+    /// Hands the given association to the retrieve of the PACS with its calling AE title. If there isn't any, to any retrieve being executed, which will
+    /// check the owner with the first file it receives. Returns false if no retrieve is being executed.
+    static bool handOverSubAssociation(SubAssociation subAssociation);
+    /// Hands the given association to the retrieve whose C-MOVE has the given message ID. Returns false if there isn't any.
+    static bool handOverSubAssociation(SubAssociation subAssociation, unsigned short moveMessageID);
+    /// Moves the associations handed over by the other retrieves to the ones served by this retrieve
+    void takeHandedOverSubAssociations();
+    /// Receives and answers the next request of the given association. Returns false if the association has been closed or handed over to another retrieve.
+    bool subOperationSCP(SubAssociation &subAssociation);
+    /// Aborts and destroys the given association
+    static void abortSubAssociation(SubAssociation &subAssociation);
+
     /// Retorna el nom del fitxer amb que s'ha de guardar l'objecte descarregat, composa el path on s'ha de guardar més el nom del fitxer.
     /// Si el path on s'ha de guardar la imatge no existeix, el crea
     QString getAbsoluteFilePathCompositeInstance(DcmDataset *imageDataset, QString fileName);
@@ -86,36 +134,24 @@ private:
     DcmDataset* getDcmDatasetOfImagesToRetrieve(const QString &studyInstanceUID, const QString &seriesInstanceUID, const QString &sopInstanceUID);
 
     /// Configura l'objecte MoveRequest per la descàrrega de fitxers DICOM
-    T_DIMSE_C_MoveRQ getConfiguredMoveRequest(T_ASC_Association *association);
+    T_DIMSE_C_MoveRQ getConfiguredMoveRequest();
 
     /// Translates DIMSE status code to PACSRequestStatus::RetrieveRequestStatus
     PACSRequestStatus::RetrieveRequestStatus getDIMSEStatusCodeAsRetrieveRequestStatus(unsigned int dimseStatusCode);
 
-    /// Callback de move, semblaria que s'executa cada vegada que s'ha descarregat una imatge
-    static void moveCallback(void *callbackData, T_DIMSE_C_MoveRQ *moveRequest, int responseCount, T_DIMSE_C_MoveRSP *moveResponse);
-
     /// Aquesta funció s'encarrega de guardar cada trama DICOM que rebem
     static void storeSCPCallback(void *callbackData, T_DIMSE_StoreProgress *progress, T_DIMSE_C_StoreRQ *storeRequest, char *imageFileName,
                                  DcmDataset **imageDataSet, T_DIMSE_C_StoreRSP *storeResponse, DcmDataset **statusDetail);
 
-    /// Callback que s'ha executat quan s'inicia un suboperació de descàrrega d'imatges
-    static void subOperationCallback(void *subOperationCallbackData, T_ASC_Network *associationNetwork, T_ASC_Association **subAssociation);
-
 private:
     struct StoreSCPCallbackData
     {
+        /// The callback sets it to null when it takes the ownership of the file format to write it asynchronously
         DcmFileFormat *dcmFileFormat;
         RetrieveDICOMFilesFromPACS *retrieveDICOMFilesFromPACS;
         QString fileName;
     };
 
-    struct MoveSCPCallbackData
-    {
-        T_ASC_Association *association;
-        T_ASC_PresentationContextID presentationContextId;
-        RetrieveDICOMFilesFromPACS *retrieveDICOMFilesFromPACS;
-    };
-
     /// Request DICOM association;
     PacsDevice m_pacs;
     PACSConnection *m_pacsConnection;
@@ -124,6 +160,29 @@ private:
 
     bool m_abortIsRequested;
 
+    /// Threads that write the retrieved files to disk
+    QThreadPool m_writersPool;
+    /// Limits of files and bytes pending to be written. With a maximum of 0 files the files are written synchronously.
+    int m_maximumFilesPendingToWrite;
+    qint64 m_maximumBytesPendingToWrite;
+    /// Files and bytes queued and not yet written
+    int m_filesPendingToWrite;
+    qint64 m_bytesPendingToWrite;
+    /// True if some queued file could not be written
+    bool m_writeFailed;
+    /// Message ID of the C-MOVE request, that the PACS sends back as Move Originator Message ID with each file
+    unsigned short m_moveMessageID;
+    /// Associations through which this retrieve is receiving files. Only used by the thread that executes the retrieve.
+    QList<SubAssociation> m_subAssociations;
+    /// Associations accepted by other retrieves for this one, pending to be taken by its thread. Protected by the mutex of the retrieves in progress.
+    QList<SubAssociation> m_handedOverSubAssociations;
+    /// Protects the pending writes state
+    QMutex m_pendingWritesMutex;
+    /// Signaled each time a queued file has been written
+    QWaitCondition m_pendingWriteFinished;
+    /// Serializes the DICOMFileRetrieved notifications, that are emitted from the writer threads
+    QMutex m_notificationMutex;
+
 };
 
 };
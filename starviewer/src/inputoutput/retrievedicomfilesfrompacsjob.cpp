@@ -24,6 +24,7 @@
 #include "image.h"
 #include "starviewerapplication.h"
 #include "retrievedicomfilesfrompacs.h"
+#include "retrievedicomfilesfrompacsqueuepolicy.h"
 #include "dicommask.h"
 #include "localdatabasemanager.h"
 #include "patientfiller.h"
@@ -32,6 +33,7 @@
 #include "inputoutputsettings.h"
 #include "dicomtagreader.h"
 #include "portinuse.h"
+#include "pacsconnection.h"
 #include "dicomsource.h"
 #include "usermessage.h"
 
@@ -53,6 +55,14 @@ RetrieveDICOMFilesFromPACSJob::RetrieveDICOMFilesFromPACSJob(PacsDevice pacsDevi
 
 RetrieveDICOMFilesFromPACSJob::~RetrieveDICOMFilesFromPACSJob()
 {
+    if (m_queuePolicy)
+    {
+        // ThreadWeaver::Job tells the policies that the job is destroyed in its destructor, once the policy could have already been deleted with
+        // m_queuePolicy, so it's done here
+        removeQueuePolicy(m_queuePolicy.data());
+        m_queuePolicy->destructed(this);
+    }
+
     delete m_studyToRetrieveDICOMFiles;
     delete m_retrieveDICOMFilesFromPACS;
 }
@@ -62,6 +72,17 @@ PACSJob::PACSJobType RetrieveDICOMFilesFromPACSJob::getPACSJobType()
     return PACSJob::RetrieveDICOMFilesFromPACSJobType;
 }
 
+void RetrieveDICOMFilesFromPACSJob::setQueuePolicy(QSharedPointer<RetrieveDICOMFilesFromPACSQueuePolicy> queuePolicy)
+{
+    if (m_queuePolicy)
+    {
+        removeQueuePolicy(m_queuePolicy.data());
+    }
+
+    m_queuePolicy = queuePolicy;
+    assignQueuePolicy(m_queuePolicy.data());
+}
+
 Study* RetrieveDICOMFilesFromPACSJob::getStudyToRetrieveDICOMFiles()
 {
     return m_studyToRetrieveDICOMFiles;
@@ -91,7 +112,8 @@ void RetrieveDICOMFilesFromPACSJob::run(ThreadWeaver::JobPointer self, ThreadWea
 
     int localPort = settings.getValue(InputOutputSettings::IncomingDICOMConnectionsPort).toInt();
 
-    if (PortInUse().isPortInUse(localPort))
+    // When other retrieves are being executed the port is already open by ourselves, and this retrieve will share it
+    if (!PACSConnection::isIncomingDICOMConnectionsNetworkInitialized() && PortInUse().isPortInUse(localPort))
     {
         m_retrieveRequestStatus = PACSRequestStatus::RetrieveIncomingDICOMConnectionsPortInUse;
         ERROR_LOG("El port " + QString::number(localPort) + " per a connexions entrants del PACS, esta en us, no es pot descarregar l'estudi");
@@ -160,7 +182,7 @@ void RetrieveDICOMFilesFromPACSJob::run(ThreadWeaver::JobPointer self, ThreadWea
             deleteRetrievedDICOMFilesIfStudyNotExistInDatabase();
         }
 
-        localDatabaseManager.setNoStudyBeingRetrieved();
+        localDatabaseManager.setNoStudyBeingRetrieved(m_studyToRetrieveDICOMFiles->getInstanceUID());
     }
 }
 
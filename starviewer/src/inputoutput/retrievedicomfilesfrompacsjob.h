@@ -17,6 +17,7 @@
 
 #include <QObject>
 #include <QSet>
+#include <QSharedPointer>
 
 #include "pacsjob.h"
 #include "pacsrequeststatus.h"
@@ -30,6 +31,7 @@ class RetrieveDICOMFilesFromPACS;
 class PacsDevice;
 class DICOMTagReader;
 class DICOMSource;
+class RetrieveDICOMFilesFromPACSQueuePolicy;
 
 /**
     Job que s'encarrega de descarregar fitxers del PACS.
@@ -50,6 +52,9 @@ public:
     /// Retorna el tipus de PACSJob que s l'objecte
     PACSJob::PACSJobType getPACSJobType();
 
+    /// Assigns the queue policy that decides when the job can be executed. The job keeps the policy alive until it's destroyed.
+    void setQueuePolicy(QSharedPointer<RetrieveDICOMFilesFromPACSQueuePolicy> queuePolicy);
+
     /// Retorna l'estudi del qual s'han de descarregar els fitxers. Aquest objecte s'esborra quan es destrueixi el Job
     Study* getStudyToRetrieveDICOMFiles();
 
@@ -117,6 +122,7 @@ private:
     QString m_SOPInstanceUIDToRetrieve;
     PACSRequestStatus::RetrieveRequestStatus m_retrieveRequestStatus;
     RetrievePriorityJob m_retrievePriorityJob;
+    QSharedPointer<RetrieveDICOMFilesFromPACSQueuePolicy> m_queuePolicy;
     
     /// Conjunt que conté els diferents UIDs de sèrie de les imatges descarregades
     QSet<QString> m_retrievedSeriesInstanceUIDSet;
@@ -0,0 +1,106 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#include "retrievedicomfilesfrompacsqueuepolicy.h"
+
+#include "pacsdevice.h"
+#include "retrievedicomfilesfrompacsjob.h"
+#include "study.h"
+
+namespace udg {
+
+RetrieveDICOMFilesFromPACSQueuePolicy::RetrieveDICOMFilesFromPACSQueuePolicy(int maximumConcurrentRetrievesPerPACS)
+{
+    m_maximumConcurrentRetrievesPerPACS = qMax(1, maximumConcurrentRetrievesPerPACS);
+}
+
+bool RetrieveDICOMFilesFromPACSQueuePolicy::canRun(ThreadWeaver::JobPointer job)
+{
+    QSharedPointer<RetrieveDICOMFilesFromPACSJob> retrieveJob = job.dynamicCast<RetrieveDICOMFilesFromPACSJob>();
+
+    if (!retrieveJob)
+    {
+        return true;
+    }
+
+    QString pacsKey = getPACSKey(retrieveJob->getPacsDevice());
+    QString studyInstanceUID = retrieveJob->getStudyToRetrieveDICOMFiles()->getInstanceUID();
+
+    QMutexLocker locker(&m_mutex);
+
+    int numberOfRetrievesFromPACS = 0;
+    typedef QPair<QString, QString> RunningJob;
+    foreach (const RunningJob &runningJob, m_runningJobs)
+    {
+        // Two retrieves of the same study would write the same files and the incoming files could not be assigned to one of them
+        if (runningJob.second == studyInstanceUID)
+        {
+            return false;
+        }
+
+        if (runningJob.first == pacsKey)
+        {
+            numberOfRetrievesFromPACS++;
+        }
+    }
+
+    if (numberOfRetrievesFromPACS >= m_maximumConcurrentRetrievesPerPACS)
+    {
+        return false;
+    }
+
+    m_runningJobs.insert(job.data(), qMakePair(pacsKey, studyInstanceUID));
+    return true;
+}
+
+void RetrieveDICOMFilesFromPACSQueuePolicy::free(ThreadWeaver::JobPointer job)
+{
+    destructed(job.data());
+}
+
+void RetrieveDICOMFilesFromPACSQueuePolicy::release(ThreadWeaver::JobPointer job)
+{
+    destructed(job.data());
+}
+
+void RetrieveDICOMFilesFromPACSQueuePolicy::destructed(ThreadWeaver::JobInterface *job)
+{
+    QMutexLocker locker(&m_mutex);
+    m_runningJobs.remove(job);
+}
+
+int RetrieveDICOMFilesFromPACSQueuePolicy::getNumberOfRetrievesRunning(const PacsDevice &pacsDevice)
+{
+    QString pacsKey = getPACSKey(pacsDevice);
+    int numberOfRetrieves = 0;
+
+    QMutexLocker locker(&m_mutex);
+    typedef QPair<QString, QString> RunningJob;
+    foreach (const RunningJob &runningJob, m_runningJobs)
+    {
+        if (runningJob.first == pacsKey)
+        {
+            numberOfRetrieves++;
+        }
+    }
+
+    return numberOfRetrieves;
+}
+
+QString RetrieveDICOMFilesFromPACSQueuePolicy::getPACSKey(const PacsDevice &pacsDevice)
+{
+    return QString("%1@%2:%3").arg(pacsDevice.getAETitle(), pacsDevice.getAddress()).arg(pacsDevice.getQueryRetrieveServicePort());
+}
+
+}
@@ -0,0 +1,64 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#ifndef UDGRETRIEVEDICOMFILESFROMPACSQUEUEPOLICY_H
+#define UDGRETRIEVEDICOMFILESFROMPACSQUEUEPOLICY_H
+
+#include <ThreadWeaver/QueuePolicy>
+
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+
+namespace udg {
+
+class PacsDevice;
+
+/**
+    Queue policy for the RetrieveDICOMFilesFromPACSJob that limits the number of retrieves executed at the same time from the same PACS and prevents retrieving
+    the same study from two PACS at the same time. The global limit of concurrent retrieves is the maximum number of threads of the queue, and the order in
+    which the jobs are executed is still decided by the queue according to their priority.
+  */
+class RetrieveDICOMFilesFromPACSQueuePolicy : public ThreadWeaver::QueuePolicy {
+public:
+    /// Creates the policy with the given maximum number of concurrent retrieves from the same PACS. Values lower than 1 are treated as 1.
+    RetrieveDICOMFilesFromPACSQueuePolicy(int maximumConcurrentRetrievesPerPACS);
+
+    /// Returns true and reserves the resources for the job if it can be executed now
+    bool canRun(ThreadWeaver::JobPointer job);
+    /// Frees the resources reserved for the job when it has finished
+    void free(ThreadWeaver::JobPointer job);
+    /// Frees the resources reserved for the job when it has not been executed after all
+    void release(ThreadWeaver::JobPointer job);
+    /// Frees the resources reserved for the job if it is destroyed
+    void destructed(ThreadWeaver::JobInterface *job);
+
+    /// Returns the number of retrieves from the given PACS that are being executed
+    int getNumberOfRetrievesRunning(const PacsDevice &pacsDevice);
+
+private:
+    /// Returns the key that identifies the given PACS, following PacsDevice::isSamePacsDevice
+    static QString getPACSKey(const PacsDevice &pacsDevice);
+
+private:
+    int m_maximumConcurrentRetrievesPerPACS;
+    /// PACS key and Study Instance UID of each job that is being executed
+    QHash<ThreadWeaver::JobInterface*, QPair<QString, QString> > m_runningJobs;
+    QMutex m_mutex;
+};
+
+}
+
+#endif
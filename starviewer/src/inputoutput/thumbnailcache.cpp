@@ -0,0 +1,230 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#include "thumbnailcache.h"
+
+#include "directoryutilities.h"
+#include "harddiskinformation.h"
+#include "inputoutputsettings.h"
+#include "logging.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+
+#include <algorithm>
+
+namespace udg {
+
+namespace {
+
+// Size in bytes of the thumbnails stored in each cache directory. It's computed the first time it's needed and kept up to date by all the instances
+// afterwards, so that checking whether the maximum size is exceeded doesn't need to walk the directory.
+QHash<QString, qint64> CacheSizes;
+QMutex CacheSizesMutex;
+
+// Orders study directories from the least to the most recently modified.
+bool LeastRecentlyModifiedFirst(const QFileInfo &fileInfo1, const QFileInfo &fileInfo2)
+{
+    return fileInfo1.lastModified() < fileInfo2.lastModified();
+}
+
+}
+
+ThumbnailCache::ThumbnailCache()
+{
+    Settings settings;
+    m_directory = QDir::toNativeSeparators(settings.getValue(InputOutputSettings::ThumbnailCachePath).toString());
+    m_maximumSizeInBytes = settings.getValue(InputOutputSettings::ThumbnailCacheMaximumSizeInMegaBytes).toLongLong() * 1024 * 1024;
+}
+
+ThumbnailCache::ThumbnailCache(const QString &directory, qint64 maximumSizeInBytes)
+    : m_directory(directory), m_maximumSizeInBytes(maximumSizeInBytes)
+{
+}
+
+QString ThumbnailCache::getThumbnailFilePath(const QString &studyInstanceUID, const QString &uid) const
+{
+    return QDir(getStudyDirectory(studyInstanceUID)).filePath(uid + ".png");
+}
+
+bool ThumbnailCache::contains(const QString &studyInstanceUID, const QString &uid) const
+{
+    return QFileInfo(getThumbnailFilePath(studyInstanceUID, uid)).exists();
+}
+
+QImage ThumbnailCache::getThumbnail(const QString &studyInstanceUID, const QString &uid) const
+{
+    // A missing file simply gives a null image, so there's no need to check for its existence first
+    return QImage(getThumbnailFilePath(studyInstanceUID, uid), "PNG");
+}
+
+bool ThumbnailCache::storeThumbnail(const QString &studyInstanceUID, const QString &uid, const QImage &thumbnail)
+{
+    if (studyInstanceUID.isEmpty() || uid.isEmpty() || thumbnail.isNull())
+    {
+        return false;
+    }
+
+    QString filePath = getThumbnailFilePath(studyInstanceUID, uid);
+    qint64 previousSize = QFileInfo(filePath).size();
+
+    if (!QDir().mkpath(getStudyDirectory(studyInstanceUID)))
+    {
+        WARN_LOG(QString("Can't create the thumbnail cache directory for study %1").arg(studyInstanceUID));
+        return false;
+    }
+
+    if (!thumbnail.save(filePath, "PNG"))
+    {
+        WARN_LOG(QString("Can't store the thumbnail %1 of study %2 in the thumbnail cache").arg(uid).arg(studyInstanceUID));
+        return false;
+    }
+
+    updateSize(QFileInfo(filePath).size() - previousSize);
+
+    return true;
+}
+
+void ThumbnailCache::removeThumbnail(const QString &studyInstanceUID, const QString &uid)
+{
+    QString filePath = getThumbnailFilePath(studyInstanceUID, uid);
+    qint64 size = QFileInfo(filePath).size();
+
+    if (QFile::remove(filePath))
+    {
+        updateSize(-size);
+    }
+}
+
+void ThumbnailCache::removeThumbnails(const QString &studyInstanceUID, const QStringList &uids)
+{
+    foreach (const QString &uid, uids)
+    {
+        removeThumbnail(studyInstanceUID, uid);
+    }
+}
+
+void ThumbnailCache::removeStudy(const QString &studyInstanceUID)
+{
+    if (studyInstanceUID.isEmpty())
+    {
+        return;
+    }
+
+    QString studyDirectory = getStudyDirectory(studyInstanceUID);
+
+    if (QDir().exists(studyDirectory))
+    {
+        qint64 size = HardDiskInformation::getDirectorySizeInBytes(studyDirectory);
+
+        if (DirectoryUtilities().deleteDirectory(studyDirectory, true))
+        {
+            updateSize(-size);
+        }
+    }
+}
+
+void ThumbnailCache::enforceMaximumSize(const QString &studyInstanceUIDToKeep)
+{
+    if (getSize() <= m_maximumSizeInBytes)
+    {
+        return;
+    }
+
+    // Only when the maximum size is exceeded the size of each study is needed
+    QFileInfoList studyDirectories = QDir(m_directory).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+    QHash<QString, qint64> sizeByStudy;
+    qint64 totalSize = 0;
+
+    foreach (const QFileInfo &studyDirectory, studyDirectories)
+    {
+        qint64 studySize = HardDiskInformation::getDirectorySizeInBytes(studyDirectory.absoluteFilePath());
+        sizeByStudy.insert(studyDirectory.fileName(), studySize);
+        totalSize += studySize;
+    }
+
+    // The directory has just been walked, so this also corrects any deviation of the running total, e.g. because of files removed by someone else
+    setSize(totalSize);
+
+    if (totalSize <= m_maximumSizeInBytes)
+    {
+        return;
+    }
+
+    std::sort(studyDirectories.begin(), studyDirectories.end(), LeastRecentlyModifiedFirst);
+
+    int numberOfRemovedStudies = 0;
+
+    foreach (const QFileInfo &studyDirectory, studyDirectories)
+    {
+        if (totalSize <= m_maximumSizeInBytes)
+        {
+            break;
+        }
+
+        QString studyInstanceUID = studyDirectory.fileName();
+
+        if (studyInstanceUID == studyInstanceUIDToKeep)
+        {
+            continue;
+        }
+
+        removeStudy(studyInstanceUID);
+        totalSize -= sizeByStudy.value(studyInstanceUID);
+        numberOfRemovedStudies++;
+    }
+
+    INFO_LOG(QString("Thumbnail cache exceeded its maximum size of %1 MB. Thumbnails of %2 studies have been removed.")
+             .arg(m_maximumSizeInBytes / 1024 / 1024).arg(numberOfRemovedStudies));
+}
+
+QString ThumbnailCache::getStudyDirectory(const QString &studyInstanceUID) const
+{
+    return QDir(m_directory).filePath(studyInstanceUID);
+}
+
+qint64 ThumbnailCache::getSize() const
+{
+    QMutexLocker locker(&CacheSizesMutex);
+
+    if (!CacheSizes.contains(m_directory))
+    {
+        CacheSizes.insert(m_directory, HardDiskInformation::getDirectorySizeInBytes(m_directory));
+    }
+
+    return CacheSizes.value(m_directory);
+}
+
+void ThumbnailCache::setSize(qint64 size) const
+{
+    QMutexLocker locker(&CacheSizesMutex);
+    CacheSizes.insert(m_directory, size);
+}
+
+void ThumbnailCache::updateSize(qint64 sizeIncrement) const
+{
+    QMutexLocker locker(&CacheSizesMutex);
+
+    // Until the size is needed for the first time there's nothing to update
+    if (CacheSizes.contains(m_directory))
+    {
+        CacheSizes[m_directory] = qMax(CacheSizes.value(m_directory) + sizeIncrement, Q_INT64_C(0));
+    }
+}
+
+}
@@ -0,0 +1,83 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#ifndef UDGTHUMBNAILCACHE_H
+#define UDGTHUMBNAILCACHE_H
+
+#include <QString>
+#include <QStringList>
+
+class QImage;
+
+namespace udg {
+
+/**
+    Persistent, size-bounded on-disk store of thumbnails of the studies in the local database.
+
+    Thumbnails are keyed by DICOM UID: the SOP Instance UID of the first image of a volume for volume thumbnails and the Series Instance UID for series
+    previews. They are grouped by study in "<directory>/<StudyInstanceUID>/<UID>.png", so that the path of a thumbnail is computed directly from its keys
+    without scanning or parsing anything and all the thumbnails of a study can be invalidated at once.
+  */
+class ThumbnailCache {
+public:
+    /// Creates a thumbnail cache with the directory and maximum size defined in settings.
+    ThumbnailCache();
+    /// Creates a thumbnail cache in the given directory with the given maximum size in bytes.
+    ThumbnailCache(const QString &directory, qint64 maximumSizeInBytes);
+
+    /// Returns the path of the file where the thumbnail with the given UID from the given study is or would be stored.
+    QString getThumbnailFilePath(const QString &studyInstanceUID, const QString &uid) const;
+
+    /// Returns true if the thumbnail with the given UID from the given study is stored in the cache.
+    bool contains(const QString &studyInstanceUID, const QString &uid) const;
+
+    /// Returns the thumbnail with the given UID from the given study, or a null image if it's not stored in the cache.
+    QImage getThumbnail(const QString &studyInstanceUID, const QString &uid) const;
+
+    /// Stores the given thumbnail with the given UID for the given study, replacing the previous one if any. Returns true if it has been stored.
+    bool storeThumbnail(const QString &studyInstanceUID, const QString &uid, const QImage &thumbnail);
+
+    /// Removes the thumbnail with the given UID from the given study.
+    void removeThumbnail(const QString &studyInstanceUID, const QString &uid);
+    /// Removes the thumbnails with the given UIDs from the given study. UIDs without a thumbnail are ignored.
+    void removeThumbnails(const QString &studyInstanceUID, const QStringList &uids);
+    /// Removes all the thumbnails of the given study.
+    void removeStudy(const QString &studyInstanceUID);
+
+    /// If the cache exceeds its maximum size, removes the thumbnails of the least recently stored studies until it fits. The thumbnails of the given study
+    /// are never removed. The size of the cache is kept as a running total, so the directory is only walked when the maximum size is exceeded.
+    void enforceMaximumSize(const QString &studyInstanceUIDToKeep = QString());
+
+private:
+    /// Returns the directory where the thumbnails of the given study are stored.
+    QString getStudyDirectory(const QString &studyInstanceUID) const;
+
+    /// Returns the total size in bytes of the cache directory, computing it the first time it's needed.
+    qint64 getSize() const;
+    /// Sets the total size in bytes of the cache directory.
+    void setSize(qint64 size) const;
+    /// Adds the given increment, which can be negative, to the total size of the cache directory if it has already been computed.
+    void updateSize(qint64 sizeIncrement) const;
+
+private:
+    /// Root directory of the cache.
+    QString m_directory;
+    /// Maximum size in bytes of the stored thumbnails.
+    qint64 m_maximumSizeInBytes;
+
+};
+
+}
+
+#endif
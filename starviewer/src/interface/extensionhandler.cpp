@@ -17,6 +17,7 @@
 // Qt
 #include <QFileInfo>
 #include <QDir>
+#include <QImage>
 #include <QProgressDialog>
 #include <QMessageBox>
 // Recursos
@@ -38,6 +39,7 @@
 // PACS --------------------------------------------
 #include "queryscreen.h"
 #include "patientfiller.h"
+#include "thumbnailcache.h"
 
 namespace udg {
 
@@ -387,6 +389,7 @@ QList<Patient*> ExtensionHandler::mergePatients(const QList<Patient*> &patientLi
 void ExtensionHandler::generatePatientVolumes(Patient *patient, const QString &defaultSeriesUID)
 {
     Q_UNUSED(defaultSeriesUID);
+    ThumbnailCache thumbnailCache;
     foreach (Study *study, patient->getStudies())
     {
         // Per cada sèrie, si les seves imatges són multiframe o de mides diferents entre sí aniran en volums separats
@@ -432,7 +435,16 @@ void ExtensionHandler::generatePatientVolumes(Patient *patient, const QString &d
                 volume->setImages(imageList);
                 volume->setNumberOfPhases(numberOfPhases);
                 volume->setNumberOfSlicesPerPhase(numberOfSlicesPerPhase);
-                volume->setThumbnail(imageList.at(imageList.count() / 2)->getThumbnail(true));
+                // Volumes of studies from the local database have their thumbnail in the thumbnail cache, keyed by the UID of their first image
+                QImage thumbnail = thumbnailCache.getThumbnail(study->getInstanceUID(), imageList.first()->getSOPInstanceUID());
+                if (!thumbnail.isNull())
+                {
+                    volume->setThumbnail(QPixmap::fromImage(thumbnail));
+                }
+                else
+                {
+                    volume->setThumbnail(imageList.at(imageList.count() / 2)->getThumbnail(true));
+                }
                 series->addVolume(volume);
             }
         }
@@ -12,7 +12,7 @@ CREATE TABLE DatabaseRevision
 -- IMPORTANT!!! Cal canviar el número de revisió per un de superior cada vegada que es faci un canvi a aquest fitxer i calgui
 -- que la BD s'actualitzi
 
-INSERT INTO DatabaseRevision (Revision) VALUES ('9593');
+INSERT INTO DatabaseRevision (Revision) VALUES ('9595');
 
 CREATE TABLE PACSRetrievedImages
 (
@@ -33,6 +33,31 @@ CREATE TABLE Patient
   Sex                           TEXT
 );
 
+CREATE INDEX  IndexPatient_DICOMPatientId ON Patient (DICOMPatientId COLLATE NOCASE);
+
+-- Full-text index of patient names. It is kept up to date by the triggers below and searches must join it with Patient through docid.
+CREATE VIRTUAL TABLE PatientNameSearch USING fts4(content="Patient", Name, tokenize=unicode61);
+
+CREATE TRIGGER TriggerPatientNameSearch_BeforeUpdate BEFORE UPDATE OF Name ON Patient
+BEGIN
+  DELETE FROM PatientNameSearch WHERE docid = old.rowid;
+END;
+
+CREATE TRIGGER TriggerPatientNameSearch_BeforeDelete BEFORE DELETE ON Patient
+BEGIN
+  DELETE FROM PatientNameSearch WHERE docid = old.rowid;
+END;
+
+CREATE TRIGGER TriggerPatientNameSearch_AfterUpdate AFTER UPDATE OF Name ON Patient
+BEGIN
+  INSERT INTO PatientNameSearch (docid, Name) VALUES (new.rowid, new.Name);
+END;
+
+CREATE TRIGGER TriggerPatientNameSearch_AfterInsert AFTER INSERT ON Patient
+BEGIN
+  INSERT INTO PatientNameSearch (docid, Name) VALUES (new.rowid, new.Name);
+END;
+
 
 CREATE TABLE Study
 (
@@ -51,9 +76,37 @@ CREATE TABLE Study
   LastAccessDate                TEXT,
   RetrievedDate                 TEXT,
   RetrievedTime                 TEXT,
-  State                         INTEGER
+  State                         INTEGER,
+  SizeInBytes                   INTEGER
 );
 
+CREATE INDEX  IndexStudy_PatientID ON Study (PatientID);
+CREATE INDEX  IndexStudy_Date ON Study (Date);
+CREATE INDEX  IndexStudy_LastAccessDate ON Study (LastAccessDate);
+
+-- Full-text index of study descriptions. Study rowids can change with VACUUM, so it has to be rebuilt after compacting the database.
+CREATE VIRTUAL TABLE StudyDescriptionSearch USING fts4(content="Study", Description, tokenize=unicode61);
+
+CREATE TRIGGER TriggerStudyDescriptionSearch_BeforeUpdate BEFORE UPDATE OF Description ON Study
+BEGIN
+  DELETE FROM StudyDescriptionSearch WHERE docid = old.rowid;
+END;
+
+CREATE TRIGGER TriggerStudyDescriptionSearch_BeforeDelete BEFORE DELETE ON Study
+BEGIN
+  DELETE FROM StudyDescriptionSearch WHERE docid = old.rowid;
+END;
+
+CREATE TRIGGER TriggerStudyDescriptionSearch_AfterUpdate AFTER UPDATE OF Description ON Study
+BEGIN
+  INSERT INTO StudyDescriptionSearch (docid, Description) VALUES (new.rowid, new.Description);
+END;
+
+CREATE TRIGGER TriggerStudyDescriptionSearch_AfterInsert AFTER INSERT ON Study
+BEGIN
+  INSERT INTO StudyDescriptionSearch (docid, Description) VALUES (new.rowid, new.Description);
+END;
+
 CREATE TABLE Series
 (
   InstanceUID                   TEXT PRIMARY KEY,
@@ -2,6 +2,15 @@
 
 #include "databaseconnection.h"
 #include "databaseinstallation.h"
+#include "image.h"
+#include "localdatabaseimagedal.h"
+#include "localdatabasepatientdal.h"
+#include "localdatabaseseriesdal.h"
+#include "localdatabasestudydal.h"
+#include "patient.h"
+#include "patienttesthelper.h"
+#include "series.h"
+#include "study.h"
 
 using namespace udg;
 
@@ -21,4 +30,73 @@ DatabaseConnection* DatabaseTestHelper::getCreatedDatabase()
     return databaseConnection;
 }
 
+Patient* DatabaseTestHelper::createPatientWithStudy(const QString &studyInstanceUID, int numberOfSeries, int numberOfImagesPerSeries)
+{
+    Patient *patient = PatientTestHelper::createPatientWithIDAndName("ID" + studyInstanceUID, "PATIENT^" + studyInstanceUID);
+    Study *study = new Study();
+    study->setInstanceUID(studyInstanceUID);
+
+    for (int i = 0; i < numberOfSeries; i++)
+    {
+        Series *series = new Series();
+        series->setInstanceUID(QString("%1.%2").arg(studyInstanceUID).arg(i + 1));
+
+        for (int j = 0; j < numberOfImagesPerSeries; j++)
+        {
+            Image *image = new Image();
+            image->setSOPInstanceUID(QString("%1.%2").arg(series->getInstanceUID()).arg(j + 1));
+            image->setInstanceNumber(QString::number(j + 1));
+            image->setOrderNumberInVolume(j);
+            series->addImage(image);
+        }
+
+        study->addSeries(series);
+    }
+
+    patient->addStudy(study);
+
+    return patient;
+}
+
+bool DatabaseTestHelper::insertStudy(DatabaseConnection &databaseConnection, Study *study, const QDate &lastAccessDate)
+{
+    Patient *patient = study->getParentPatient();
+
+    if (!patient)
+    {
+        return false;
+    }
+
+    if (patient->getDatabaseID() == 0 && !LocalDatabasePatientDAL(databaseConnection).insert(patient))
+    {
+        return false;
+    }
+
+    if (!LocalDatabaseStudyDAL(databaseConnection).insert(study, lastAccessDate))
+    {
+        return false;
+    }
+
+    LocalDatabaseSeriesDAL seriesDAL(databaseConnection);
+    LocalDatabaseImageDAL imageDAL(databaseConnection);
+
+    foreach (Series *series, study->getSeries())
+    {
+        if (!seriesDAL.insert(series))
+        {
+            return false;
+        }
+
+        foreach (Image *image, series->getImages())
+        {
+            if (!imageDAL.insert(image))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 }
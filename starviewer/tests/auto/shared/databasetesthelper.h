@@ -1,8 +1,13 @@
 #ifndef DATABASETESTHELPER_H
 #define DATABASETESTHELPER_H
 
+#include <QDate>
+#include <QString>
+
 namespace udg {
 class DatabaseConnection;
+class Patient;
+class Study;
 }
 
 namespace testing {
@@ -17,6 +22,12 @@ public:
     static udg::DatabaseConnection* getEmptyDatabase();
     /// Returns an in-memory database with the tables created but empty.
     static udg::DatabaseConnection* getCreatedDatabase();
+    /// Returns a patient with a study with the given UID and the given number of series and images in each series. The UIDs of the series and images are
+    /// derived from the study UID, so they are unique in the database as long as the study UIDs are.
+    static udg::Patient* createPatientWithStudy(const QString &studyInstanceUID, int numberOfSeries, int numberOfImagesPerSeries);
+    /// Inserts the given study, with its series and images, in the given database with the given last access date. The parent patient is inserted too if it
+    /// hasn't been inserted yet. Display shutters and VOI LUTs of the images are not inserted. Returns true if successful and false otherwise.
+    static bool insertStudy(udg::DatabaseConnection &databaseConnection, udg::Study *study, const QDate &lastAccessDate = QDate::currentDate());
 };
 
 }
@@ -24,7 +24,8 @@ SOURCES += $$PWD/pacsdevicetesthelper.cpp \
            $$PWD/testingsettings.cpp \
            $$PWD/testingmammographyimagehelper.cpp \
            $$PWD/testingdecaycorrectionfactorformulacalculator.cpp \
-           $$PWD/databasetesthelper.cpp
+           $$PWD/databasetesthelper.cpp \
+           $$PWD/testingconverttodicomdir.cpp
            
 HEADERS += $$PWD/autotest.h \
            $$PWD/pacsdevicetesthelper.h \
@@ -52,4 +53,5 @@ HEADERS += $$PWD/autotest.h \
            $$PWD/testingsettings.h \
            $$PWD/testingmammographyimagehelper.h \
            $$PWD/testingdecaycorrectionfactorformulacalculator.h \
-           $$PWD/databasetesthelper.h
+           $$PWD/databasetesthelper.h \
+           $$PWD/testingconverttodicomdir.h
@@ -0,0 +1,34 @@
+#include "testingconverttodicomdir.h"
+
+namespace testing {
+
+void TestingConvertToDicomdir::setSeriesPath(const QString &seriesPath)
+{
+    m_dicomDirSeriesPath = seriesPath;
+}
+
+QStringList TestingConvertToDicomdir::getSourceFilesToCopy() const
+{
+    QStringList files;
+
+    foreach (const ImageToCopy &file, m_imagesToCopy)
+    {
+        files << file.sourceFile;
+    }
+
+    return files;
+}
+
+QStringList TestingConvertToDicomdir::getDestinationFilesToCopy() const
+{
+    QStringList files;
+
+    foreach (const ImageToCopy &file, m_imagesToCopy)
+    {
+        files << file.destinationFile;
+    }
+
+    return files;
+}
+
+}
@@ -0,0 +1,31 @@
+#ifndef TESTINGCONVERTTODICOMDIR_H
+#define TESTINGCONVERTTODICOMDIR_H
+
+#include "converttodicomdir.h"
+
+#include <QStringList>
+
+namespace testing {
+
+/**
+ * ConvertToDicomdir class for use in unit tests. Gives access to the copy of the images of a series to the DICOMDIR without having to convert a whole study.
+ */
+class TestingConvertToDicomdir : public udg::ConvertToDicomdir {
+
+public:
+    using udg::ConvertToDicomdir::addImagesToCopy;
+    using udg::ConvertToDicomdir::copyImagesToDicomdirPath;
+
+    /// Sets the directory of the series where the images added afterwards will be copied.
+    void setSeriesPath(const QString &seriesPath);
+
+    /// Returns the files added to copy, in the order in which they have been added.
+    QStringList getSourceFilesToCopy() const;
+    /// Returns the destination files of the files added to copy, in the order in which they have been added.
+    QStringList getDestinationFilesToCopy() const;
+
+};
+
+}
+
+#endif // TESTINGCONVERTTODICOMDIR_H
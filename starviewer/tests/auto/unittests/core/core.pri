@@ -9,6 +9,9 @@ SOURCES += $$PWD/test_image.cpp \
            $$PWD/test_imageorientationoperationsmapper.cpp \
            $$PWD/test_volume.cpp \
            $$PWD/test_q2dviewer.cpp \
+           $$PWD/test_renderscheduler.cpp \
+           $$PWD/test_qviewercinecontroller.cpp \
+           $$PWD/test_imagepipeline.cpp \
            $$PWD/test_machineinformation.cpp \
            $$PWD/test_opacitytransferfunction.cpp \
            $$PWD/test_series.cpp \
@@ -69,6 +72,7 @@ SOURCES += $$PWD/test_image.cpp \
            $$PWD/test_slicehandler.cpp \
            $$PWD/test_voxel.cpp \
            $$PWD/test_roidata.cpp \
+           $$PWD/test_scanlinepolygonrasterizer.cpp \
            $$PWD/test_mammographyimagehelper.cpp \
            $$PWD/test_transferfunction.cpp \
            $$PWD/test_leanbodymassformula.cpp \
@@ -82,13 +86,20 @@ SOURCES += $$PWD/test_image.cpp \
            $$PWD/test_standardizeduptakevaluebodysurfaceareaformulacalculator.cpp \
            $$PWD/test_relativegeometrylayout.cpp \
            $$PWD/test_griditerator.cpp \
+           $$PWD/test_magicroiregiongrower.cpp \
            $$PWD/test_voilut.cpp \
            $$PWD/test_hangingprotocolimagesetrestriction.cpp \
            $$PWD/test_hangingprotocolimagesetrestrictionexpression.cpp \
            $$PWD/test_volumefillerstep.cpp \
            $$PWD/test_patientfillerinput.cpp \
+           $$PWD/test_patientfiller.cpp \
            $$PWD/test_externalapplication.cpp \
-           $$PWD/test_sliceorientedvolumepixeldata.cpp
+           $$PWD/test_sliceorientedvolumepixeldata.cpp \
+           $$PWD/test_volumerepository.cpp \
+           $$PWD/test_vtkdcmtkimagereader.cpp \
+           $$PWD/test_obscurancemainthread.cpp \
+           $$PWD/test_vtkimageextractphase.cpp \
+           $$PWD/test_emptyspacemap.cpp
 
 win32 {
     SOURCES += $$PWD/test_windowsfirewallaccess.cpp \
@@ -3,9 +3,13 @@
 #include "dicomtagreader.h"
 #include "dicomvalueattribute.h"
 
+#include <QTemporaryDir>
+
 #include <dcdatset.h>
 #include <dcdeftag.h>
+#include <dcfilefo.h>
 #include <dcsequen.h>
+#include <dcuid.h>
 
 using namespace udg;
 
@@ -17,6 +21,15 @@ private slots:
     
     void getValueAttribute_ReturnsExpectedValues_data();
     void getValueAttribute_ReturnsExpectedValues();
+
+    void setDcmDataset_MetadataOnly_ReleasesBulkDataAndKeepsAttributes();
+
+    void setFile_Benchmark_data();
+    void setFile_Benchmark();
+
+private:
+    /// Creates a DICOM file with a single frame of size x size 16-bit pixels in the given directory and returns its path.
+    QString createDICOMFile(const QTemporaryDir &directory, int instanceNumber, int size);
 };
 
 Q_DECLARE_METATYPE(DcmDataset*)
@@ -110,6 +123,95 @@ void test_DICOMTagReader::getValueAttribute_ReturnsExpectedValues()
     QCOMPARE(expectedValue->getValueAsByteArray(), returnValue->getValueAsByteArray());
 }
 
+void test_DICOMTagReader::setDcmDataset_MetadataOnly_ReleasesBulkDataAndKeepsAttributes()
+{
+    DcmDataset *dataset = new DcmDataset;
+    dataset->putAndInsertString(DCM_PatientName, "JOHN^DOE");
+    dataset->putAndInsertUint16(DCM_Rows, 2);
+    Uint8 pixels[4] = {1, 2, 3, 4};
+    dataset->putAndInsertUint8Array(DCM_PixelData, pixels, 4);
+    dataset->putAndInsertUint8Array(DCM_OverlayData, pixels, 4);
+
+    DICOMTagReader tagReader;
+    tagReader.setDcmDataset("", dataset, DICOMTagReader::MetadataOnly);
+
+    QCOMPARE(tagReader.getValueAttributeAsQString(DICOMPatientName), QString("JOHN^DOE"));
+    QCOMPARE(tagReader.getValueAttributeAsQString(DICOMRows), QString("2"));
+    QVERIFY(tagReader.tagExists(DICOMPixelData));
+    QVERIFY(tagReader.tagExists(DICOMOverlayData));
+
+    DcmElement *element = NULL;
+    QVERIFY(dataset->findAndGetElement(DCM_PixelData, element).good());
+    QCOMPARE(element->getLength(), Uint32(0));
+    QVERIFY(dataset->findAndGetElement(DCM_OverlayData, element).good());
+    QCOMPARE(element->getLength(), Uint32(0));
+}
+
+void test_DICOMTagReader::setFile_Benchmark_data()
+{
+    QTest::addColumn<int>("loadMode");
+
+    QTest::newRow("full load") << static_cast<int>(DICOMTagReader::FullLoad);
+    QTest::newRow("metadata only") << static_cast<int>(DICOMTagReader::MetadataOnly);
+}
+
+void test_DICOMTagReader::setFile_Benchmark()
+{
+    QFETCH(int, loadMode);
+
+    // Same work as PatientFiller per file: parse it and read some attributes
+    const int NumberOfFiles = 50;
+    QTemporaryDir directory;
+    QStringList files;
+
+    for (int i = 0; i < NumberOfFiles; i++)
+    {
+        files << createDICOMFile(directory, i + 1, 512);
+    }
+
+    QBENCHMARK
+    {
+        foreach (const QString &file, files)
+        {
+            DICOMTagReader tagReader(file, static_cast<DICOMTagReader::LoadMode>(loadMode));
+            QCOMPARE(tagReader.getValueAttributeAsQString(DICOMRows), QString("512"));
+            QVERIFY(!tagReader.getValueAttributeAsQString(DICOMSOPInstanceUID).isEmpty());
+            QVERIFY(tagReader.tagExists(DICOMPixelData));
+        }
+    }
+}
+
+QString test_DICOMTagReader::createDICOMFile(const QTemporaryDir &directory, int instanceNumber, int size)
+{
+    DcmFileFormat fileFormat;
+    DcmDataset *dataset = fileFormat.getDataset();
+    QString sopInstanceUID = QString("1.2.3.4.5.1.%1").arg(instanceNumber);
+
+    dataset->putAndInsertString(DCM_SOPClassUID, UID_CTImageStorage);
+    dataset->putAndInsertString(DCM_SOPInstanceUID, qPrintable(sopInstanceUID));
+    dataset->putAndInsertString(DCM_StudyInstanceUID, "1.2.3.4");
+    dataset->putAndInsertString(DCM_SeriesInstanceUID, "1.2.3.4.5.1");
+    dataset->putAndInsertString(DCM_PatientName, "JOHN^DOE");
+    dataset->putAndInsertString(DCM_Modality, "CT");
+    dataset->putAndInsertString(DCM_InstanceNumber, qPrintable(QString::number(instanceNumber)));
+    dataset->putAndInsertUint16(DCM_SamplesPerPixel, 1);
+    dataset->putAndInsertString(DCM_PhotometricInterpretation, "MONOCHROME2");
+    dataset->putAndInsertUint16(DCM_Rows, static_cast<Uint16>(size));
+    dataset->putAndInsertUint16(DCM_Columns, static_cast<Uint16>(size));
+    dataset->putAndInsertUint16(DCM_BitsAllocated, 16);
+    dataset->putAndInsertUint16(DCM_BitsStored, 16);
+    dataset->putAndInsertUint16(DCM_HighBit, 15);
+    dataset->putAndInsertUint16(DCM_PixelRepresentation, 0);
+
+    QVector<Uint16> pixels(size * size, static_cast<Uint16>(instanceNumber));
+    dataset->putAndInsertUint16Array(DCM_PixelData, pixels.data(), pixels.size());
+
+    QString path = QString("%1/%2.dcm").arg(directory.path()).arg(sopInstanceUID);
+    fileFormat.saveFile(qPrintable(path), EXS_LittleEndianExplicit);
+
+    return path;
+}
+
 DECLARE_TEST(test_DICOMTagReader)
 
 #include "test_dicomtagreader.moc"
@@ -0,0 +1,306 @@
+#include "autotest.h"
+#include "emptyspacemap.h"
+
+#include "ambientvoxelshader.h"
+#include "combiningvoxelshader.h"
+#include "obscurance.h"
+#include "obscurancevoxelshader.h"
+#include "vtkVolumeRayCastSingleVoxelShaderCompositeFunction.h"
+
+#include <vtkSmartPointer.h>
+
+using namespace udg;
+
+class test_EmptySpaceMap : public QObject {
+Q_OBJECT
+
+private slots:
+    void getNumberOfEmptySamples_ReturnsExpectedValue_data();
+    void getNumberOfEmptySamples_ReturnsExpectedValue();
+
+    void getNumberOfEmptyBlocks_ReturnsExpectedValue_data();
+    void getNumberOfEmptyBlocks_ReturnsExpectedValue();
+
+    void setData_WithNullData_ShouldClearBlocks();
+
+    void castRay_WithEmptySpaceMap_ShouldGiveSameImage();
+
+    void castRay_Benchmark_data();
+    void castRay_Benchmark();
+
+private:
+    typedef CombiningVoxelShader<AmbientVoxelShader, ObscuranceVoxelShader> AmbientObscuranceVoxelShader;
+
+    /// Returns a volume of size^3 voxels with value 0 except the voxels in the cube [first, last]^3, that have the given value.
+    static QVector<unsigned short> createCubeVolume(int size, int first, int last, unsigned short value);
+    /// Returns a volume of size^3 voxels with a noisy sphere of values around 1000 in the middle and zeros elsewhere.
+    static QVector<unsigned short> createSphereVolume(int size);
+    /// Returns a transfer function that is transparent below lowerValue and opaque from upperValue on.
+    static TransferFunction createTransferFunction(double lowerValue, double upperValue);
+    /// Casts a ray along z through the center of each column of voxels of a volume of size^3 voxels and returns the RGBA colors.
+    static QVector<float> castRays(vtkVolumeRayCastFunction *function, int size);
+    static void castRay(vtkVolumeRayCastFunction *function, int size, int x, int y, float color[4]);
+};
+
+Q_DECLARE_METATYPE(Vector3)
+
+void test_EmptySpaceMap::getNumberOfEmptySamples_ReturnsExpectedValue_data()
+{
+    QTest::addColumn<Vector3>("position");
+    QTest::addColumn<Vector3>("increment");
+    QTest::addColumn<int>("expectedNumberOfSamples");
+
+    // The volume has 20x20x20 voxels, so 3x3x3 blocks covering the voxels [0, 8], [8, 16] and [16, 19] along each axis, and only the central block is opaque
+    QTest::newRow("forwards") << Vector3(2.5, 2.5, 2.5) << Vector3(1.0, 0.0, 0.0) << 6;
+    QTest::newRow("backwards") << Vector3(2.5, 2.5, 2.5) << Vector3(-1.0, 0.0, 0.0) << 3;
+    QTest::newRow("small steps") << Vector3(10.5, 2.5, 2.5) << Vector3(0.0, 0.0, 0.5) << 11;
+    QTest::newRow("diagonal") << Vector3(1.0, 1.0, 1.0) << Vector3(1.0, 2.0, 0.5) << 4;
+    QTest::newRow("last partial block") << Vector3(18.5, 2.5, 2.5) << Vector3(1.0, 0.0, 0.0) << 1;
+    QTest::newRow("opaque block") << Vector3(10.5, 10.5, 10.5) << Vector3(1.0, 0.0, 0.0) << 0;
+    QTest::newRow("on a face") << Vector3(8.0, 2.5, 2.5) << Vector3(1.0, 0.0, 0.0) << 0;
+    QTest::newRow("outside") << Vector3(-1.0, 2.5, 2.5) << Vector3(1.0, 0.0, 0.0) << 0;
+    QTest::newRow("beyond the last voxel") << Vector3(19.5, 2.5, 2.5) << Vector3(-1.0, 0.0, 0.0) << 0;
+}
+
+void test_EmptySpaceMap::getNumberOfEmptySamples_ReturnsExpectedValue()
+{
+    QFETCH(Vector3, position);
+    QFETCH(Vector3, increment);
+    QFETCH(int, expectedNumberOfSamples);
+
+    const int Size = 20;
+    QVector<unsigned short> data = createCubeVolume(Size, 10, 12, 100);
+    int dimensions[3] = { Size, Size, Size };
+
+    EmptySpaceMap map;
+    map.setData(data.constData(), dimensions);
+    map.setTransferFunction(createTransferFunction(50.0, 100.0));
+
+    QCOMPARE(map.getNumberOfEmptySamples(position, increment), expectedNumberOfSamples);
+}
+
+void test_EmptySpaceMap::getNumberOfEmptyBlocks_ReturnsExpectedValue_data()
+{
+    QTest::addColumn<double>("lowerValue");
+    QTest::addColumn<double>("upperValue");
+    QTest::addColumn<int>("expectedNumberOfEmptyBlocks");
+
+    QTest::newRow("cube opaque") << 50.0 << 100.0 << 26;
+    QTest::newRow("everything opaque") << -1.0 << 0.0 << 0;
+    QTest::newRow("everything transparent") << 100.0 << 101.0 << 27;
+}
+
+void test_EmptySpaceMap::getNumberOfEmptyBlocks_ReturnsExpectedValue()
+{
+    QFETCH(double, lowerValue);
+    QFETCH(double, upperValue);
+    QFETCH(int, expectedNumberOfEmptyBlocks);
+
+    const int Size = 20;
+    QVector<unsigned short> data = createCubeVolume(Size, 10, 12, 100);
+    int dimensions[3] = { Size, Size, Size };
+
+    EmptySpaceMap map;
+    map.setData(data.constData(), dimensions);
+    map.setTransferFunction(createTransferFunction(lowerValue, upperValue));
+
+    QCOMPARE(map.getNumberOfBlocks(), 27);
+    QCOMPARE(map.getNumberOfEmptyBlocks(), expectedNumberOfEmptyBlocks);
+}
+
+void test_EmptySpaceMap::setData_WithNullData_ShouldClearBlocks()
+{
+    const int Size = 20;
+    QVector<unsigned short> data = createCubeVolume(Size, 10, 12, 100);
+    int dimensions[3] = { Size, Size, Size };
+
+    EmptySpaceMap map;
+    map.setTransferFunction(createTransferFunction(50.0, 100.0));
+    map.setData(data.constData(), dimensions);
+    map.setData(0, 0);
+
+    QCOMPARE(map.getNumberOfBlocks(), 0);
+    QCOMPARE(map.getNumberOfEmptySamples(Vector3(2.5, 2.5, 2.5), Vector3(1.0, 0.0, 0.0)), 0);
+}
+
+void test_EmptySpaceMap::castRay_WithEmptySpaceMap_ShouldGiveSameImage()
+{
+    const int Size = 64;
+    QVector<unsigned short> data = createSphereVolume(Size);
+    int dimensions[3] = { Size, Size, Size };
+    TransferFunction transferFunction = createTransferFunction(500.0, 1000.0);
+
+    AmbientVoxelShader voxelShader;
+    voxelShader.setData(data.constData(), 1100);
+    voxelShader.setTransferFunction(transferFunction);
+
+    EmptySpaceMap map;
+    map.setData(data.constData(), dimensions);
+    map.setTransferFunction(transferFunction);
+    QVERIFY(map.getNumberOfEmptyBlocks() > 0);
+
+    auto function = vtkSmartPointer<vtkVolumeRayCastSingleVoxelShaderCompositeFunction<AmbientVoxelShader>>::New();
+    function->SetVoxelShader(&voxelShader);
+    QVector<float> expectedImage = castRays(function, Size);
+
+    function->SetEmptySpaceMap(&map);
+    QVector<float> image = castRays(function, Size);
+
+    QCOMPARE(image, expectedImage);
+}
+
+void test_EmptySpaceMap::castRay_Benchmark_data()
+{
+    QTest::addColumn<bool>("obscurance");
+    QTest::addColumn<bool>("skipEmptySpace");
+
+    QTest::newRow("ambient") << false << false;
+    QTest::newRow("ambient, skipping empty space") << false << true;
+    QTest::newRow("ambient obscurance") << true << false;
+    QTest::newRow("ambient obscurance, skipping empty space") << true << true;
+}
+
+void test_EmptySpaceMap::castRay_Benchmark()
+{
+    QFETCH(bool, obscurance);
+    QFETCH(bool, skipEmptySpace);
+
+    // Time of a frame of a 256^3 volume with a sphere in the middle, as seen by the fused voxel shaders of Q3DViewer
+    const int Size = 256;
+    QVector<unsigned short> data = createSphereVolume(Size);
+    int dimensions[3] = { Size, Size, Size };
+    TransferFunction transferFunction = createTransferFunction(500.0, 1000.0);
+
+    AmbientVoxelShader ambientVoxelShader;
+    ambientVoxelShader.setData(data.constData(), 1100);
+    ambientVoxelShader.setTransferFunction(transferFunction);
+
+    Obscurance obscuranceValues(data.size());
+    for (int i = 0; i < data.size(); i++)
+    {
+        obscuranceValues.setObscurance(i, (i % 7) / 6.0);
+    }
+    ObscuranceVoxelShader obscuranceVoxelShader;
+    obscuranceVoxelShader.setData(data.constData(), 1100);
+    obscuranceVoxelShader.setTransferFunction(transferFunction);
+    obscuranceVoxelShader.setObscurance(&obscuranceValues);
+    AmbientObscuranceVoxelShader ambientObscuranceVoxelShader;
+    ambientObscuranceVoxelShader.setVoxelShaders(&ambientVoxelShader, &obscuranceVoxelShader);
+
+    EmptySpaceMap map;
+    map.setData(data.constData(), dimensions);
+    map.setTransferFunction(transferFunction);
+
+    auto ambientFunction = vtkSmartPointer<vtkVolumeRayCastSingleVoxelShaderCompositeFunction<AmbientVoxelShader>>::New();
+    ambientFunction->SetVoxelShader(&ambientVoxelShader);
+    ambientFunction->SetEmptySpaceMap(skipEmptySpace ? &map : 0);
+    auto ambientObscuranceFunction = vtkSmartPointer<vtkVolumeRayCastSingleVoxelShaderCompositeFunction<AmbientObscuranceVoxelShader>>::New();
+    ambientObscuranceFunction->SetVoxelShader(&ambientObscuranceVoxelShader);
+    ambientObscuranceFunction->SetEmptySpaceMap(skipEmptySpace ? &map : 0);
+
+    vtkVolumeRayCastFunction *function = obscurance ? static_cast<vtkVolumeRayCastFunction*>(ambientObscuranceFunction.GetPointer())
+                                                    : static_cast<vtkVolumeRayCastFunction*>(ambientFunction.GetPointer());
+
+    QBENCHMARK
+    {
+        castRays(function, Size);
+    }
+}
+
+QVector<unsigned short> test_EmptySpaceMap::createCubeVolume(int size, int first, int last, unsigned short value)
+{
+    QVector<unsigned short> data(size * size * size, 0);
+
+    for (int z = first; z <= last; z++)
+    {
+        for (int y = first; y <= last; y++)
+        {
+            for (int x = first; x <= last; x++)
+            {
+                data[(z * size + y) * size + x] = value;
+            }
+        }
+    }
+
+    return data;
+}
+
+QVector<unsigned short> test_EmptySpaceMap::createSphereVolume(int size)
+{
+    QVector<unsigned short> data(size * size * size, 0);
+    double center = (size - 1) / 2.0;
+    double radius = size / 4.0;
+    // Linear congruential generator, so that the volume is always the same
+    quint32 state = 12345;
+
+    for (int z = 0; z < size; z++)
+    {
+        for (int y = 0; y < size; y++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                double distance = Vector3(x - center, y - center, z - center).length();
+                state = state * 1103515245u + 12345u;
+
+                if (distance < radius)
+                {
+                    data[(z * size + y) * size + x] = 900 + (state >> 16) % 200;
+                }
+            }
+        }
+    }
+
+    return data;
+}
+
+TransferFunction test_EmptySpaceMap::createTransferFunction(double lowerValue, double upperValue)
+{
+    TransferFunction transferFunction;
+    transferFunction.set(lowerValue, 1.0, 1.0, 1.0, 0.0);
+    transferFunction.set(upperValue, 1.0, 0.5, 0.25, 0.1);
+    return transferFunction;
+}
+
+QVector<float> test_EmptySpaceMap::castRays(vtkVolumeRayCastFunction *function, int size)
+{
+    QVector<float> image(size * size * 4);
+
+    for (int y = 0; y < size - 1; y++)
+    {
+        for (int x = 0; x < size - 1; x++)
+        {
+            castRay(function, size, x, y, image.data() + (y * size + x) * 4);
+        }
+    }
+
+    return image;
+}
+
+void test_EmptySpaceMap::castRay(vtkVolumeRayCastFunction *function, int size, int x, int y, float color[4])
+{
+    vtkVolumeRayCastStaticInfo staticInfo = {};
+    staticInfo.InterpolationType = VTK_LINEAR_INTERPOLATION;
+    staticInfo.DataIncrement[0] = 1;
+    staticInfo.DataIncrement[1] = size;
+    staticInfo.DataIncrement[2] = size * size;
+
+    // Rays along z through the middle of the cells, sampled twice per voxel
+    vtkVolumeRayCastDynamicInfo dynamicInfo = {};
+    dynamicInfo.TransformedStart[0] = x + 0.5f;
+    dynamicInfo.TransformedStart[1] = y + 0.5f;
+    dynamicInfo.TransformedStart[2] = 0.0f;
+    dynamicInfo.TransformedDirection[2] = 1.0f;
+    dynamicInfo.TransformedIncrement[2] = 0.5f;
+    dynamicInfo.NumberOfStepsToTake = 2 * (size - 1);
+
+    function->CastRay(&dynamicInfo, &staticInfo);
+
+    for (int i = 0; i < 4; i++)
+    {
+        color[i] = dynamicInfo.Color[i];
+    }
+}
+
+DECLARE_TEST(test_EmptySpaceMap)
+
+#include "test_emptyspacemap.moc"
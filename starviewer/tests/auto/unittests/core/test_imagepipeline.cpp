@@ -0,0 +1,172 @@
+#include "autotest.h"
+#include "imagepipeline.h"
+
+#include "filteroutput.h"
+#include "voilut.h"
+#include "windowlevel.h"
+
+#include <cstring>
+
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+
+using namespace udg;
+
+class TestingImagePipeline : public ImagePipeline {
+public:
+    using ImagePipeline::waitForPrefetchedPhases;
+    using ImagePipeline::getPrefetchedPhases;
+    using ImagePipeline::isShowingPrefetchedPhase;
+
+    void setMaximumPrefetchedPhasesSizeInBytes(qint64 size)
+    {
+        m_maximumPrefetchedPhasesSizeInBytes = size;
+    }
+};
+
+class test_ImagePipeline : public QObject {
+Q_OBJECT
+
+private slots:
+    void setPhase_WhenThePhaseHasBeenPrefetched_ShouldOutputTheSameImageAsTheFilters_data();
+    void setPhase_WhenThePhaseHasBeenPrefetched_ShouldOutputTheSameImageAsTheFilters();
+
+    void prefetchPhases_ShouldKeepOnlyThePhasesThatFitInTheMemoryLimit();
+
+private:
+    /// Returns a new image of unsigned shorts with the given size and number of phases, with all the slices of each phase consecutive and different values
+    /// in each voxel.
+    static vtkSmartPointer<vtkImageData> createMultiphaseImage(int size, int numberOfSlices, int numberOfPhases);
+    /// Returns a copy of the current output of the given pipeline.
+    static vtkSmartPointer<vtkImageData> getOutputCopy(ImagePipeline &pipeline);
+    /// Returns true if both images have the same dimensions, scalar type and voxel values.
+    static bool areEqual(vtkImageData *image1, vtkImageData *image2);
+};
+
+void test_ImagePipeline::setPhase_WhenThePhaseHasBeenPrefetched_ShouldOutputTheSameImageAsTheFilters_data()
+{
+    QTest::addColumn<bool>("enableColorMapping");
+
+    QTest::newRow("phase filter") << false;
+    QTest::newRow("phase and window level filters") << true;
+}
+
+void test_ImagePipeline::setPhase_WhenThePhaseHasBeenPrefetched_ShouldOutputTheSameImageAsTheFilters()
+{
+    QFETCH(bool, enableColorMapping);
+
+    const int NumberOfPhases = 4;
+    vtkSmartPointer<vtkImageData> input = createMultiphaseImage(16, 2, NumberOfPhases);
+
+    TestingImagePipeline pipeline;
+    pipeline.setInput(input.GetPointer());
+    pipeline.setNumberOfPhases(NumberOfPhases);
+    pipeline.enableColorMapping(enableColorMapping);
+    pipeline.setVoiLut(VoiLut(WindowLevel(2000.0, 1500.0)));
+
+    QList<vtkSmartPointer<vtkImageData> > filteredPhases;
+    QList<int> phases;
+
+    for (int phase = 0; phase < NumberOfPhases; phase++)
+    {
+        pipeline.setPhase(phase);
+        QVERIFY(!pipeline.isShowingPrefetchedPhase());
+        filteredPhases << getOutputCopy(pipeline);
+        phases << phase;
+    }
+
+    pipeline.prefetchPhases(phases);
+    pipeline.waitForPrefetchedPhases();
+    QCOMPARE(pipeline.getPrefetchedPhases(), phases);
+
+    for (int phase = 0; phase < NumberOfPhases; phase++)
+    {
+        pipeline.setPhase(phase);
+        QVERIFY(pipeline.isShowingPrefetchedPhase());
+        QVERIFY(areEqual(getOutputCopy(pipeline), filteredPhases.at(phase)));
+    }
+}
+
+void test_ImagePipeline::prefetchPhases_ShouldKeepOnlyThePhasesThatFitInTheMemoryLimit()
+{
+    // Each phase is a single 32x32 slice of unsigned shorts, 2 KiB, so that its estimated and measured sizes are the same
+    const int NumberOfPhases = 10;
+    const qint64 PhaseSizeInBytes = 32 * 32 * sizeof(unsigned short);
+    vtkSmartPointer<vtkImageData> input = createMultiphaseImage(32, 1, NumberOfPhases);
+
+    TestingImagePipeline pipeline;
+    pipeline.setInput(input.GetPointer());
+    pipeline.setNumberOfPhases(NumberOfPhases);
+    pipeline.setPhase(0);
+    // Room for 5 phases, one of them being the displayed one
+    pipeline.setMaximumPrefetchedPhasesSizeInBytes(5 * PhaseSizeInBytes);
+
+    pipeline.prefetchPhases(QList<int>() << 1 << 2 << 3 << 4 << 5 << 6 << 7 << 8);
+    pipeline.waitForPrefetchedPhases();
+    QCOMPARE(pipeline.getPrefetchedPhases(), QList<int>() << 1 << 2 << 3 << 4);
+
+    // Phases that are not requested anymore are discarded
+    pipeline.prefetchPhases(QList<int>() << 3 << 4 << 5 << 6 << 7);
+    pipeline.waitForPrefetchedPhases();
+    QCOMPARE(pipeline.getPrefetchedPhases(), QList<int>() << 3 << 4 << 5 << 6);
+
+    // The displayed phase is kept in addition to the requested ones
+    pipeline.setPhase(3);
+    QVERIFY(pipeline.isShowingPrefetchedPhase());
+    pipeline.prefetchPhases(QList<int>() << 4 << 5 << 6 << 7 << 8 << 9);
+    pipeline.waitForPrefetchedPhases();
+    QCOMPARE(pipeline.getPrefetchedPhases(), QList<int>() << 3 << 4 << 5 << 6 << 7);
+    QVERIFY(pipeline.isShowingPrefetchedPhase());
+
+    // No phase is prefetched if a single one doesn't fit
+    pipeline.setMaximumPrefetchedPhasesSizeInBytes(PhaseSizeInBytes);
+    pipeline.prefetchPhases(QList<int>() << 4 << 5);
+    pipeline.waitForPrefetchedPhases();
+    QCOMPARE(pipeline.getPrefetchedPhases(), QList<int>() << 3);
+}
+
+vtkSmartPointer<vtkImageData> test_ImagePipeline::createMultiphaseImage(int size, int numberOfSlices, int numberOfPhases)
+{
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetDimensions(size, size, numberOfSlices * numberOfPhases);
+    image->AllocateScalars(VTK_UNSIGNED_SHORT, 1);
+
+    unsigned short *scalars = static_cast<unsigned short*>(image->GetScalarPointer());
+    vtkIdType numberOfVoxels = image->GetNumberOfPoints();
+
+    for (vtkIdType i = 0; i < numberOfVoxels; i++)
+    {
+        scalars[i] = static_cast<unsigned short>(i % 4096);
+    }
+
+    return image;
+}
+
+vtkSmartPointer<vtkImageData> test_ImagePipeline::getOutputCopy(ImagePipeline &pipeline)
+{
+    pipeline.update();
+
+    vtkSmartPointer<vtkImageData> copy = vtkSmartPointer<vtkImageData>::New();
+    copy->DeepCopy(pipeline.getOutput().getVtkImageData());
+    return copy;
+}
+
+bool test_ImagePipeline::areEqual(vtkImageData *image1, vtkImageData *image2)
+{
+    int *dimensions1 = image1->GetDimensions();
+    int *dimensions2 = image2->GetDimensions();
+
+    if (dimensions1[0] != dimensions2[0] || dimensions1[1] != dimensions2[1] || dimensions1[2] != dimensions2[2] ||
+        image1->GetScalarType() != image2->GetScalarType() || image1->GetNumberOfScalarComponents() != image2->GetNumberOfScalarComponents())
+    {
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(image1->GetNumberOfPoints()) * image1->GetNumberOfScalarComponents() * image1->GetScalarSize();
+
+    return std::memcmp(image1->GetScalarPointer(), image2->GetScalarPointer(), size) == 0;
+}
+
+DECLARE_TEST(test_ImagePipeline)
+
+#include "test_imagepipeline.moc"
@@ -0,0 +1,228 @@
+#include "autotest.h"
+#include "magicroiregiongrower.h"
+
+#include <QStringList>
+#include <qmath.h>
+
+using namespace udg;
+
+class test_MagicROIRegionGrower : public QObject {
+    Q_OBJECT
+
+private slots:
+    void grow_ShouldSelectConnectedPixelsInRange_data();
+    void grow_ShouldSelectConnectedPixelsInRange();
+
+    void grow_WithNestedRanges_ShouldGiveSameRegionAsGrowingFromScratch();
+
+    void traceContour_ShouldReturnExpectedPoints_data();
+    void traceContour_ShouldReturnExpectedPoints();
+
+    void grow_WhileDragging_Benchmark();
+
+private:
+    /// Sets an image given as rows of digits to the grower.
+    static void setImage(MagicROIRegionGrower &grower, const QStringList &rows);
+    /// Sets an image of width x height values to the grower.
+    static void setImage(MagicROIRegionGrower &grower, const QVector<float> &values, int width, int height);
+    /// Returns a pseudo-random image with values in [0, numberOfValues).
+    static QVector<float> createRandomImage(int width, int height, int numberOfValues);
+};
+
+void test_MagicROIRegionGrower::grow_ShouldSelectConnectedPixelsInRange_data()
+{
+    QTest::addColumn<QStringList>("image");
+    QTest::addColumn<int>("seedX");
+    QTest::addColumn<int>("seedY");
+    QTest::addColumn<double>("lowerLevel");
+    QTest::addColumn<double>("upperLevel");
+    QTest::addColumn<QStringList>("expectedRegion");
+
+    QTest::newRow("uniform image, border excluded") << (QStringList() << "00000" << "00000" << "00000" << "00000" << "00000") << 2 << 2 << 0.0 << 0.0
+                                                     << (QStringList() << "....." << ".###." << ".###." << ".###." << ".....");
+    QTest::newRow("wall") << (QStringList() << "0000000" << "0010000" << "0010000" << "0010000" << "0000000") << 1 << 2 << 0.0 << 0.0
+                          << (QStringList() << "......." << ".#....." << ".#....." << ".#....." << ".......");
+    QTest::newRow("wall inside range") << (QStringList() << "0000000" << "0010000" << "0010000" << "0010000" << "0000000") << 1 << 2 << 0.0 << 1.0
+                                       << (QStringList() << "......." << ".#####." << ".#####." << ".#####." << ".......");
+    QTest::newRow("diagonal neighbours not connected") << (QStringList() << "99999" << "90999" << "99099" << "99909" << "99999") << 1 << 1 << 0.0 << 0.0
+                                                        << (QStringList() << "....." << ".#..." << "....." << "....." << ".....");
+    QTest::newRow("several branches from the seed") << (QStringList() << "999999" << "900099" << "909099" << "909099" << "999999") << 2 << 1 << 0.0 << 0.0
+                                                     << (QStringList() << "......" << ".###.." << ".#.#.." << ".#.#.." << "......");
+    QTest::newRow("seed out of range") << (QStringList() << "0000" << "0500" << "0000" << "0000") << 1 << 1 << 0.0 << 1.0
+                                       << (QStringList() << "...." << "...." << "...." << "....");
+}
+
+void test_MagicROIRegionGrower::grow_ShouldSelectConnectedPixelsInRange()
+{
+    QFETCH(QStringList, image);
+    QFETCH(int, seedX);
+    QFETCH(int, seedY);
+    QFETCH(double, lowerLevel);
+    QFETCH(double, upperLevel);
+    QFETCH(QStringList, expectedRegion);
+
+    MagicROIRegionGrower grower;
+    setImage(grower, image);
+    grower.setSeed(seedX, seedY);
+    grower.grow(lowerLevel, upperLevel);
+
+    QStringList region;
+    int expectedNumberOfPixels = 0;
+    for (int y = 0; y < image.size(); y++)
+    {
+        QString row;
+        for (int x = 0; x < image.at(y).size(); x++)
+        {
+            row += grower.contains(x, y) ? "#" : ".";
+        }
+        region << row;
+        expectedNumberOfPixels += expectedRegion.at(y).count('#');
+    }
+
+    QCOMPARE(region, expectedRegion);
+    QCOMPARE(grower.getNumberOfPixels(), expectedNumberOfPixels);
+}
+
+void test_MagicROIRegionGrower::grow_WithNestedRanges_ShouldGiveSameRegionAsGrowingFromScratch()
+{
+    const int Width = 67;
+    const int Height = 41;
+    const int SeedX = 30;
+    const int SeedY = 20;
+    QVector<float> values = createRandomImage(Width, Height, 6);
+    float seedValue = values.at(SeedY * Width + SeedX);
+
+    MagicROIRegionGrower incrementalGrower;
+    setImage(incrementalGrower, values, Width, Height);
+    incrementalGrower.setSeed(SeedX, SeedY);
+
+    QList<double> tolerances;
+    tolerances << 0.0 << 0.5 << 1.0 << 2.0 << 1.0 << 0.0 << 3.0 << 6.0 << 2.0 << 2.5 << 0.0;
+
+    foreach (double tolerance, tolerances)
+    {
+        incrementalGrower.grow(seedValue - tolerance, seedValue + tolerance);
+
+        MagicROIRegionGrower grower;
+        setImage(grower, values, Width, Height);
+        grower.setSeed(SeedX, SeedY);
+        grower.grow(seedValue - tolerance, seedValue + tolerance);
+
+        QCOMPARE(incrementalGrower.getNumberOfPixels(), grower.getNumberOfPixels());
+        for (int y = 0; y < Height; y++)
+        {
+            for (int x = 0; x < Width; x++)
+            {
+                QCOMPARE(incrementalGrower.contains(x, y), grower.contains(x, y));
+            }
+        }
+        QCOMPARE(incrementalGrower.traceContour(), grower.traceContour());
+    }
+}
+
+void test_MagicROIRegionGrower::traceContour_ShouldReturnExpectedPoints_data()
+{
+    QTest::addColumn<QStringList>("image");
+    QTest::addColumn<int>("seedX");
+    QTest::addColumn<int>("seedY");
+    QTest::addColumn<QVector<QPointF> >("expectedContour");
+
+    QTest::newRow("empty region") << (QStringList() << "000" << "010" << "000") << 1 << 1 << QVector<QPointF>();
+    QTest::newRow("single pixel") << (QStringList() << "11111" << "11111" << "11011" << "11111" << "11111") << 2 << 2
+                                  << (QVector<QPointF>() << QPointF(1.5, 2.0) << QPointF(2.0, 1.5) << QPointF(2.5, 2.0) << QPointF(2.0, 2.5)
+                                                         << QPointF(1.5, 2.0));
+    QTest::newRow("L shape") << (QStringList() << "11111" << "10011" << "11011" << "11111" << "11111") << 1 << 1
+                             << (QVector<QPointF>() << QPointF(0.5, 1.0) << QPointF(1.0, 0.5) << QPointF(2.0, 0.5) << QPointF(2.5, 1.0)
+                                                    << QPointF(2.5, 2.0) << QPointF(2.0, 2.5) << QPointF(1.5, 2.0) << QPointF(1.0, 1.5)
+                                                    << QPointF(0.5, 1.0));
+}
+
+void test_MagicROIRegionGrower::traceContour_ShouldReturnExpectedPoints()
+{
+    QFETCH(QStringList, image);
+    QFETCH(int, seedX);
+    QFETCH(int, seedY);
+    QFETCH(QVector<QPointF>, expectedContour);
+
+    MagicROIRegionGrower grower;
+    setImage(grower, image);
+    grower.setSeed(seedX, seedY);
+    grower.grow(0.0, 0.0);
+
+    QCOMPARE(grower.traceContour(), expectedContour);
+}
+
+void test_MagicROIRegionGrower::grow_WhileDragging_Benchmark()
+{
+    // A noisy blob on a 1024x1024 slice, like a lesion in a mammography, grown and narrowed as when dragging the mouse back and forth
+    const int Width = 1024;
+    const int Height = 1024;
+    const int NumberOfSteps = 40;
+    QVector<float> noise = createRandomImage(Width, Height, 20);
+    QVector<float> values(Width * Height);
+    for (int y = 0; y < Height; y++)
+    {
+        for (int x = 0; x < Width; x++)
+        {
+            values[y * Width + x] = qSqrt(qPow(x - Width / 2, 2) + qPow(y - Height / 2, 2)) + noise.at(y * Width + x);
+        }
+    }
+
+    MagicROIRegionGrower grower;
+    setImage(grower, values, Width, Height);
+    grower.setSeed(Width / 2, Height / 2);
+
+    // Each iteration is a drag of NumberOfSteps steps, each one updating the region and its contour
+    QBENCHMARK
+    {
+        for (int step = 0; step < NumberOfSteps; step++)
+        {
+            int tolerance = step < NumberOfSteps / 2 ? step : NumberOfSteps - step;
+            grower.grow(0.0, 20.0 * tolerance);
+            grower.traceContour();
+        }
+    }
+}
+
+void test_MagicROIRegionGrower::setImage(MagicROIRegionGrower &grower, const QStringList &rows)
+{
+    QVector<float> values;
+    foreach (const QString &row, rows)
+    {
+        foreach (const QChar &value, row)
+        {
+            values << value.digitValue();
+        }
+    }
+
+    setImage(grower, values, rows.first().size(), rows.size());
+}
+
+void test_MagicROIRegionGrower::setImage(MagicROIRegionGrower &grower, const QVector<float> &values, int width, int height)
+{
+    grower.setImage(width, height, [values, width](int y, float *rowValues)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            rowValues[x] = values.at(y * width + x);
+        }
+    });
+}
+
+QVector<float> test_MagicROIRegionGrower::createRandomImage(int width, int height, int numberOfValues)
+{
+    // Linear congruential generator, so that the image is always the same
+    QVector<float> values(width * height);
+    quint32 state = 12345;
+    for (int i = 0; i < values.size(); i++)
+    {
+        state = state * 1103515245u + 12345u;
+        values[i] = (state >> 16) % numberOfValues;
+    }
+
+    return values;
+}
+
+DECLARE_TEST(test_MagicROIRegionGrower)
+
+#include "test_magicroiregiongrower.moc"
@@ -0,0 +1,142 @@
+#include "autotest.h"
+#include "obscurancemainthread.h"
+
+#include "obscurance.h"
+#include "vector3.h"
+
+#include <QThread>
+
+#include <vtkEncodedGradientEstimator.h>
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+#include <vtkVolume.h>
+#include <vtkVolumeRayCastMapper.h>
+
+using namespace udg;
+
+class test_ObscuranceMainThread : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void run_ResultShouldNotDependOnTheNumberOfThreads_data();
+    void run_ResultShouldNotDependOnTheNumberOfThreads();
+
+    void run_Benchmark_data();
+    void run_Benchmark();
+
+private:
+    /// Returns a cubic image of the given size with a noisy ball, so that lines have very different amounts of work.
+    vtkSmartPointer<vtkImageData> createNoisyBall(int size);
+    /// Computes the obscurances of the given image with the given variant and number of threads and returns them.
+    QVector<double> computeObscurances(vtkImageData *image, ObscuranceMainThread::Variant variant, int numberOfThreads);
+
+};
+
+Q_DECLARE_METATYPE(ObscuranceMainThread::Variant)
+
+void test_ObscuranceMainThread::run_ResultShouldNotDependOnTheNumberOfThreads_data()
+{
+    QTest::addColumn<ObscuranceMainThread::Variant>("variant");
+
+    QTest::newRow("density") << ObscuranceMainThread::Density;
+    QTest::newRow("density smooth") << ObscuranceMainThread::DensitySmooth;
+}
+
+void test_ObscuranceMainThread::run_ResultShouldNotDependOnTheNumberOfThreads()
+{
+    QFETCH(ObscuranceMainThread::Variant, variant);
+
+    const int Size = 24;
+
+    vtkSmartPointer<vtkImageData> image = createNoisyBall(Size);
+
+    QVector<double> sequentialObscurances = computeObscurances(image, variant, 1);
+    QVector<double> parallelObscurances = computeObscurances(image, variant, 4);
+
+    QCOMPARE(sequentialObscurances.size(), Size * Size * Size);
+    // Each voxel belongs to a single line in each direction, so the same values must be added in the same order
+    QVERIFY(sequentialObscurances == parallelObscurances);
+}
+
+void test_ObscuranceMainThread::run_Benchmark_data()
+{
+    QTest::addColumn<int>("numberOfThreads");
+
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("all threads") << QThread::idealThreadCount();
+}
+
+void test_ObscuranceMainThread::run_Benchmark()
+{
+    QFETCH(int, numberOfThreads);
+
+    // The size of a typical CT volume, where the lines that cross the ball are much longer to process than the ones that only cross the air
+    const int Size = 512;
+
+    vtkSmartPointer<vtkImageData> image = createNoisyBall(Size);
+
+    QBENCHMARK_ONCE
+    {
+        computeObscurances(image, ObscuranceMainThread::Density, numberOfThreads);
+    }
+}
+
+vtkSmartPointer<vtkImageData> test_ObscuranceMainThread::createNoisyBall(int size)
+{
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetDimensions(size, size, size);
+    image->AllocateScalars(VTK_UNSIGNED_SHORT, 1);
+    unsigned short *data = static_cast<unsigned short*>(image->GetScalarPointer());
+    // The profile of the ball is the same whatever the size
+    double scale = 24.0 / size;
+    qsrand(1);
+
+    for (int z = 0; z < size; z++)
+    {
+        for (int y = 0; y < size; y++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                double distance = Vector3(x - size / 2, y - size / 2, z - size / 2).length() * scale;
+                *data++ = static_cast<unsigned short>(qMax(0.0, 1000.0 - 80.0 * distance) + qrand() % 100);
+            }
+        }
+    }
+
+    return image;
+}
+
+QVector<double> test_ObscuranceMainThread::computeObscurances(vtkImageData *image, ObscuranceMainThread::Variant variant, int numberOfThreads)
+{
+    vtkSmartPointer<vtkVolumeRayCastMapper> mapper = vtkSmartPointer<vtkVolumeRayCastMapper>::New();
+    mapper->SetInputData(image);
+    mapper->GetGradientEstimator()->SetInputData(image);
+    vtkSmartPointer<vtkVolume> volume = vtkSmartPointer<vtkVolume>::New();
+    volume->SetMapper(mapper);
+
+    ObscuranceMainThread obscuranceMainThread(-20, 8.0, ObscuranceMainThread::Exponential, variant);
+    obscuranceMainThread.setVolume(volume);
+    obscuranceMainThread.setNumberOfThreads(numberOfThreads);
+    obscuranceMainThread.start();
+    obscuranceMainThread.wait();
+
+    Obscurance *obscurance = obscuranceMainThread.getObscurance();
+    QVector<double> obscurances;
+
+    if (obscurance)
+    {
+        for (unsigned int i = 0; i < obscurance->size(); i++)
+        {
+            obscurances << obscurance->obscurance(i);
+        }
+
+        delete obscurance;
+    }
+
+    return obscurances;
+}
+
+DECLARE_TEST(test_ObscuranceMainThread)
+
+#include "test_obscurancemainthread.moc"
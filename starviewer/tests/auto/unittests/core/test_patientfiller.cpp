@@ -0,0 +1,163 @@
+#include "autotest.h"
+#include "patientfiller.h"
+
+#include "image.h"
+#include "patient.h"
+#include "series.h"
+#include "study.h"
+
+#include <QTemporaryDir>
+
+#include <dcdeftag.h>
+#include <dcfilefo.h>
+#include <dcuid.h>
+
+using namespace udg;
+
+class test_PatientFiller : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void processFiles_ParallelProcessingShouldGenerateTheSameTreeAsSequentialProcessing();
+
+private:
+    /// Creates a small CT file with the given attributes in the given directory and returns its path.
+    QString createDICOMFile(const QTemporaryDir &directory, const QString &seriesInstanceUID, int seriesNumber, int instanceNumber, int numberOfFrames);
+    /// Returns a textual representation of the given patients including everything that the fillers fill that is relevant for the comparison.
+    QStringList describe(const QList<Patient*> &patients);
+
+};
+
+void test_PatientFiller::processFiles_ParallelProcessingShouldGenerateTheSameTreeAsSequentialProcessing()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    const int NumberOfSeries = 3;
+    const int NumberOfImagesPerSeries = 40;
+    QStringList seriesInstanceUIDs;
+
+    for (int i = 0; i < NumberOfSeries; i++)
+    {
+        seriesInstanceUIDs << QString("1.2.3.4.5.%1").arg(i + 1);
+    }
+
+    // Files of different series are interleaved so that the order in which the fillers see them matters
+    QStringList files;
+
+    for (int instanceNumber = 1; instanceNumber <= NumberOfImagesPerSeries; instanceNumber++)
+    {
+        for (int i = 0; i < NumberOfSeries; i++)
+        {
+            files << createDICOMFile(directory, seriesInstanceUIDs.at(i), i + 1, instanceNumber, 1);
+        }
+    }
+
+    // A multiframe file and a file that is not DICOM
+    files << createDICOMFile(directory, "1.2.3.4.5.9", 9, 1, 5);
+    QFile notDICOMFile(directory.path() + "/notdicom.txt");
+    QVERIFY(notDICOMFile.open(QIODevice::WriteOnly));
+    notDICOMFile.write("not a DICOM file");
+    notDICOMFile.close();
+    files.insert(files.size() / 2, notDICOMFile.fileName());
+
+    PatientFiller sequentialFiller;
+    sequentialFiller.setParallelProcessingEnabled(false);
+    QList<Patient*> sequentialPatients = sequentialFiller.processFiles(files);
+
+    PatientFiller parallelFiller;
+    parallelFiller.setParallelProcessingEnabled(true);
+    QList<Patient*> parallelPatients = parallelFiller.processFiles(files);
+
+    QStringList sequentialDescription = describe(sequentialPatients);
+    QStringList parallelDescription = describe(parallelPatients);
+
+    QCOMPARE(sequentialPatients.size(), 1);
+    QCOMPARE(sequentialPatients.first()->getStudies().first()->getSeries().size(), NumberOfSeries + 1);
+    QCOMPARE(parallelDescription, sequentialDescription);
+
+    qDeleteAll(sequentialPatients);
+    qDeleteAll(parallelPatients);
+}
+
+QString test_PatientFiller::createDICOMFile(const QTemporaryDir &directory, const QString &seriesInstanceUID, int seriesNumber, int instanceNumber,
+                                            int numberOfFrames)
+{
+    const Uint16 Rows = 4;
+    const Uint16 Columns = 4;
+
+    DcmFileFormat fileFormat;
+    DcmDataset *dataset = fileFormat.getDataset();
+    QString sopInstanceUID = QString("%1.%2").arg(seriesInstanceUID).arg(instanceNumber);
+
+    dataset->putAndInsertString(DCM_SOPClassUID, UID_CTImageStorage);
+    dataset->putAndInsertString(DCM_SOPInstanceUID, qPrintable(sopInstanceUID));
+    dataset->putAndInsertString(DCM_PatientID, "PATIENT1");
+    dataset->putAndInsertString(DCM_PatientName, "DOE^JOHN");
+    dataset->putAndInsertString(DCM_StudyInstanceUID, "1.2.3.4");
+    dataset->putAndInsertString(DCM_StudyDate, "20160101");
+    dataset->putAndInsertString(DCM_SeriesInstanceUID, qPrintable(seriesInstanceUID));
+    dataset->putAndInsertString(DCM_SeriesNumber, qPrintable(QString::number(seriesNumber)));
+    dataset->putAndInsertString(DCM_Modality, "CT");
+    dataset->putAndInsertString(DCM_InstanceNumber, qPrintable(QString::number(instanceNumber)));
+    dataset->putAndInsertString(DCM_ImagePositionPatient, qPrintable(QString("0\\0\\%1").arg(instanceNumber)));
+    dataset->putAndInsertString(DCM_ImageOrientationPatient, "1\\0\\0\\0\\1\\0");
+    dataset->putAndInsertString(DCM_PixelSpacing, "0.5\\0.5");
+    dataset->putAndInsertString(DCM_SliceThickness, "1");
+    dataset->putAndInsertUint16(DCM_SamplesPerPixel, 1);
+    dataset->putAndInsertString(DCM_PhotometricInterpretation, "MONOCHROME2");
+    dataset->putAndInsertUint16(DCM_Rows, Rows);
+    dataset->putAndInsertUint16(DCM_Columns, Columns);
+    dataset->putAndInsertUint16(DCM_BitsAllocated, 16);
+    dataset->putAndInsertUint16(DCM_BitsStored, 16);
+    dataset->putAndInsertUint16(DCM_HighBit, 15);
+    dataset->putAndInsertUint16(DCM_PixelRepresentation, 0);
+
+    if (numberOfFrames > 1)
+    {
+        dataset->putAndInsertString(DCM_NumberOfFrames, qPrintable(QString::number(numberOfFrames)));
+    }
+
+    QVector<Uint16> pixels(Rows * Columns * numberOfFrames, static_cast<Uint16>(instanceNumber));
+    dataset->putAndInsertUint16Array(DCM_PixelData, pixels.data(), pixels.size());
+
+    QString path = QString("%1/%2.dcm").arg(directory.path()).arg(sopInstanceUID);
+    fileFormat.saveFile(qPrintable(path), EXS_LittleEndianExplicit);
+
+    return path;
+}
+
+QStringList test_PatientFiller::describe(const QList<Patient*> &patients)
+{
+    QStringList description;
+
+    foreach (Patient *patient, patients)
+    {
+        description << QString("Patient %1 %2").arg(patient->getID()).arg(patient->getFullName());
+
+        foreach (Study *study, patient->getStudies())
+        {
+            description << QString(" Study %1").arg(study->getInstanceUID());
+
+            foreach (Series *series, study->getSeries())
+            {
+                description << QString("  Series %1 %2 volumes").arg(series->getInstanceUID()).arg(series->getNumberOfVolumes());
+
+                foreach (Image *image, series->getImages())
+                {
+                    const double *position = image->getImagePositionPatient();
+                    description << QString("   Image %1 %2 frame %3 volume %4 order %5 phase %6 position %7\\%8\\%9")
+                        .arg(image->getPath()).arg(image->getSOPInstanceUID()).arg(image->getFrameNumber()).arg(image->getVolumeNumberInSeries())
+                        .arg(image->getOrderNumberInVolume()).arg(image->getPhaseNumber()).arg(position[0]).arg(position[1]).arg(position[2]);
+                }
+            }
+        }
+    }
+
+    return description;
+}
+
+DECLARE_TEST(test_PatientFiller)
+
+#include "test_patientfiller.moc"
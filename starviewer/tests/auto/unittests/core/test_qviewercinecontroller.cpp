@@ -0,0 +1,65 @@
+#include "autotest.h"
+#include "qviewercinecontroller.h"
+
+using namespace udg;
+
+class TestingQViewerCINEController : public QViewerCINEController {
+public:
+    using QViewerCINEController::getUpcomingImageIndices;
+};
+
+class test_QViewerCINEController : public QObject {
+Q_OBJECT
+
+private slots:
+    void getUpcomingImageIndices_ShouldReturnExpectedIndices_data();
+    void getUpcomingImageIndices_ShouldReturnExpectedIndices();
+};
+
+void test_QViewerCINEController::getUpcomingImageIndices_ShouldReturnExpectedIndices_data()
+{
+    QTest::addColumn<int>("firstImage");
+    QTest::addColumn<int>("lastImage");
+    QTest::addColumn<bool>("loop");
+    QTest::addColumn<bool>("boomerang");
+    QTest::addColumn<int>("imageIndex");
+    QTest::addColumn<int>("step");
+    QTest::addColumn<int>("count");
+    QTest::addColumn<QList<int> >("expectedIndices");
+
+    QTest::newRow("forwards") << 0 << 9 << false << false << 2 << 1 << 3 << (QList<int>() << 3 << 4 << 5);
+    QTest::newRow("forwards until the end") << 0 << 4 << false << false << 1 << 1 << 8 << (QList<int>() << 2 << 3 << 4);
+    QTest::newRow("at the end") << 0 << 4 << false << false << 4 << 1 << 8 << QList<int>();
+    QTest::newRow("backwards until the beginning") << 0 << 4 << false << false << 3 << -1 << 8 << (QList<int>() << 2 << 1 << 0);
+    QTest::newRow("loop wraps around to the first image") << 0 << 4 << true << false << 3 << 1 << 4 << (QList<int>() << 4 << 0 << 1 << 2);
+    QTest::newRow("loop in a play interval") << 2 << 6 << true << false << 5 << 1 << 3 << (QList<int>() << 6 << 2 << 3);
+    QTest::newRow("loop covers the interval only once") << 0 << 4 << true << false << 2 << 1 << 8 << (QList<int>() << 3 << 4 << 0 << 1 << 2);
+    QTest::newRow("boomerang turns back at the end") << 0 << 4 << true << true << 3 << 1 << 4 << (QList<int>() << 4 << 3 << 2 << 1);
+    QTest::newRow("boomerang turns forwards at the beginning") << 0 << 4 << true << true << 1 << -1 << 4 << (QList<int>() << 0 << 1 << 2 << 3);
+    QTest::newRow("boomerang stops when an image repeats") << 0 << 4 << true << true << 3 << 1 << 8 << (QList<int>() << 4 << 3 << 2 << 1 << 0);
+    QTest::newRow("boomerang without loop stops at the end") << 0 << 4 << false << true << 3 << 1 << 8 << (QList<int>() << 4);
+    QTest::newRow("no images requested") << 0 << 4 << true << false << 1 << 1 << 0 << QList<int>();
+}
+
+void test_QViewerCINEController::getUpcomingImageIndices_ShouldReturnExpectedIndices()
+{
+    QFETCH(int, firstImage);
+    QFETCH(int, lastImage);
+    QFETCH(bool, loop);
+    QFETCH(bool, boomerang);
+    QFETCH(int, imageIndex);
+    QFETCH(int, step);
+    QFETCH(int, count);
+    QFETCH(QList<int>, expectedIndices);
+
+    TestingQViewerCINEController controller;
+    controller.setPlayInterval(firstImage, lastImage);
+    controller.enableLoop(loop);
+    controller.enableBoomerang(boomerang);
+
+    QCOMPARE(controller.getUpcomingImageIndices(imageIndex, step, count), expectedIndices);
+}
+
+DECLARE_TEST(test_QViewerCINEController)
+
+#include "test_qviewercinecontroller.moc"
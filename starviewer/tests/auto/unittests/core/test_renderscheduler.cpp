@@ -0,0 +1,138 @@
+#include "autotest.h"
+
+#include "renderscheduler.h"
+
+#include "q2dviewer.h"
+#include "volume.h"
+#include "volumetesthelper.h"
+
+#include <QProcessEnvironment>
+
+using namespace udg;
+using namespace testing;
+
+class test_RenderScheduler : public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void render_CalledSeveralTimesInOneTurn_ShouldRenderEachViewerOnceInOneFrame();
+    void render_WhenRenderingIsDisabledBeforeTheFrame_ShouldNotCountTheViewerAsRendered();
+
+private:
+    /// Returns a new viewer that is visualizing a new volume, which is added to m_volumes.
+    Q2DViewer* createVisualizingViewer();
+    /// Runs the frames scheduled so far.
+    void runScheduledFrames();
+
+private:
+    QList<Q2DViewer*> m_viewers;
+    QList<Volume*> m_volumes;
+};
+
+void test_RenderScheduler::init()
+{
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+
+    if (environment.contains("APPVEYOR") || environment.value("TRAVIS_OS_NAME") == "linux")
+    {
+        QSKIP("Viewers crash in AppVeyor and Travis CI Linux");
+    }
+}
+
+void test_RenderScheduler::cleanup()
+{
+    qDeleteAll(m_viewers);
+    m_viewers.clear();
+
+    foreach (Volume *volume, m_volumes)
+    {
+        VolumeTestHelper::cleanUp(volume);
+    }
+    m_volumes.clear();
+}
+
+void test_RenderScheduler::render_CalledSeveralTimesInOneTurn_ShouldRenderEachViewerOnceInOneFrame()
+{
+    Q2DViewer *viewer1 = createVisualizingViewer();
+    Q2DViewer *viewer2 = createVisualizingViewer();
+    runScheduledFrames();
+
+    RenderScheduler *scheduler = RenderScheduler::instance();
+    int numberOfFrames = scheduler->getNumberOfFrames();
+    int numberOfRenders1 = viewer1->getNumberOfRenders();
+    int numberOfRenders2 = viewer2->getNumberOfRenders();
+
+    viewer1->render();
+    viewer2->render();
+    viewer1->render();
+    viewer2->render();
+    viewer1->render();
+
+    // Nothing is rendered until control returns to the event loop
+    QVERIFY(scheduler->isRenderPending(viewer1));
+    QVERIFY(scheduler->isRenderPending(viewer2));
+    QCOMPARE(scheduler->getNumberOfFrames(), numberOfFrames);
+    QCOMPARE(viewer1->getNumberOfRenders(), numberOfRenders1);
+    QCOMPARE(viewer2->getNumberOfRenders(), numberOfRenders2);
+
+    runScheduledFrames();
+
+    QCOMPARE(scheduler->getNumberOfFrames(), numberOfFrames + 1);
+    QCOMPARE(scheduler->getNumberOfRendersInLastFrame(), 2);
+    QCOMPARE(viewer1->getNumberOfRenders(), numberOfRenders1 + 1);
+    QCOMPARE(viewer2->getNumberOfRenders(), numberOfRenders2 + 1);
+    QVERIFY(!scheduler->isRenderPending(viewer1));
+    QVERIFY(!scheduler->isRenderPending(viewer2));
+}
+
+void test_RenderScheduler::render_WhenRenderingIsDisabledBeforeTheFrame_ShouldNotCountTheViewerAsRendered()
+{
+    Q2DViewer *viewer1 = createVisualizingViewer();
+    Q2DViewer *viewer2 = createVisualizingViewer();
+    runScheduledFrames();
+
+    RenderScheduler *scheduler = RenderScheduler::instance();
+    int numberOfFrames = scheduler->getNumberOfFrames();
+    int numberOfRenders2 = viewer2->getNumberOfRenders();
+
+    viewer1->render();
+    viewer2->render();
+    viewer2->enableRendering(false);
+
+    runScheduledFrames();
+
+    QCOMPARE(scheduler->getNumberOfFrames(), numberOfFrames + 1);
+    QCOMPARE(scheduler->getNumberOfRendersInLastFrame(), 1);
+    QCOMPARE(viewer2->getNumberOfRenders(), numberOfRenders2);
+    QVERIFY(!scheduler->isRenderPending(viewer2));
+}
+
+Q2DViewer* test_RenderScheduler::createVisualizingViewer()
+{
+    double origin[3] = { 0.0, 0.0, 0.0 };
+    double spacing[3] = { 1.0, 1.0, 1.0 };
+    int extent[6] = { 0, 7, 0, 7, 0, 1 };
+
+    Volume *volume = VolumeTestHelper::createVolumeWithParameters(2, 1, 1, origin, spacing, extent, true);
+    m_volumes.append(volume);
+
+    Q2DViewer *viewer = new Q2DViewer();
+    viewer->setInput(volume);
+    m_viewers.append(viewer);
+
+    return viewer;
+}
+
+void test_RenderScheduler::runScheduledFrames()
+{
+    // Frames are scheduled with a zero-time single-shot timer
+    QTest::qWait(0);
+    QCoreApplication::processEvents();
+}
+
+DECLARE_TEST(test_RenderScheduler)
+
+#include "test_renderscheduler.moc"
@@ -27,6 +27,15 @@ private slots:
     void getMaximum_ReturnsExpectedData_data();
     void getMaximum_ReturnsExpectedData();
 
+    void addValues_GivesSameStatisticsAsAddVoxel();
+
+    void getStandardDeviation_WithLargeValues_IsAccurate();
+
+    void getPercentile_ReturnsExpectedData_data();
+    void getPercentile_ReturnsExpectedData();
+
+    void getPercentile_WithoutHistogram_ReturnsZero();
+
 private:
     ROIData generateROIData();
 };
@@ -120,6 +129,70 @@ void test_ROIData::getMaximum_ReturnsExpectedData()
     QCOMPARE(roiData.getMaximum(), expectedMaximum);
 }
 
+void test_ROIData::addValues_GivesSameStatisticsAsAddVoxel()
+{
+    ROIData expectedROIData = generateROIData();
+
+    ROIData roiData;
+    double firstSpan[] = { 1.0, 2.0, 3.0, 4.0 };
+    double secondSpan[] = { 5.0, 6.0, 7.0, 8.0, 9.0, 10.0 };
+    roiData.addValues(firstSpan, 4);
+    roiData.addValues(secondSpan, 6);
+
+    QCOMPARE(roiData.getNumberOfVoxels(), 10);
+    QCOMPARE(roiData.getMean(), expectedROIData.getMean());
+    QVERIFY(FuzzyCompareTestHelper::fuzzyCompare(roiData.getStandardDeviation(), expectedROIData.getStandardDeviation(), 1.0e-9));
+    QCOMPARE(roiData.getMinimum(), 1.0);
+    QCOMPARE(roiData.getMaximum(), expectedROIData.getMaximum());
+}
+
+void test_ROIData::getStandardDeviation_WithLargeValues_IsAccurate()
+{
+    ROIData roiData;
+    for (int i = 1; i <= 10; ++i)
+    {
+        roiData.addValue(1.0e9 + i);
+    }
+
+    QVERIFY(FuzzyCompareTestHelper::fuzzyCompare(roiData.getStandardDeviation(), 2.872, 1.0e-3));
+}
+
+void test_ROIData::getPercentile_ReturnsExpectedData_data()
+{
+    QTest::addColumn<double>("percentile");
+    QTest::addColumn<double>("expectedValue");
+
+    QTest::newRow("0") << 0.0 << 0.5;
+    QTest::newRow("10") << 10.0 << 1.0;
+    QTest::newRow("50") << 50.0 << 5.0;
+    QTest::newRow("75") << 75.0 << 7.5;
+    QTest::newRow("100") << 100.0 << 9.5;
+}
+
+void test_ROIData::getPercentile_ReturnsExpectedData()
+{
+    QFETCH(double, percentile);
+    QFETCH(double, expectedValue);
+
+    ROIData roiData;
+    roiData.setHistogramRange(0.0, 10.0, 10);
+    for (int i = 0; i < 10; ++i)
+    {
+        roiData.addValue(i + 0.5);
+    }
+
+    QCOMPARE(roiData.getHistogram(), QVector<int>(10, 1));
+    QVERIFY(FuzzyCompareTestHelper::fuzzyCompare(roiData.getPercentile(percentile), expectedValue, 1.0e-9));
+}
+
+void test_ROIData::getPercentile_WithoutHistogram_ReturnsZero()
+{
+    ROIData roiData = generateROIData();
+
+    QVERIFY(roiData.getHistogram().isEmpty());
+    QCOMPARE(roiData.getPercentile(50.0), 0.0);
+}
+
 ROIData test_ROIData::generateROIData()
 {
     ROIData roiData;
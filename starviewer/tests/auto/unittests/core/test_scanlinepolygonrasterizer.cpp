@@ -0,0 +1,63 @@
+#include "autotest.h"
+#include "scanlinepolygonrasterizer.h"
+
+#include <QStringList>
+
+using namespace udg;
+
+class test_ScanlinePolygonRasterizer : public QObject {
+    Q_OBJECT
+
+private slots:
+    void getSpans_ReturnsExpectedSpans_data();
+    void getSpans_ReturnsExpectedSpans();
+
+private:
+    /// Returns the spans as strings "y: firstX-lastX" to compare them easily.
+    static QStringList toStringList(const QVector<ScanlinePolygonRasterizer::Span> &spans);
+};
+
+Q_DECLARE_METATYPE(QVector<QPointF>)
+
+void test_ScanlinePolygonRasterizer::getSpans_ReturnsExpectedSpans_data()
+{
+    QTest::addColumn<QVector<QPointF> >("polygon");
+    QTest::addColumn<QStringList>("expectedSpans");
+
+    QTest::newRow("empty polygon") << QVector<QPointF>() << QStringList();
+    QTest::newRow("degenerate polygon") << (QVector<QPointF>() << QPointF(0.0, 1.0) << QPointF(5.0, 1.0)) << QStringList();
+    QTest::newRow("square") << (QVector<QPointF>() << QPointF(0.5, 0.5) << QPointF(3.5, 0.5) << QPointF(3.5, 2.5) << QPointF(0.5, 2.5))
+                            << (QStringList() << "1: 1-3" << "2: 1-3");
+    QTest::newRow("square clipped") << (QVector<QPointF>() << QPointF(-2.5, -2.5) << QPointF(3.5, -2.5) << QPointF(3.5, 2.5) << QPointF(-2.5, 2.5))
+                                    << (QStringList() << "0: 0-3" << "1: 0-3" << "2: 0-3");
+    QTest::newRow("triangle") << (QVector<QPointF>() << QPointF(0.5, 0.5) << QPointF(4.5, 0.5) << QPointF(0.5, 4.5))
+                              << (QStringList() << "1: 1-4" << "2: 1-3" << "3: 1-2" << "4: 1-1");
+    QTest::newRow("concave") << (QVector<QPointF>() << QPointF(0.5, 0.5) << QPointF(6.5, 0.5) << QPointF(6.5, 3.5) << QPointF(4.5, 3.5)
+                                                    << QPointF(4.5, 1.5) << QPointF(2.5, 1.5) << QPointF(2.5, 3.5) << QPointF(0.5, 3.5))
+                             << (QStringList() << "1: 1-6" << "2: 1-2" << "2: 5-6" << "3: 1-2" << "3: 5-6");
+}
+
+void test_ScanlinePolygonRasterizer::getSpans_ReturnsExpectedSpans()
+{
+    QFETCH(QVector<QPointF>, polygon);
+    QFETCH(QStringList, expectedSpans);
+
+    ScanlinePolygonRasterizer rasterizer(polygon);
+
+    QCOMPARE(toStringList(rasterizer.getSpans(0, 9, 0, 9)), expectedSpans);
+}
+
+QStringList test_ScanlinePolygonRasterizer::toStringList(const QVector<ScanlinePolygonRasterizer::Span> &spans)
+{
+    QStringList list;
+    foreach (const ScanlinePolygonRasterizer::Span &span, spans)
+    {
+        list << QString("%1: %2-%3").arg(span.y).arg(span.firstX).arg(span.lastX);
+    }
+
+    return list;
+}
+
+DECLARE_TEST(test_ScanlinePolygonRasterizer)
+
+#include "test_scanlinepolygonrasterizer.moc"
@@ -40,12 +40,30 @@ private slots:
     void getVoxelIndex_ReturnsExpectedIndex_data();
     void getVoxelIndex_ReturnsExpectedIndex();
 
+    void getVoxelCoordinate_ReturnsExpectedCoordinate_data();
+    void getVoxelCoordinate_ReturnsExpectedCoordinate();
+
     void getVoxelValue_PermutesAxesCorrectly_data();
     void getVoxelValue_PermutesAxesCorrectly();
 
+    void getRowValues_PermutesAxesCorrectly_data();
+    void getRowValues_PermutesAxesCorrectly();
+
     void getWorldCoordinate_ReturnsExpectedCoordinate_data();
     void getWorldCoordinate_ReturnsExpectedCoordinate();
 
+    void setPhase_RestrictsExtentToPhase_data();
+    void setPhase_RestrictsExtentToPhase();
+
+    void setPhase_ReadsVoxelsOfPhase_data();
+    void setPhase_ReadsVoxelsOfPhase();
+
+    void setPhase_ReadsRowsOfPhase_data();
+    void setPhase_ReadsRowsOfPhase();
+
+    void setPhase_MapsWorldCoordinatesOfPhase_data();
+    void setPhase_MapsWorldCoordinatesOfPhase();
+
 };
 
 typedef std::array<int, 6> Extent;
@@ -238,6 +256,45 @@ void test_SliceOrientedVolumePixelData::getVoxelIndex_ReturnsExpectedIndex()
     delete volumePixelData;
 }
 
+void test_SliceOrientedVolumePixelData::getVoxelCoordinate_ReturnsExpectedCoordinate_data()
+{
+    QTest::addColumn<VolumePixelData*>("volumePixelData");
+    QTest::addColumn<OrthogonalPlane>("orthogonalPlane");
+    QTest::addColumn<Vector3>("worldCoordinate");
+    QTest::addColumn<Vector3>("expectedVoxelCoordinate");
+
+    int dimensions[3] = { 25, 100, 18 };
+    int extent[6] = { 0, 24, 0, 99, 0, 17 };
+    double spacing[3] = { 0.1, 0.2, 0.3 };
+    double origin[3] = { 10, 20, 30 };
+
+    QTest::newRow("no data") << new VolumePixelData() << OrthogonalPlane() << Vector3{10.05, 24.1, 33.3} << Vector3();
+
+    QTest::newRow("xy") << VolumePixelDataTestHelper::createVolumePixelData(dimensions, extent, spacing, origin)
+                        << OrthogonalPlane(OrthogonalPlane::XYPlane) << Vector3{10.05, 24.1, 33.3} << Vector3{0.5, 20.5, 11};
+    QTest::newRow("xz") << VolumePixelDataTestHelper::createVolumePixelData(dimensions, extent, spacing, origin)
+                        << OrthogonalPlane(OrthogonalPlane::XZPlane) << Vector3{10.05, 24.1, 33.3} << Vector3{0.5, 11, 20.5};
+    QTest::newRow("yz") << VolumePixelDataTestHelper::createVolumePixelData(dimensions, extent, spacing, origin)
+                        << OrthogonalPlane(OrthogonalPlane::YZPlane) << Vector3{10.05, 24.1, 33.3} << Vector3{20.5, 11, 0.5};
+}
+
+void test_SliceOrientedVolumePixelData::getVoxelCoordinate_ReturnsExpectedCoordinate()
+{
+    QFETCH(VolumePixelData*, volumePixelData);
+    QFETCH(OrthogonalPlane, orthogonalPlane);
+    QFETCH(Vector3, worldCoordinate);
+    QFETCH(Vector3, expectedVoxelCoordinate);
+
+    SliceOrientedVolumePixelData data;
+    data.setVolumePixelData(volumePixelData).setOrthogonalPlane(orthogonalPlane);
+
+    QVERIFY2(FuzzyCompareTestHelper::fuzzyCompare(data.getVoxelCoordinate(worldCoordinate), expectedVoxelCoordinate, 0.0001),
+             qPrintable(QString("actual %1, expected %2").arg(data.getVoxelCoordinate(worldCoordinate).toString())
+                                                         .arg(expectedVoxelCoordinate.toString())));
+
+    delete volumePixelData;
+}
+
 void test_SliceOrientedVolumePixelData::getVoxelValue_PermutesAxesCorrectly_data()
 {
     QTest::addColumn<VolumePixelData*>("volumePixelData");
@@ -275,6 +332,53 @@ void test_SliceOrientedVolumePixelData::getVoxelValue_PermutesAxesCorrectly()
     delete volumePixelData;
 }
 
+void test_SliceOrientedVolumePixelData::getRowValues_PermutesAxesCorrectly_data()
+{
+    QTest::addColumn<VolumePixelData*>("volumePixelData");
+    QTest::addColumn<OrthogonalPlane>("orthogonalPlane");
+    QTest::addColumn<int>("firstX");
+    QTest::addColumn<int>("lastX");
+    QTest::addColumn<int>("row");
+    QTest::addColumn<int>("slice");
+    QTest::addColumn<QVector<double>>("expectedValues");
+
+    int dimensions[3] = { 25, 100, 18 };
+    int extent[6] = { 0, 24, 0, 99, 0, 17 };
+    double spacing[3] = { 0.1, 0.2, 0.3 };
+    double origin[3] = { 10, 20, 30 };
+
+    // The value of each voxel is its offset in the data
+    QTest::newRow("xy") << VolumePixelDataTestHelper::createVolumePixelData(dimensions, extent, spacing, origin)
+                        << OrthogonalPlane(OrthogonalPlane::XYPlane) << 2 << 4 << 2 << 1 << (QVector<double>() << 2552 << 2553 << 2554);
+    QTest::newRow("xz") << VolumePixelDataTestHelper::createVolumePixelData(dimensions, extent, spacing, origin)
+                        << OrthogonalPlane(OrthogonalPlane::XZPlane) << 2 << 4 << 1 << 2 << (QVector<double>() << 2552 << 2553 << 2554);
+    QTest::newRow("yz") << VolumePixelDataTestHelper::createVolumePixelData(dimensions, extent, spacing, origin)
+                        << OrthogonalPlane(OrthogonalPlane::YZPlane) << 2 << 4 << 1 << 3 << (QVector<double>() << 2553 << 2578 << 2603);
+    QTest::newRow("single voxel") << VolumePixelDataTestHelper::createVolumePixelData(dimensions, extent, spacing, origin)
+                                  << OrthogonalPlane(OrthogonalPlane::XYPlane) << 0 << 0 << 0 << 0 << (QVector<double>() << 0);
+}
+
+void test_SliceOrientedVolumePixelData::getRowValues_PermutesAxesCorrectly()
+{
+    QFETCH(VolumePixelData*, volumePixelData);
+    QFETCH(OrthogonalPlane, orthogonalPlane);
+    QFETCH(int, firstX);
+    QFETCH(int, lastX);
+    QFETCH(int, row);
+    QFETCH(int, slice);
+    QFETCH(QVector<double>, expectedValues);
+
+    SliceOrientedVolumePixelData data;
+    data.setVolumePixelData(volumePixelData).setOrthogonalPlane(orthogonalPlane);
+
+    QVector<double> values(lastX - firstX + 1);
+    data.getRowValues(firstX, lastX, row, slice, values.data());
+
+    QCOMPARE(values, expectedValues);
+
+    delete volumePixelData;
+}
+
 void test_SliceOrientedVolumePixelData::getWorldCoordinate_ReturnsExpectedCoordinate_data()
 {
     QTest::addColumn<VolumePixelData*>("volumePixelData");
@@ -333,6 +437,154 @@ void test_SliceOrientedVolumePixelData::getWorldCoordinate_ReturnsExpectedCoordi
     delete volumePixelData;
 }
 
+void test_SliceOrientedVolumePixelData::setPhase_RestrictsExtentToPhase_data()
+{
+    QTest::addColumn<OrthogonalPlane>("orthogonalPlane");
+    QTest::addColumn<int>("phase");
+    QTest::addColumn<int>("numberOfPhases");
+    QTest::addColumn<Extent>("expectedExtent");
+
+    QTest::newRow("xy") << OrthogonalPlane(OrthogonalPlane::XYPlane) << 1 << 3 << Extent{{0, 24, 0, 99, 0, 5}};
+    QTest::newRow("xz") << OrthogonalPlane(OrthogonalPlane::XZPlane) << 2 << 3 << Extent{{0, 24, 0, 5, 0, 99}};
+    QTest::newRow("yz") << OrthogonalPlane(OrthogonalPlane::YZPlane) << 0 << 6 << Extent{{0, 99, 0, 2, 0, 24}};
+    QTest::newRow("invalid phase") << OrthogonalPlane(OrthogonalPlane::XYPlane) << 3 << 3 << Extent{{0, 24, 0, 99, 0, 17}};
+}
+
+void test_SliceOrientedVolumePixelData::setPhase_RestrictsExtentToPhase()
+{
+    QFETCH(OrthogonalPlane, orthogonalPlane);
+    QFETCH(int, phase);
+    QFETCH(int, numberOfPhases);
+    QFETCH(Extent, expectedExtent);
+
+    int dimensions[3] = { 25, 100, 18 };
+    int extent[6] = { 0, 24, 0, 99, 0, 17 };
+    double spacing[3] = { 0.1, 0.2, 0.3 };
+    double origin[3] = { 10, 20, 30 };
+    VolumePixelData *volumePixelData = VolumePixelDataTestHelper::createVolumePixelData(dimensions, extent, spacing, origin);
+
+    SliceOrientedVolumePixelData data;
+    data.setVolumePixelData(volumePixelData).setOrthogonalPlane(orthogonalPlane).setPhase(phase, numberOfPhases);
+
+    QCOMPARE(data.getExtent(), expectedExtent);
+
+    delete volumePixelData;
+}
+
+void test_SliceOrientedVolumePixelData::setPhase_ReadsVoxelsOfPhase_data()
+{
+    QTest::addColumn<OrthogonalPlane>("orthogonalPlane");
+    QTest::addColumn<int>("phase");
+    QTest::addColumn<VoxelIndex>("voxelIndex");
+    QTest::addColumn<Voxel>("expectedValue");
+
+    // The data has 3 phases, so the slice 4 of the phase 1 is the slice 13 of the data
+    Voxel voxel;
+    voxel.addComponent(static_cast<short>(34756));
+
+    QTest::newRow("xy") << OrthogonalPlane(OrthogonalPlane::XYPlane) << 1 << VoxelIndex(6, 90, 4) << voxel;
+    QTest::newRow("xz") << OrthogonalPlane(OrthogonalPlane::XZPlane) << 1 << VoxelIndex(6, 4, 90) << voxel;
+    QTest::newRow("yz") << OrthogonalPlane(OrthogonalPlane::YZPlane) << 1 << VoxelIndex(90, 4, 6) << voxel;
+    QTest::newRow("outside phase") << OrthogonalPlane(OrthogonalPlane::XYPlane) << 1 << VoxelIndex(6, 90, 6) << Voxel();
+}
+
+void test_SliceOrientedVolumePixelData::setPhase_ReadsVoxelsOfPhase()
+{
+    QFETCH(OrthogonalPlane, orthogonalPlane);
+    QFETCH(int, phase);
+    QFETCH(VoxelIndex, voxelIndex);
+    QFETCH(Voxel, expectedValue);
+
+    int dimensions[3] = { 25, 100, 18 };
+    int extent[6] = { 0, 24, 0, 99, 0, 17 };
+    double spacing[3] = { 0.1, 0.2, 0.3 };
+    double origin[3] = { 10, 20, 30 };
+    VolumePixelData *volumePixelData = VolumePixelDataTestHelper::createVolumePixelData(dimensions, extent, spacing, origin);
+
+    SliceOrientedVolumePixelData data;
+    data.setVolumePixelData(volumePixelData).setOrthogonalPlane(orthogonalPlane).setPhase(phase, 3);
+
+    QCOMPARE(data.getVoxelValue(voxelIndex), expectedValue);
+
+    delete volumePixelData;
+}
+
+void test_SliceOrientedVolumePixelData::setPhase_ReadsRowsOfPhase_data()
+{
+    QTest::addColumn<OrthogonalPlane>("orthogonalPlane");
+    QTest::addColumn<int>("phase");
+    QTest::addColumn<int>("row");
+    QTest::addColumn<int>("slice");
+    QTest::addColumn<QVector<double>>("expectedValues");
+
+    // The value of each voxel is its offset in the data, which has 3 phases
+    QTest::newRow("xy") << OrthogonalPlane(OrthogonalPlane::XYPlane) << 2 << 2 << 1 << (QVector<double>() << 12552 << 12553 << 12554);
+    QTest::newRow("xz") << OrthogonalPlane(OrthogonalPlane::XZPlane) << 1 << 1 << 2 << (QVector<double>() << 10052 << 10053 << 10054);
+    QTest::newRow("yz") << OrthogonalPlane(OrthogonalPlane::YZPlane) << 2 << 1 << 3 << (QVector<double>() << 12553 << 12578 << 12603);
+}
+
+void test_SliceOrientedVolumePixelData::setPhase_ReadsRowsOfPhase()
+{
+    QFETCH(OrthogonalPlane, orthogonalPlane);
+    QFETCH(int, phase);
+    QFETCH(int, row);
+    QFETCH(int, slice);
+    QFETCH(QVector<double>, expectedValues);
+
+    int dimensions[3] = { 25, 100, 18 };
+    int extent[6] = { 0, 24, 0, 99, 0, 17 };
+    double spacing[3] = { 0.1, 0.2, 0.3 };
+    double origin[3] = { 10, 20, 30 };
+    VolumePixelData *volumePixelData = VolumePixelDataTestHelper::createVolumePixelData(dimensions, extent, spacing, origin);
+
+    SliceOrientedVolumePixelData data;
+    data.setVolumePixelData(volumePixelData).setOrthogonalPlane(orthogonalPlane).setPhase(phase, 3);
+
+    QVector<double> values(expectedValues.size());
+    data.getRowValues(2, 4, row, slice, values.data());
+
+    QCOMPARE(values, expectedValues);
+
+    delete volumePixelData;
+}
+
+void test_SliceOrientedVolumePixelData::setPhase_MapsWorldCoordinatesOfPhase_data()
+{
+    QTest::addColumn<OrthogonalPlane>("orthogonalPlane");
+    QTest::addColumn<VoxelIndex>("voxelIndex");
+    QTest::addColumn<Vector3>("worldCoordinate");
+
+    // The world coordinates of a phase are spaced as its slices were consecutive, as in the output of the phase filter
+    QTest::newRow("xy") << OrthogonalPlane(OrthogonalPlane::XYPlane) << VoxelIndex(0, 20, 5) << Vector3{10, 24, 31.5};
+    QTest::newRow("yz") << OrthogonalPlane(OrthogonalPlane::YZPlane) << VoxelIndex(20, 5, 0) << Vector3{10, 24, 31.5};
+    QTest::newRow("outside phase") << OrthogonalPlane(OrthogonalPlane::XYPlane) << VoxelIndex() << Vector3{10, 24, 33};
+}
+
+void test_SliceOrientedVolumePixelData::setPhase_MapsWorldCoordinatesOfPhase()
+{
+    QFETCH(OrthogonalPlane, orthogonalPlane);
+    QFETCH(VoxelIndex, voxelIndex);
+    QFETCH(Vector3, worldCoordinate);
+
+    int dimensions[3] = { 25, 100, 18 };
+    int extent[6] = { 0, 24, 0, 99, 0, 17 };
+    double spacing[3] = { 0.1, 0.2, 0.3 };
+    double origin[3] = { 10, 20, 30 };
+    VolumePixelData *volumePixelData = VolumePixelDataTestHelper::createVolumePixelData(dimensions, extent, spacing, origin);
+
+    SliceOrientedVolumePixelData data;
+    data.setVolumePixelData(volumePixelData).setOrthogonalPlane(orthogonalPlane).setPhase(1, 3);
+
+    QCOMPARE(data.getVoxelIndex(worldCoordinate), voxelIndex);
+
+    if (voxelIndex.isValid())
+    {
+        QVERIFY2(FuzzyCompareTestHelper::fuzzyCompare(data.getWorldCoordinate(voxelIndex), worldCoordinate, 0.0001),
+                 qPrintable(QString("actual %1, expected %2").arg(data.getWorldCoordinate(voxelIndex).toString()).arg(worldCoordinate.toString())));
+    }
+
+    delete volumePixelData;
+}
 
 DECLARE_TEST(test_SliceOrientedVolumePixelData)
 
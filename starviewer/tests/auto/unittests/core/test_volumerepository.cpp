@@ -0,0 +1,172 @@
+#include "autotest.h"
+#include "volumerepository.h"
+
+#include "volume.h"
+#include "volumepixeldata.h"
+
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+
+using namespace udg;
+
+class test_VolumeRepository : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+
+    void updateCache_ShouldFreeLeastRecentlyUsedVolumesThatAreNotDisplayedWhenBudgetIsExceeded();
+    void updateCache_ShouldNotFreeAnythingWithoutBudget();
+    void updateCache_ShouldNotFreeVolumesWhosePixelDataHasNotBeenRead();
+    void updateCache_ShouldNotFreePixelDataReferencedByOthers();
+    void updateCache_ShouldKeepPixelDataObjectWhenFreeingItsData();
+
+private:
+    /// Creates a volume with 1 MB of pixel data set as if it had been read from the images, adds it to the repository and returns it.
+    Volume* createReadVolume();
+    /// Calls the cache update directly.
+    void updateCache();
+
+    QList<Identifier> m_identifiers;
+
+};
+
+void test_VolumeRepository::cleanup()
+{
+    foreach (const Identifier &id, m_identifiers)
+    {
+        VolumeRepository::getRepository()->deleteVolume(id);
+    }
+
+    m_identifiers.clear();
+    VolumeRepository::getRepository()->setMemoryBudget(0);
+}
+
+void test_VolumeRepository::updateCache_ShouldFreeLeastRecentlyUsedVolumesThatAreNotDisplayedWhenBudgetIsExceeded()
+{
+    VolumeRepository *repository = VolumeRepository::getRepository();
+    Volume *displayedVolume = createReadVolume();
+    Volume *leastRecentlyUsedVolume = createReadVolume();
+    Volume *mostRecentlyUsedVolume = createReadVolume();
+
+    repository->retainVolume(displayedVolume);
+    repository->getVolume(mostRecentlyUsedVolume->getIdentifier());
+
+    repository->setMemoryBudget(2.5 * 1024 * 1024);
+    updateCache();
+
+    QVERIFY(displayedVolume->isPixelDataLoaded());
+    QVERIFY(!leastRecentlyUsedVolume->isPixelDataLoaded());
+    QVERIFY(mostRecentlyUsedVolume->isPixelDataLoaded());
+
+    // Not even the displayed volume fits, but it must be kept
+    repository->setMemoryBudget(512 * 1024);
+    updateCache();
+
+    QVERIFY(displayedVolume->isPixelDataLoaded());
+    QVERIFY(!mostRecentlyUsedVolume->isPixelDataLoaded());
+
+    repository->releaseVolume(displayedVolume);
+    updateCache();
+
+    QVERIFY(!displayedVolume->isPixelDataLoaded());
+}
+
+void test_VolumeRepository::updateCache_ShouldNotFreeAnythingWithoutBudget()
+{
+    Volume *volume1 = createReadVolume();
+    Volume *volume2 = createReadVolume();
+
+    VolumeRepository::getRepository()->setMemoryBudget(0);
+    updateCache();
+
+    QVERIFY(volume1->isPixelDataLoaded());
+    QVERIFY(volume2->isPixelDataLoaded());
+}
+
+void test_VolumeRepository::updateCache_ShouldNotFreeVolumesWhosePixelDataHasNotBeenRead()
+{
+    Volume *readVolume = createReadVolume();
+    Volume *generatedVolume = createReadVolume();
+    // Data set by other means than reading can't be read again
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetExtent(0, 127, 0, 127, 0, 63);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    generatedVolume->setData(imageData);
+
+    VolumeRepository::getRepository()->setMemoryBudget(512 * 1024);
+    updateCache();
+
+    QVERIFY(!readVolume->isPixelDataLoaded());
+    QVERIFY(generatedVolume->isPixelDataLoaded());
+}
+
+void test_VolumeRepository::updateCache_ShouldNotFreePixelDataReferencedByOthers()
+{
+    Volume *freeVolume = createReadVolume();
+    Volume *referencedVolume = createReadVolume();
+    // E.g. the input of a filter or a viewer
+    vtkSmartPointer<vtkImageData> reference = referencedVolume->getVtkData();
+
+    VolumeRepository::getRepository()->setMemoryBudget(512 * 1024);
+    updateCache();
+
+    QVERIFY(!freeVolume->isPixelDataLoaded());
+    QVERIFY(referencedVolume->isPixelDataLoaded());
+
+    reference = 0;
+    updateCache();
+
+    QVERIFY(!referencedVolume->isPixelDataLoaded());
+}
+
+void test_VolumeRepository::updateCache_ShouldKeepPixelDataObjectWhenFreeingItsData()
+{
+    Volume *volume = createReadVolume();
+    VolumePixelData *pixelData = volume->getPixelData();
+
+    VolumeRepository::getRepository()->setMemoryBudget(512 * 1024);
+    updateCache();
+
+    QVERIFY(!volume->isPixelDataLoaded());
+    QVERIFY(!pixelData->isLoaded());
+
+    // Reading it again must fill the same object
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetExtent(0, 127, 0, 127, 0, 63);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    VolumePixelData *readPixelData = new VolumePixelData();
+    readPixelData->setData(imageData);
+    volume->setPixelData(readPixelData);
+
+    QVERIFY(volume->isPixelDataLoaded());
+    QCOMPARE(volume->getPixelData(), pixelData);
+    QCOMPARE(pixelData->getVtkData(), imageData.GetPointer());
+}
+
+Volume* test_VolumeRepository::createReadVolume()
+{
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetExtent(0, 127, 0, 127, 0, 63);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
+    VolumePixelData *pixelData = new VolumePixelData();
+    pixelData->setData(imageData);
+
+    Volume *volume = new Volume();
+    volume->setPixelData(pixelData);
+    m_identifiers << VolumeRepository::getRepository()->addVolume(volume);
+    volume->setIdentifier(m_identifiers.last());
+
+    return volume;
+}
+
+void test_VolumeRepository::updateCache()
+{
+    QMetaObject::invokeMethod(VolumeRepository::getRepository(), "updateCache", Qt::DirectConnection);
+}
+
+DECLARE_TEST(test_VolumeRepository)
+
+#include "test_volumerepository.moc"
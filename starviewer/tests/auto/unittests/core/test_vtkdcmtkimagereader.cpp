@@ -0,0 +1,385 @@
+#include "autotest.h"
+#include "vtkdcmtkimagereader.h"
+
+#include <QElapsedTimer>
+#include <QReadLocker>
+#include <QTemporaryDir>
+
+#include <algorithm>
+
+#include <vtkCallbackCommand.h>
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+#include <vtkStringArray.h>
+
+#include <dcdeftag.h>
+#include <dcfilefo.h>
+#include <dcuid.h>
+
+using namespace udg;
+
+namespace {
+
+// Keeps what the reader reports during a progressive read.
+struct ProgressiveReadRecord
+{
+    ProgressiveReadRecord() : numberOfPriorityFramesLoadedEvents(0), priorityFramesLoadedEventIsFirst(true), timer(0), timeToPriorityFramesLoaded(-1)
+    {
+    }
+
+    int numberOfPriorityFramesLoadedEvents;
+    bool priorityFramesLoadedEventIsFirst;
+    // If set, the elapsed time of this timer at the first PriorityFramesLoadedEvent is kept in timeToPriorityFramesLoaded
+    QElapsedTimer *timer;
+    qint64 timeToPriorityFramesLoaded;
+    // Value of the first voxel of each frame when PriorityFramesLoadedEvent is invoked
+    QList<int> firstVoxelValuesAtPriorityFramesLoaded;
+    QList<int> loadedFrames;
+};
+
+void recordPriorityFramesLoaded(vtkObject *caller, unsigned long eventId, void *clientData, void *callData)
+{
+    Q_UNUSED(caller)
+    Q_UNUSED(eventId)
+
+    ProgressiveReadRecord *record = static_cast<ProgressiveReadRecord*>(clientData);
+    vtkImageData *imageData = static_cast<vtkImageData*>(callData);
+    record->numberOfPriorityFramesLoadedEvents++;
+
+    if (record->timer && record->timeToPriorityFramesLoaded < 0)
+    {
+        record->timeToPriorityFramesLoaded = record->timer->elapsed();
+    }
+
+    // The decoding threads are still writing the rest of frames
+    QReadLocker locker(VtkDcmtkImageReader::getProgressiveReadLock());
+    int dimensions[3];
+    imageData->GetDimensions(dimensions);
+
+    for (int z = 0; z < dimensions[2]; z++)
+    {
+        record->firstVoxelValuesAtPriorityFramesLoaded << *static_cast<unsigned short*>(imageData->GetScalarPointer(0, 0, z));
+    }
+}
+
+void recordFramesLoaded(vtkObject *caller, unsigned long eventId, void *clientData, void *callData)
+{
+    Q_UNUSED(caller)
+    Q_UNUSED(eventId)
+
+    ProgressiveReadRecord *record = static_cast<ProgressiveReadRecord*>(clientData);
+
+    if (record->numberOfPriorityFramesLoadedEvents == 0)
+    {
+        record->priorityFramesLoadedEventIsFirst = false;
+    }
+
+    record->loadedFrames << *static_cast<QList<int>*>(callData);
+}
+
+}
+
+class test_VtkDcmtkImageReader : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void update_ProgressiveReadShouldLoadPriorityFramesFirstAndGiveTheSameResult_data();
+    void update_ProgressiveReadShouldLoadPriorityFramesFirstAndGiveTheSameResult();
+
+    void update_ShouldConvertFramesWithADifferentInternalRepresentation_data();
+    void update_ShouldConvertFramesWithADifferentInternalRepresentation();
+
+    void update_TimeToFirstImage_Benchmark_data();
+    void update_TimeToFirstImage_Benchmark();
+
+    void convertScalars_Benchmark_data();
+    void convertScalars_Benchmark();
+
+private:
+    /// Creates a CT file whose voxels have the given value in the given directory and returns its path. The image has size x size pixels.
+    QString createDICOMFile(const QTemporaryDir &directory, int instanceNumber, Uint16 value, int size = 4);
+    /// Reads the given files with the given number of threads and priority frames, recording the progressive read events in the given record.
+    vtkSmartPointer<vtkImageData> read(const QStringList &files, int numberOfThreads, const QList<int> &priorityFrames, ProgressiveReadRecord &record);
+
+};
+
+void test_VtkDcmtkImageReader::update_ProgressiveReadShouldLoadPriorityFramesFirstAndGiveTheSameResult_data()
+{
+    QTest::addColumn<int>("numberOfThreads");
+
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("4 threads") << 4;
+}
+
+void test_VtkDcmtkImageReader::update_ProgressiveReadShouldLoadPriorityFramesFirstAndGiveTheSameResult()
+{
+    QFETCH(int, numberOfThreads);
+
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    const int NumberOfFrames = 40;
+    QStringList files;
+
+    for (int i = 0; i < NumberOfFrames; i++)
+    {
+        files << createDICOMFile(directory, i + 1, static_cast<Uint16>(i + 1));
+    }
+
+    QList<int> priorityFrames;
+    priorityFrames << 20 << 0 << 10 << 30;
+
+    ProgressiveReadRecord sequentialRecord;
+    vtkSmartPointer<vtkImageData> sequentialData = read(files, 1, QList<int>(), sequentialRecord);
+    ProgressiveReadRecord progressiveRecord;
+    vtkSmartPointer<vtkImageData> progressiveData = read(files, numberOfThreads, priorityFrames, progressiveRecord);
+
+    QCOMPARE(sequentialRecord.numberOfPriorityFramesLoadedEvents, 0);
+    QVERIFY(sequentialRecord.loadedFrames.isEmpty());
+
+    QCOMPARE(progressiveRecord.numberOfPriorityFramesLoadedEvents, 1);
+    QVERIFY(progressiveRecord.priorityFramesLoadedEventIsFirst);
+
+    // Priority frames were available at the first event, and not loaded frames were zero
+    QCOMPARE(progressiveRecord.firstVoxelValuesAtPriorityFramesLoaded.size(), NumberOfFrames);
+
+    for (int frame = 0; frame < NumberOfFrames; frame++)
+    {
+        int value = progressiveRecord.firstVoxelValuesAtPriorityFramesLoaded.at(frame);
+
+        if (priorityFrames.contains(frame))
+        {
+            QCOMPARE(value, frame + 1);
+        }
+        else
+        {
+            QVERIFY(value == 0 || value == frame + 1);
+        }
+    }
+
+    // Every frame is reported once
+    QList<int> loadedFrames = progressiveRecord.loadedFrames;
+    std::sort(loadedFrames.begin(), loadedFrames.end());
+
+    QCOMPARE(loadedFrames.size(), NumberOfFrames);
+
+    for (int frame = 0; frame < NumberOfFrames; frame++)
+    {
+        QCOMPARE(loadedFrames.at(frame), frame);
+    }
+
+    // Same result as a normal read
+    QCOMPARE(progressiveData->GetScalarType(), sequentialData->GetScalarType());
+    QCOMPARE(progressiveData->GetNumberOfPoints(), sequentialData->GetNumberOfPoints());
+    QVERIFY(memcmp(progressiveData->GetScalarPointer(), sequentialData->GetScalarPointer(),
+                   progressiveData->GetNumberOfPoints() * progressiveData->GetScalarSize()) == 0);
+}
+
+void test_VtkDcmtkImageReader::update_ShouldConvertFramesWithADifferentInternalRepresentation_data()
+{
+    QTest::addColumn<int>("numberOfThreads");
+
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("4 threads") << 4;
+}
+
+void test_VtkDcmtkImageReader::update_ShouldConvertFramesWithADifferentInternalRepresentation()
+{
+    QFETCH(int, numberOfThreads);
+
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    // DCMTK represents internally the first frame with 16 bits and the rest with 8 bits, so they must be converted to the output scalar type
+    const int NumberOfFrames = 8;
+    QList<int> values;
+    values << 1000;
+
+    for (int i = 1; i < NumberOfFrames; i++)
+    {
+        values << i;
+    }
+
+    QStringList files;
+
+    for (int i = 0; i < NumberOfFrames; i++)
+    {
+        files << createDICOMFile(directory, i + 1, static_cast<Uint16>(values.at(i)));
+    }
+
+    ProgressiveReadRecord record;
+    vtkSmartPointer<vtkImageData> data = read(files, numberOfThreads, QList<int>(), record);
+
+    QCOMPARE(data->GetScalarType(), VTK_UNSIGNED_SHORT);
+
+    int dimensions[3];
+    data->GetDimensions(dimensions);
+    QCOMPARE(dimensions[2], NumberOfFrames);
+
+    for (int z = 0; z < dimensions[2]; z++)
+    {
+        for (int y = 0; y < dimensions[1]; y++)
+        {
+            for (int x = 0; x < dimensions[0]; x++)
+            {
+                QCOMPARE(static_cast<int>(*static_cast<unsigned short*>(data->GetScalarPointer(x, y, z))), values.at(z));
+            }
+        }
+    }
+}
+
+void test_VtkDcmtkImageReader::update_TimeToFirstImage_Benchmark_data()
+{
+    QTest::addColumn<bool>("progressive");
+
+    QTest::newRow("whole read") << false;
+    QTest::newRow("progressive read") << true;
+}
+
+void test_VtkDcmtkImageReader::update_TimeToFirstImage_Benchmark()
+{
+    QFETCH(bool, progressive);
+
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    // A 256x256 series of 200 slices, shown from its middle slice as a hanging protocol may do
+    const int NumberOfFrames = 200;
+    const int FirstFrame = NumberOfFrames / 2;
+    QStringList files;
+
+    for (int i = 0; i < NumberOfFrames; i++)
+    {
+        files << createDICOMFile(directory, i + 1, static_cast<Uint16>(i + 1), 256);
+    }
+
+    // The same priority frames that VolumeReader asks for: the first displayed slice and a strided subset of 16 slices
+    QList<int> priorityFrames;
+
+    if (progressive)
+    {
+        const int Stride = NumberOfFrames / 16;
+        priorityFrames << FirstFrame;
+
+        for (int frame = FirstFrame % Stride; frame < NumberOfFrames; frame += Stride)
+        {
+            if (frame != FirstFrame)
+            {
+                priorityFrames << frame;
+            }
+        }
+    }
+
+    // Each read is timed once, since what matters is the time until the first image can be shown and not the whole read
+    ProgressiveReadRecord record;
+    QElapsedTimer timer;
+    record.timer = &timer;
+    timer.start();
+    read(files, 0, priorityFrames, record);
+    qint64 timeToFirstImage = progressive ? record.timeToPriorityFramesLoaded : timer.elapsed();
+
+    QVERIFY(timeToFirstImage >= 0);
+    QTest::setBenchmarkResult(timeToFirstImage, QTest::WalltimeMilliseconds);
+}
+
+void test_VtkDcmtkImageReader::convertScalars_Benchmark_data()
+{
+    QTest::addColumn<int>("sourceScalarType");
+    QTest::addColumn<int>("destinationScalarType");
+
+    // DCMTK uses the smallest representation that fits the values of each frame, so the source is usually smaller than the output
+    QTest::newRow("uint8 to int16") << VTK_UNSIGNED_CHAR << VTK_SHORT;
+    QTest::newRow("uint8 to uint16") << VTK_UNSIGNED_CHAR << VTK_UNSIGNED_SHORT;
+    QTest::newRow("int16 to int32") << VTK_SHORT << VTK_INT;
+    QTest::newRow("int16 to float") << VTK_SHORT << VTK_FLOAT;
+}
+
+void test_VtkDcmtkImageReader::convertScalars_Benchmark()
+{
+    QFETCH(int, sourceScalarType);
+    QFETCH(int, destinationScalarType);
+
+    // 64 frames of 512x512
+    const size_t Count = 512 * 512 * 64;
+    // Sources are filled with zeros, which fit in any destination type
+    QByteArray source(static_cast<int>(Count * vtkDataArray::GetDataTypeSize(sourceScalarType)), 0);
+    QByteArray destination(static_cast<int>(Count * vtkDataArray::GetDataTypeSize(destinationScalarType)), 1);
+
+    QBENCHMARK
+    {
+        VtkDcmtkImageReader::convertScalars(source.constData(), sourceScalarType, destination.data(), destinationScalarType, Count);
+    }
+
+    QVERIFY(std::all_of(destination.constBegin(), destination.constEnd(), [](char value) { return value == 0; }));
+}
+
+QString test_VtkDcmtkImageReader::createDICOMFile(const QTemporaryDir &directory, int instanceNumber, Uint16 value, int size)
+{
+    const Uint16 Rows = static_cast<Uint16>(size);
+    const Uint16 Columns = static_cast<Uint16>(size);
+
+    DcmFileFormat fileFormat;
+    DcmDataset *dataset = fileFormat.getDataset();
+    QString sopInstanceUID = QString("1.2.3.4.5.1.%1").arg(instanceNumber);
+
+    dataset->putAndInsertString(DCM_SOPClassUID, UID_CTImageStorage);
+    dataset->putAndInsertString(DCM_SOPInstanceUID, qPrintable(sopInstanceUID));
+    dataset->putAndInsertString(DCM_StudyInstanceUID, "1.2.3.4");
+    dataset->putAndInsertString(DCM_SeriesInstanceUID, "1.2.3.4.5.1");
+    dataset->putAndInsertString(DCM_Modality, "CT");
+    dataset->putAndInsertString(DCM_InstanceNumber, qPrintable(QString::number(instanceNumber)));
+    dataset->putAndInsertString(DCM_ImagePositionPatient, qPrintable(QString("0\\0\\%1").arg(instanceNumber)));
+    dataset->putAndInsertString(DCM_ImageOrientationPatient, "1\\0\\0\\0\\1\\0");
+    dataset->putAndInsertString(DCM_PixelSpacing, "0.5\\0.5");
+    dataset->putAndInsertString(DCM_SliceThickness, "1");
+    dataset->putAndInsertUint16(DCM_SamplesPerPixel, 1);
+    dataset->putAndInsertString(DCM_PhotometricInterpretation, "MONOCHROME2");
+    dataset->putAndInsertUint16(DCM_Rows, Rows);
+    dataset->putAndInsertUint16(DCM_Columns, Columns);
+    dataset->putAndInsertUint16(DCM_BitsAllocated, 16);
+    dataset->putAndInsertUint16(DCM_BitsStored, 16);
+    dataset->putAndInsertUint16(DCM_HighBit, 15);
+    dataset->putAndInsertUint16(DCM_PixelRepresentation, 0);
+
+    QVector<Uint16> pixels(Rows * Columns, value);
+    dataset->putAndInsertUint16Array(DCM_PixelData, pixels.data(), pixels.size());
+
+    QString path = QString("%1/%2.dcm").arg(directory.path()).arg(sopInstanceUID);
+    fileFormat.saveFile(qPrintable(path), EXS_LittleEndianExplicit);
+
+    return path;
+}
+
+vtkSmartPointer<vtkImageData> test_VtkDcmtkImageReader::read(const QStringList &files, int numberOfThreads, const QList<int> &priorityFrames,
+                                                             ProgressiveReadRecord &record)
+{
+    vtkSmartPointer<vtkStringArray> fileNames = vtkSmartPointer<vtkStringArray>::New();
+
+    foreach (const QString &file, files)
+    {
+        fileNames->InsertNextValue(file.toStdString());
+    }
+
+    vtkSmartPointer<vtkCallbackCommand> priorityFramesLoadedCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+    priorityFramesLoadedCallback->SetCallback(recordPriorityFramesLoaded);
+    priorityFramesLoadedCallback->SetClientData(&record);
+    vtkSmartPointer<vtkCallbackCommand> framesLoadedCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+    framesLoadedCallback->SetCallback(recordFramesLoaded);
+    framesLoadedCallback->SetClientData(&record);
+
+    vtkSmartPointer<VtkDcmtkImageReader> reader = vtkSmartPointer<VtkDcmtkImageReader>::New();
+    reader->SetFileNames(fileNames);
+    reader->setNumberOfThreads(numberOfThreads);
+    reader->setPriorityFrames(priorityFrames);
+    reader->AddObserver(VtkDcmtkImageReader::PriorityFramesLoadedEvent, priorityFramesLoadedCallback);
+    reader->AddObserver(VtkDcmtkImageReader::FramesLoadedEvent, framesLoadedCallback);
+    reader->Update();
+
+    return reader->GetOutput();
+}
+
+DECLARE_TEST(test_VtkDcmtkImageReader)
+
+#include "test_vtkdcmtkimagereader.moc"
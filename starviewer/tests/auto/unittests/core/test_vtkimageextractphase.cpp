@@ -0,0 +1,183 @@
+#include "autotest.h"
+#include "vtkimageextractphase.h"
+
+#include <vtkFieldData.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+using namespace udg;
+
+class test_VtkImageExtractPhase : public QObject {
+Q_OBJECT
+
+private slots:
+    void update_WithSingleSlice_ShouldShareInputMemory_data();
+    void update_WithSingleSlice_ShouldShareInputMemory();
+
+    void update_WithSingleSlice_ShouldKeepSharedMemoryAfterInputReleasesIt();
+
+    void update_WithWholeExtent_ShouldCopyPhase_data();
+    void update_WithWholeExtent_ShouldCopyPhase();
+
+    void update_SwitchingPhases_Benchmark();
+
+private:
+    /// Returns an image of shorts with the given dimensions where the value of each voxel is its offset.
+    static vtkSmartPointer<vtkImageData> createImage(int width, int height, int depth);
+};
+
+void test_VtkImageExtractPhase::update_WithSingleSlice_ShouldShareInputMemory_data()
+{
+    QTest::addColumn<int>("phase");
+    QTest::addColumn<int>("slice");
+
+    QTest::newRow("first phase, first slice") << 0 << 0;
+    QTest::newRow("middle phase") << 1 << 3;
+    QTest::newRow("last phase, last slice") << 2 << 4;
+}
+
+void test_VtkImageExtractPhase::update_WithSingleSlice_ShouldShareInputMemory()
+{
+    QFETCH(int, phase);
+    QFETCH(int, slice);
+
+    const int NumberOfPhases = 3;
+    vtkSmartPointer<vtkImageData> input = createImage(7, 5, 5 * NumberOfPhases);
+
+    auto filter = vtkSmartPointer<VtkImageExtractPhase>::New();
+    filter->SetInputData(input);
+    filter->setNumberOfPhases(NumberOfPhases);
+    filter->setPhase(phase);
+    filter->UpdateInformation();
+    int updateExtent[6] = { 0, 6, 0, 4, slice, slice };
+    filter->SetUpdateExtent(updateExtent);
+    filter->Update();
+
+    vtkImageData *output = filter->GetOutput();
+    int inputSlice = slice * NumberOfPhases + phase;
+
+    QCOMPARE(output->GetScalarPointer(0, 0, slice), input->GetScalarPointer(0, 0, inputSlice));
+
+    for (int y = 0; y < 5; y++)
+    {
+        for (int x = 0; x < 7; x++)
+        {
+            QCOMPARE(output->GetScalarComponentAsDouble(x, y, slice, 0), input->GetScalarComponentAsDouble(x, y, inputSlice, 0));
+        }
+    }
+}
+
+void test_VtkImageExtractPhase::update_WithSingleSlice_ShouldKeepSharedMemoryAfterInputReleasesIt()
+{
+    const int NumberOfPhases = 2;
+    vtkSmartPointer<vtkImageData> input = createImage(7, 5, 3 * NumberOfPhases);
+    vtkSmartPointer<vtkImageData> expected = createImage(7, 5, 3 * NumberOfPhases);
+
+    auto filter = vtkSmartPointer<VtkImageExtractPhase>::New();
+    filter->SetInputData(input);
+    filter->setNumberOfPhases(NumberOfPhases);
+    filter->setPhase(1);
+    filter->UpdateInformation();
+    int updateExtent[6] = { 0, 6, 0, 4, 2, 2 };
+    filter->SetUpdateExtent(updateExtent);
+    filter->Update();
+
+    // The output doesn't carry the whole input scalars
+    vtkImageData *output = filter->GetOutput();
+    QCOMPARE(output->GetFieldData()->GetNumberOfArrays(), 0);
+
+    input->GetPointData()->SetScalars(0);
+
+    for (int y = 0; y < 5; y++)
+    {
+        for (int x = 0; x < 7; x++)
+        {
+            QCOMPARE(output->GetScalarComponentAsDouble(x, y, 2, 0), expected->GetScalarComponentAsDouble(x, y, 2 * NumberOfPhases + 1, 0));
+        }
+    }
+}
+
+void test_VtkImageExtractPhase::update_WithWholeExtent_ShouldCopyPhase_data()
+{
+    QTest::addColumn<int>("numberOfPhases");
+    QTest::addColumn<int>("phase");
+
+    QTest::newRow("single phase") << 1 << 0;
+    QTest::newRow("first phase") << 3 << 0;
+    QTest::newRow("last phase") << 3 << 2;
+}
+
+void test_VtkImageExtractPhase::update_WithWholeExtent_ShouldCopyPhase()
+{
+    QFETCH(int, numberOfPhases);
+    QFETCH(int, phase);
+
+    vtkSmartPointer<vtkImageData> input = createImage(7, 5, 4 * numberOfPhases);
+
+    auto filter = vtkSmartPointer<VtkImageExtractPhase>::New();
+    filter->SetInputData(input);
+    filter->setNumberOfPhases(numberOfPhases);
+    filter->setPhase(phase);
+    filter->Update();
+
+    vtkImageData *output = filter->GetOutput();
+    int *extent = output->GetExtent();
+
+    QCOMPARE(extent[4], 0);
+    QCOMPARE(extent[5], 3);
+
+    for (int z = 0; z < 4; z++)
+    {
+        for (int y = 0; y < 5; y++)
+        {
+            for (int x = 0; x < 7; x++)
+            {
+                QCOMPARE(output->GetScalarComponentAsDouble(x, y, z, 0), input->GetScalarComponentAsDouble(x, y, z * numberOfPhases + phase, 0));
+            }
+        }
+    }
+}
+
+void test_VtkImageExtractPhase::update_SwitchingPhases_Benchmark()
+{
+    // A 512x512 perfusion series of 20 phases of 10 slices, played as a cine loop on an axial view, which only requests the current slice
+    const int NumberOfPhases = 20;
+    const int Slice = 5;
+    vtkSmartPointer<vtkImageData> input = createImage(512, 512, 10 * NumberOfPhases);
+
+    auto filter = vtkSmartPointer<VtkImageExtractPhase>::New();
+    filter->SetInputData(input);
+    filter->setNumberOfPhases(NumberOfPhases);
+    filter->UpdateInformation();
+    int updateExtent[6] = { 0, 511, 0, 511, Slice, Slice };
+
+    QBENCHMARK
+    {
+        for (int phase = 0; phase < NumberOfPhases; phase++)
+        {
+            filter->setPhase(phase);
+            filter->SetUpdateExtent(updateExtent);
+            filter->Update();
+        }
+    }
+}
+
+vtkSmartPointer<vtkImageData> test_VtkImageExtractPhase::createImage(int width, int height, int depth)
+{
+    auto image = vtkSmartPointer<vtkImageData>::New();
+    image->SetExtent(0, width - 1, 0, height - 1, 0, depth - 1);
+    image->AllocateScalars(VTK_SHORT, 1);
+
+    short *scalars = static_cast<short*>(image->GetScalarPointer());
+    for (int i = 0; i < width * height * depth; i++)
+    {
+        scalars[i] = static_cast<short>(i);
+    }
+
+    return image;
+}
+
+DECLARE_TEST(test_VtkImageExtractPhase)
+
+#include "test_vtkimageextractphase.moc"
@@ -0,0 +1,6 @@
+# The playground extensions are not always built, and the extensions list is only defined later by the project
+include($$PWD/../../../../src/extensions.pri)
+
+contains(PLAYGROUND_EXTENSIONS, experimental3d) {
+    SOURCES += $$PWD/test_voxelprobabilitiesperviewstore.cpp
+}
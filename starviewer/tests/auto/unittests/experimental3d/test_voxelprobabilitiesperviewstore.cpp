@@ -0,0 +1,222 @@
+#include "autotest.h"
+#include "voxelprobabilitiesperviewstore.h"
+
+#include <QTemporaryDir>
+
+using namespace udg;
+
+class TestingVoxelProbabilitiesPerViewStore : public VoxelProbabilitiesPerViewStore {
+public:
+    TestingVoxelProbabilitiesPerViewStore(int numberOfViews, int numberOfVoxels, const QString &directory, bool halfPrecision, qint64 maximumChunkSize)
+        : VoxelProbabilitiesPerViewStore(numberOfViews, numberOfVoxels, directory, halfPrecision, maximumChunkSize)
+    {
+    }
+
+    using VoxelProbabilitiesPerViewStore::BlockSize;
+};
+
+class test_VoxelProbabilitiesPerViewStore : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void view_InSinglePrecision_ShouldReturnTheStoredProbabilities();
+
+    void view_InHalfPrecision_ShouldReturnTheStoredProbabilitiesWithHalfPrecisionError_data();
+    void view_InHalfPrecision_ShouldReturnTheStoredProbabilitiesWithHalfPrecisionError();
+
+    void BlockIterator_ShouldVisitTheVoxelsFromStartToEndInConsecutiveBlocks_data();
+    void BlockIterator_ShouldVisitTheVoxelsFromStartToEndInConsecutiveBlocks();
+
+private:
+    /// Returns the probabilities of the given view used to fill the stores.
+    static QVector<float> createProbabilities(int view, int numberOfVoxels);
+    /// Returns the size of a chunk with the given number of views of the given number of voxels.
+    static qint64 getChunkSize(int numberOfViews, int numberOfVoxels, bool halfPrecision);
+};
+
+void test_VoxelProbabilitiesPerViewStore::view_InSinglePrecision_ShouldReturnTheStoredProbabilities()
+{
+    // Two views per chunk, so that there are more chunks than the ones that are kept mapped
+    const int NumberOfViews = 11;
+    const int NumberOfVoxels = 1000;
+
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    TestingVoxelProbabilitiesPerViewStore store(NumberOfViews, NumberOfVoxels, directory.path(), false, getChunkSize(2, NumberOfVoxels, false));
+    QVERIFY(store.isValid());
+
+    for (int view = 0; view < NumberOfViews; view++)
+    {
+        QVERIFY(store.setView(view, createProbabilities(view, NumberOfVoxels)));
+    }
+
+    for (int view = 0; view < NumberOfViews; view++)
+    {
+        QCOMPARE(store.view(view), createProbabilities(view, NumberOfVoxels));
+    }
+}
+
+void test_VoxelProbabilitiesPerViewStore::view_InHalfPrecision_ShouldReturnTheStoredProbabilitiesWithHalfPrecisionError_data()
+{
+    QTest::addColumn<float>("maximum");
+
+    // Without the scaling of each view to the half precision range the smallest values would underflow and the biggest ones would overflow
+    QTest::newRow("below the half precision range") << 1e-9f;
+    QTest::newRow("probabilities") << 1.0f;
+    QTest::newRow("above the half precision range") << 1e6f;
+    QTest::newRow("all zero") << 0.0f;
+}
+
+void test_VoxelProbabilitiesPerViewStore::view_InHalfPrecision_ShouldReturnTheStoredProbabilitiesWithHalfPrecisionError()
+{
+    QFETCH(float, maximum);
+
+    const int NumberOfVoxels = 1001;
+
+    // The first voxel is zero and the rest go from maximum / 1000 to maximum, so that once scaled they are normal half precision values
+    QVector<float> probabilities(NumberOfVoxels);
+    probabilities[0] = 0.0f;
+
+    for (int i = 1; i < NumberOfVoxels; i++)
+    {
+        probabilities[i] = maximum * i / (NumberOfVoxels - 1);
+    }
+
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    TestingVoxelProbabilitiesPerViewStore store(1, NumberOfVoxels, directory.path(), true, getChunkSize(1, NumberOfVoxels, true));
+    QVERIFY(store.isValid());
+    QVERIFY(store.isHalfPrecision());
+    QVERIFY(store.setView(0, probabilities));
+
+    QVector<float> storedProbabilities = store.view(0);
+    QCOMPARE(storedProbabilities.size(), NumberOfVoxels);
+
+    // Half precision floats have 11 significant bits, so rounding to them has a relative error of at most 2^-11, plus the error of the scaling
+    const float MaximumRelativeError = 1.0f / 1024.0f;
+
+    for (int i = 0; i < NumberOfVoxels; i++)
+    {
+        if (qAbs(storedProbabilities.at(i) - probabilities.at(i)) > probabilities.at(i) * MaximumRelativeError)
+        {
+            QFAIL(qPrintable(QString("Voxel %1: expected %2, got %3").arg(i).arg(probabilities.at(i)).arg(storedProbabilities.at(i))));
+        }
+    }
+}
+
+void test_VoxelProbabilitiesPerViewStore::BlockIterator_ShouldVisitTheVoxelsFromStartToEndInConsecutiveBlocks_data()
+{
+    QTest::addColumn<bool>("halfPrecision");
+    QTest::addColumn<int>("start");
+    QTest::addColumn<int>("end");
+    QTest::addColumn<QList<int> >("expectedBlockStarts");
+    QTest::addColumn<QList<int> >("expectedBlockSizes");
+
+    const int BlockSize = TestingVoxelProbabilitiesPerViewStore::BlockSize;
+    const int NumberOfVoxels = 2 * BlockSize + 1000;
+
+    for (int i = 0; i < 2; i++)
+    {
+        bool halfPrecision = i == 1;
+        QString precision = halfPrecision ? "fp16" : "fp32";
+
+        QTest::newRow(qPrintable(precision + ", whole view")) << halfPrecision << 0 << NumberOfVoxels
+                                                              << (QList<int>() << 0 << BlockSize << 2 * BlockSize)
+                                                              << (QList<int>() << BlockSize << BlockSize << 1000);
+        QTest::newRow(qPrintable(precision + ", one block")) << halfPrecision << 0 << BlockSize << (QList<int>() << 0) << (QList<int>() << BlockSize);
+        QTest::newRow(qPrintable(precision + ", across a multiple of the block size")) << halfPrecision << BlockSize - 100 << BlockSize + 100
+                                                                           << (QList<int>() << BlockSize - 100) << (QList<int>() << 200);
+        QTest::newRow(qPrintable(precision + ", from a voxel in a block to the end")) << halfPrecision << BlockSize + 1 << NumberOfVoxels
+                                                                                      << (QList<int>() << BlockSize + 1 << 2 * BlockSize + 1)
+                                                                                      << (QList<int>() << BlockSize << 999);
+        QTest::newRow(qPrintable(precision + ", last voxel")) << halfPrecision << NumberOfVoxels - 1 << NumberOfVoxels
+                                                              << (QList<int>() << NumberOfVoxels - 1) << (QList<int>() << 1);
+        QTest::newRow(qPrintable(precision + ", empty range")) << halfPrecision << 500 << 500 << QList<int>() << QList<int>();
+    }
+}
+
+void test_VoxelProbabilitiesPerViewStore::BlockIterator_ShouldVisitTheVoxelsFromStartToEndInConsecutiveBlocks()
+{
+    QFETCH(bool, halfPrecision);
+    QFETCH(int, start);
+    QFETCH(int, end);
+    QFETCH(QList<int>, expectedBlockStarts);
+    QFETCH(QList<int>, expectedBlockSizes);
+
+    // Two views per chunk, so that there are more chunks than the ones that are kept mapped when they are not used
+    const int NumberOfViews = 11;
+    const int NumberOfVoxels = 2 * TestingVoxelProbabilitiesPerViewStore::BlockSize + 1000;
+
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    TestingVoxelProbabilitiesPerViewStore store(NumberOfViews, NumberOfVoxels, directory.path(), halfPrecision,
+                                                getChunkSize(2, NumberOfVoxels, halfPrecision));
+    QVERIFY(store.isValid());
+
+    for (int view = 0; view < NumberOfViews; view++)
+    {
+        QVERIFY(store.setView(view, createProbabilities(view, NumberOfVoxels)));
+    }
+
+    // All the iterators are created first, so that the chunks of all the views have to stay mapped at the same time
+    QList<VoxelProbabilitiesPerViewStore::BlockIterator*> iterators;
+
+    for (int view = 0; view < NumberOfViews; view++)
+    {
+        iterators << new VoxelProbabilitiesPerViewStore::BlockIterator(store, view, start, end);
+    }
+
+    for (int view = 0; view < NumberOfViews; view++)
+    {
+        // In half precision the blocks must have the same values as the whole view, and in single precision the same values as the stored ones
+        QVector<float> expectedProbabilities = halfPrecision ? store.view(view) : createProbabilities(view, NumberOfVoxels);
+        VoxelProbabilitiesPerViewStore::BlockIterator *iterator = iterators.at(view);
+        QList<int> blockStarts, blockSizes;
+
+        for (; !iterator->atEnd(); iterator->next())
+        {
+            blockStarts << iterator->blockStart();
+            blockSizes << iterator->blockSize();
+
+            for (int i = 0; i < iterator->blockSize(); i++)
+            {
+                if (iterator->block()[i] != expectedProbabilities.at(iterator->blockStart() + i))
+                {
+                    qDeleteAll(iterators);
+                    QFAIL(qPrintable(QString("View %1, voxel %2: expected %3, got %4").arg(view).arg(iterator->blockStart() + i)
+                                     .arg(expectedProbabilities.at(iterator->blockStart() + i)).arg(iterator->block()[i])));
+                }
+            }
+        }
+
+        if (blockStarts != expectedBlockStarts || blockSizes != expectedBlockSizes)
+        {
+            qDeleteAll(iterators);
+            QFAIL(qPrintable(QString("View %1: unexpected blocks").arg(view)));
+        }
+    }
+
+    qDeleteAll(iterators);
+}
+
+QVector<float> test_VoxelProbabilitiesPerViewStore::createProbabilities(int view, int numberOfVoxels)
+{
+    QVector<float> probabilities(numberOfVoxels);
+
+    for (int i = 0; i < numberOfVoxels; i++)
+    {
+        probabilities[i] = (view + 1) * (1 + i % 997) / 997.0f / numberOfVoxels;
+    }
+
+    return probabilities;
+}
+
+qint64 test_VoxelProbabilitiesPerViewStore::getChunkSize(int numberOfViews, int numberOfVoxels, bool halfPrecision)
+{
+    return static_cast<qint64>(numberOfViews) * numberOfVoxels * (halfPrecision ? sizeof(unsigned short) : sizeof(float));
+}
+
+DECLARE_TEST(test_VoxelProbabilitiesPerViewStore)
+
+#include "test_voxelprobabilitiesperviewstore.moc"
@@ -7,8 +7,17 @@ SOURCES += $$PWD/test_dicommask.cpp \
            $$PWD/test_echotopacs.cpp \
            $$PWD/test_echotopacstest.cpp \
            $$PWD/test_dicomdirburningapplicationtest.cpp \
+           $$PWD/test_converttodicomdir.cpp \
            $$PWD//test_pacsdevice.cpp \
            $$PWD/test_cachetest.cpp \
            $$PWD/test_senddicomfilestopacs.cpp \
            $$PWD/test_databaseconnection.cpp \
-           $$PWD/test_localdatabasebasedal.cpp
+           $$PWD/test_localdatabasebasedal.cpp \
+           $$PWD/test_localdatabasestudydal.cpp \
+           $$PWD/test_localdatabaseimagedal.cpp \
+           $$PWD/test_localdatabasedisplayshutterdal.cpp \
+           $$PWD/test_localdatabasevoilutdal.cpp \
+           $$PWD/test_localdatabasemanager.cpp \
+           $$PWD/test_retrievedicomfilesfrompacsqueuepolicy.cpp \
+           $$PWD/test_thumbnailcache.cpp \
+           $$PWD/test_retrievedicomfilesfrompacs.cpp
@@ -0,0 +1,214 @@
+#include "autotest.h"
+#include "converttodicomdir.h"
+
+#include "image.h"
+#include "status.h"
+#include "testingconverttodicomdir.h"
+
+#include <QDir>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QThreadPool>
+
+#include <dcdeftag.h>
+#include <dcfilefo.h>
+#include <dcuid.h>
+
+using namespace udg;
+using namespace testing;
+
+class test_ConvertToDicomdir : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void addImagesToCopy_ShouldNameEachFileInOrderOnlyOnce_data();
+    void addImagesToCopy_ShouldNameEachFileInOrderOnlyOnce();
+
+    void addImagesToCopy_CalledForSeveralSeries_ShouldNumberTheFilesOfEachSeriesFromOne();
+
+    void copyImagesToDicomdirPath_Benchmark_data();
+    void copyImagesToDicomdirPath_Benchmark();
+
+private:
+    /// Returns new images with the given paths, which are deleted at cleanup. Consecutive images with the same path are frames of the same multiframe file.
+    QList<Image*> createImages(const QStringList &paths);
+    /// Returns the expected paths of the given number of images copied to the given series directory.
+    static QStringList getExpectedDestinationFiles(const QString &seriesPath, int numberOfFiles);
+    /// Creates a big endian DICOM file with a square image of the given size in the given directory and returns its path.
+    static QString createDICOMFile(const QTemporaryDir &directory, int instanceNumber, int size);
+
+private:
+    QList<Image*> m_images;
+    int m_originalMaximumThreadCount;
+};
+
+void test_ConvertToDicomdir::init()
+{
+    m_originalMaximumThreadCount = QThreadPool::globalInstance()->maxThreadCount();
+}
+
+void test_ConvertToDicomdir::cleanup()
+{
+    qDeleteAll(m_images);
+    m_images.clear();
+    QThreadPool::globalInstance()->setMaxThreadCount(m_originalMaximumThreadCount);
+}
+
+void test_ConvertToDicomdir::addImagesToCopy_ShouldNameEachFileInOrderOnlyOnce_data()
+{
+    QTest::addColumn<QStringList>("imagePaths");
+    QTest::addColumn<QStringList>("expectedSourceFiles");
+
+    QTest::newRow("no images") << QStringList() << QStringList();
+    QTest::newRow("single-frame images") << (QStringList() << "/a" << "/b" << "/c") << (QStringList() << "/a" << "/b" << "/c");
+    QTest::newRow("multiframe image") << (QStringList() << "/a" << "/a" << "/a") << (QStringList() << "/a");
+    QTest::newRow("multiframe image between single-frame images") << (QStringList() << "/a" << "/b" << "/b" << "/b" << "/c")
+                                                                   << (QStringList() << "/a" << "/b" << "/c");
+    QTest::newRow("consecutive multiframe images") << (QStringList() << "/a" << "/a" << "/b" << "/b") << (QStringList() << "/a" << "/b");
+}
+
+void test_ConvertToDicomdir::addImagesToCopy_ShouldNameEachFileInOrderOnlyOnce()
+{
+    QFETCH(QStringList, imagePaths);
+    QFETCH(QStringList, expectedSourceFiles);
+
+    TestingConvertToDicomdir convertToDicomdir;
+    convertToDicomdir.setSeriesPath("/DICOM/PAT00000/STU00000/SER00000");
+    convertToDicomdir.addImagesToCopy(createImages(imagePaths));
+
+    QCOMPARE(convertToDicomdir.getSourceFilesToCopy(), expectedSourceFiles);
+    QCOMPARE(convertToDicomdir.getDestinationFilesToCopy(), getExpectedDestinationFiles("/DICOM/PAT00000/STU00000/SER00000", expectedSourceFiles.size()));
+}
+
+void test_ConvertToDicomdir::addImagesToCopy_CalledForSeveralSeries_ShouldNumberTheFilesOfEachSeriesFromOne()
+{
+    TestingConvertToDicomdir convertToDicomdir;
+    convertToDicomdir.setSeriesPath("/DICOM/PAT00000/STU00000/SER00000");
+    convertToDicomdir.addImagesToCopy(createImages(QStringList() << "/a" << "/a" << "/b"));
+    convertToDicomdir.setSeriesPath("/DICOM/PAT00000/STU00000/SER00001");
+    convertToDicomdir.addImagesToCopy(createImages(QStringList() << "/c" << "/d"));
+
+    QCOMPARE(convertToDicomdir.getSourceFilesToCopy(), QStringList() << "/a" << "/b" << "/c" << "/d");
+    QCOMPARE(convertToDicomdir.getDestinationFilesToCopy(), getExpectedDestinationFiles("/DICOM/PAT00000/STU00000/SER00000", 2)
+                                                              + getExpectedDestinationFiles("/DICOM/PAT00000/STU00000/SER00001", 2));
+}
+
+void test_ConvertToDicomdir::copyImagesToDicomdirPath_Benchmark_data()
+{
+    QTest::addColumn<bool>("convertToLittleEndian");
+    QTest::addColumn<int>("maximumThreadCount");
+
+    QTest::newRow("copy, sequential") << false << 1;
+    QTest::newRow("copy, parallel") << false << QThread::idealThreadCount();
+    QTest::newRow("little endian, sequential") << true << 1;
+    QTest::newRow("little endian, parallel") << true << QThread::idealThreadCount();
+}
+
+void test_ConvertToDicomdir::copyImagesToDicomdirPath_Benchmark()
+{
+    QFETCH(bool, convertToLittleEndian);
+    QFETCH(int, maximumThreadCount);
+
+    const int NumberOfFiles = 100;
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    QStringList paths;
+
+    for (int i = 0; i < NumberOfFiles; i++)
+    {
+        paths << createDICOMFile(directory, i + 1, 512);
+    }
+
+    QList<Image*> images = createImages(paths);
+
+    // The files are copied by the global thread pool, so limiting it to one thread copies them sequentially
+    QThreadPool::globalInstance()->setMaxThreadCount(maximumThreadCount);
+
+    TestingConvertToDicomdir convertToDicomdir;
+    convertToDicomdir.setConvertDicomdirImagesToLittleEndian(convertToLittleEndian);
+    int iteration = 0;
+    QString seriesPath;
+
+    QBENCHMARK
+    {
+        // Existing files are not overwritten, so each iteration copies the files to a new series directory
+        seriesPath = QString("%1/SER%2").arg(directory.path()).arg(iteration++, 5, 10, QChar('0'));
+        QVERIFY(QDir().mkpath(seriesPath));
+
+        convertToDicomdir.setSeriesPath(seriesPath);
+        convertToDicomdir.addImagesToCopy(images);
+        Status status = convertToDicomdir.copyImagesToDicomdirPath();
+        QVERIFY(status.good());
+    }
+
+    QCOMPARE(QDir(seriesPath).entryList(QDir::Files).size(), NumberOfFiles);
+}
+
+QList<Image*> test_ConvertToDicomdir::createImages(const QStringList &paths)
+{
+    QList<Image*> images;
+
+    foreach (const QString &path, paths)
+    {
+        Image *image = new Image();
+        image->setPath(path);
+        images << image;
+    }
+
+    m_images.append(images);
+
+    return images;
+}
+
+QStringList test_ConvertToDicomdir::getExpectedDestinationFiles(const QString &seriesPath, int numberOfFiles)
+{
+    QStringList files;
+
+    for (int i = 1; i <= numberOfFiles; i++)
+    {
+        files << QString("%1/IMG%2").arg(seriesPath).arg(i, 5, 10, QChar('0'));
+    }
+
+    return files;
+}
+
+QString test_ConvertToDicomdir::createDICOMFile(const QTemporaryDir &directory, int instanceNumber, int size)
+{
+    DcmFileFormat fileFormat;
+    DcmDataset *dataset = fileFormat.getDataset();
+    QString sopInstanceUID = QString("1.2.3.4.5.1.%1").arg(instanceNumber);
+
+    dataset->putAndInsertString(DCM_SOPClassUID, UID_CTImageStorage);
+    dataset->putAndInsertString(DCM_SOPInstanceUID, qPrintable(sopInstanceUID));
+    dataset->putAndInsertString(DCM_StudyInstanceUID, "1.2.3.4");
+    dataset->putAndInsertString(DCM_SeriesInstanceUID, "1.2.3.4.5.1");
+    dataset->putAndInsertString(DCM_PatientName, "JOHN^DOE");
+    dataset->putAndInsertString(DCM_Modality, "CT");
+    dataset->putAndInsertString(DCM_InstanceNumber, qPrintable(QString::number(instanceNumber)));
+    dataset->putAndInsertUint16(DCM_SamplesPerPixel, 1);
+    dataset->putAndInsertString(DCM_PhotometricInterpretation, "MONOCHROME2");
+    dataset->putAndInsertUint16(DCM_Rows, static_cast<Uint16>(size));
+    dataset->putAndInsertUint16(DCM_Columns, static_cast<Uint16>(size));
+    dataset->putAndInsertUint16(DCM_BitsAllocated, 16);
+    dataset->putAndInsertUint16(DCM_BitsStored, 16);
+    dataset->putAndInsertUint16(DCM_HighBit, 15);
+    dataset->putAndInsertUint16(DCM_PixelRepresentation, 0);
+
+    QVector<Uint16> pixels(size * size, static_cast<Uint16>(instanceNumber));
+    dataset->putAndInsertUint16Array(DCM_PixelData, pixels.data(), pixels.size());
+
+    // Big endian, so that converting the files to little endian has to rewrite them
+    QString path = QString("%1/%2.dcm").arg(directory.path()).arg(sopInstanceUID);
+    fileFormat.saveFile(qPrintable(path), EXS_BigEndianExplicit);
+
+    return path;
+}
+
+DECLARE_TEST(test_ConvertToDicomdir)
+
+#include "test_converttodicomdir.moc"
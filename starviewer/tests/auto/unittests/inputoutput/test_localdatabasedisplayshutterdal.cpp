@@ -0,0 +1,156 @@
+#include "autotest.h"
+#include "localdatabasedisplayshutterdal.h"
+
+#include "databaseconnection.h"
+#include "databasetesthelper.h"
+#include "dicommask.h"
+#include "displayshutter.h"
+#include "image.h"
+#include "patient.h"
+#include "series.h"
+#include "study.h"
+
+using namespace udg;
+using namespace testing;
+
+namespace {
+
+// Returns the given shutters as strings, so that they can be compared
+QStringList toStrings(const QList<DisplayShutter> &shutters)
+{
+    QStringList strings;
+
+    foreach (const DisplayShutter &shutter, shutters)
+    {
+        strings << QString("%1 %2 %3").arg(shutter.getShapeAsDICOMString()).arg(shutter.getShutterValue()).arg(shutter.getPointsAsString());
+    }
+
+    return strings;
+}
+
+}
+
+class test_LocalDatabaseDisplayShutterDAL : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void queryGroupedByImage_ShouldReturnTheSameShuttersAsQueryingEachImage_data();
+    void queryGroupedByImage_ShouldReturnTheSameShuttersAsQueryingEachImage();
+
+private:
+    DatabaseConnection *m_databaseConnection;
+    QList<Patient*> m_patients;
+};
+
+void test_LocalDatabaseDisplayShutterDAL::init()
+{
+    m_databaseConnection = DatabaseTestHelper::getCreatedDatabase();
+    m_patients << DatabaseTestHelper::createPatientWithStudy("1.1", 2, 3) << DatabaseTestHelper::createPatientWithStudy("1.2", 1, 2);
+
+    // A second frame of the first image, so that images are told apart by frame number too
+    Series *firstSeries = m_patients.first()->getStudies().first()->getSeries().first();
+    Image *secondFrame = new Image();
+    secondFrame->setSOPInstanceUID(firstSeries->getImages().first()->getSOPInstanceUID());
+    secondFrame->setFrameNumber(1);
+    firstSeries->addImage(secondFrame);
+
+    LocalDatabaseDisplayShutterDAL shutterDAL(*m_databaseConnection);
+    int imageIndex = 0;
+
+    foreach (Patient *patient, m_patients)
+    {
+        Study *study = patient->getStudies().first();
+        QVERIFY(DatabaseTestHelper::insertStudy(*m_databaseConnection, study));
+
+        foreach (Series *series, study->getSeries())
+        {
+            foreach (Image *image, series->getImages())
+            {
+                // 0, 1 or 2 different shutters per image
+                for (int i = 0; i < imageIndex % 3; i++)
+                {
+                    DisplayShutter shutter;
+                    shutter.setPoints(QPoint(imageIndex, i), QPoint(imageIndex + 10, i + 10));
+                    shutter.setShutterValue(static_cast<unsigned short>(imageIndex));
+                    QVERIFY(shutterDAL.insert(shutter, image));
+                }
+
+                imageIndex++;
+            }
+        }
+    }
+}
+
+void test_LocalDatabaseDisplayShutterDAL::cleanup()
+{
+    qDeleteAll(m_patients);
+    m_patients.clear();
+    delete m_databaseConnection;
+}
+
+void test_LocalDatabaseDisplayShutterDAL::queryGroupedByImage_ShouldReturnTheSameShuttersAsQueryingEachImage_data()
+{
+    QTest::addColumn<QString>("studyInstanceUID");
+    QTest::addColumn<QString>("seriesInstanceUID");
+
+    QTest::newRow("study with a multiframe image") << QString("1.1") << QString();
+    QTest::newRow("series with a multiframe image") << QString("1.1") << QString("1.1.1");
+    QTest::newRow("series") << QString("1.1") << QString("1.1.2");
+    QTest::newRow("another study") << QString("1.2") << QString();
+}
+
+void test_LocalDatabaseDisplayShutterDAL::queryGroupedByImage_ShouldReturnTheSameShuttersAsQueryingEachImage()
+{
+    QFETCH(QString, studyInstanceUID);
+    QFETCH(QString, seriesInstanceUID);
+
+    DicomMask mask;
+    mask.setStudyInstanceUID(studyInstanceUID);
+    mask.setSeriesInstanceUID(seriesInstanceUID);
+
+    LocalDatabaseDisplayShutterDAL shutterDAL(*m_databaseConnection);
+    QHash<LocalDatabaseBaseDAL::ImageKey, QList<DisplayShutter> > shuttersByImage = shutterDAL.queryGroupedByImage(mask);
+    QVERIFY(!shutterDAL.getLastError().isValid());
+
+    int numberOfImagesWithShutters = 0;
+
+    foreach (Patient *patient, m_patients)
+    {
+        foreach (Series *series, patient->getStudies().first()->getSeries())
+        {
+            if (series->getParentStudy()->getInstanceUID() != studyInstanceUID ||
+                (!seriesInstanceUID.isEmpty() && series->getInstanceUID() != seriesInstanceUID))
+            {
+                continue;
+            }
+
+            foreach (Image *image, series->getImages())
+            {
+                // The query that was done for each image before
+                DicomMask imageMask;
+                imageMask.setSOPInstanceUID(image->getSOPInstanceUID());
+                imageMask.setImageNumber(QString::number(image->getFrameNumber()));
+                QList<DisplayShutter> expectedShutters = shutterDAL.query(imageMask);
+
+                LocalDatabaseBaseDAL::ImageKey imageKey(image->getSOPInstanceUID(), image->getFrameNumber());
+                QCOMPARE(toStrings(shuttersByImage.value(imageKey)), toStrings(expectedShutters));
+
+                if (!expectedShutters.isEmpty())
+                {
+                    numberOfImagesWithShutters++;
+                }
+            }
+        }
+    }
+
+    // No shutters of images outside the mask
+    QCOMPARE(shuttersByImage.size(), numberOfImagesWithShutters);
+}
+
+DECLARE_TEST(test_LocalDatabaseDisplayShutterDAL)
+
+#include "test_localdatabasedisplayshutterdal.moc"
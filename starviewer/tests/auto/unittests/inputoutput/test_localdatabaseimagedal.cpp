@@ -0,0 +1,236 @@
+#include "autotest.h"
+#include "localdatabaseimagedal.h"
+
+#include "databaseconnection.h"
+#include "databasetesthelper.h"
+#include "dicommask.h"
+#include "image.h"
+#include "patient.h"
+#include "series.h"
+#include "study.h"
+
+#include <QSqlQuery>
+#include <QSqlRecord>
+
+using namespace udg;
+using namespace testing;
+
+typedef QSet<LocalDatabaseBaseDAL::ImageKey> ImageKeySet;
+
+Q_DECLARE_METATYPE(ImageKeySet)
+
+class test_LocalDatabaseImageDAL : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void insert_ImageList_ShouldInsertAllTheImages_data();
+    void insert_ImageList_ShouldInsertAllTheImages();
+
+    void insert_ImageList_ShouldStoreTheSameValuesAsInsertingEachImage();
+
+    void queryKeys_ShouldReturnTheKeysOfTheImagesThatMatchTheMask_data();
+    void queryKeys_ShouldReturnTheKeysOfTheImagesThatMatchTheMask();
+
+private:
+    /// Returns a new image of the given series with the given SOP Instance UID and frame number and with the rest of values derived from the given index.
+    static Image* createImage(Series *series, const QString &sopInstanceUID, int index, int frameNumber = 0);
+    /// Returns the values of all the columns but SOPInstanceUID of the images in the database with the given SOP Instance UID.
+    QList<QVariantList> queryValuesWithoutSOPInstanceUID(const QString &sopInstanceUID);
+
+private:
+    DatabaseConnection *m_databaseConnection;
+    Patient *m_patient;
+};
+
+void test_LocalDatabaseImageDAL::init()
+{
+    m_databaseConnection = DatabaseTestHelper::getCreatedDatabase();
+    m_patient = DatabaseTestHelper::createPatientWithStudy("1.1", 2, 0);
+    QVERIFY(DatabaseTestHelper::insertStudy(*m_databaseConnection, m_patient->getStudies().first()));
+}
+
+void test_LocalDatabaseImageDAL::cleanup()
+{
+    delete m_patient;
+    delete m_databaseConnection;
+}
+
+void test_LocalDatabaseImageDAL::insert_ImageList_ShouldInsertAllTheImages_data()
+{
+    QTest::addColumn<int>("numberOfImages");
+
+    // Images are inserted in batches of 25
+    QTest::newRow("no images") << 0;
+    QTest::newRow("1 image") << 1;
+    QTest::newRow("a full batch") << 25;
+    QTest::newRow("a full batch and 1 image") << 26;
+    QTest::newRow("two full batches and 1 image") << 51;
+}
+
+void test_LocalDatabaseImageDAL::insert_ImageList_ShouldInsertAllTheImages()
+{
+    QFETCH(int, numberOfImages);
+
+    Series *series = m_patient->getStudies().first()->getSeries().first();
+    QList<Image*> images;
+    ImageKeySet expectedKeys;
+
+    for (int i = 0; i < numberOfImages; i++)
+    {
+        Image *image = createImage(series, QString("%1.%2").arg(series->getInstanceUID()).arg(i + 1), i);
+        images << image;
+        expectedKeys.insert(LocalDatabaseBaseDAL::ImageKey(image->getSOPInstanceUID(), image->getFrameNumber()));
+    }
+
+    LocalDatabaseImageDAL imageDAL(*m_databaseConnection);
+    QVERIFY(imageDAL.insert(images));
+
+    DicomMask mask;
+    mask.setStudyInstanceUID("1.1");
+    QCOMPARE(imageDAL.queryKeys(mask), expectedKeys);
+    QVERIFY(!imageDAL.getLastError().isValid());
+}
+
+void test_LocalDatabaseImageDAL::insert_ImageList_ShouldStoreTheSameValuesAsInsertingEachImage()
+{
+    Series *series = m_patient->getStudies().first()->getSeries().first();
+    QList<Image*> images;
+    LocalDatabaseImageDAL imageDAL(*m_databaseConnection);
+
+    // More than a batch, so that the values of the images of both batches are checked
+    for (int i = 0; i < 26; i++)
+    {
+        images << createImage(series, QString("1.1.1.%1").arg(i + 1), i);
+        QVERIFY(imageDAL.insert(createImage(series, QString("1.1.1.%1.1").arg(i + 1), i)));
+    }
+
+    QVERIFY(imageDAL.insert(images));
+
+    for (int i = 0; i < images.size(); i++)
+    {
+        QList<QVariantList> values = queryValuesWithoutSOPInstanceUID(QString("1.1.1.%1").arg(i + 1));
+        QCOMPARE(values.size(), 1);
+        QCOMPARE(values, queryValuesWithoutSOPInstanceUID(QString("1.1.1.%1.1").arg(i + 1)));
+    }
+}
+
+void test_LocalDatabaseImageDAL::queryKeys_ShouldReturnTheKeysOfTheImagesThatMatchTheMask_data()
+{
+    QTest::addColumn<QString>("studyInstanceUID");
+    QTest::addColumn<QString>("seriesInstanceUID");
+    QTest::addColumn<QString>("sopInstanceUID");
+    QTest::addColumn<ImageKeySet>("expectedKeys");
+
+    typedef LocalDatabaseBaseDAL::ImageKey ImageKey;
+    ImageKeySet firstSeriesKeys = ImageKeySet() << ImageKey("1.1.1.1", 0) << ImageKey("1.1.1.1", 1) << ImageKey("1.1.1.2", 0);
+    ImageKeySet secondSeriesKeys = ImageKeySet() << ImageKey("1.1.2.1", 0) << ImageKey("1.1.2.2", 0) << ImageKey("1.1.2.3", 0);
+
+    QTest::newRow("study") << QString("1.1") << QString() << QString() << (firstSeriesKeys | secondSeriesKeys);
+    QTest::newRow("series with a multiframe image") << QString("1.1") << QString("1.1.1") << QString() << firstSeriesKeys;
+    QTest::newRow("series") << QString() << QString("1.1.2") << QString() << secondSeriesKeys;
+    QTest::newRow("multiframe image") << QString() << QString() << QString("1.1.1.1") << (ImageKeySet() << ImageKey("1.1.1.1", 0) << ImageKey("1.1.1.1", 1));
+    QTest::newRow("image of another series") << QString() << QString("1.1.1") << QString("1.1.2.1") << ImageKeySet();
+    QTest::newRow("unknown study") << QString("1.2") << QString() << QString() << ImageKeySet();
+}
+
+void test_LocalDatabaseImageDAL::queryKeys_ShouldReturnTheKeysOfTheImagesThatMatchTheMask()
+{
+    QFETCH(QString, studyInstanceUID);
+    QFETCH(QString, seriesInstanceUID);
+    QFETCH(QString, sopInstanceUID);
+    QFETCH(ImageKeySet, expectedKeys);
+
+    Series *firstSeries = m_patient->getStudies().first()->getSeries().at(0);
+    Series *secondSeries = m_patient->getStudies().first()->getSeries().at(1);
+
+    QList<Image*> images;
+    images << createImage(firstSeries, "1.1.1.1", 0) << createImage(firstSeries, "1.1.1.1", 1, 1) << createImage(firstSeries, "1.1.1.2", 2);
+    images << createImage(secondSeries, "1.1.2.1", 3) << createImage(secondSeries, "1.1.2.2", 4) << createImage(secondSeries, "1.1.2.3", 5);
+
+    LocalDatabaseImageDAL imageDAL(*m_databaseConnection);
+    QVERIFY(imageDAL.insert(images));
+
+    DicomMask mask;
+    mask.setStudyInstanceUID(studyInstanceUID);
+    mask.setSeriesInstanceUID(seriesInstanceUID);
+    mask.setSOPInstanceUID(sopInstanceUID);
+
+    QCOMPARE(imageDAL.queryKeys(mask), expectedKeys);
+    QVERIFY(!imageDAL.getLastError().isValid());
+}
+
+Image* test_LocalDatabaseImageDAL::createImage(Series *series, const QString &sopInstanceUID, int index, int frameNumber)
+{
+    Image *image = new Image();
+    image->setSOPInstanceUID(sopInstanceUID);
+    image->setFrameNumber(frameNumber);
+    image->setInstanceNumber(QString::number(index + 1));
+    image->setPixelSpacing(0.5 + index, 0.25 + index);
+    image->setImagerPixelSpacing(0.75 + index, 0.5 + index);
+    image->setEstimatedRadiographicMagnificationFactor(1.0 + index / 10.0);
+    image->setSliceThickness(1.5 + index);
+    double imagePositionPatient[3] = { 1.0 * index, 2.0 * index, 3.0 * index };
+    image->setImagePositionPatient(imagePositionPatient);
+    image->setSamplesPerPixel(1);
+    image->setPhotometricInterpretation("MONOCHROME2");
+    image->setRows(512 + index);
+    image->setColumns(256 + index);
+    image->setBitsAllocated(16);
+    image->setBitsStored(12);
+    image->setPixelRepresentation(index % 2);
+    image->setRescaleSlope(1.0 + index);
+    image->setRescaleIntercept(-1024.0 + index);
+    image->setSliceLocation(QString::number(index * 2.5));
+    image->setRetrievedDate(QDate(2020, 1, 1).addDays(index));
+    image->setRetrievedTime(QTime(10, 0).addSecs(index));
+    image->setImageType(QString("ORIGINAL\\PRIMARY\\AXIAL%1").arg(index));
+    image->setViewPosition(index % 2 ? "CC" : "MLO");
+    image->setImageLaterality(index % 2 ? QChar('L') : QChar('R'));
+    image->setViewCodeMeaning(QString("view %1").arg(index));
+    image->setPhaseNumber(index % 3);
+    image->setVolumeNumberInSeries(index % 4);
+    image->setOrderNumberInVolume(index);
+    image->setImageTime(QString("1200%1").arg(index, 2, 10, QChar('0')));
+    image->setTransferSyntaxUID("1.2.840.10008.1.2.1");
+    image->setNumberOfOverlays(static_cast<unsigned short>(index % 2));
+    series->addImage(image);
+
+    return image;
+}
+
+QList<QVariantList> test_LocalDatabaseImageDAL::queryValuesWithoutSOPInstanceUID(const QString &sopInstanceUID)
+{
+    QSqlQuery query(m_databaseConnection->getConnection());
+    query.prepare("SELECT * FROM Image WHERE SOPInstanceUID = :sopInstanceUID");
+    query.bindValue(":sopInstanceUID", sopInstanceUID);
+    QList<QVariantList> rows;
+
+    if (query.exec())
+    {
+        while (query.next())
+        {
+            QSqlRecord record = query.record();
+            QVariantList values;
+
+            for (int i = 0; i < record.count(); i++)
+            {
+                if (record.fieldName(i) != "SOPInstanceUID")
+                {
+                    values << record.value(i);
+                }
+            }
+
+            rows << values;
+        }
+    }
+
+    return rows;
+}
+
+DECLARE_TEST(test_LocalDatabaseImageDAL)
+
+#include "test_localdatabaseimagedal.moc"
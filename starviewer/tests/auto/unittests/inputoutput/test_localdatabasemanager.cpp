@@ -0,0 +1,282 @@
+#include "autotest.h"
+#include "localdatabasemanager.h"
+
+#include "databaseconnection.h"
+#include "databaseinstallation.h"
+#include "databasetesthelper.h"
+#include "dicommask.h"
+#include "displayshutter.h"
+#include "image.h"
+#include "inputoutputsettings.h"
+#include "localdatabasedisplayshutterdal.h"
+#include "localdatabasestudydal.h"
+#include "localdatabasevoilutdal.h"
+#include "patient.h"
+#include "series.h"
+#include "settings.h"
+#include "study.h"
+#include "voilut.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+using namespace udg;
+using namespace testing;
+
+class TestingLocalDatabaseManager : public LocalDatabaseManager {
+public:
+    using LocalDatabaseManager::deleteLeastValuableStudies;
+};
+
+class test_LocalDatabaseManager : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void retrieve_Benchmark_data();
+    void retrieve_Benchmark();
+
+    void deleteLeastValuableStudies_ShouldDeleteStudiesInOrderUntilEnoughSpaceIsFreed_data();
+    void deleteLeastValuableStudies_ShouldDeleteStudiesInOrderUntilEnoughSpaceIsFreed();
+
+private:
+    /// Saves in the database of the temporary directory a study with the given UID and number of series and images per series, with a display shutter
+    /// and a VOI LUT in each image. Returns true if successful and false otherwise.
+    bool saveStudy(const QString &studyInstanceUID, int numberOfSeries, int numberOfImagesPerSeries);
+    /// Saves in the database of the temporary directory the given number of studies, each one with the given size and accessed one day after the previous
+    /// one, and creates their directories in the cache. Returns the UIDs of the studies in the order they were accessed.
+    QStringList saveStudiesAccessedOnConsecutiveDays(int numberOfStudies, qint64 sizeInBytes);
+
+private:
+    QTemporaryDir *m_directory;
+    QHash<QString, QVariant> m_originalSettings;
+};
+
+void test_LocalDatabaseManager::init()
+{
+    m_directory = new QTemporaryDir();
+    QVERIFY(m_directory->isValid());
+
+    // The database, the cache and the thumbnails are all kept in the temporary directory
+    QHash<QString, QString> testSettings;
+    testSettings[InputOutputSettings::DatabaseAbsoluteFilePath] = m_directory->path() + "/database.sqlite";
+    testSettings[InputOutputSettings::CachePath] = m_directory->path() + "/cache/";
+    testSettings[InputOutputSettings::ThumbnailCachePath] = m_directory->path() + "/thumbnails/";
+
+    Settings settings;
+
+    foreach (const QString &key, testSettings.keys())
+    {
+        m_originalSettings[key] = settings.getValue(key);
+        settings.setValue(key, testSettings.value(key));
+    }
+}
+
+void test_LocalDatabaseManager::cleanup()
+{
+    Settings settings;
+
+    foreach (const QString &key, m_originalSettings.keys())
+    {
+        settings.setValue(key, m_originalSettings.value(key));
+    }
+
+    m_originalSettings.clear();
+    delete m_directory;
+}
+
+void test_LocalDatabaseManager::retrieve_Benchmark_data()
+{
+    QTest::addColumn<int>("numberOfSeries");
+    QTest::addColumn<int>("numberOfImagesPerSeries");
+
+    QTest::newRow("1 series of 100 images") << 1 << 100;
+    QTest::newRow("4 series of 250 images") << 4 << 250;
+    QTest::newRow("10 series of 500 images") << 10 << 500;
+}
+
+void test_LocalDatabaseManager::retrieve_Benchmark()
+{
+    QFETCH(int, numberOfSeries);
+    QFETCH(int, numberOfImagesPerSeries);
+
+    QString studyInstanceUID("1.2.3");
+    QVERIFY(saveStudy(studyInstanceUID, numberOfSeries, numberOfImagesPerSeries));
+
+    DicomMask mask;
+    mask.setStudyInstanceUID(studyInstanceUID);
+    LocalDatabaseManager localDatabaseManager;
+
+    QBENCHMARK
+    {
+        Patient *patient = localDatabaseManager.retrieve(mask);
+        QVERIFY(patient);
+        QCOMPARE(localDatabaseManager.getLastError(), LocalDatabaseManager::Ok);
+
+        Study *study = patient->getStudy(studyInstanceUID);
+        QVERIFY(study);
+        QCOMPARE(study->getNumberOfSeries(), numberOfSeries);
+        QCOMPARE(study->getSeries().first()->getImages().size(), numberOfImagesPerSeries);
+
+        delete patient;
+    }
+}
+
+void test_LocalDatabaseManager::deleteLeastValuableStudies_ShouldDeleteStudiesInOrderUntilEnoughSpaceIsFreed_data()
+{
+    QTest::addColumn<qint64>("bytesToFree");
+    QTest::addColumn<int>("expectedNumberOfDeletedStudies");
+
+    // There are 120 studies of 1000 bytes, and studies are deleted in batches of 50
+    QTest::newRow("nothing to free") << Q_INT64_C(0) << 0;
+    QTest::newRow("part of the first batch") << Q_INT64_C(30000) << 30;
+    QTest::newRow("part of a study") << Q_INT64_C(30500) << 31;
+    QTest::newRow("the whole first batch") << Q_INT64_C(50000) << 50;
+    QTest::newRow("part of the second batch") << Q_INT64_C(75000) << 75;
+    QTest::newRow("all the studies") << Q_INT64_C(-1) << 120;
+    QTest::newRow("more than all the studies") << Q_INT64_C(200000) << 120;
+}
+
+void test_LocalDatabaseManager::deleteLeastValuableStudies_ShouldDeleteStudiesInOrderUntilEnoughSpaceIsFreed()
+{
+    QFETCH(qint64, bytesToFree);
+    QFETCH(int, expectedNumberOfDeletedStudies);
+
+    const int NumberOfStudies = 120;
+    const qint64 StudySizeInBytes = 1000;
+    QStringList studyInstanceUIDs = saveStudiesAccessedOnConsecutiveDays(NumberOfStudies, StudySizeInBytes);
+    QCOMPARE(studyInstanceUIDs.size(), NumberOfStudies);
+
+    QStringList expectedDeletedStudies = studyInstanceUIDs.mid(0, expectedNumberOfDeletedStudies);
+    QStringList expectedRemainingStudies = studyInstanceUIDs.mid(expectedNumberOfDeletedStudies);
+
+    TestingLocalDatabaseManager localDatabaseManager;
+    QSignalSpy studyWillBeDeletedSpy(&localDatabaseManager, SIGNAL(studyWillBeDeleted(QString)));
+
+    QCOMPARE(localDatabaseManager.deleteLeastValuableStudies(QDate(), bytesToFree), expectedNumberOfDeletedStudies * StudySizeInBytes);
+    QCOMPARE(localDatabaseManager.getLastError(), LocalDatabaseManager::Ok);
+
+    QStringList deletedStudies;
+
+    for (int i = 0; i < studyWillBeDeletedSpy.count(); i++)
+    {
+        deletedStudies << studyWillBeDeletedSpy.at(i).at(0).toString();
+    }
+
+    QCOMPARE(deletedStudies, expectedDeletedStudies);
+
+    QStringList remainingStudies;
+
+    {
+        DatabaseConnection databaseConnection;
+        QList<QPair<QString, qint64> > studies = LocalDatabaseStudyDAL(databaseConnection).queryLeastValuable(QDate(), NumberOfStudies);
+
+        for (int i = 0; i < studies.size(); i++)
+        {
+            remainingStudies << studies.at(i).first;
+        }
+    }
+
+    QCOMPARE(remainingStudies, expectedRemainingStudies);
+
+    foreach (const QString &studyInstanceUID, expectedDeletedStudies)
+    {
+        QVERIFY(!QDir(LocalDatabaseManager::getStudyPath(studyInstanceUID)).exists());
+    }
+
+    foreach (const QString &studyInstanceUID, expectedRemainingStudies)
+    {
+        QVERIFY(QDir(LocalDatabaseManager::getStudyPath(studyInstanceUID)).exists());
+    }
+
+    // The directories of the deleted studies are moved out of the cache and deleted in the background
+    QTRY_VERIFY(QDir(LocalDatabaseManager::getCachePath() + ".deleted").entryList(QDir::AllEntries | QDir::NoDotAndDotDot).isEmpty());
+}
+
+bool test_LocalDatabaseManager::saveStudy(const QString &studyInstanceUID, int numberOfSeries, int numberOfImagesPerSeries)
+{
+    Patient *patient = DatabaseTestHelper::createPatientWithStudy(studyInstanceUID, numberOfSeries, numberOfImagesPerSeries);
+    Study *study = patient->getStudies().first();
+    bool ok = true;
+
+    {
+        DatabaseConnection databaseConnection;
+        ok = DatabaseInstallation().createDatabase(databaseConnection);
+
+        LocalDatabaseDisplayShutterDAL shutterDAL(databaseConnection);
+        LocalDatabaseVoiLutDAL voiLutDAL(databaseConnection);
+        databaseConnection.beginTransaction();
+
+        ok = ok && DatabaseTestHelper::insertStudy(databaseConnection, study);
+
+        foreach (Series *series, study->getSeries())
+        {
+            foreach (Image *image, series->getImages())
+            {
+                DisplayShutter shutter;
+                shutter.setPoints(QPoint(0, 0), QPoint(511, 511));
+
+                TransferFunction lut;
+                lut.set(0.0, Qt::black, 0.0);
+                lut.set(4095.0, Qt::white, 1.0);
+
+                ok = ok && shutterDAL.insert(shutter, image) && voiLutDAL.insert(VoiLut(lut), image);
+            }
+        }
+
+        databaseConnection.commitTransaction();
+    }
+
+    delete patient;
+
+    return ok;
+}
+
+QStringList test_LocalDatabaseManager::saveStudiesAccessedOnConsecutiveDays(int numberOfStudies, qint64 sizeInBytes)
+{
+    QStringList studyInstanceUIDs;
+    DatabaseConnection databaseConnection;
+
+    if (!DatabaseInstallation().createDatabase(databaseConnection))
+    {
+        return studyInstanceUIDs;
+    }
+
+    LocalDatabaseStudyDAL studyDAL(databaseConnection);
+    databaseConnection.beginTransaction();
+
+    for (int i = 0; i < numberOfStudies; i++)
+    {
+        QString studyInstanceUID = QString("1.2.%1").arg(i + 1);
+        Patient *patient = DatabaseTestHelper::createPatientWithStudy(studyInstanceUID, 1, 0);
+        bool ok = DatabaseTestHelper::insertStudy(databaseConnection, patient->getStudies().first(), QDate(2020, 1, 1).addDays(i)) &&
+                  studyDAL.updateSizeInBytes(studyInstanceUID, sizeInBytes);
+        delete patient;
+
+        QString studyPath = LocalDatabaseManager::getStudyPath(studyInstanceUID);
+        QFile file(studyPath + "/file.dcm");
+
+        ok = ok && QDir().mkpath(studyPath) && file.open(QIODevice::WriteOnly);
+        ok = ok && file.write(QByteArray(static_cast<int>(sizeInBytes), 0)) == sizeInBytes;
+
+        if (!ok)
+        {
+            break;
+        }
+
+        studyInstanceUIDs << studyInstanceUID;
+    }
+
+    databaseConnection.commitTransaction();
+
+    return studyInstanceUIDs;
+}
+
+DECLARE_TEST(test_LocalDatabaseManager)
+
+#include "test_localdatabasemanager.moc"
@@ -0,0 +1,214 @@
+#include "autotest.h"
+#include "localdatabasestudydal.h"
+
+#include "databaseconnection.h"
+#include "databasetesthelper.h"
+#include "patient.h"
+#include "study.h"
+
+using namespace udg;
+using namespace testing;
+
+typedef QList<QPair<QString, qint64> > StudySizeList;
+
+Q_DECLARE_METATYPE(StudySizeList)
+
+class test_LocalDatabaseStudyDAL : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void canUseFullTextSearch_ShouldReturnExpectedValue_data();
+    void canUseFullTextSearch_ShouldReturnExpectedValue();
+
+    void getFullTextQuery_ShouldReturnExpectedQuery_data();
+    void getFullTextQuery_ShouldReturnExpectedQuery();
+
+    void getContainsLikePattern_ShouldReturnExpectedPattern_data();
+    void getContainsLikePattern_ShouldReturnExpectedPattern();
+
+    void isStartsWithMask_ShouldReturnExpectedValue_data();
+    void isStartsWithMask_ShouldReturnExpectedValue();
+
+    void getStartsWithLikePattern_ShouldReturnExpectedPattern_data();
+    void getStartsWithLikePattern_ShouldReturnExpectedPattern();
+
+    void queryLeastValuable_ShouldReturnTheLeastRecentlyAccessedAndBiggestStudiesFirst_data();
+    void queryLeastValuable_ShouldReturnTheLeastRecentlyAccessedAndBiggestStudiesFirst();
+
+};
+
+void test_LocalDatabaseStudyDAL::canUseFullTextSearch_ShouldReturnExpectedValue_data()
+{
+    QTest::addColumn<QString>("value");
+    QTest::addColumn<bool>("expectedValue");
+
+    QTest::newRow("word without wildcard") << QString("sol") << false;
+    QTest::newRow("words without wildcard") << QString("sol mar") << false;
+    QTest::newRow("word with trailing *") << QString("sol*") << true;
+    QTest::newRow("words with trailing *") << QString("sol* mar*") << true;
+    QTest::newRow("DICOM name components with trailing *") << QString("SOL*^MAR*") << true;
+    QTest::newRow("only one word with trailing *") << QString("sol* mar") << false;
+    QTest::newRow("leading *") << QString("*sol*") << false;
+    QTest::newRow("* in the middle of a word") << QString("so*l*") << false;
+    QTest::newRow("?") << QString("so?*") << false;
+    QTest::newRow("only wildcards") << QString("**") << false;
+    QTest::newRow("only separators") << QString(" ^ ") << false;
+    QTest::newRow("empty") << QString("") << false;
+}
+
+void test_LocalDatabaseStudyDAL::canUseFullTextSearch_ShouldReturnExpectedValue()
+{
+    QFETCH(QString, value);
+    QFETCH(bool, expectedValue);
+
+    QCOMPARE(LocalDatabaseStudyDAL::canUseFullTextSearch(value), expectedValue);
+}
+
+void test_LocalDatabaseStudyDAL::getFullTextQuery_ShouldReturnExpectedQuery_data()
+{
+    QTest::addColumn<QString>("value");
+    QTest::addColumn<QString>("expectedQuery");
+
+    QTest::newRow("one word") << QString("sol*") << QString("sol*");
+    QTest::newRow("two words") << QString("sol* mar*") << QString("sol* mar*");
+    QTest::newRow("DICOM name components") << QString("SOLER*^MARIA*") << QString("SOLER* MARIA*");
+    QTest::newRow("repeated separators") << QString("  sol*^^ mar* ") << QString("sol* mar*");
+    QTest::newRow("FTS operators are dropped") << QString("sol* -mar* \"pui*\"") << QString("sol* mar* pui*");
+    QTest::newRow("empty") << QString("") << QString("");
+}
+
+void test_LocalDatabaseStudyDAL::getFullTextQuery_ShouldReturnExpectedQuery()
+{
+    QFETCH(QString, value);
+    QFETCH(QString, expectedQuery);
+
+    QCOMPARE(LocalDatabaseStudyDAL::getFullTextQuery(value), expectedQuery);
+}
+
+void test_LocalDatabaseStudyDAL::getContainsLikePattern_ShouldReturnExpectedPattern_data()
+{
+    QTest::addColumn<QString>("value");
+    QTest::addColumn<QString>("expectedPattern");
+
+    QTest::newRow("plain value") << QString("sol") << QString("%sol%");
+    QTest::newRow("*") << QString("so*er") << QString("%so%er%");
+    QTest::newRow("?") << QString("so?er") << QString("%so_er%");
+    QTest::newRow("trailing *") << QString("123*") << QString("%123%%");
+    QTest::newRow("%") << QString("10%") << QString("%10\\%%");
+    QTest::newRow("_") << QString("A_1") << QString("%A\\_1%");
+    QTest::newRow("\\") << QString("A\\1") << QString("%A\\\\1%");
+}
+
+void test_LocalDatabaseStudyDAL::getContainsLikePattern_ShouldReturnExpectedPattern()
+{
+    QFETCH(QString, value);
+    QFETCH(QString, expectedPattern);
+
+    QCOMPARE(LocalDatabaseStudyDAL::getContainsLikePattern(value), expectedPattern);
+}
+
+void test_LocalDatabaseStudyDAL::isStartsWithMask_ShouldReturnExpectedValue_data()
+{
+    QTest::addColumn<QString>("value");
+    QTest::addColumn<bool>("expectedValue");
+
+    QTest::newRow("trailing *") << QString("123*") << true;
+    QTest::newRow("trailing * with LIKE wildcards") << QString("1_2%*") << true;
+    QTest::newRow("without wildcard") << QString("123") << false;
+    QTest::newRow("leading *") << QString("*123") << false;
+    QTest::newRow("leading and trailing *") << QString("*123*") << false;
+    QTest::newRow("* in the middle") << QString("1*3*") << false;
+    QTest::newRow("?") << QString("1?3*") << false;
+    QTest::newRow("only *") << QString("*") << false;
+    QTest::newRow("empty") << QString("") << false;
+}
+
+void test_LocalDatabaseStudyDAL::isStartsWithMask_ShouldReturnExpectedValue()
+{
+    QFETCH(QString, value);
+    QFETCH(bool, expectedValue);
+
+    QCOMPARE(LocalDatabaseStudyDAL::isStartsWithMask(value), expectedValue);
+}
+
+void test_LocalDatabaseStudyDAL::getStartsWithLikePattern_ShouldReturnExpectedPattern_data()
+{
+    QTest::addColumn<QString>("value");
+    QTest::addColumn<QString>("expectedPattern");
+
+    QTest::newRow("prefix") << QString("123*") << QString("123%");
+    QTest::newRow("%") << QString("10%*") << QString("10\\%%");
+    QTest::newRow("_") << QString("A_1*") << QString("A\\_1%");
+    QTest::newRow("\\") << QString("A\\1*") << QString("A\\\\1%");
+}
+
+void test_LocalDatabaseStudyDAL::getStartsWithLikePattern_ShouldReturnExpectedPattern()
+{
+    QFETCH(QString, value);
+    QFETCH(QString, expectedPattern);
+
+    QCOMPARE(LocalDatabaseStudyDAL::getStartsWithLikePattern(value), expectedPattern);
+}
+
+void test_LocalDatabaseStudyDAL::queryLeastValuable_ShouldReturnTheLeastRecentlyAccessedAndBiggestStudiesFirst_data()
+{
+    QTest::addColumn<QDate>("accessedBefore");
+    QTest::addColumn<int>("maximumNumberOfStudies");
+    QTest::addColumn<StudySizeList>("expectedStudies");
+
+    // Studies with an unknown size come after the rest of studies accessed the same day
+    StudySizeList allStudies;
+    allStudies << qMakePair(QString("1.1"), Q_INT64_C(100)) << qMakePair(QString("1.3"), Q_INT64_C(500)) << qMakePair(QString("1.2"), Q_INT64_C(300))
+               << qMakePair(QString("1.4"), Q_INT64_C(-1)) << qMakePair(QString("1.5"), Q_INT64_C(200));
+
+    QTest::newRow("all studies") << QDate() << 10 << allStudies;
+    QTest::newRow("maximum number of studies") << QDate() << 2 << allStudies.mid(0, 2);
+    QTest::newRow("accessed before a date") << QDate(2020, 1, 3) << 10 << allStudies.mid(0, 4);
+    QTest::newRow("accessed before a date and maximum number of studies") << QDate(2020, 1, 3) << 3 << allStudies.mid(0, 3);
+    QTest::newRow("none accessed before the date") << QDate(2020, 1, 1) << 10 << StudySizeList();
+}
+
+void test_LocalDatabaseStudyDAL::queryLeastValuable_ShouldReturnTheLeastRecentlyAccessedAndBiggestStudiesFirst()
+{
+    QFETCH(QDate, accessedBefore);
+    QFETCH(int, maximumNumberOfStudies);
+    QFETCH(StudySizeList, expectedStudies);
+
+    DatabaseConnection *databaseConnection = DatabaseTestHelper::getCreatedDatabase();
+    LocalDatabaseStudyDAL studyDAL(*databaseConnection);
+    QList<Patient*> patients;
+
+    // Inserted in a different order than the expected one, so that the insertion order doesn't matter
+    QList<QPair<QString, QDate> > studies;
+    studies << qMakePair(QString("1.5"), QDate(2020, 1, 3)) << qMakePair(QString("1.2"), QDate(2020, 1, 2))
+            << qMakePair(QString("1.4"), QDate(2020, 1, 2)) << qMakePair(QString("1.1"), QDate(2020, 1, 1)) << qMakePair(QString("1.3"), QDate(2020, 1, 2));
+    QHash<QString, qint64> sizes;
+    sizes["1.1"] = 100;
+    sizes["1.2"] = 300;
+    sizes["1.3"] = 500;
+    sizes["1.5"] = 200;
+
+    for (int i = 0; i < studies.size(); i++)
+    {
+        QString studyInstanceUID = studies.at(i).first;
+        Patient *patient = DatabaseTestHelper::createPatientWithStudy(studyInstanceUID, 1, 1);
+        patients << patient;
+        QVERIFY(DatabaseTestHelper::insertStudy(*databaseConnection, patient->getStudies().first(), studies.at(i).second));
+
+        if (sizes.contains(studyInstanceUID))
+        {
+            QVERIFY(studyDAL.updateSizeInBytes(studyInstanceUID, sizes.value(studyInstanceUID)));
+        }
+    }
+
+    QCOMPARE(studyDAL.queryLeastValuable(accessedBefore, maximumNumberOfStudies), expectedStudies);
+    QVERIFY(!studyDAL.getLastError().isValid());
+
+    qDeleteAll(patients);
+    delete databaseConnection;
+}
+
+DECLARE_TEST(test_LocalDatabaseStudyDAL)
+
+#include "test_localdatabasestudydal.moc"
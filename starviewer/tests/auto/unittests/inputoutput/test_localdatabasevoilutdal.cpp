@@ -0,0 +1,139 @@
+#include "autotest.h"
+#include "localdatabasevoilutdal.h"
+
+#include "databaseconnection.h"
+#include "databasetesthelper.h"
+#include "dicommask.h"
+#include "image.h"
+#include "patient.h"
+#include "series.h"
+#include "study.h"
+#include "voilut.h"
+
+using namespace udg;
+using namespace testing;
+
+class test_LocalDatabaseVoiLutDAL : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void queryGroupedByImage_ShouldReturnTheSameVoiLutsAsQueryingEachImage_data();
+    void queryGroupedByImage_ShouldReturnTheSameVoiLutsAsQueryingEachImage();
+
+private:
+    DatabaseConnection *m_databaseConnection;
+    QList<Patient*> m_patients;
+};
+
+void test_LocalDatabaseVoiLutDAL::init()
+{
+    m_databaseConnection = DatabaseTestHelper::getCreatedDatabase();
+    m_patients << DatabaseTestHelper::createPatientWithStudy("1.1", 2, 3) << DatabaseTestHelper::createPatientWithStudy("1.2", 1, 2);
+
+    // A second frame of the first image, so that images are told apart by frame number too
+    Series *firstSeries = m_patients.first()->getStudies().first()->getSeries().first();
+    Image *secondFrame = new Image();
+    secondFrame->setSOPInstanceUID(firstSeries->getImages().first()->getSOPInstanceUID());
+    secondFrame->setFrameNumber(1);
+    firstSeries->addImage(secondFrame);
+
+    LocalDatabaseVoiLutDAL voiLutDAL(*m_databaseConnection);
+    int imageIndex = 0;
+
+    foreach (Patient *patient, m_patients)
+    {
+        Study *study = patient->getStudies().first();
+        QVERIFY(DatabaseTestHelper::insertStudy(*m_databaseConnection, study));
+
+        foreach (Series *series, study->getSeries())
+        {
+            foreach (Image *image, series->getImages())
+            {
+                // 0, 1 or 2 different VOI LUTs per image
+                for (int i = 0; i < imageIndex % 3; i++)
+                {
+                    TransferFunction lut;
+                    lut.set(imageIndex, Qt::black, 0.0);
+                    lut.set(imageIndex + 100 * (i + 1), Qt::white, 1.0);
+                    QVERIFY(voiLutDAL.insert(VoiLut(lut), image));
+                }
+
+                imageIndex++;
+            }
+        }
+    }
+}
+
+void test_LocalDatabaseVoiLutDAL::cleanup()
+{
+    qDeleteAll(m_patients);
+    m_patients.clear();
+    delete m_databaseConnection;
+}
+
+void test_LocalDatabaseVoiLutDAL::queryGroupedByImage_ShouldReturnTheSameVoiLutsAsQueryingEachImage_data()
+{
+    QTest::addColumn<QString>("studyInstanceUID");
+    QTest::addColumn<QString>("seriesInstanceUID");
+
+    QTest::newRow("study with a multiframe image") << QString("1.1") << QString();
+    QTest::newRow("series with a multiframe image") << QString("1.1") << QString("1.1.1");
+    QTest::newRow("series") << QString("1.1") << QString("1.1.2");
+    QTest::newRow("another study") << QString("1.2") << QString();
+}
+
+void test_LocalDatabaseVoiLutDAL::queryGroupedByImage_ShouldReturnTheSameVoiLutsAsQueryingEachImage()
+{
+    QFETCH(QString, studyInstanceUID);
+    QFETCH(QString, seriesInstanceUID);
+
+    DicomMask mask;
+    mask.setStudyInstanceUID(studyInstanceUID);
+    mask.setSeriesInstanceUID(seriesInstanceUID);
+
+    LocalDatabaseVoiLutDAL voiLutDAL(*m_databaseConnection);
+    QHash<LocalDatabaseBaseDAL::ImageKey, QList<VoiLut> > voiLutsByImage = voiLutDAL.queryGroupedByImage(mask);
+    QVERIFY(!voiLutDAL.getLastError().isValid());
+
+    int numberOfImagesWithVoiLuts = 0;
+
+    foreach (Patient *patient, m_patients)
+    {
+        foreach (Series *series, patient->getStudies().first()->getSeries())
+        {
+            if (series->getParentStudy()->getInstanceUID() != studyInstanceUID ||
+                (!seriesInstanceUID.isEmpty() && series->getInstanceUID() != seriesInstanceUID))
+            {
+                continue;
+            }
+
+            foreach (Image *image, series->getImages())
+            {
+                // The query that was done for each image before
+                DicomMask imageMask;
+                imageMask.setSOPInstanceUID(image->getSOPInstanceUID());
+                imageMask.setImageNumber(QString::number(image->getFrameNumber()));
+                QList<VoiLut> expectedVoiLuts = voiLutDAL.query(imageMask);
+
+                LocalDatabaseBaseDAL::ImageKey imageKey(image->getSOPInstanceUID(), image->getFrameNumber());
+                QVERIFY(voiLutsByImage.value(imageKey) == expectedVoiLuts);
+
+                if (!expectedVoiLuts.isEmpty())
+                {
+                    numberOfImagesWithVoiLuts++;
+                }
+            }
+        }
+    }
+
+    // No VOI LUTs of images outside the mask
+    QCOMPARE(voiLutsByImage.size(), numberOfImagesWithVoiLuts);
+}
+
+DECLARE_TEST(test_LocalDatabaseVoiLutDAL)
+
+#include "test_localdatabasevoilutdal.moc"
@@ -0,0 +1,349 @@
+#include "autotest.h"
+#include "retrievedicomfilesfrompacs.h"
+
+#include "dicomdictionary.h"
+#include "dicomtagreader.h"
+#include "inputoutputsettings.h"
+#include "pacsdevice.h"
+#include "settings.h"
+
+#include <QDir>
+#include <QFile>
+#include <QMutex>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <dcdeftag.h>
+#include <dcfilefo.h>
+#include <dcuid.h>
+
+using namespace udg;
+
+namespace {
+
+// Ports used by the test PACS and by the incoming DICOM connections of the retrieves
+const int PACSPort = 11113;
+const int IncomingDICOMConnectionsPort = 11114;
+const char *LocalAETitle = "STARVIEWERTEST";
+const int NumberOfFilesPerStudy = 30;
+
+// Files received by a retrieve
+struct RetrievedFiles
+{
+    RetrievedFiles() : numberOfFiles(0)
+    {
+    }
+
+    QMutex mutex;
+    int numberOfFiles;
+    QStringList studyInstanceUIDs;
+};
+
+}
+
+/// These tests retrieve studies from a dcmqrscp launched by the test, so they are skipped if the DCMTK tools are not in the path.
+class test_RetrieveDICOMFilesFromPACS : public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void retrieve_AtTheSameTime_ShouldGiveEachFileToTheRetrieveThatRequestedIt_data();
+    void retrieve_AtTheSameTime_ShouldGiveEachFileToTheRetrieveThatRequestedIt();
+
+    void requestCancel_WhileAnotherRetrieveIsExecuted_ShouldOnlyCancelThatRetrieve_data();
+    void requestCancel_WhileAnotherRetrieveIsExecuted_ShouldOnlyCancelThatRetrieve();
+
+private:
+    /// Starts dcmqrscp with the AE titles PACS_A and PACS_B and stores on each one the given studies. Returns false if it can't be started.
+    bool startPACS(const QStringList &studiesOfPACSA, const QStringList &studiesOfPACSB);
+    /// Creates the files of a study in the given directory and returns their paths
+    QStringList createStudy(const QString &directoryPath, const QString &studyInstanceUID);
+    /// Returns a device for the test PACS with the given AE title
+    PacsDevice getPACS(const QString &aeTitle);
+    /// Executes both retrieves at the same time, recording their files. If cancelFirstRetrieve is true the first retrieve is cancelled when it receives its
+    /// first file.
+    void retrieveAtTheSameTime(const QString &firstPACS, const QString &firstStudy, const QString &secondPACS, const QString &secondStudy,
+                               bool cancelFirstRetrieve, PACSRequestStatus::RetrieveRequestStatus &firstStatus, RetrievedFiles &firstFiles,
+                               PACSRequestStatus::RetrieveRequestStatus &secondStatus, RetrievedFiles &secondFiles);
+
+private:
+    QTemporaryDir *m_directory;
+    QProcess *m_pacsProcess;
+    QHash<QString, QVariant> m_originalSettings;
+};
+
+Q_DECLARE_METATYPE(PACSRequestStatus::RetrieveRequestStatus)
+
+void test_RetrieveDICOMFilesFromPACS::init()
+{
+    if (QStandardPaths::findExecutable("dcmqrscp").isEmpty() || QStandardPaths::findExecutable("storescu").isEmpty())
+    {
+        QSKIP("dcmqrscp and storescu are needed to execute a test PACS");
+    }
+
+    m_directory = new QTemporaryDir();
+    m_pacsProcess = new QProcess();
+
+    Settings settings;
+    QStringList keys;
+    keys << InputOutputSettings::LocalAETitle << InputOutputSettings::IncomingDICOMConnectionsPort << InputOutputSettings::CachePath;
+    foreach (const QString &key, keys)
+    {
+        m_originalSettings.insert(key, settings.getValue(key));
+    }
+
+    settings.setValue(InputOutputSettings::LocalAETitle, LocalAETitle);
+    settings.setValue(InputOutputSettings::IncomingDICOMConnectionsPort, IncomingDICOMConnectionsPort);
+    QDir().mkpath(m_directory->path() + "/cache");
+    settings.setValue(InputOutputSettings::CachePath, m_directory->path() + "/cache/");
+}
+
+void test_RetrieveDICOMFilesFromPACS::cleanup()
+{
+    if (m_originalSettings.isEmpty())
+    {
+        return;
+    }
+
+    m_pacsProcess->kill();
+    m_pacsProcess->waitForFinished();
+    delete m_pacsProcess;
+    delete m_directory;
+
+    Settings settings;
+    foreach (const QString &key, m_originalSettings.keys())
+    {
+        settings.setValue(key, m_originalSettings.value(key));
+    }
+    m_originalSettings.clear();
+}
+
+void test_RetrieveDICOMFilesFromPACS::retrieve_AtTheSameTime_ShouldGiveEachFileToTheRetrieveThatRequestedIt_data()
+{
+    QTest::addColumn<QString>("secondPACS");
+
+    // With different PACS the associations are told apart by the calling AE title, with the same PACS by the Move Originator Message ID
+    QTest::newRow("different PACS") << "PACS_B";
+    QTest::newRow("same PACS") << "PACS_A";
+}
+
+void test_RetrieveDICOMFilesFromPACS::retrieve_AtTheSameTime_ShouldGiveEachFileToTheRetrieveThatRequestedIt()
+{
+    QFETCH(QString, secondPACS);
+
+    const QString FirstStudy = "1.2.826.0.1.3680043.2.1125.1";
+    const QString SecondStudy = "1.2.826.0.1.3680043.2.1125.2";
+
+    QVERIFY(secondPACS == "PACS_A" ? startPACS(QStringList() << FirstStudy << SecondStudy, QStringList())
+                                   : startPACS(QStringList() << FirstStudy, QStringList() << SecondStudy));
+
+    PACSRequestStatus::RetrieveRequestStatus firstStatus, secondStatus;
+    RetrievedFiles firstFiles, secondFiles;
+    retrieveAtTheSameTime("PACS_A", FirstStudy, secondPACS, SecondStudy, false, firstStatus, firstFiles, secondStatus, secondFiles);
+
+    QCOMPARE(firstStatus, PACSRequestStatus::RetrieveOk);
+    QCOMPARE(secondStatus, PACSRequestStatus::RetrieveOk);
+    QCOMPARE(firstFiles.numberOfFiles, NumberOfFilesPerStudy);
+    QCOMPARE(secondFiles.numberOfFiles, NumberOfFilesPerStudy);
+    QCOMPARE(firstFiles.studyInstanceUIDs.toSet(), QSet<QString>() << FirstStudy);
+    QCOMPARE(secondFiles.studyInstanceUIDs.toSet(), QSet<QString>() << SecondStudy);
+}
+
+void test_RetrieveDICOMFilesFromPACS::requestCancel_WhileAnotherRetrieveIsExecuted_ShouldOnlyCancelThatRetrieve_data()
+{
+    retrieve_AtTheSameTime_ShouldGiveEachFileToTheRetrieveThatRequestedIt_data();
+}
+
+void test_RetrieveDICOMFilesFromPACS::requestCancel_WhileAnotherRetrieveIsExecuted_ShouldOnlyCancelThatRetrieve()
+{
+    QFETCH(QString, secondPACS);
+
+    const QString FirstStudy = "1.2.826.0.1.3680043.2.1125.1";
+    const QString SecondStudy = "1.2.826.0.1.3680043.2.1125.2";
+
+    QVERIFY(secondPACS == "PACS_A" ? startPACS(QStringList() << FirstStudy << SecondStudy, QStringList())
+                                   : startPACS(QStringList() << FirstStudy, QStringList() << SecondStudy));
+
+    PACSRequestStatus::RetrieveRequestStatus firstStatus, secondStatus;
+    RetrievedFiles firstFiles, secondFiles;
+    retrieveAtTheSameTime("PACS_A", FirstStudy, secondPACS, SecondStudy, true, firstStatus, firstFiles, secondStatus, secondFiles);
+
+    QCOMPARE(firstStatus, PACSRequestStatus::RetrieveCancelled);
+    QVERIFY(firstFiles.numberOfFiles < NumberOfFilesPerStudy);
+    QCOMPARE(secondStatus, PACSRequestStatus::RetrieveOk);
+    QCOMPARE(secondFiles.numberOfFiles, NumberOfFilesPerStudy);
+    QCOMPARE(secondFiles.studyInstanceUIDs.toSet(), QSet<QString>() << SecondStudy);
+}
+
+bool test_RetrieveDICOMFilesFromPACS::startPACS(const QStringList &studiesOfPACSA, const QStringList &studiesOfPACSB)
+{
+    QString path = m_directory->path();
+    QDir().mkpath(path + "/PACS_A");
+    QDir().mkpath(path + "/PACS_B");
+
+    QFile configuration(path + "/dcmqrscp.cfg");
+    if (!configuration.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        return false;
+    }
+
+    QTextStream stream(&configuration);
+    stream << "NetworkTCPPort = " << PACSPort << "\n"
+           << "MaxPDUSize = 16384\n"
+           << "MaxAssociations = 16\n"
+           << "HostTable BEGIN\n"
+           << "starviewer = (" << LocalAETitle << ", localhost, " << IncomingDICOMConnectionsPort << ")\n"
+           << "HostTable END\n"
+           << "VendorTable BEGIN\n"
+           << "VendorTable END\n"
+           << "AETable BEGIN\n"
+           << "PACS_A " << path << "/PACS_A RW (200, 1024mb) ANY\n"
+           << "PACS_B " << path << "/PACS_B RW (200, 1024mb) ANY\n"
+           << "AETable END\n";
+    configuration.close();
+
+    m_pacsProcess->start("dcmqrscp", QStringList() << "-c" << configuration.fileName());
+
+    // Waits until it accepts connections
+    bool isListening = false;
+    for (int i = 0; i < 50 && !isListening; i++)
+    {
+        QTcpSocket socket;
+        socket.connectToHost("localhost", PACSPort);
+        isListening = socket.waitForConnected(100);
+        if (!isListening)
+        {
+            QThread::msleep(100);
+        }
+    }
+
+    if (!isListening)
+    {
+        return false;
+    }
+
+    QHash<QString, QStringList> studiesOfPACS;
+    studiesOfPACS.insert("PACS_A", studiesOfPACSA);
+    studiesOfPACS.insert("PACS_B", studiesOfPACSB);
+
+    foreach (const QString &aeTitle, studiesOfPACS.keys())
+    {
+        foreach (const QString &studyInstanceUID, studiesOfPACS.value(aeTitle))
+        {
+            QStringList arguments;
+            arguments << "-aec" << aeTitle << "localhost" << QString::number(PACSPort) << createStudy(path, studyInstanceUID);
+
+            if (QProcess::execute("storescu", arguments) != 0)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+QStringList test_RetrieveDICOMFilesFromPACS::createStudy(const QString &directoryPath, const QString &studyInstanceUID)
+{
+    // Big enough to make the transfers of both retrieves overlap
+    const Uint16 Rows = 512;
+    const Uint16 Columns = 512;
+    QStringList paths;
+
+    for (int instanceNumber = 1; instanceNumber <= NumberOfFilesPerStudy; instanceNumber++)
+    {
+        DcmFileFormat fileFormat;
+        DcmDataset *dataset = fileFormat.getDataset();
+        QString seriesInstanceUID = studyInstanceUID + ".1";
+        QString sopInstanceUID = QString("%1.%2").arg(seriesInstanceUID).arg(instanceNumber);
+
+        dataset->putAndInsertString(DCM_SOPClassUID, UID_CTImageStorage);
+        dataset->putAndInsertString(DCM_SOPInstanceUID, qPrintable(sopInstanceUID));
+        dataset->putAndInsertString(DCM_PatientID, "PATIENT1");
+        dataset->putAndInsertString(DCM_PatientName, "DOE^JOHN");
+        dataset->putAndInsertString(DCM_StudyInstanceUID, qPrintable(studyInstanceUID));
+        dataset->putAndInsertString(DCM_StudyID, "1");
+        dataset->putAndInsertString(DCM_StudyDate, "20160101");
+        dataset->putAndInsertString(DCM_SeriesInstanceUID, qPrintable(seriesInstanceUID));
+        dataset->putAndInsertString(DCM_SeriesNumber, "1");
+        dataset->putAndInsertString(DCM_Modality, "CT");
+        dataset->putAndInsertString(DCM_InstanceNumber, qPrintable(QString::number(instanceNumber)));
+        dataset->putAndInsertUint16(DCM_SamplesPerPixel, 1);
+        dataset->putAndInsertString(DCM_PhotometricInterpretation, "MONOCHROME2");
+        dataset->putAndInsertUint16(DCM_Rows, Rows);
+        dataset->putAndInsertUint16(DCM_Columns, Columns);
+        dataset->putAndInsertUint16(DCM_BitsAllocated, 16);
+        dataset->putAndInsertUint16(DCM_BitsStored, 16);
+        dataset->putAndInsertUint16(DCM_HighBit, 15);
+        dataset->putAndInsertUint16(DCM_PixelRepresentation, 0);
+
+        QVector<Uint16> pixels(Rows * Columns, instanceNumber);
+        dataset->putAndInsertUint16Array(DCM_PixelData, pixels.data(), pixels.size());
+
+        QString path = QString("%1/%2.dcm").arg(directoryPath).arg(sopInstanceUID);
+        fileFormat.saveFile(qPrintable(path), EXS_LittleEndianExplicit);
+        paths << path;
+    }
+
+    return paths;
+}
+
+PacsDevice test_RetrieveDICOMFilesFromPACS::getPACS(const QString &aeTitle)
+{
+    PacsDevice pacs;
+    pacs.setAETitle(aeTitle);
+    pacs.setAddress("localhost");
+    pacs.setQueryRetrieveServiceEnabled(true);
+    pacs.setQueryRetrieveServicePort(PACSPort);
+
+    return pacs;
+}
+
+void test_RetrieveDICOMFilesFromPACS::retrieveAtTheSameTime(const QString &firstPACS, const QString &firstStudy, const QString &secondPACS,
+                                                            const QString &secondStudy, bool cancelFirstRetrieve,
+                                                            PACSRequestStatus::RetrieveRequestStatus &firstStatus, RetrievedFiles &firstFiles,
+                                                            PACSRequestStatus::RetrieveRequestStatus &secondStatus, RetrievedFiles &secondFiles)
+{
+    RetrieveDICOMFilesFromPACS firstRetrieve(getPACS(firstPACS));
+    RetrieveDICOMFilesFromPACS secondRetrieve(getPACS(secondPACS));
+
+    auto record = [](RetrievedFiles &files, DICOMTagReader *dicomTagReader)
+    {
+        QMutexLocker locker(&files.mutex);
+        files.numberOfFiles++;
+        files.studyInstanceUIDs << dicomTagReader->getValueAttributeAsQString(DICOMStudyInstanceUID);
+        delete dicomTagReader;
+    };
+
+    // Without a receiver object the lambdas are called directly from the threads that write the files
+    connect(&firstRetrieve, &RetrieveDICOMFilesFromPACS::DICOMFileRetrieved, [&](DICOMTagReader *dicomTagReader, int numberOfImagesRetrieved)
+    {
+        record(firstFiles, dicomTagReader);
+
+        if (cancelFirstRetrieve && numberOfImagesRetrieved == 1)
+        {
+            firstRetrieve.requestCancel();
+        }
+    });
+    connect(&secondRetrieve, &RetrieveDICOMFilesFromPACS::DICOMFileRetrieved, [&](DICOMTagReader *dicomTagReader, int)
+    {
+        record(secondFiles, dicomTagReader);
+    });
+
+    QFuture<PACSRequestStatus::RetrieveRequestStatus> firstResult = QtConcurrent::run([&]() { return firstRetrieve.retrieve(firstStudy); });
+    QFuture<PACSRequestStatus::RetrieveRequestStatus> secondResult = QtConcurrent::run([&]() { return secondRetrieve.retrieve(secondStudy); });
+
+    firstStatus = firstResult.result();
+    secondStatus = secondResult.result();
+}
+
+DECLARE_TEST(test_RetrieveDICOMFilesFromPACS)
+
+#include "test_retrievedicomfilesfrompacs.moc"
@@ -0,0 +1,79 @@
+#include "autotest.h"
+#include "retrievedicomfilesfrompacsqueuepolicy.h"
+
+#include "pacsdevicetesthelper.h"
+#include "patient.h"
+#include "retrievedicomfilesfrompacsjob.h"
+#include "study.h"
+#include "studytesthelper.h"
+
+using namespace udg;
+using namespace testing;
+
+class test_RetrieveDICOMFilesFromPACSQueuePolicy : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void canRun_ShouldLimitConcurrentRetrievesFromTheSamePACS();
+    void canRun_ShouldNotRetrieveTheSameStudyTwiceAtTheSameTime();
+
+private:
+    /// Returns a job that retrieves the study with the given UID from the given PACS
+    PACSJobPointer createRetrieveJob(const PacsDevice &pacsDevice, const QString &studyInstanceUID);
+
+private:
+    Patient m_patient;
+
+};
+
+void test_RetrieveDICOMFilesFromPACSQueuePolicy::canRun_ShouldLimitConcurrentRetrievesFromTheSamePACS()
+{
+    PacsDevice pacsA = PACSDeviceTestHelper::createPACSDeviceByID("A");
+    PacsDevice pacsB = PACSDeviceTestHelper::createPACSDeviceByID("B");
+    PACSJobPointer study1FromA = createRetrieveJob(pacsA, "1");
+    PACSJobPointer study2FromA = createRetrieveJob(pacsA, "2");
+    PACSJobPointer study3FromA = createRetrieveJob(pacsA, "3");
+    PACSJobPointer study4FromB = createRetrieveJob(pacsB, "4");
+
+    RetrieveDICOMFilesFromPACSQueuePolicy policy(2);
+
+    QVERIFY(policy.canRun(study1FromA));
+    QVERIFY(policy.canRun(study2FromA));
+    QVERIFY(!policy.canRun(study3FromA));
+    QVERIFY(policy.canRun(study4FromB));
+    QCOMPARE(policy.getNumberOfRetrievesRunning(pacsA), 2);
+    QCOMPARE(policy.getNumberOfRetrievesRunning(pacsB), 1);
+
+    policy.free(study1FromA);
+    QVERIFY(policy.canRun(study3FromA));
+
+    policy.release(study2FromA);
+    QCOMPARE(policy.getNumberOfRetrievesRunning(pacsA), 1);
+}
+
+void test_RetrieveDICOMFilesFromPACSQueuePolicy::canRun_ShouldNotRetrieveTheSameStudyTwiceAtTheSameTime()
+{
+    PACSJobPointer study1FromA = createRetrieveJob(PACSDeviceTestHelper::createPACSDeviceByID("A"), "1");
+    PACSJobPointer study1FromB = createRetrieveJob(PACSDeviceTestHelper::createPACSDeviceByID("B"), "1");
+
+    RetrieveDICOMFilesFromPACSQueuePolicy policy(1);
+
+    QVERIFY(policy.canRun(study1FromA));
+    QVERIFY(!policy.canRun(study1FromB));
+
+    policy.free(study1FromA);
+    QVERIFY(policy.canRun(study1FromB));
+}
+
+PACSJobPointer test_RetrieveDICOMFilesFromPACSQueuePolicy::createRetrieveJob(const PacsDevice &pacsDevice, const QString &studyInstanceUID)
+{
+    Study *study = StudyTestHelper::createStudyByUID(studyInstanceUID);
+    m_patient.addStudy(study);
+
+    return PACSJobPointer(new RetrieveDICOMFilesFromPACSJob(pacsDevice, RetrieveDICOMFilesFromPACSJob::Medium, study));
+}
+
+DECLARE_TEST(test_RetrieveDICOMFilesFromPACSQueuePolicy)
+
+#include "test_retrievedicomfilesfrompacsqueuepolicy.moc"
@@ -0,0 +1,183 @@
+#include "autotest.h"
+#include "thumbnailcache.h"
+
+#include <QDir>
+#include <QImage>
+#include <QTemporaryDir>
+
+using namespace udg;
+
+class test_ThumbnailCache : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void getThumbnail_ShouldReturnStoredThumbnail();
+    void getThumbnail_ShouldReturnNullImageIfNotStored();
+    void removeStudy_ShouldRemoveOnlyThumbnailsOfThatStudy();
+    void removeThumbnails_ShouldRemoveOnlyTheGivenThumbnails();
+    void enforceMaximumSize_ShouldKeepTrackOfTheSizeBetweenCalls();
+    void enforceMaximumSize_ShouldRemoveStudiesUntilItFitsKeepingTheGivenStudy();
+
+private:
+    /// Returns a thumbnail filled with noise, so that it doesn't compress too much, with the given seed.
+    QImage createThumbnail(int seed);
+
+};
+
+void test_ThumbnailCache::getThumbnail_ShouldReturnStoredThumbnail()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    ThumbnailCache thumbnailCache(directory.path(), 1024 * 1024);
+    QImage thumbnail = createThumbnail(1);
+
+    QVERIFY(!thumbnailCache.contains("1.2.3", "1.2.3.4.1"));
+    QVERIFY(thumbnailCache.storeThumbnail("1.2.3", "1.2.3.4.1", thumbnail));
+    QVERIFY(thumbnailCache.contains("1.2.3", "1.2.3.4.1"));
+    QCOMPARE(thumbnailCache.getThumbnail("1.2.3", "1.2.3.4.1").convertToFormat(thumbnail.format()), thumbnail);
+
+    // Another instance on the same directory must see it too
+    QVERIFY(ThumbnailCache(directory.path(), 1024 * 1024).contains("1.2.3", "1.2.3.4.1"));
+}
+
+void test_ThumbnailCache::getThumbnail_ShouldReturnNullImageIfNotStored()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    ThumbnailCache thumbnailCache(directory.path(), 1024 * 1024);
+    QVERIFY(thumbnailCache.storeThumbnail("1.2.3", "1.2.3.4.1", createThumbnail(1)));
+
+    QVERIFY(thumbnailCache.getThumbnail("1.2.3", "1.2.3.4.2").isNull());
+    QVERIFY(thumbnailCache.getThumbnail("1.2.4", "1.2.3.4.1").isNull());
+
+    thumbnailCache.removeThumbnail("1.2.3", "1.2.3.4.1");
+    QVERIFY(thumbnailCache.getThumbnail("1.2.3", "1.2.3.4.1").isNull());
+}
+
+void test_ThumbnailCache::removeStudy_ShouldRemoveOnlyThumbnailsOfThatStudy()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    ThumbnailCache thumbnailCache(directory.path(), 1024 * 1024);
+    QVERIFY(thumbnailCache.storeThumbnail("1.2.3", "1.2.3.4.1", createThumbnail(1)));
+    QVERIFY(thumbnailCache.storeThumbnail("1.2.3", "1.2.3.4.2", createThumbnail(2)));
+    QVERIFY(thumbnailCache.storeThumbnail("1.2.4", "1.2.4.4.1", createThumbnail(3)));
+
+    thumbnailCache.removeStudy("1.2.3");
+
+    QVERIFY(!thumbnailCache.contains("1.2.3", "1.2.3.4.1"));
+    QVERIFY(!thumbnailCache.contains("1.2.3", "1.2.3.4.2"));
+    QVERIFY(!QDir(directory.path() + "/1.2.3").exists());
+    QVERIFY(thumbnailCache.contains("1.2.4", "1.2.4.4.1"));
+}
+
+void test_ThumbnailCache::removeThumbnails_ShouldRemoveOnlyTheGivenThumbnails()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    ThumbnailCache thumbnailCache(directory.path(), 1024 * 1024);
+    QVERIFY(thumbnailCache.storeThumbnail("1.2.3", "1.2.3.4.1", createThumbnail(1)));
+    QVERIFY(thumbnailCache.storeThumbnail("1.2.3", "1.2.3.4.2", createThumbnail(2)));
+    QVERIFY(thumbnailCache.storeThumbnail("1.2.3", "1.2.3.4.3", createThumbnail(3)));
+
+    thumbnailCache.removeThumbnails("1.2.3", QStringList() << "1.2.3.4.1" << "1.2.3.4.3" << "1.2.3.4.4");
+
+    QVERIFY(!thumbnailCache.contains("1.2.3", "1.2.3.4.1"));
+    QVERIFY(thumbnailCache.contains("1.2.3", "1.2.3.4.2"));
+    QVERIFY(!thumbnailCache.contains("1.2.3", "1.2.3.4.3"));
+}
+
+void test_ThumbnailCache::enforceMaximumSize_ShouldKeepTrackOfTheSizeBetweenCalls()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    ThumbnailCache unboundedCache(directory.path(), 1024 * 1024 * 1024);
+    QVERIFY(unboundedCache.storeThumbnail("1", "1.1", createThumbnail(0)));
+    qint64 thumbnailSize = QFileInfo(unboundedCache.getThumbnailFilePath("1", "1.1")).size();
+    unboundedCache.removeStudy("1");
+
+    // Fits exactly two thumbnails
+    ThumbnailCache thumbnailCache(directory.path(), 2 * thumbnailSize + thumbnailSize / 2);
+
+    QVERIFY(thumbnailCache.storeThumbnail("1", "1.1", createThumbnail(0)));
+    thumbnailCache.enforceMaximumSize("1");
+    QVERIFY(thumbnailCache.storeThumbnail("2", "2.1", createThumbnail(0)));
+    thumbnailCache.enforceMaximumSize("2");
+
+    QVERIFY(thumbnailCache.contains("1", "1.1"));
+    QVERIFY(thumbnailCache.contains("2", "2.1"));
+
+    // Replacing a thumbnail doesn't increase the size
+    QVERIFY(thumbnailCache.storeThumbnail("2", "2.1", createThumbnail(0)));
+    thumbnailCache.enforceMaximumSize("2");
+
+    QVERIFY(thumbnailCache.contains("1", "1.1"));
+
+    QVERIFY(thumbnailCache.storeThumbnail("3", "3.1", createThumbnail(0)));
+    thumbnailCache.enforceMaximumSize("3");
+
+    QVERIFY(thumbnailCache.contains("3", "3.1"));
+    QCOMPARE(thumbnailCache.contains("1", "1.1") + thumbnailCache.contains("2", "2.1"), 1);
+}
+
+void test_ThumbnailCache::enforceMaximumSize_ShouldRemoveStudiesUntilItFitsKeepingTheGivenStudy()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    const int NumberOfStudies = 6;
+
+    // Measure the size of one thumbnail to set a maximum size that fits exactly two studies
+    ThumbnailCache unboundedCache(directory.path(), 1024 * 1024 * 1024);
+    QVERIFY(unboundedCache.storeThumbnail("1", "1.1", createThumbnail(0)));
+    qint64 thumbnailSize = QFileInfo(unboundedCache.getThumbnailFilePath("1", "1.1")).size();
+    unboundedCache.removeStudy("1");
+
+    ThumbnailCache thumbnailCache(directory.path(), 2 * thumbnailSize + thumbnailSize / 2);
+
+    for (int i = 0; i < NumberOfStudies; i++)
+    {
+        QVERIFY(thumbnailCache.storeThumbnail(QString::number(i), QString("%1.1").arg(i), createThumbnail(0)));
+    }
+
+    thumbnailCache.enforceMaximumSize("0");
+
+    int numberOfRemainingStudies = 0;
+
+    for (int i = 0; i < NumberOfStudies; i++)
+    {
+        if (thumbnailCache.contains(QString::number(i), QString("%1.1").arg(i)))
+        {
+            numberOfRemainingStudies++;
+        }
+    }
+
+    QVERIFY(thumbnailCache.contains("0", "0.1"));
+    QCOMPARE(numberOfRemainingStudies, 2);
+}
+
+QImage test_ThumbnailCache::createThumbnail(int seed)
+{
+    QImage thumbnail(96, 96, QImage::Format_RGB32);
+    qsrand(seed);
+
+    for (int y = 0; y < thumbnail.height(); y++)
+    {
+        for (int x = 0; x < thumbnail.width(); x++)
+        {
+            thumbnail.setPixel(x, y, qRgb(qrand() % 256, qrand() % 256, qrand() % 256));
+        }
+    }
+
+    return thumbnail;
+}
+
+DECLARE_TEST(test_ThumbnailCache)
+
+#include "test_thumbnailcache.moc"
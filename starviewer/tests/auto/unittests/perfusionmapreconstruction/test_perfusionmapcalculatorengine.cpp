@@ -0,0 +1,174 @@
+#include "autotest.h"
+#include "perfusionmapcalculatorengine.h"
+
+#include <cmath>
+
+using namespace udg;
+
+class test_PerfusionMapCalculatorEngine : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void computeDeltaRAndMoments_ShouldMarkVoxelsWithGoodSignalAsValid();
+
+    void computePerfusion_Benchmark();
+
+private:
+    typedef PerfusionMapCalculatorEngine::ImageType ImageType;
+    typedef PerfusionMapCalculatorEngine::BoolImageType BoolImageType;
+    typedef PerfusionMapCalculatorEngine::DoubleImageType DoubleImageType;
+    typedef PerfusionMapCalculatorEngine::DoubleTemporalImageType DoubleTemporalImageType;
+
+    /// Returns a DSC series with the given size, with the phases of each slice consecutive along z, where every voxel has a bolus passage after a noisy
+    /// baseline.
+    static ImageType::Pointer createDSCImage(int sizeX, int sizeY, int sizeZ, int sizeT);
+    /// Returns the value at phase t of a gamma variate curve that starts at phase 15.
+    static double bolus(int t);
+
+    template <class T>
+    static typename T::Pointer createImage(int sizeX, int sizeY, int sizeZ);
+    static DoubleTemporalImageType::Pointer createTemporalImage(int sizeX, int sizeY, int sizeZ, int sizeT);
+
+};
+
+void test_PerfusionMapCalculatorEngine::computeDeltaRAndMoments_ShouldMarkVoxelsWithGoodSignalAsValid()
+{
+    const int SizeX = 16, SizeY = 8, SizeZ = 2, SizeT = 30;
+
+    PerfusionMapCalculatorEngine engine;
+    engine.setDSCImage(createDSCImage(SizeX, SizeY, SizeZ, SizeT), SizeX, SizeY, SizeZ, SizeT);
+
+    BoolImageType::Pointer checkImage = createImage<BoolImageType>(SizeX, SizeY, SizeZ);
+    DoubleTemporalImageType::Pointer deltaRImage = createTemporalImage(SizeX, SizeY, SizeZ, SizeT);
+    DoubleImageType::Pointer m0Image = createImage<DoubleImageType>(SizeX, SizeY, SizeZ);
+    DoubleImageType::Pointer m1Image = createImage<DoubleImageType>(SizeX, SizeY, SizeZ);
+    DoubleImageType::Pointer m2Image = createImage<DoubleImageType>(SizeX, SizeY, SizeZ);
+    QVector<QVector<double> > meanDeltaRPerSlice;
+
+    QVERIFY(engine.computeDeltaRAndMoments(checkImage, deltaRImage, m0Image, m1Image, m2Image, meanDeltaRPerSlice));
+
+    const bool *check = checkImage->GetBufferPointer();
+    for (int i = 0; i < SizeX * SizeY * SizeZ; i++)
+    {
+        QVERIFY(check[i]);
+    }
+
+    QCOMPARE(meanDeltaRPerSlice.size(), SizeZ);
+    // ΔR grows with the concentration of the contrast
+    QVERIFY(meanDeltaRPerSlice.at(0).at(18) > meanDeltaRPerSlice.at(0).at(5));
+}
+
+void test_PerfusionMapCalculatorEngine::computePerfusion_Benchmark()
+{
+    // A typical DSC series
+    const int SizeX = 128, SizeY = 128, SizeZ = 20, SizeT = 60;
+
+    PerfusionMapCalculatorEngine engine;
+    engine.setDSCImage(createDSCImage(SizeX, SizeY, SizeZ, SizeT), SizeX, SizeY, SizeZ, SizeT);
+
+    BoolImageType::Pointer checkImage = createImage<BoolImageType>(SizeX, SizeY, SizeZ);
+    DoubleTemporalImageType::Pointer deltaRImage = createTemporalImage(SizeX, SizeY, SizeZ, SizeT);
+    DoubleImageType::Pointer m0Image = createImage<DoubleImageType>(SizeX, SizeY, SizeZ);
+    DoubleImageType::Pointer m1Image = createImage<DoubleImageType>(SizeX, SizeY, SizeZ);
+    DoubleImageType::Pointer m2Image = createImage<DoubleImageType>(SizeX, SizeY, SizeZ);
+    DoubleImageType::Pointer cbvImage = createImage<DoubleImageType>(SizeX, SizeY, SizeZ);
+    DoubleImageType::Pointer cbfImage = createImage<DoubleImageType>(SizeX, SizeY, SizeZ);
+    DoubleImageType::Pointer mttImage = createImage<DoubleImageType>(SizeX, SizeY, SizeZ);
+    ImageType::Pointer cbvMapImage = createImage<ImageType>(SizeX, SizeY, SizeZ);
+    ImageType::Pointer cbfMapImage = createImage<ImageType>(SizeX, SizeY, SizeZ);
+    ImageType::Pointer mttMapImage = createImage<ImageType>(SizeX, SizeY, SizeZ);
+    QVector<QVector<double> > meanDeltaRPerSlice;
+
+    QVector<double> aif(SizeT);
+    for (int t = 0; t < SizeT; t++)
+    {
+        aif[t] = 4.0 * bolus(t);
+    }
+    double m0Aif, m1Aif, m2Aif;
+    PerfusionMapCalculatorEngine::computeMoments(aif, m0Aif, m1Aif, m2Aif);
+
+    QBENCHMARK
+    {
+        QVERIFY(engine.computeDeltaRAndMoments(checkImage, deltaRImage, m0Image, m1Image, m2Image, meanDeltaRPerSlice));
+        QVERIFY(engine.setAIF(aif, m0Aif));
+        QVERIFY(engine.computePerfusion(checkImage, deltaRImage, m0Image, cbvImage, cbfImage, mttImage, cbvMapImage, cbfMapImage, mttMapImage));
+    }
+}
+
+test_PerfusionMapCalculatorEngine::ImageType::Pointer test_PerfusionMapCalculatorEngine::createDSCImage(int sizeX, int sizeY, int sizeZ, int sizeT)
+{
+    const double Baseline = 1000.0;
+
+    ImageType::Pointer image = createImage<ImageType>(sizeX, sizeY, sizeZ * sizeT);
+    ImageType::PixelType *data = image->GetBufferPointer();
+    qsrand(1);
+
+    for (int z = 0; z < sizeZ; z++)
+    {
+        for (int t = 0; t < sizeT; t++)
+        {
+            for (int i = 0; i < sizeX * sizeY; i++)
+            {
+                // The signal drops exponentially with the concentration of the contrast, and the noise keeps an SNR much higher than 10
+                double signal = Baseline * std::exp(-bolus(t)) + qrand() % 11 - 5;
+                *data++ = static_cast<ImageType::PixelType>(signal);
+            }
+        }
+    }
+
+    return image;
+}
+
+double test_PerfusionMapCalculatorEngine::bolus(int t)
+{
+    const int Arrival = 15;
+
+    if (t <= Arrival)
+    {
+        return 0.0;
+    }
+
+    double time = t - Arrival;
+    return 0.15 * time * time * time * std::exp(-time / 1.5);
+}
+
+template <class T>
+typename T::Pointer test_PerfusionMapCalculatorEngine::createImage(int sizeX, int sizeY, int sizeZ)
+{
+    typename T::IndexType start;
+    start.Fill(0);
+    typename T::SizeType size;
+    size[0] = sizeX;
+    size[1] = sizeY;
+    size[2] = sizeZ;
+
+    typename T::Pointer image = T::New();
+    image->SetRegions(typename T::RegionType(start, size));
+    image->Allocate();
+
+    return image;
+}
+
+test_PerfusionMapCalculatorEngine::DoubleTemporalImageType::Pointer test_PerfusionMapCalculatorEngine::createTemporalImage(int sizeX, int sizeY,
+                                                                                                                          int sizeZ, int sizeT)
+{
+    // As in the calculator, the phases of each voxel are together
+    DoubleTemporalImageType::IndexType start;
+    start.Fill(0);
+    DoubleTemporalImageType::SizeType size;
+    size[0] = sizeT;
+    size[1] = sizeX;
+    size[2] = sizeY;
+    size[3] = sizeZ;
+
+    DoubleTemporalImageType::Pointer image = DoubleTemporalImageType::New();
+    image->SetRegions(DoubleTemporalImageType::RegionType(start, size));
+    image->Allocate();
+
+    return image;
+}
+
+DECLARE_TEST(test_PerfusionMapCalculatorEngine)
+
+#include "test_perfusionmapcalculatorengine.moc"
@@ -4,3 +4,5 @@ include(inputoutput/inputoutput.pri)
 include(interface/interface.pri)
 include(q2dviewer/q2dviewer.pri)
 include(q3dviewer/q3dviewer.pri)
+include(perfusionmapreconstruction/perfusionmapreconstruction.pri)
+include(experimental3d/experimental3d.pri)